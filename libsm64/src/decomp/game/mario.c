@@ -1353,6 +1353,11 @@ void update_mario_geometry_inputs(struct MarioState *m) {
     m->ceilHeight = vec3f_find_ceil(&m->pos[0], m->floorHeight, &m->ceil);
     gasLevel = find_poison_gas_level(m->pos[0], m->pos[2]);
     //m->waterLevel = find_water_level(m->pos[0], m->pos[2]);
+    // libsm64: water comes from the floor below Mario instead of environment boxes,
+    // unless the level was set through sm64_set_mario_water_level
+    if (m->floor != NULL && !m->overrideWaterLevel) {
+        m->waterLevel = (m->floor->type == SURFACE_WATER) ? m->floor->waterLevel : find_water_level(m->pos[0], m->pos[2]);
+    }
 
     if (m->floor != NULL) {
         m->floorAngle = atan2s(m->floor->normal.z, m->floor->normal.x);
@@ -1851,6 +1856,7 @@ int init_mario(void) {
 
 	gMarioState->overrideTerrain = 0x7;
 	gMarioState->overrideFloorType = 0x39;
+	gMarioState->overrideWaterLevel = FALSE;
 
     gMarioState->floorHeight =
         find_floor(gMarioState->pos[0], gMarioState->pos[1], gMarioState->pos[2], &gMarioState->floor);
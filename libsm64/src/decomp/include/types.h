@@ -261,6 +261,7 @@ struct Surface
     u8 isValid; // libsm64: added field
     struct SurfaceObjectTransform *transform; // libsm64: added field
     u16 terrain; // libsm64: added field
+    s32 waterLevel; // libsm64: added field, only valid on SURFACE_WATER floors
 };
 
 struct MarioBodyState
@@ -366,6 +367,7 @@ struct MarioState
     u16 curTerrain; // libsm64: added field
 	u16 overrideTerrain; // libsm64-gmod: added field
 	s16 overrideFloorType; // libsm64-gmod: added field
+	u8 overrideWaterLevel; // libsm64: added field, set by sm64_set_mario_water_level
 };
 
 #endif // TYPES_H
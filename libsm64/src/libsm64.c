@@ -512,6 +512,21 @@ SM64_LIB_FN void sm64_set_mario_water_level(int32_t marioId, signed int level)
 	global_state_bind( globalState );
 
 	gMarioState->waterLevel = level;
+	gMarioState->overrideWaterLevel = true;
+}
+
+SM64_LIB_FN void sm64_reset_mario_water_level(int32_t marioId)
+{
+	if( marioId >= s_mario_instance_pool.size || s_mario_instance_pool.objects[marioId] == NULL )
+    {
+        DEBUG_PRINT("Tried to use non-existant Mario with ID: %d", marioId);
+        return;
+    }
+
+	struct GlobalState *globalState = ((struct MarioInstance *)s_mario_instance_pool.objects[ marioId ])->globalState;
+	global_state_bind( globalState );
+
+	gMarioState->overrideWaterLevel = false;
 }
 
 SM64_LIB_FN signed int sm64_get_mario_water_level(int32_t marioId)
@@ -22,6 +22,7 @@ struct SM64Surface
     int16_t force;
     uint16_t terrain;
     int32_t vertices[3][3];
+    int32_t waterLevel; // height of the water surface above a SURFACE_WATER floor, ignored otherwise
 };
 
 struct SM64MarioInputs
@@ -136,7 +137,9 @@ extern SM64_LIB_FN void sm64_set_mario_angle(int32_t marioId, float x, float y,
 extern SM64_LIB_FN void sm64_set_mario_faceangle(int32_t marioId, float y);
 extern SM64_LIB_FN void sm64_set_mario_velocity(int32_t marioId, float x, float y, float z);
 extern SM64_LIB_FN void sm64_set_mario_forward_velocity(int32_t marioId, float vel);
+// Overrides the water level taken from SURFACE_WATER floors until sm64_reset_mario_water_level is called.
 extern SM64_LIB_FN void sm64_set_mario_water_level(int32_t marioId, signed int level);
+extern SM64_LIB_FN void sm64_reset_mario_water_level(int32_t marioId);
 extern SM64_LIB_FN signed int sm64_get_mario_water_level(int32_t marioId);
 extern SM64_LIB_FN void sm64_set_mario_floor_override(int32_t marioId, uint16_t terrain, int16_t floorType);
 extern SM64_LIB_FN void sm64_mario_take_damage(int32_t marioId, uint32_t damage, uint32_t subtype, float x, float y, float z);
@@ -25,6 +25,14 @@ static struct Surface *s_static_surface_list = NULL;
 static uint32_t s_surface_object_count = 0;
 static struct LoadedSurfaceObject *s_surface_object_list = NULL;
 
+// Indices of unloaded slots in s_surface_object_list, reused LIFO.
+static uint32_t s_free_object_count = 0;
+static uint32_t s_free_object_capacity = 0;
+static uint32_t *s_free_object_list = NULL;
+
+// Transform, lib surfaces and engine surfaces live in one block owned by engineSurfaces.
+#define SURFACE_BLOCK_ALIGN( x ) (((x) + 15) & ~(size_t)15)
+
 #define CONVERT_ANGLE( x ) ((s16)( -(x) / 180.0f * 32768.0f ))
 
 static void init_transform( struct SurfaceObjectTransform *out, const struct SM64ObjectTransform *in )
@@ -198,6 +206,7 @@ static void engine_surface_from_lib_surface( struct Surface *surface, const stru
     surface->type = type;
     surface->flags = (s8) flags;
     surface->terrain = libSurf->terrain;
+    surface->waterLevel = libSurf->waterLevel;
 
     if (hasForce) {
         surface->force = force;
@@ -243,20 +252,13 @@ void surfaces_load_static( const struct SM64Surface *surfaceArray, uint32_t numS
 
 uint32_t surfaces_load_object( const struct SM64SurfaceObject *surfaceObject )
 {
-    bool pickedOldIndex = false;
-    uint32_t idx = s_surface_object_count;
+    uint32_t idx;
 
-    for( int i = 0; i < s_surface_object_count; ++i )
+    if( s_free_object_count > 0 )
     {
-        if( s_surface_object_list[i].surfaceCount == 0 )
-        {
-            pickedOldIndex = true;
-            idx = i;
-            break;
-        }
+        idx = s_free_object_list[ --s_free_object_count ];
     }
-
-    if( !pickedOldIndex )
+    else
     {
         idx = s_surface_object_count;
         s_surface_object_count++;
@@ -267,13 +269,17 @@ uint32_t surfaces_load_object( const struct SM64SurfaceObject *surfaceObject )
 
     obj->surfaceCount = surfaceObject->surfaceCount;
 
-    obj->transform = malloc( sizeof( struct SurfaceObjectTransform ));
-    init_transform( obj->transform, &surfaceObject->transform );
+    size_t engineSize = SURFACE_BLOCK_ALIGN( obj->surfaceCount * sizeof( struct Surface ));
+    size_t transformSize = SURFACE_BLOCK_ALIGN( sizeof( struct SurfaceObjectTransform ));
+    uint8_t *block = malloc( engineSize + transformSize + obj->surfaceCount * sizeof( struct SM64Surface ));
 
-    obj->libSurfaces = malloc( obj->surfaceCount * sizeof( struct SM64Surface ));
+    obj->engineSurfaces = (struct Surface *)block;
+    obj->transform = (struct SurfaceObjectTransform *)( block + engineSize );
+    obj->libSurfaces = (struct SM64Surface *)( block + engineSize + transformSize );
+
+    init_transform( obj->transform, &surfaceObject->transform );
     memcpy( obj->libSurfaces, surfaceObject->surfaces, obj->surfaceCount * sizeof( struct SM64Surface ));
 
-    obj->engineSurfaces = malloc( obj->surfaceCount * sizeof( struct Surface ));
     for( int i = 0; i < obj->surfaceCount; ++i )
         engine_surface_from_lib_surface( &obj->engineSurfaces[i], &obj->libSurfaces[i], obj->transform );
 
@@ -288,14 +294,19 @@ void surfaces_unload_object( uint32_t objId )
         return;
     }
 
-    free( s_surface_object_list[objId].transform );
-    free( s_surface_object_list[objId].libSurfaces );
     free( s_surface_object_list[objId].engineSurfaces );
 
     s_surface_object_list[objId].surfaceCount = 0;
     s_surface_object_list[objId].transform = NULL;
     s_surface_object_list[objId].libSurfaces = NULL;
     s_surface_object_list[objId].engineSurfaces = NULL;
+
+    if( s_free_object_count == s_free_object_capacity )
+    {
+        s_free_object_capacity = s_free_object_capacity == 0 ? 16 : s_free_object_capacity * 2;
+        s_free_object_list = realloc( s_free_object_list, s_free_object_capacity * sizeof( uint32_t ));
+    }
+    s_free_object_list[ s_free_object_count++ ] = objId;
 }
 
 void surface_object_update_transform( uint32_t objId, const struct SM64ObjectTransform *newTransform )
@@ -329,9 +340,14 @@ void surfaces_unload_all( void )
     s_static_surface_list = NULL;
 
     for( int i = 0; i < s_surface_object_count; ++i )
-        surfaces_unload_object( i );
+        free( s_surface_object_list[i].engineSurfaces );
 
     free( s_surface_object_list );
     s_surface_object_count = 0;
     s_surface_object_list = NULL;
+
+    free( s_free_object_list );
+    s_free_object_count = 0;
+    s_free_object_capacity = 0;
+    s_free_object_list = NULL;
 }
@@ -4,13 +4,11 @@
 
 uint32_t obj_pool_alloc_index( struct ObjPool *pool, size_t size )
 {
-    for( uint32_t i = 0; i < pool->size; ++i )
+    if( pool->freeCount > 0 )
     {
-        if( pool->objects[i] == NULL )
-        {
-            pool->objects[i] = malloc( size );
-            return i;
-        }
+        uint32_t i = pool->freeIndices[ --pool->freeCount ];
+        pool->objects[i] = malloc( size );
+        return i;
     }
 
     uint32_t i = pool->size;
@@ -24,6 +22,13 @@ void obj_pool_free_index( struct ObjPool *pool, uint32_t index )
 {
     free( pool->objects[index] );
     pool->objects[index] = NULL;
+
+    if( pool->freeCount == pool->freeCapacity )
+    {
+        pool->freeCapacity = pool->freeCapacity == 0 ? 16 : pool->freeCapacity * 2;
+        pool->freeIndices = realloc( pool->freeIndices, pool->freeCapacity * sizeof( uint32_t ));
+    }
+    pool->freeIndices[ pool->freeCount++ ] = index;
 }
 
 void obj_pool_free_all( struct ObjPool *pool )
@@ -31,7 +36,11 @@ void obj_pool_free_all( struct ObjPool *pool )
     for( uint32_t i = 0; i < pool->size; ++i )
         free( pool->objects[i] );
     free( pool->objects );
+    free( pool->freeIndices );
 
     pool->size = 0;
     pool->objects = NULL;
+    pool->freeCount = 0;
+    pool->freeCapacity = 0;
+    pool->freeIndices = NULL;
 }
\ No newline at end of file
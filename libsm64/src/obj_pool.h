@@ -7,6 +7,11 @@ struct ObjPool
 {
     size_t size;
     void **objects;
+
+    // Stack of released indices, so allocation doesn't have to scan for a hole.
+    size_t freeCount;
+    size_t freeCapacity;
+    uint32_t *freeIndices;
 };
 
 extern uint32_t obj_pool_alloc_index( struct ObjPool *pool, size_t size );
@@ -624,6 +624,9 @@ struct FDropItem
 
 const double MinVel = EQUAL_EPSILON;
 
+// Set once per tic by P_UpdateThinkerSleep
+extern bool ThinkersSleep;
+
 // Map Object definition.
 class AActor : public DThinker
 {
@@ -838,6 +841,12 @@ public:
 	// Enter the crash state
 	void Crash();
 
+	// Sleeping actors are skipped by the thinker loop as long as Tick would do nothing but
+	// count down the state's tics. They only wake up on their own when the tics run out,
+	// so anything that changes what CanSleep checks has to call StopSleeping.
+	bool CanSleep();
+	bool StaysAsleep();
+
 	// Return starting health adjusted by skill level
 	int SpawnHealth() const;
 	int GetGibHealth() const;
@@ -1189,6 +1198,7 @@ public:
 	struct msecnode_t	*touching_sectorportallist;		// same for cross-sectorportal rendering
 	struct portnode_t	*touching_lineportallist;		// and for cross-lineportal
 	struct msecnode_t	*touching_rendersectors; // this is the list of sectors that this thing interesects with it's max(radius, renderradius).
+	struct FSecNodeCache	*secnodecache;		// lines around the last position for P_CreateSecNodeList
 	int validcount;
 
 
@@ -1442,44 +1452,53 @@ public:
 		Angles.Yaw = VecToAngle(Vel.X, Vel.Y);
 	}
 
+	// A sleeping actor doesn't look at its velocity, so anything that
+	// changes it has to wake it up first.
 	void VelFromAngle()
 	{
+		StopSleeping();
 		Vel.X = Speed * Angles.Yaw.Cos();
 		Vel.Y = Speed * Angles.Yaw.Sin();
 	}
 
 	void VelFromAngle(double speed)
 	{
+		StopSleeping();
 		Vel.X = speed * Angles.Yaw.Cos();
 		Vel.Y = speed * Angles.Yaw.Sin();
 	}
 
 	void VelFromAngle(double speed, DAngle angle)
 	{
+		StopSleeping();
 		Vel.X = speed * angle.Cos();
 		Vel.Y = speed * angle.Sin();
 	}
 
 	void Thrust()
 	{
+		StopSleeping();
 		Vel.X += Speed * Angles.Yaw.Cos();
 		Vel.Y += Speed * Angles.Yaw.Sin();
 	}
 
 	void Thrust(double speed)
 	{
+		StopSleeping();
 		Vel.X += speed * Angles.Yaw.Cos();
 		Vel.Y += speed * Angles.Yaw.Sin();
 	}
 
 	void Thrust(DAngle angle, double speed)
 	{
+		StopSleeping();
 		Vel.X += speed * angle.Cos();
 		Vel.Y += speed * angle.Sin();
 	}
 
 	void Vel3DFromAngle(DAngle angle, DAngle pitch, double speed)
 	{
+		StopSleeping();
 		double cospitch = pitch.Cos();
 		Vel.X = speed * cospitch * angle.Cos();
 		Vel.Y = speed * cospitch * angle.Sin();
@@ -1488,6 +1507,7 @@ public:
 
 	void Vel3DFromAngle(DAngle pitch, double speed)
 	{
+		StopSleeping();
 		double cospitch = pitch.Cos();
 		Vel.X = speed * cospitch * Angles.Yaw.Cos();
 		Vel.Y = speed * cospitch * Angles.Yaw.Sin();
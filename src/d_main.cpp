@@ -1067,6 +1067,9 @@ void D_DoomLoop ()
 			// Update display, next frame, with current state.
 			I_StartTic ();
 			D_Display ();
+			// Spend whatever collection time the frame budget allows
+			// now that the frame is out.
+			GC::FrameStep ();
 			if (wantToRestart)
 			{
 				wantToRestart = false;
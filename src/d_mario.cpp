@@ -5,10 +5,13 @@
 #include "d_mario.h"
 #include "doomtype.h"
 #include "doomstat.h"
+#include "d_player.h"
 #include "i_system.h"
 #include "p_local.h"
 #include "g_levellocals.h"
 #include "dsectoreffect.h"
+#include "po_man.h"
+#include "p_tick.h"
 
 #include "gl/system/gl_interface.h"
 #include "gl/renderer/gl_renderer.h"
@@ -123,6 +126,28 @@ namespace MarioGlobal
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SM64_TEXTURE_WIDTH, SM64_TEXTURE_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, texture);
 	}
+
+	// called by every renderer once per frame, before the scene is drawn
+	void tickView(AActor *camera)
+	{
+		if (camera->player && camera->player-players==consoleplayer && camera->player->marioInstance)
+		{
+			// this will be used for 60fps geometry interpolation
+			static int last = 0;
+			int now = I_MSTime();
+			if (camera->player->marioInstance->first < 2)
+			{
+				last = now;
+				camera->player->marioInstance->first++;
+			}
+			if (!P_CheckTickerPaused())
+			{
+				// SM64: tick mario here
+				camera->player->marioInstance->Tick((now - last)/1000.f);
+			}
+			last = now;
+		}
+	}
 }
 
 
@@ -140,23 +165,9 @@ MarioInstance::MarioInstance(int id, AActor *Parent) : marioId(id), parent(Paren
 	memset(&input, 0, sizeof(SM64MarioInputs));
 	memset(&state, 0, sizeof(SM64MarioState));
 
-	glGenVertexArrays(1, &vao);
-	glBindVertexArray(vao);
-
-	#define X( loc, buff, arr, type ) do { \
-		glGenBuffers(1, &buff); \
-		glBindBuffer(GL_ARRAY_BUFFER, buff); \
-		glBufferData(GL_ARRAY_BUFFER, sizeof( type ) * 3 * SM64_GEO_MAX_TRIANGLES, arr, GL_DYNAMIC_DRAW); \
-		glEnableVertexAttribArray(loc); \
-		glVertexAttribPointer(loc, sizeof(type) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(type), NULL); \
-	} while( 0 )
-
-	X(6, position_buf, geometry.position, vec3);
-	X(7, normal_buf,   geometry.normal,   vec3);
-	X(8, color_buf,    geometry.color,    vec3);
-	X(9, uv_buf,       geometry.uv,       vec2);
-
-	#undef X
+	// GL buffers are only created once the GL renderer draws Mario
+	vao = 0;
+	glDirty = false;
 
 	first = 0;
 	memset(lastGeom, 0, sizeof(float) * 9 * SM64_GEO_MAX_TRIANGLES);
@@ -168,11 +179,14 @@ MarioInstance::MarioInstance(int id, AActor *Parent) : marioId(id), parent(Paren
 
 MarioInstance::~MarioInstance()
 {
-	glDeleteVertexArrays(1, &vao);
-	glDeleteBuffers(1, &position_buf);
-	glDeleteBuffers(1, &normal_buf);
-	glDeleteBuffers(1, &color_buf);
-	glDeleteBuffers(1, &uv_buf);
+	if (vao)
+	{
+		glDeleteVertexArrays(1, &vao);
+		glDeleteBuffers(1, &position_buf);
+		glDeleteBuffers(1, &normal_buf);
+		glDeleteBuffers(1, &color_buf);
+		glDeleteBuffers(1, &uv_buf);
+	}
 	free(meshIndex);
 
 	sm64_mario_delete(marioId);
@@ -183,6 +197,27 @@ MarioInstance::~MarioInstance()
 	free(geometry.uv);
 }
 
+void MarioInstance::InitGL()
+{
+	glGenVertexArrays(1, &vao);
+	glBindVertexArray(vao);
+
+	#define X( loc, buff, arr, type ) do { \
+		glGenBuffers(1, &buff); \
+		glBindBuffer(GL_ARRAY_BUFFER, buff); \
+		glBufferData(GL_ARRAY_BUFFER, sizeof( type ) * 3 * SM64_GEO_MAX_TRIANGLES, arr, GL_DYNAMIC_DRAW); \
+		glEnableVertexAttribArray(loc); \
+		glVertexAttribPointer(loc, sizeof(type) / sizeof(float), GL_FLOAT, GL_FALSE, sizeof(type), NULL); \
+	} while( 0 )
+
+	X(6, position_buf, geometry.position, vec3);
+	X(7, normal_buf,   geometry.normal,   vec3);
+	X(8, color_buf,    geometry.color,    vec3);
+	X(9, uv_buf,       geometry.uv,       vec2);
+
+	#undef X
+}
+
 void MarioInstance::Tick(float addTicks)
 {
 	if (first < 2) return;
@@ -222,6 +257,52 @@ void MarioInstance::Tick(float addTicks)
 			}
 		}
 
+		// polyobjects and 3D floors are only re-transformed after they actually moved
+		for (uint32_t i=0; i<level.dynamicPolyobjs.Size(); i++)
+		{
+			SM64DynamicPolyobj *dynpoly = &level.dynamicPolyobjs[i];
+			if (!dynpoly->dirty) continue;
+			dynpoly->dirty = false;
+
+			FPolyObj *poly = dynpoly->poly;
+			dynpoly->walls.transform.position[0] = poly->StartSpot.pos.X*MARIO_SCALE;
+			dynpoly->walls.transform.position[2] = -poly->StartSpot.pos.Y*MARIO_SCALE;
+			dynpoly->walls.transform.eulerRotation[1] = -poly->Angle.Normalized180().Degrees;
+			if (dynpoly->walls.ID != UINT_MAX) sm64_surface_object_move(dynpoly->walls.ID, &dynpoly->walls.transform);
+		}
+
+		for (uint32_t i=0; i<level.dynamic3DFloors.Size(); i++)
+		{
+			SM64Dynamic3DFloor *dynfloor = &level.dynamic3DFloors[i];
+			if (!dynfloor->dirty) continue;
+			dynfloor->dirty = false;
+
+			sector_t *sec = dynfloor->ffloor->target;
+			float topZ = dynfloor->ffloor->top.plane->ZatPoint(sec->centerspot)*MARIO_SCALE;
+			float bottomZ = dynfloor->ffloor->bottom.plane->ZatPoint(sec->centerspot)*MARIO_SCALE;
+
+			if (dynfloor->top.transform.position[1] != topZ - dynfloor->topSpawnZ)
+			{
+				dynfloor->top.transform.position[1] = topZ - dynfloor->topSpawnZ;
+				if (dynfloor->top.ID != UINT_MAX) sm64_surface_object_move(dynfloor->top.ID, &dynfloor->top.transform);
+			}
+			if (topZ - bottomZ != dynfloor->thickness)
+			{
+				// the sides no longer fit between top and bottom
+				P_SM64RebuildXFloorSides(dynfloor);
+			}
+			if (dynfloor->walls.transform.position[1] != topZ - dynfloor->wallsSpawnZ)
+			{
+				dynfloor->walls.transform.position[1] = topZ - dynfloor->wallsSpawnZ;
+				if (dynfloor->walls.ID != UINT_MAX) sm64_surface_object_move(dynfloor->walls.ID, &dynfloor->walls.transform);
+			}
+			if (dynfloor->bottom.transform.position[1] != bottomZ - dynfloor->bottomSpawnZ)
+			{
+				dynfloor->bottom.transform.position[1] = bottomZ - dynfloor->bottomSpawnZ;
+				if (dynfloor->bottom.ID != UINT_MAX) sm64_surface_object_move(dynfloor->bottom.ID, &dynfloor->bottom.transform);
+			}
+		}
+
 		for (int i=0; i<9 * geometry.numTrianglesUsed; i++)
 		{
 			if (i<3) lastPos[i] = newPos[i];
@@ -304,20 +385,33 @@ void MarioInstance::UpdateModel(float ticks, float* position)
 		geometry.position[i] = lastGeom[i] + ((newGeom[i] - lastGeom[i]) * (ticks / (1.f/30)));
 	}
 
-    glBindBuffer(GL_ARRAY_BUFFER, position_buf);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.position);
-    glBindBuffer(GL_ARRAY_BUFFER, normal_buf);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.normal);
-    glBindBuffer(GL_ARRAY_BUFFER, color_buf);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.color);
-    glBindBuffer(GL_ARRAY_BUFFER, uv_buf);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec2 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.uv);
+
+	// the geometry buffers are uploaded by Render(), the software renderers read them directly
+	glDirty = true;
 }
 
 void MarioInstance::Render(VSMatrix &view, VSMatrix &projection)
 {
 	if (first < 2) return;
 
+	if (!vao)
+	{
+		InitGL();
+		glDirty = true;
+	}
+	if (glDirty)
+	{
+		glBindBuffer(GL_ARRAY_BUFFER, position_buf);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.position);
+		glBindBuffer(GL_ARRAY_BUFFER, normal_buf);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.normal);
+		glBindBuffer(GL_ARRAY_BUFFER, color_buf);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec3 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.color);
+		glBindBuffer(GL_ARRAY_BUFFER, uv_buf);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof( vec2 ) * 3 * SM64_GEO_MAX_TRIANGLES, geometry.uv);
+		glDirty = false;
+	}
+
 	glDisable(GL_CLIP_DISTANCE0);
 	glDisable(GL_CLIP_DISTANCE1);
 	glDisable(GL_CLIP_DISTANCE2);
@@ -33,6 +33,7 @@ namespace MarioGlobal
 	extern GLuint GLtexture;
 
 	void initThings();
+	void tickView(AActor *camera);
 }
 
 
@@ -44,6 +45,7 @@ class MarioInstance
 	GLuint color_buf;
 	GLuint uv_buf;
 	uint16_t *meshIndex;
+	bool glDirty;
 
 	int marioId;
 	float ticks;
@@ -68,6 +70,9 @@ public:
 	void Render(VSMatrix &view, VSMatrix &projection);
 
 	int ID() {return marioId;}
+
+private:
+	void InitGL();
 };
 
 #endif
@@ -56,6 +56,8 @@
 
 // HEADER FILES ------------------------------------------------------------
 
+#include <chrono>
+
 #include "dobject.h"
 #include "templates.h"
 #include "b_bot.h"
@@ -65,6 +67,7 @@
 #include "sbar.h"
 #include "stats.h"
 #include "c_dispatch.h"
+#include "c_cvars.h"
 #include "s_sndseq.h"
 #include "r_data/r_interpolate.h"
 #include "doomstat.h"
@@ -138,6 +141,25 @@ IMPLEMENT_CLASS(DSectorMarker, false, false)
 
 extern DThinker *NextToThink;
 
+// Microseconds of collection work done once per frame by GC::FrameStep.
+// 0 paces the collector by allocation alone, as it always has been.
+CUSTOM_CVAR(Int, gc_framebudget, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 0)
+	{
+		self = 0;
+		return;
+	}
+	if (GC::State == GC::GCS_Pause)
+	{
+		GC::SetThreshold();
+	}
+	else
+	{ // Let whichever pacing is now active pick up the collection.
+		GC::Threshold = GC::AllocBytes;
+	}
+}
+
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
 namespace GC
@@ -161,6 +183,75 @@ bool FinalGC;
 
 static DSectorMarker *SectorMarker;
 
+// Time spent in each phase, in nanoseconds, for the current and the last
+// complete collection cycle. Sweep time does not include finalization, as long
+// as the gc stat is shown.
+enum { PHASE_Mark, PHASE_Sweep, PHASE_Finalize, NUM_PHASES };
+static uint64_t CycleTime[NUM_PHASES];
+static uint64_t LastCycleTime[NUM_PHASES];
+static uint64_t FinalizeTime;		// Not yet charged to the current cycle
+static uint64_t FrameStepTime;		// Time used by the last FrameStep
+
+// "gc stop" sets the threshold to this, so that the collector never runs.
+static const size_t STOPPED_THRESHOLD = ~(size_t)0 - 2;
+
+static inline uint64_t NowNS()
+{
+	using namespace std::chrono;
+	return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Reading the clock around every freed object costs about as much as freeing
+// it, so that is only done while somebody is looking at the numbers.
+static bool TimeFinalization()
+{
+	static FStat *stat = FStat::FindStat("gc");
+	return stat != nullptr && stat->isActive();
+}
+
+// Charges the time since the last check to the phase the collector was in,
+// whenever the collector changes state or stops stepping.
+struct FPhaseClock
+{
+	uint64_t Start;
+	EGCState Phase;
+
+	FPhaseClock() : Start(NowNS()), Phase(State) {}
+	~FPhaseClock() { Charge(); }
+
+	void Check()
+	{
+		if (State != Phase) Charge();
+	}
+
+	void Charge()
+	{
+		uint64_t now = NowNS();
+		uint64_t elapsed = now - Start;
+		switch (Phase)
+		{
+		case GCS_Pause:
+		case GCS_Propagate:
+			CycleTime[PHASE_Mark] += elapsed;
+			break;
+
+		case GCS_Sweep:
+			// Destroying dead objects happens inside the sweep steps.
+			elapsed -= MIN(elapsed, FinalizeTime);
+			CycleTime[PHASE_Sweep] += elapsed;
+			break;
+
+		default:
+			CycleTime[PHASE_Finalize] += elapsed;
+			break;
+		}
+		CycleTime[PHASE_Finalize] += FinalizeTime;
+		FinalizeTime = 0;
+		Start = now;
+		Phase = State;
+	}
+};
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -168,12 +259,19 @@ static DSectorMarker *SectorMarker;
 // SetThreshold
 //
 // Sets the new threshold after a collection is finished.
+// In frame budget mode, this is the point where CheckGC steps in because
+// the per-frame work is not keeping up.
 //
 //==========================================================================
 
 void SetThreshold()
 {
 	Threshold = (Estimate / 100) * Pause;
+	if (gc_framebudget > 0)
+	{ // FrameStep starts the collection. Only step from CheckGC if
+	  // allocation gets far ahead of it.
+		Threshold += Estimate;
+	}
 }
 
 //==========================================================================
@@ -227,6 +325,7 @@ static DObject **SweepList(DObject **p, size_t count, size_t *finalize_count)
 	DObject *curr;
 	int deadmask = OtherWhite();
 	size_t finalized = 0;
+	bool timed = TimeFinalization();
 
 	while ((curr = *p) != NULL && count-- > 0)
 	{
@@ -238,6 +337,7 @@ static DObject **SweepList(DObject **p, size_t count, size_t *finalize_count)
 		}
 		else	// must erase 'curr'
 		{
+			uint64_t start = timed ? NowNS() : 0;
 			assert(curr->IsDead());
 			*p = curr->ObjNext;
 			if (!(curr->ObjectFlags & OF_EuthanizeMe))
@@ -257,6 +357,10 @@ static DObject **SweepList(DObject **p, size_t count, size_t *finalize_count)
 			curr->ObjectFlags |= OF_Cleanup;
 			delete curr;
 			finalized++;
+			if (timed)
+			{
+				FinalizeTime += NowNS() - start;
+			}
 		}
 	}
 	if (finalize_count != NULL)
@@ -322,6 +426,10 @@ static void MarkRoot()
 {
 	int i;
 
+	// A new cycle starts here.
+	memcpy(LastCycleTime, CycleTime, sizeof(CycleTime));
+	memset(CycleTime, 0, sizeof(CycleTime));
+
 	Gray = NULL;
 	Mark(StatusBar);
 	M_MarkMenus();
@@ -474,10 +582,12 @@ void Step()
 		lim = (~(size_t)0) / 2;		// no limit
 	}
 	Dept += AllocBytes - Threshold;
+	FPhaseClock clock;
 	do
 	{
 		olim = lim;
 		lim -= SingleStep();
+		clock.Check();
 	} while (olim > lim && State != GCS_Pause);
 	if (State != GCS_Pause)
 	{
@@ -499,6 +609,51 @@ void Step()
 	StepCount++;
 }
 
+//==========================================================================
+//
+// FrameStep
+//
+// Performs collection steps until gc_framebudget microseconds have passed.
+// Called once per frame, after the frame has been presented, so the work
+// lands in the time the frame would otherwise spend waiting. A collection
+// is started once memory has grown by the pause factor, as with Step.
+//
+//==========================================================================
+
+void FrameStep()
+{
+	FrameStepTime = 0;
+	if (gc_framebudget <= 0 || Threshold == STOPPED_THRESHOLD)
+	{ // Disabled, or stopped with "gc stop"
+		return;
+	}
+	if (State == GCS_Pause && AllocBytes < (Estimate / 100) * Pause)
+	{
+		return;
+	}
+	uint64_t start = NowNS();
+	uint64_t deadline = start + (uint64_t)gc_framebudget * 1000;
+	{
+		FPhaseClock clock;
+		do
+		{
+			SingleStep();
+			clock.Check();
+		} while (State != GCS_Pause && NowNS() < deadline);
+	}
+	if (State != GCS_Pause)
+	{
+		Dept = 0;
+		Threshold = AllocBytes + Estimate;
+	}
+	else
+	{
+		SetThreshold();
+	}
+	StepCount++;
+	FrameStepTime = NowNS() - start;
+}
+
 //==========================================================================
 //
 // FullGC
@@ -509,6 +664,7 @@ void Step()
 
 void FullGC()
 {
+	FPhaseClock clock;
 	if (State <= GCS_Propagate)
 	{
 		// Reset sweep mark to sweep all elements (returning them to white)
@@ -521,11 +677,16 @@ void FullGC()
 	while (State != GCS_Finalize)
 	{
 		SingleStep();
+		clock.Check();
 	}
+	clock.Charge();
+	clock.Phase = GCS_Pause;	// MarkRoot belongs to the mark phase
 	MarkRoot();
+	clock.Check();
 	while (State != GCS_Pause)
 	{
 		SingleStep();
+		clock.Check();
 	}
 	SetThreshold();
 }
@@ -745,6 +906,17 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("\nMark:%7.3f ms  Sweep:%7.3f ms  Finalize:%7.3f ms  (last cycle %.3f/%.3f/%.3f)",
+		GC::CycleTime[GC::PHASE_Mark] * 1e-6,
+		GC::CycleTime[GC::PHASE_Sweep] * 1e-6,
+		GC::CycleTime[GC::PHASE_Finalize] * 1e-6,
+		GC::LastCycleTime[GC::PHASE_Mark] * 1e-6,
+		GC::LastCycleTime[GC::PHASE_Sweep] * 1e-6,
+		GC::LastCycleTime[GC::PHASE_Finalize] * 1e-6);
+	if (gc_framebudget > 0)
+	{
+		out.AppendFormat("\nFrame budget: %d us, used %d us", *gc_framebudget, int(GC::FrameStepTime / 1000));
+	}
 	return out;
 }
 
@@ -765,7 +937,7 @@ CCMD(gc)
 	}
 	if (stricmp(argv[1], "stop") == 0)
 	{
-		GC::Threshold = ~(size_t)0 - 2;
+		GC::Threshold = GC::STOPPED_THRESHOLD;
 	}
 	else if (stricmp(argv[1], "now") == 0)
 	{
@@ -25,6 +25,7 @@ enum EObjectFlags
 	OF_Transient		= 1 << 11,		// Object should not be archived (references to it will be nulled on disk)
 	OF_Spawned			= 1 << 12,      // Thinker was spawned at all (some thinkers get deleted before spawning)
 	OF_Released			= 1 << 13,		// Object was released from the GC system and should not be processed by GC function
+	OF_Sleeping			= 1 << 14,		// Thinker's Tick is known to do nothing and gets skipped (see AActor::CanSleep)
 };
 
 template<class T> class TObjPtr;
@@ -81,6 +82,13 @@ namespace GC
 	// Does one collection step.
 	void Step();
 
+	// Does as many collection steps as fit in gc_framebudget. Called once
+	// per frame.
+	void FrameStep();
+
+	// Sets the threshold for the next collection.
+	void SetThreshold();
+
 	// Does a complete collection.
 	void FullGC();
 
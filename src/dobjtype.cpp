@@ -271,6 +271,7 @@ void PClass::StaticShutdown ()
 	// From this point onward no scripts may be called anymore because the data needed by the VM is getting deleted now.
 	// This flags DObject::Destroy not to call any scripted OnDestroy methods anymore.
 	bVMOperational = false;
+	VMJitRelease();
 
 	// PendingWeapon must be cleared manually because it is not subjected to the GC if it contains WP_NOCHANGE, which is just RUNTIME_CLASS(AWWeapon).
 	// But that will get cleared here, confusing the GC if the value is left in.
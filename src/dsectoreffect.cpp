@@ -163,6 +163,8 @@ EMoveResult sector_t::MoveFloor(double speed, double dest, int crush, int direct
 	//double		destheight;	//jff 02/04/98 used to keep floors/ceilings
 							// from moving thru each other
 	lastpos = floorplane.fD();
+	P_SM64SectorPlaneMoved(this);
+	P_SightGeometryChanged();
 	switch (direction)
 	{
 	case -1:
@@ -299,6 +301,8 @@ EMoveResult sector_t::MoveCeiling(double speed, double dest, int crush, int dire
 	// from moving thru each other
 
 	lastpos = ceilingplane.fD();
+	P_SM64SectorPlaneMoved(this);
+	P_SightGeometryChanged();
 	switch (direction)
 	{
 	case -1:
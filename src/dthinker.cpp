@@ -41,9 +41,13 @@
 #include "serializer.h"
 #include "d_player.h"
 #include "vm.h"
+#include "dthinkerprofile.h"
+#include "b_bot.h"
+#include "g_levellocals.h"
 
 
 static int ThinkCount;
+static int SleepCount;
 static cycle_t ThinkCycles;
 extern cycle_t BotSupportCycles;
 extern cycle_t ActionCycles;
@@ -53,6 +57,12 @@ IMPLEMENT_CLASS(DThinker, false, false)
 
 DThinker *NextToThink;
 
+// Where the thinker loop is in the list it is ticking. If that thinker gets
+// removed, this moves to the one before it, so it still marks the position.
+static DThinker *ThinkingNode;
+static int ThinkingStat = MAX_STATNUM + 1;	// list being ticked, above MAX_STATNUM once all of them are done
+static int ThinkTic;
+
 FThinkerList DThinker::Thinkers[MAX_STATNUM+2];
 FThinkerList DThinker::FreshThinkers[MAX_STATNUM+1];
 bool DThinker::bSerialOverride = false;
@@ -73,6 +83,8 @@ void FThinkerList::AddTail(DThinker *thinker)
 		Sentinel->ObjectFlags |= OF_Sentinel;
 		Sentinel->NextThinker = Sentinel;
 		Sentinel->PrevThinker = Sentinel;
+		Sentinel->NextAwake = Sentinel;
+		Sentinel->PrevAwake = Sentinel;
 		GC::WriteBarrier(Sentinel);
 	}
 	DThinker *tail = Sentinel->PrevThinker;
@@ -85,6 +97,13 @@ void FThinkerList::AddTail(DThinker *thinker)
 	GC::WriteBarrier(thinker, Sentinel);
 	GC::WriteBarrier(tail, thinker);
 	GC::WriteBarrier(Sentinel, thinker);
+
+	DThinker *awaketail = Sentinel->PrevAwake;
+	thinker->PrevAwake = awaketail;
+	thinker->NextAwake = Sentinel;
+	awaketail->NextAwake = thinker;
+	Sentinel->PrevAwake = thinker;
+	thinker->TickedAt = 0;
 }
 
 //==========================================================================
@@ -163,6 +182,8 @@ void DThinker::SerializeThinkers(FSerializer &arc, bool hubLoad)
 
 	if (arc.isWriting())
 	{
+		// Sleepers only get their tics updated when they wake up.
+		WakeSleepers();
 		arc.BeginArray("thinkers");
 		for (i = 0; i <= MAX_STATNUM; i++)
 		{
@@ -235,6 +256,11 @@ DThinker::DThinker (int statnum) throw()
 {
 	NextThinker = NULL;
 	PrevThinker = NULL;
+	NextAwake = NULL;
+	PrevAwake = NULL;
+	TickedAt = 0;
+	SleepUntil = -1;
+	SleepStat = 0;
 	if (bSerialOverride)
 	{ // The serializer will insert us into the right list
 		return;
@@ -279,8 +305,24 @@ void DThinker::Remove()
 {
 	if (this == NextToThink)
 	{
-		NextToThink = NextThinker;
+		NextToThink = NextAwake;
+	}
+	if (this == ThinkingNode)
+	{
+		ThinkingNode = PrevThinker;
 	}
+	if (ObjectFlags & OF_Sleeping)
+	{
+		UnlinkSleeper();
+	}
+	else
+	{
+		PrevAwake->NextAwake = NextAwake;
+		NextAwake->PrevAwake = PrevAwake;
+	}
+	NextAwake = NULL;
+	PrevAwake = NULL;
+
 	DThinker *prev = PrevThinker;
 	DThinker *next = NextThinker;
 	assert(prev != NULL && next != NULL);
@@ -435,6 +477,11 @@ void DThinker::DestroyAllThinkers ()
 	}
 	DestroyThinkersInList (Thinkers[MAX_STATNUM+1]);
 	GC::FullGC();
+
+	// The lists that are kept never tick, so nothing is asleep anymore.
+	assert(SleepCount == 0);
+	memset(level.SleepWheel, 0, sizeof(level.SleepWheel));
+	level.SleepClock = 0;
 }
 
 //==========================================================================
@@ -467,12 +514,7 @@ CVAR(Bool, profilethinkers, false, 0)
 struct ProfileInfo
 {
 	int numcalls = 0;
-	cycle_t timer;
-
-	ProfileInfo()
-	{
-		timer.Reset();
-	}
+	double timems = 0;
 };
 
 TMap<FName, ProfileInfo> Profiles;
@@ -489,14 +531,22 @@ void DThinker::RunThinkers ()
 	BotWTG = 0;
 
 	ThinkCycles.Clock();
+	ThinkTic++;
+	ThinkingStat = -1;
+	RunSleepWheel();
+	P_UpdateThinkerSleep();
 
-	if (!profilethinkers)
+	if (!profilethinkers && !ThinkerProfiler.Active)
 	{
 		// Tick every thinker left from last time
 		for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 		{
+			ThinkingStat = i;
+			if (i == STAT_DEFAULT) P_SightPrepass();
 			TickThinkers(&Thinkers[i], NULL);
+			if (i == STAT_DEFAULT) P_ClearSightPrepass();
 		}
+		ThinkingStat = MAX_STATNUM + 1;
 
 		// Keep ticking the fresh thinkers until there are no new ones.
 		do
@@ -511,11 +561,16 @@ void DThinker::RunThinkers ()
 	else
 	{
 		Profiles.Clear();
+		if (ThinkerProfiler.Active) ThinkerProfiler.BeginTic();
 		// Tick every thinker left from last time
 		for (i = STAT_FIRST_THINKING; i <= MAX_STATNUM; ++i)
 		{
+			ThinkingStat = i;
+			if (i == STAT_DEFAULT) P_SightPrepass();
 			ProfileThinkers(&Thinkers[i], NULL);
+			if (i == STAT_DEFAULT) P_ClearSightPrepass();
 		}
+		ThinkingStat = MAX_STATNUM + 1;
 
 		// Keep ticking the fresh thinkers until there are no new ones.
 		do
@@ -526,16 +581,204 @@ void DThinker::RunThinkers ()
 				count += ProfileThinkers(&FreshThinkers[i], &Thinkers[i]);
 			}
 		} while (count != 0);
-		auto it = TMap<FName, ProfileInfo>::Iterator(Profiles);
-		TMap<FName, ProfileInfo>::Pair *pair;
-		while (it.NextPair(pair))
+
+		if (profilethinkers)
 		{
-			Printf("%s, %dx, %fms\n", pair->Key.GetChars(), pair->Value.numcalls, pair->Value.timer.TimeMS());
+			auto it = TMap<FName, ProfileInfo>::Iterator(Profiles);
+			TMap<FName, ProfileInfo>::Pair *pair;
+			while (it.NextPair(pair))
+			{
+				Printf("%s, %dx, %fms\n", pair->Key.GetChars(), pair->Value.numcalls, pair->Value.timems);
+			}
+			profilethinkers = false;
 		}
-		profilethinkers = false;
 	}
 
 	ThinkCycles.Unclock();
+	if (ThinkerProfiler.Active) ThinkerProfiler.EndTic(ThinkCycles.TimeMS());
+}
+
+//==========================================================================
+//
+// Sleeping actors stay in their list so that iterators, savegames and
+// the order in which everything ticks are not affected. Only the chain
+// of awake thinkers the loop follows leaves them out.
+//
+//==========================================================================
+
+static inline void TrySleep(DThinker *node, int stat)
+{
+	if (ThinkersSleep && !(node->ObjectFlags & OF_EuthanizeMe) && node->IsKindOf(RUNTIME_CLASS(AActor)))
+	{
+		AActor *actor = static_cast<AActor *>(node);
+
+		// Time freeze only stops the countdown for the sleep wheel, so actors that ignore it can't count down asleep.
+		if (actor->CanSleep() && (actor->tics == -1 || !(actor->flags5 & MF5_NOTIMEFREEZE)))
+		{
+			node->Sleep(stat, actor->tics);
+		}
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: Sleep
+//
+// Takes the thinker out of the awake chain. With tics >= 0 it wakes up
+// again when that many tics have passed with time not frozen.
+//
+//==========================================================================
+
+void DThinker::Sleep(int stat, int tics)
+{
+	// A thinker that got moved to another list during its Tick is not where the loop left it.
+	if (TickedAt != ThinkTic)
+	{
+		return;
+	}
+	assert(!(ObjectFlags & OF_Sleeping) && this != NextToThink);
+	PrevAwake->NextAwake = NextAwake;
+	NextAwake->PrevAwake = PrevAwake;
+	ObjectFlags |= OF_Sleeping;
+	SleepStat = stat;
+	SleepCount++;
+
+	if (tics < 0)
+	{
+		SleepUntil = -1;
+		NextAwake = NULL;
+		PrevAwake = NULL;
+	}
+	else
+	{
+		SleepUntil = level.SleepClock + tics;
+		DThinker *&slot = level.SleepWheel[SleepUntil & (FLevelLocals::SLEEP_WHEEL_SIZE - 1)];
+		PrevAwake = NULL;
+		NextAwake = slot;
+		if (slot != NULL) slot->PrevAwake = this;
+		slot = this;
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: UnlinkSleeper
+//
+//==========================================================================
+
+void DThinker::UnlinkSleeper()
+{
+	if (SleepUntil >= 0)
+	{
+		if (PrevAwake != NULL) PrevAwake->NextAwake = NextAwake;
+		else level.SleepWheel[SleepUntil & (FLevelLocals::SLEEP_WHEEL_SIZE - 1)] = NextAwake;
+		if (NextAwake != NULL) NextAwake->PrevAwake = PrevAwake;
+	}
+	ObjectFlags &= ~OF_Sleeping;
+	SleepCount--;
+}
+
+//==========================================================================
+//
+// DThinker :: Wake
+//
+// Links the thinker back into the awake chain after the closest awake
+// thinker before it. If the loop has not got to it yet in the current
+// tic, it still gets ticked in this one, as if it had never slept.
+// An actor's tics are set to what is left of the countdown it slept
+// with, so anything that sets them has to do that after waking it.
+//
+//==========================================================================
+
+void DThinker::Wake()
+{
+	int until = SleepUntil;
+	UnlinkSleeper();
+
+	bool ahead = SleepStat > ThinkingStat;
+	DThinker *prev = PrevThinker;
+	if (SleepStat == ThinkingStat)
+	{
+		while (prev != ThinkingNode && (prev->ObjectFlags & OF_Sleeping))
+		{
+			prev = prev->PrevThinker;
+		}
+		// Awake thinkers the loop has already passed are all stamped with the current tic.
+		ahead = prev == ThinkingNode || (!(prev->ObjectFlags & OF_Sentinel) && prev->TickedAt != ThinkTic);
+	}
+	while (prev->ObjectFlags & OF_Sleeping)
+	{
+		prev = prev->PrevThinker;
+	}
+
+	PrevAwake = prev;
+	NextAwake = prev->NextAwake;
+	NextAwake->PrevAwake = this;
+	prev->NextAwake = this;
+
+	if (!ahead)
+	{
+		TickedAt = ThinkTic;
+	}
+	else if (SleepStat == ThinkingStat && NextAwake == NextToThink)
+	{
+		NextToThink = this;
+	}
+
+	if (until >= 0)
+	{
+		// Catch up on the countdown. Only the actor's own Tick still has to do it for this tic.
+		static_cast<AActor *>(this)->tics = until - level.SleepClock + (level.SleepClockRunning && ahead);
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: RunSleepWheel
+//
+// Advances the sleep wheel and wakes everything whose tics have run
+// out. Those are now at 1, so their next Tick changes state.
+//
+//==========================================================================
+
+void DThinker::RunSleepWheel()
+{
+	level.SleepClockRunning = !(bglobal.freeze || (level.flags2 & LEVEL2_FROZEN));
+	if (level.SleepClockRunning)
+	{
+		level.SleepClock++;
+		DThinker *node = level.SleepWheel[level.SleepClock & (FLevelLocals::SLEEP_WHEEL_SIZE - 1)];
+		while (node != NULL)
+		{
+			DThinker *next = node->NextAwake;
+			if (node->SleepUntil == level.SleepClock)
+			{
+				node->Wake();
+			}
+			node = next;
+		}
+	}
+}
+
+//==========================================================================
+//
+// DThinker :: WakeSleepers
+//
+//==========================================================================
+
+void DThinker::WakeSleepers()
+{
+	for (int i = STAT_FIRST_THINKING; i <= MAX_STATNUM; i++)
+	{
+		DThinker *sentinel = Thinkers[i].Sentinel;
+		if (sentinel != NULL)
+		{
+			for (DThinker *node = sentinel->NextThinker; node != sentinel; node = node->NextThinker)
+			{
+				node->StopSleeping();
+			}
+		}
+	}
 }
 
 //==========================================================================
@@ -554,10 +797,14 @@ int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
 		return 0;
 	}
 
+	int stat = int((dest != NULL ? dest : list) - Thinkers);
+	if (dest == NULL) ThinkingNode = list->Sentinel;
+	node = list->Sentinel->NextAwake;
 	while (node != list->Sentinel)
 	{
 		++count;
-		NextToThink = node->NextThinker;
+		NextToThink = node->NextAwake;
+		if (dest == NULL) ThinkingNode = node;
 		if (node->ObjectFlags & OF_JustSpawned)
 		{
 			// Leave OF_JustSpawn set until after Tick() so the ticker can check it.
@@ -572,16 +819,19 @@ int DThinker::TickThinkers (FThinkerList *list, FThinkerList *dest)
 		{
 			I_Error("There is a thinker in the fresh list that has already ticked.\n");
 		}
+		node->TickedAt = ThinkTic;
 
 		if (!(node->ObjectFlags & OF_EuthanizeMe))
 		{ // Only tick thinkers not scheduled for destruction
 			ThinkCount++;
 			node->CallTick();
 			node->ObjectFlags &= ~OF_JustSpawned;
+			TrySleep(node, stat);
 			GC::CheckGC();
 		}
 		node = NextToThink;
 	}
+	ThinkingNode = NULL;
 	return count;
 }
 
@@ -600,10 +850,14 @@ int DThinker::ProfileThinkers(FThinkerList *list, FThinkerList *dest)
 		return 0;
 	}
 
+	int stat = int((dest != NULL ? dest : list) - Thinkers);
+	if (dest == NULL) ThinkingNode = list->Sentinel;
+	node = list->Sentinel->NextAwake;
 	while (node != list->Sentinel)
 	{
 		++count;
-		NextToThink = node->NextThinker;
+		NextToThink = node->NextAwake;
+		if (dest == NULL) ThinkingNode = node;
 		if (node->ObjectFlags & OF_JustSpawned)
 		{
 			// Leave OF_JustSpawn set until after Tick() so the ticker can check it.
@@ -618,21 +872,34 @@ int DThinker::ProfileThinkers(FThinkerList *list, FThinkerList *dest)
 		{
 			I_Error("There is a thinker in the fresh list that has already ticked.\n");
 		}
+		node->TickedAt = ThinkTic;
 
 		if (!(node->ObjectFlags & OF_EuthanizeMe))
 		{ // Only tick thinkers not scheduled for destruction
 			ThinkCount++;
 
-			auto &prof = Profiles[node->GetClass()->TypeName];
-			prof.numcalls++;
-			prof.timer.Clock();
+			cycle_t ticktime;
+			ticktime.Reset();
+			ticktime.Clock();
 			node->CallTick();
-			prof.timer.Unclock();
+			ticktime.Unclock();
+			if (profilethinkers)
+			{
+				auto &prof = Profiles[node->GetClass()->TypeName];
+				prof.numcalls++;
+				prof.timems += ticktime.TimeMS();
+			}
+			if (ThinkerProfiler.Active)
+			{
+				ThinkerProfiler.AddThinker(node, ticktime.TimeMS());
+			}
 			node->ObjectFlags &= ~OF_JustSpawned;
+			TrySleep(node, stat);
 			GC::CheckGC();
 		}
 		node = NextToThink;
 	}
+	ThinkingNode = NULL;
 	return count;
 }
 
@@ -852,5 +1119,9 @@ ADD_STAT (think)
 {
 	FString out;
 	out.Format ("Think time = %04.2f ms - %d thinkers, Action = %04.2f ms", ThinkCycles.TimeMS(), ThinkCount, ActionCycles.TimeMS());
+	if (SleepCount > 0)
+	{
+		out.AppendFormat (", %d asleep", SleepCount);
+	}
 	return out;
 }
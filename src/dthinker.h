@@ -91,6 +91,15 @@ public:
 	static DThinker *FirstThinker (int statnum);
 	static bool bSerialOverride;
 
+	// Sleeping thinkers are left out of the thinker loop until they wake up,
+	// either through StopSleeping or because their wake-up tic has come.
+	void Sleep(int stat, int tics);
+	void StopSleeping()
+	{
+		if (ObjectFlags & OF_Sleeping) Wake();
+	}
+	static void WakeSleepers();
+
 	// only used internally but Create needs access.
 	enum no_link_type { NO_LINK };
 	DThinker(no_link_type) throw();
@@ -99,7 +108,10 @@ private:
 	static int TickThinkers (FThinkerList *list, FThinkerList *dest);	// Returns: # of thinkers ticked
 	static int ProfileThinkers(FThinkerList *list, FThinkerList *dest);
 	static void SaveList(FSerializer &arc, DThinker *node);
+	static void RunSleepWheel();
 	void Remove();
+	void Wake();
+	void UnlinkSleeper();
 
 	static FThinkerList Thinkers[MAX_STATNUM+2];		// Current thinkers
 	static FThinkerList FreshThinkers[MAX_STATNUM+1];	// Newly created thinkers
@@ -110,6 +122,13 @@ private:
 	friend class FSerializer;
 
 	DThinker *NextThinker, *PrevThinker;
+
+	// Links between the awake thinkers of a list, in the same order as the list itself.
+	// Sleeping thinkers use them for their slot in the sleep wheel instead.
+	DThinker *NextAwake, *PrevAwake;
+	int TickedAt;					// tic in which the thinker loop last got to this thinker
+	int SleepUntil;					// sleep wheel tic to wake up in, or -1 to sleep until woken
+	int SleepStat;					// statnum of the list the thinker sleeps in
 };
 
 class FThinkerIterator
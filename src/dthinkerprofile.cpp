@@ -0,0 +1,383 @@
+/*
+** dthinkerprofile.cpp
+** Collects where the time in DThinker::RunThinkers goes
+**
+**---------------------------------------------------------------------------
+**
+** Unlike the one-shot profilethinkers CVAR this keeps running until it is
+** stopped. It records time per thinker class and per state action, splits
+** it into native and ZScript time, and keeps a window of per-tic records
+** for histograms and for dumping to CSV or a Chrome trace file
+** (chrome://tracing or https://ui.perfetto.dev).
+**
+*/
+
+#include <stdio.h>
+#include <algorithm>
+
+#include "dthinkerprofile.h"
+#include "dthinker.h"
+#include "doomstat.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "templates.h"
+#include "types.h"
+#include "vm.h"
+
+FThinkerProfiler ThinkerProfiler;
+
+CUSTOM_CVAR(Int, thinkerprofile_window, 350, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+{
+	if (self < 1) self = 1;
+	else ThinkerProfiler.Clear();
+}
+
+static double ThinkerScriptActionMS;
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FThinkerProfiler::Start()
+{
+	Active = true;
+}
+
+void FThinkerProfiler::Stop()
+{
+	Active = false;
+}
+
+void FThinkerProfiler::Clear()
+{
+	Classes.Clear();
+	Actions.Clear();
+	Tics.Clear();
+	NextTic = 0;
+}
+
+//==========================================================================
+//
+// Per-tic bookkeeping
+//
+//==========================================================================
+
+void FThinkerProfiler::BeginTic()
+{
+	CurrentClasses.Clear();
+	CurrentActionMS = 0;
+	CurrentScriptMS = 0;
+	ActionDepth = 0;
+	ThinkerScriptActionMS = 0;
+}
+
+void FThinkerProfiler::EndTic(double thinkms)
+{
+	Tic tic;
+	tic.Gametic = gametic;
+	tic.ThinkMS = thinkms;
+	tic.ActionMS = CurrentActionMS;
+	tic.ScriptMS = CurrentScriptMS;
+
+	TMap<FName, TicClass>::Iterator it(CurrentClasses);
+	TMap<FName, TicClass>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		tic.Classes.Push(pair->Value);
+	}
+	if (tic.Classes.Size() > 1) std::sort(&tic.Classes[0], &tic.Classes[0] + tic.Classes.Size(), [](const TicClass &a, const TicClass &b) { return a.MS > b.MS; });
+
+	unsigned window = thinkerprofile_window;
+	if (Tics.Size() != window)
+	{
+		Tics.Resize(window);
+		for (auto &t : Tics) t.Gametic = -1;
+		NextTic = 0;
+	}
+	Tics[NextTic] = std::move(tic);
+	NextTic = (NextTic + 1) % window;
+}
+
+template<class Func> void FThinkerProfiler::ForEachTic(Func f)
+{
+	for (unsigned i = 0; i < Tics.Size(); i++)
+	{
+		Tic &tic = Tics[(NextTic + i) % Tics.Size()];
+		if (tic.Gametic >= 0) f(tic);
+	}
+}
+
+void FThinkerProfiler::AddThinker(DThinker *thinker, double ms)
+{
+	FName name = thinker->GetClass()->TypeName;
+	bool scripted = false;
+
+	IFVIRTUALPTR(thinker, DThinker, Tick)
+	{
+		scripted = !(func->VarFlags & VARF_Native);
+	}
+
+	Entry &entry = Classes[name];
+	entry.Calls++;
+	entry.TotalMS += ms;
+	entry.MaxMS = MAX(entry.MaxMS, ms);
+	entry.Scripted = scripted;
+
+	TicClass &tc = CurrentClasses[name];
+	if (tc.Name != name)
+	{
+		tc.Name = name;
+		tc.Calls = 0;
+		tc.MS = 0;
+	}
+	tc.Calls++;
+	tc.MS += ms;
+
+	// A scripted Tick already contains the time of any scripted actions it ran
+	CurrentScriptMS += scripted ? ms : ThinkerScriptActionMS;
+	ThinkerScriptActionMS = 0;
+}
+
+void FThinkerProfiler::LeaveAction(VMFunction *func, double ms)
+{
+	bool scripted = !(func->VarFlags & VARF_Native);
+
+	Entry &entry = Actions[func];
+	entry.Calls++;
+	entry.TotalMS += ms;
+	entry.MaxMS = MAX(entry.MaxMS, ms);
+	entry.Scripted = scripted;
+
+	// Only count the outermost action towards the totals, nested calls are part of it.
+	if (--ActionDepth == 0)
+	{
+		CurrentActionMS += ms;
+		if (scripted) ThinkerScriptActionMS += ms;
+	}
+}
+
+//==========================================================================
+//
+// Console output
+//
+//==========================================================================
+
+template<class Key> static void PrintEntries(TMap<Key, FThinkerProfiler::Entry> &map, int limit, const char *(*getname)(const Key &))
+{
+	TArray<typename TMap<Key, FThinkerProfiler::Entry>::Pair *> sorted;
+	typename TMap<Key, FThinkerProfiler::Entry>::Iterator it(map);
+	typename TMap<Key, FThinkerProfiler::Entry>::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		sorted.Push(pair);
+	}
+	if (sorted.Size() > 1) std::sort(&sorted[0], &sorted[0] + sorted.Size(), [](decltype(pair) a, decltype(pair) b) { return a->Value.TotalMS > b->Value.TotalMS; });
+
+	Printf("%-32s %10s %10s %9s %9s\n", "Name", "Calls", "Total ms", "Avg us", "Max us");
+	for (unsigned i = 0; i < sorted.Size() && (int)i < limit; i++)
+	{
+		auto &e = sorted[i]->Value;
+		Printf("%-32s %10u %10.3f %9.2f %9.2f%s\n", getname(sorted[i]->Key), e.Calls, e.TotalMS,
+			e.TotalMS * 1000 / MAX(e.Calls, 1u), e.MaxMS * 1000, e.Scripted ? " (zscript)" : "");
+	}
+}
+
+static const char *ClassName(const FName &name)
+{
+	return name.GetChars();
+}
+
+static const char *ActionName(VMFunction *const &func)
+{
+	return func->PrintableName.GetChars();
+}
+
+void FThinkerProfiler::PrintClasses(int limit)
+{
+	PrintEntries(Classes, limit, ClassName);
+}
+
+void FThinkerProfiler::PrintActions(int limit)
+{
+	PrintEntries(Actions, limit, ActionName);
+}
+
+void FThinkerProfiler::PrintHistogram()
+{
+	static const double edges[] = { 0.5, 1, 2, 4, 8, 16, 1000. / TICRATE };
+	static const int numbuckets = countof(edges) + 1;
+	int buckets[numbuckets] = { 0 };
+	TArray<double> times;
+	double script = 0, action = 0;
+
+	ForEachTic([&](Tic &tic)
+	{
+		int b = 0;
+		while (b < (int)countof(edges) && tic.ThinkMS >= edges[b]) b++;
+		buckets[b]++;
+		times.Push(tic.ThinkMS);
+		script += tic.ScriptMS;
+		action += tic.ActionMS;
+	});
+
+	if (times.Size() == 0)
+	{
+		Printf("No tics recorded\n");
+		return;
+	}
+
+	std::sort(&times[0], &times[0] + times.Size());
+	double total = 0;
+	for (auto t : times) total += t;
+
+	Printf("%u tics: avg %.3f ms, median %.3f ms, 95%% %.3f ms, 99%% %.3f ms, max %.3f ms\n", times.Size(), total / times.Size(),
+		times[times.Size() / 2], times[times.Size() * 95 / 100], times[times.Size() * 99 / 100], times.Last());
+	Printf("Actions %.1f%% of think time, ZScript %.1f%%\n", total > 0 ? action * 100 / total : 0., total > 0 ? script * 100 / total : 0.);
+
+	int most = 1;
+	for (int i = 0; i < numbuckets; i++) most = MAX(most, buckets[i]);
+	for (int i = 0; i < numbuckets; i++)
+	{
+		char bar[41];
+		int len = buckets[i] * 40 / most;
+		memset(bar, '#', len);
+		bar[len] = 0;
+		if (i < (int)countof(edges)) Printf("  < %6.2f ms %6d %s\n", edges[i], buckets[i], bar);
+		else Printf(" >= %6.2f ms %6d %s\n", edges[i - 1], buckets[i], bar);
+	}
+}
+
+//==========================================================================
+//
+// File output
+//
+//==========================================================================
+
+static FString CSVQuote(const char *str)
+{
+	FString out = "\"";
+	for (; *str; str++)
+	{
+		if (*str == '"') out += '"';
+		out += *str;
+	}
+	return out + "\"";
+}
+
+bool FThinkerProfiler::DumpCSV(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == nullptr) return false;
+
+	fprintf(f, "kind,name,calls,total_ms,max_ms,zscript\n");
+	{
+		TMap<FName, Entry>::Iterator it(Classes);
+		TMap<FName, Entry>::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto &e = pair->Value;
+			fprintf(f, "class,%s,%u,%f,%f,%d\n", CSVQuote(pair->Key.GetChars()).GetChars(), e.Calls, e.TotalMS, e.MaxMS, e.Scripted);
+		}
+	}
+	{
+		TMap<VMFunction *, Entry>::Iterator it(Actions);
+		TMap<VMFunction *, Entry>::Pair *pair;
+		while (it.NextPair(pair))
+		{
+			auto &e = pair->Value;
+			fprintf(f, "action,%s,%u,%f,%f,%d\n", CSVQuote(pair->Key->PrintableName).GetChars(), e.Calls, e.TotalMS, e.MaxMS, e.Scripted);
+		}
+	}
+
+	fprintf(f, "\ntic,think_ms,action_ms,zscript_ms\n");
+	ForEachTic([=](Tic &tic)
+	{
+		fprintf(f, "%d,%f,%f,%f\n", tic.Gametic, tic.ThinkMS, tic.ActionMS, tic.ScriptMS);
+	});
+
+	fclose(f);
+	return true;
+}
+
+bool FThinkerProfiler::DumpTrace(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	if (f == nullptr) return false;
+
+	// Each tic is laid out at its game time, with the classes that ticked in it
+	// as consecutive children, largest first.
+	fprintf(f, "{\"traceEvents\":[\n");
+	bool first = true;
+	ForEachTic([&](Tic &tic)
+	{
+		double start = tic.Gametic * 1000000. / TICRATE;
+		fprintf(f, "%s{\"name\":\"tic %d\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"action_ms\":%f,\"zscript_ms\":%f}}",
+			first ? "" : ",\n", tic.Gametic, start, tic.ThinkMS * 1000, tic.ActionMS, tic.ScriptMS);
+		first = false;
+
+		for (auto &tc : tic.Classes)
+		{
+			fprintf(f, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"calls\":%u}}",
+				tc.Name.GetChars(), start, tc.MS * 1000, tc.Calls);
+			start += tc.MS * 1000;
+		}
+	});
+	fprintf(f, "\n]}\n");
+
+	fclose(f);
+	return true;
+}
+
+//==========================================================================
+//
+// CCMD thinkerprofile
+//
+//==========================================================================
+
+CCMD(thinkerprofile)
+{
+	const char *cmd = argv.argc() > 1 ? argv[1] : "";
+	int limit = argv.argc() > 2 ? atoi(argv[2]) : 20;
+
+	if (!stricmp(cmd, "start"))
+	{
+		ThinkerProfiler.Start();
+	}
+	else if (!stricmp(cmd, "stop"))
+	{
+		ThinkerProfiler.Stop();
+	}
+	else if (!stricmp(cmd, "clear"))
+	{
+		ThinkerProfiler.Clear();
+	}
+	else if (!stricmp(cmd, "classes"))
+	{
+		ThinkerProfiler.PrintClasses(limit);
+	}
+	else if (!stricmp(cmd, "actions"))
+	{
+		ThinkerProfiler.PrintActions(limit);
+	}
+	else if (!stricmp(cmd, "histogram"))
+	{
+		ThinkerProfiler.PrintHistogram();
+	}
+	else if (!stricmp(cmd, "dump") && argv.argc() > 2)
+	{
+		FString filename = argv[2];
+		bool ok = !filename.Right(5).CompareNoCase(".json") ? ThinkerProfiler.DumpTrace(filename) : ThinkerProfiler.DumpCSV(filename);
+		if (ok) Printf("Wrote %s\n", filename.GetChars());
+		else Printf("Could not write %s\n", filename.GetChars());
+	}
+	else
+	{
+		Printf("Thinker profiling is %s\n", ThinkerProfiler.Active ? "on" : "off");
+		Printf("thinkerprofile start|stop|clear\n");
+		Printf("thinkerprofile classes|actions [<limit>]\n");
+		Printf("thinkerprofile histogram\n");
+		Printf("thinkerprofile dump <file.csv|file.json>\n");
+	}
+}
@@ -0,0 +1,101 @@
+#ifndef __DTHINKERPROFILE_H__
+#define __DTHINKERPROFILE_H__
+
+#include "name.h"
+#include "tarray.h"
+#include "stats.h"
+
+class DThinker;
+class VMFunction;
+
+// Persistent profiler for DThinker::RunThinkers, controlled with the thinkerprofile command.
+class FThinkerProfiler
+{
+public:
+	struct Entry
+	{
+		unsigned Calls = 0;
+		double TotalMS = 0;
+		double MaxMS = 0;
+		bool Scripted = false;		// runs a ZScript function instead of a native one
+	};
+
+	struct TicClass
+	{
+		FName Name;
+		unsigned Calls;
+		double MS;
+	};
+
+	struct Tic
+	{
+		int Gametic;
+		double ThinkMS;
+		double ActionMS;
+		double ScriptMS;			// part of ThinkMS spent in scripted Tick overrides and actions
+		TArray<TicClass> Classes;
+	};
+
+	bool Active = false;
+
+	void Start();
+	void Stop();
+	void Clear();
+
+	void BeginTic();
+	void EndTic(double thinkms);
+	void AddThinker(DThinker *thinker, double ms);
+	void EnterAction() { ActionDepth++; }
+	void LeaveAction(VMFunction *func, double ms);
+
+	void PrintClasses(int limit);
+	void PrintActions(int limit);
+	void PrintHistogram();
+	bool DumpCSV(const char *filename);
+	bool DumpTrace(const char *filename);
+
+private:
+	TMap<FName, Entry> Classes;
+	TMap<VMFunction *, Entry> Actions;
+	TArray<Tic> Tics;				// ring buffer of the last thinkerprofile_window tics
+	unsigned NextTic = 0;
+
+	TMap<FName, TicClass> CurrentClasses;
+	double CurrentActionMS = 0;
+	double CurrentScriptMS = 0;
+	int ActionDepth = 0;
+
+	template<class Func> void ForEachTic(Func f);
+};
+
+extern FThinkerProfiler ThinkerProfiler;
+
+// Times one action call for the profiler. Leaving the scope through an
+// exception still ends the action, so the nesting depth stays balanced.
+class FProfiledAction
+{
+	VMFunction *Func;
+	cycle_t Time;
+
+public:
+	FProfiledAction(VMFunction *func) : Func(func)
+	{
+		if (Func != nullptr)
+		{
+			ThinkerProfiler.EnterAction();
+			Time.Reset();
+			Time.Clock();
+		}
+	}
+
+	~FProfiledAction()
+	{
+		if (Func != nullptr)
+		{
+			Time.Unclock();
+			ThinkerProfiler.LeaveAction(Func, Time.TimeMS());
+		}
+	}
+};
+
+#endif
@@ -62,6 +62,29 @@ struct SM64DynamicDoomSector
 	sector_t* sec;
 };
 
+struct FPolyObj;
+class DThinker;
+
+struct SM64DynamicPolyobj
+{
+	struct SM64DynamicObject walls;
+	FPolyObj* poly;
+	bool dirty; // set by MovePolyobj/RotatePolyobj, cleared once the transform is pushed to libsm64
+};
+
+struct SM64Dynamic3DFloor
+{
+	struct SM64DynamicObject top, walls, bottom;
+	float topSpawnZ, wallsSpawnZ, bottomSpawnZ;
+	float thickness; // top minus bottom when walls and bottom were built
+	F3DFloor* ffloor;
+	bool dirty; // set when the control sector's planes move
+};
+
+void P_SM64PolyobjMoved(FPolyObj *poly);
+void P_SM64SectorPlaneMoved(sector_t *sec);
+void P_SM64RebuildXFloorSides(SM64Dynamic3DFloor *dynfloor);
+
 struct FLevelLocals
 {
 	void Tick ();
@@ -92,6 +115,8 @@ struct FLevelLocals
 	TArray<sector_t> sectors;
 	TArray<line_t*> linebuffer;	// contains the line lists for the sectors.
 	TArray<SM64DynamicDoomSector> dynamicObjects; // SM64
+	TArray<SM64DynamicPolyobj> dynamicPolyobjs; // SM64, parallel to polyobjs[]
+	TArray<SM64Dynamic3DFloor> dynamic3DFloors; // SM64
 	TArray<line_t> lines;
 	TArray<side_t> sides;
 	TArray<seg_t> segs;
@@ -101,6 +126,7 @@ struct FLevelLocals
 	TArray<node_t> gamenodes;
 	node_t *headgamenode;
 	TArray<uint8_t> rejectmatrix;
+	TArray<uint8_t> sightpvs;	// generated stand-in for a missing REJECT, same layout
 
 	TArray<FSectorPortal> sectorPortals;
 	TArray<zone_t>	Zones;
@@ -156,6 +182,13 @@ struct FLevelLocals
 
 	TArray<DVector2>	Scrolls;		// NULL if no DScrollers in this level
 
+	// Sleeping thinkers that have to wake up after some tics wait in a timing
+	// wheel, indexed by the tic they wake up in (see DThinker::Sleep).
+	enum { SLEEP_WHEEL_SIZE = 256 };
+	DThinker	*SleepWheel[SLEEP_WHEEL_SIZE];
+	int			SleepClock;				// counts the tics in which time wasn't frozen
+	bool		SleepClockRunning;
+
 	int8_t		WallVertLight;			// Light diffs for vert/horiz walls
 	int8_t		WallHorizLight;
 
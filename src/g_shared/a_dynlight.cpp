@@ -75,6 +75,9 @@
 #include "c_cvars.h"
 #include "gl/system//gl_interface.h"
 #include "vm.h"
+#include "parallel_for.h"
+
+#include <thread>
 
 extern int currentrenderer;
 
@@ -86,6 +89,7 @@ CUSTOM_CVAR (Bool, gl_lights, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOIN
 }
 
 CVAR (Bool, gl_attachedlights, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR (Bool, r_parallellightlinks, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 
 //==========================================================================
 //
@@ -409,7 +413,7 @@ void ADynamicLight::UpdateLocation()
 		if (X() != oldx || Y() != oldy || radius != oldradius)
 		{
 			//Update the light lists
-			LinkLight();
+			RequestLink();
 		}
 	}
 }
@@ -424,7 +428,7 @@ void ADynamicLight::UpdateLocation()
 void ADynamicLight::SetOrigin(double x, double y, double z, bool moving)
 {
 	Super::SetOrigin(x, y, z, moving);
-	LinkLight();
+	RequestLink();
 }
 
 //==========================================================================
@@ -567,31 +571,82 @@ double ADynamicLight::DistToSeg(const DVector3 &pos, seg_t *seg)
 // Collect all touched sidedefs and subsectors
 // to sidedefs and sector parts.
 //
+// This only reads the level, so that lights can be collected on
+// several threads. Each collector has its own visit markers instead
+// of using validcount.
+//
 //==========================================================================
 struct LightLinkEntry
 {
 	subsector_t *sub;
 	DVector3 pos;
 };
-static TArray<LightLinkEntry> collected_ss;
 
-void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSec, float radius)
+struct FLightLinkCollector
+{
+	TArray<LightLinkEntry> collected_ss;
+	TArray<int> subsectorMarks;
+	TArray<int> sectorMarks;
+	TArray<int> lineMarks;
+	int mark = 0;
+
+	void Prepare()
+	{
+		if (subsectorMarks.Size() != level.subsectors.Size() || sectorMarks.Size() != level.sectors.Size() || lineMarks.Size() != level.lines.Size())
+		{
+			subsectorMarks.Resize(level.subsectors.Size());
+			sectorMarks.Resize(level.sectors.Size());
+			lineMarks.Resize(level.lines.Size());
+			for (auto &m : subsectorMarks) m = 0;
+			for (auto &m : sectorMarks) m = 0;
+			for (auto &m : lineMarks) m = 0;
+			mark = 0;
+		}
+	}
+
+	// Returns true the first time something is checked since the last mark++
+	bool Visit(TArray<int> &marks, int index)
+	{
+		if (marks[index] == mark) return false;
+		marks[index] = mark;
+		return true;
+	}
+
+	bool Visited(TArray<int> &marks, int index) const
+	{
+		return marks[index] == mark;
+	}
+};
+
+struct FLightLinks
+{
+	TArray<subsector_t *> subsectors;
+	TArray<subsector_t *> sectors;	// the first subsector reached in each sector
+	TArray<side_t *> sides;
+	bool collected;
+	bool hitonesidedback;
+};
+
+static FLightLinkCollector MainLightCollector;
+static FLightLinks MainLightLinks;
+
+void ADynamicLight::CollectWithinRadius(FLightLinkCollector &collector, FLightLinks &links, const DVector3 &opos, subsector_t *subSec, float radius) const
 {
 	if (!subSec) return;
+	auto &collected_ss = collector.collected_ss;
 	collected_ss.Clear();
 	collected_ss.Push({ subSec, opos });
-	subSec->validcount = ::validcount;
+	collector.Visit(collector.subsectorMarks, subSec->Index());
 
 	bool hitonesidedback = false;
 	for (unsigned i = 0; i < collected_ss.Size(); i++)
 	{
 		subSec = collected_ss[i].sub;
 
-		touching_subsectors = AddLightNode(&subSec->lighthead, subSec, this, touching_subsectors);
-		if (subSec->sector->validcount != ::validcount)
+		links.subsectors.Push(subSec);
+		if (collector.Visit(collector.sectorMarks, subSec->sector->Index()))
 		{
-			touching_sector = AddLightNode(&subSec->render_sector->lighthead, subSec->sector, this, touching_sector);
-			subSec->sector->validcount = ::validcount;
+			links.sectors.Push(subSec);
 		}
 
 		for (unsigned int j = 0; j < subSec->numlines; ++j)
@@ -603,13 +658,13 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 			// If out of range we do not need to bother with this seg.
 			if (DistToSeg(pos, seg) <= radius)
 			{
-				if (seg->sidedef && seg->linedef && seg->linedef->validcount != ::validcount)
+				if (seg->sidedef && seg->linedef && !collector.Visited(collector.lineMarks, seg->linedef->Index()))
 				{
 					// light is in front of the seg
 					if ((pos.Y - seg->v1->fY()) * (seg->v2->fX() - seg->v1->fX()) + (seg->v1->fX() - pos.X) * (seg->v2->fY() - seg->v1->fY()) <= 0)
 					{
-						seg->linedef->validcount = validcount;
-						touching_sides = AddLightNode(&seg->sidedef->lighthead, seg->sidedef, this, touching_sides);
+						collector.Visit(collector.lineMarks, seg->linedef->Index());
+						links.sides.Push(seg->sidedef);
 					}
 					else if (seg->linedef->sidedef[0] == seg->sidedef && seg->linedef->sidedef[1] == nullptr)
 					{
@@ -622,12 +677,11 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 					if (port && port->mType == PORTT_LINKED)
 					{
 						line_t *other = port->mDestination;
-						if (other->validcount != ::validcount)
+						if (!collector.Visited(collector.lineMarks, other->Index()))
 						{
 							subsector_t *othersub = R_PointInSubsector(other->v1->fPos() + other->Delta() / 2);
-							if (othersub->validcount != ::validcount)
+							if (collector.Visit(collector.subsectorMarks, othersub->Index()))
 							{
-								othersub->validcount = ::validcount;
 								collected_ss.Push({ othersub, PosRelative(other) });
 							}
 						}
@@ -638,9 +692,8 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 				if (partner)
 				{
 					subsector_t *sub = partner->Subsector;
-					if (sub != NULL && sub->validcount != ::validcount)
+					if (sub != NULL && collector.Visit(collector.subsectorMarks, sub->Index()))
 					{
-						sub->validcount = ::validcount;
 						collected_ss.Push({ sub, pos });
 					}
 				}
@@ -654,9 +707,8 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 			{
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::ceiling);
 				subsector_t *othersub = R_PointInSubsector(refpos);
-				if (othersub->validcount != ::validcount)
+				if (collector.Visit(collector.subsectorMarks, othersub->Index()))
 				{
-					othersub->validcount = ::validcount;
 					collected_ss.Push({ othersub, PosRelative(othersub->sector) });
 				}
 			}
@@ -668,15 +720,38 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 			{
 				DVector2 refpos = other->v1->fPos() + other->Delta() / 2 + sec->GetPortalDisplacement(sector_t::floor);
 				subsector_t *othersub = R_PointInSubsector(refpos);
-				if (othersub->validcount != ::validcount)
+				if (collector.Visit(collector.subsectorMarks, othersub->Index()))
 				{
-					othersub->validcount = ::validcount;
 					collected_ss.Push({ othersub, PosRelative(othersub->sector) });
 				}
 			}
 		}
 	}
-	shadowmapped = hitonesidedback && !(lightflags & LF_NOSHADOWMAP);
+	links.collected = true;
+	links.hitonesidedback = hitonesidedback;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void ADynamicLight::CollectLinks(FLightLinkCollector &collector, FLightLinks &links) const
+{
+	links.subsectors.Clear();
+	links.sectors.Clear();
+	links.sides.Clear();
+	links.collected = false;
+	links.hitonesidedback = false;
+
+	if (radius>0)
+	{
+		// passing in radius*radius allows us to do a distance check without any calls to sqrt
+		subsector_t * subSec = R_PointInSubsector(Pos());
+		collector.mark++;
+		CollectWithinRadius(collector, links, Pos(), subSec, float(radius*radius));
+	}
 }
 
 //==========================================================================
@@ -686,6 +761,13 @@ void ADynamicLight::CollectWithinRadius(const DVector3 &opos, subsector_t *subSe
 //==========================================================================
 
 void ADynamicLight::LinkLight()
+{
+	MainLightCollector.Prepare();
+	CollectLinks(MainLightCollector, MainLightLinks);
+	ApplyLinks(MainLightLinks);
+}
+
+void ADynamicLight::ApplyLinks(const FLightLinks &links)
 {
 	// mark the old light nodes
 	FLightNode * node;
@@ -709,13 +791,21 @@ void ADynamicLight::LinkLight()
 		node = node->nextTarget;
 	}
 
-	if (radius>0)
+	for (auto sub : links.subsectors)
 	{
-		// passing in radius*radius allows us to do a distance check without any calls to sqrt
-		subsector_t * subSec = R_PointInSubsector(Pos());
-		::validcount++;
-		CollectWithinRadius(Pos(), subSec, float(radius*radius));
-
+		touching_subsectors = AddLightNode(&sub->lighthead, sub, this, touching_subsectors);
+	}
+	for (auto sub : links.sectors)
+	{
+		touching_sector = AddLightNode(&sub->render_sector->lighthead, sub->sector, this, touching_sector);
+	}
+	for (auto side : links.sides)
+	{
+		touching_sides = AddLightNode(&side->lighthead, side, this, touching_sides);
+	}
+	if (links.collected)
+	{
+		shadowmapped = links.hitonesidedback && !(lightflags & LF_NOSHADOWMAP);
 	}
 		
 	// Now delete any nodes that won't be used. These are the ones where
@@ -755,6 +845,98 @@ void ADynamicLight::LinkLight()
 	}
 }
 
+//==========================================================================
+//
+// Batched relinking
+//
+// While the thinkers run, lights that moved only get queued. Afterwards
+// all of them are collected at once, on several threads if there are
+// enough, and then linked in the order they were queued in, which is
+// the order the thinkers would have linked them in.
+//
+//==========================================================================
+
+static bool DeferLightLinks;
+static TArray<ADynamicLight *> PendingLightLinks;
+static TArray<FLightLinks> PendingLightResults;
+static TArray<FLightLinkCollector *> LightCollectors;
+
+void ADynamicLight::RequestLink()
+{
+	if (!DeferLightLinks)
+	{
+		LinkLight();
+	}
+	else if (!linkpending)
+	{
+		linkpending = true;
+		PendingLightLinks.Push(this);
+	}
+}
+
+void ADynamicLight::BeginLinkBatch()
+{
+	DeferLightLinks = true;
+}
+
+void ADynamicLight::FinishLinkBatch()
+{
+	DeferLightLinks = false;
+
+	// Lights destroyed in the meantime have left a null here.
+	unsigned count = 0;
+	for (auto light : PendingLightLinks)
+	{
+		if (light != nullptr) PendingLightLinks[count++] = light;
+	}
+	PendingLightLinks.Resize(count);
+	if (count == 0)
+	{
+		return;
+	}
+
+	if (PendingLightResults.Size() < count)
+	{
+		PendingLightResults.Resize(count);
+	}
+
+	int numWorkers = r_parallellightlinks && count >= 16 ? clamp((int)std::thread::hardware_concurrency(), 1, 16) : 1;
+	while ((int)LightCollectors.Size() < numWorkers)
+	{
+		LightCollectors.Push(new FLightLinkCollector);
+	}
+	for (int i = 0; i < numWorkers; i++)
+	{
+		LightCollectors[i]->Prepare();
+	}
+
+	if (numWorkers == 1)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			PendingLightLinks[i]->CollectLinks(*LightCollectors[0], PendingLightResults[i]);
+		}
+	}
+	else
+	{
+		parallel_for(numWorkers, [=](int worker)
+		{
+			if (worker >= numWorkers) return;
+			FLightLinkCollector &collector = *LightCollectors[worker];
+			for (unsigned i = worker; i < count; i += numWorkers)
+			{
+				PendingLightLinks[i]->CollectLinks(collector, PendingLightResults[i]);
+			}
+		});
+	}
+
+	for (unsigned i = 0; i < count; i++)
+	{
+		PendingLightLinks[i]->linkpending = false;
+		PendingLightLinks[i]->ApplyLinks(PendingLightResults[i]);
+	}
+	PendingLightLinks.Clear();
+}
 
 //==========================================================================
 //
@@ -783,6 +965,14 @@ void ADynamicLight::UnlinkLight ()
 
 void ADynamicLight::OnDestroy()
 {
+	if (linkpending)
+	{
+		for (auto &light : PendingLightLinks)
+		{
+			if (light == this) light = nullptr;
+		}
+		linkpending = false;
+	}
 	UnlinkLight();
 	Super::OnDestroy();
 }
@@ -9,6 +9,8 @@ EXTERN_CVAR(Bool, gl_attachedlights)
 class ADynamicLight;
 class FSerializer;
 class FLightDefaults;
+struct FLightLinkCollector;
+struct FLightLinks;
 
 
 enum
@@ -85,6 +87,7 @@ public:
 	uint8_t GetBlue() const { return args[LIGHT_BLUE]; }
 	float GetRadius() const { return (IsActive() ? m_currentRadius * 2.f : 0.f); }
 	void LinkLight();
+	void RequestLink();
 	void UnlinkLight();
 	size_t PointerSubstitution(DObject *old, DObject *notOld);
 
@@ -100,14 +103,21 @@ public:
 	bool IsActive() const { return !(flags2&MF2_DORMANT); }
 	bool IsSubtractive() { return !!(lightflags & LF_SUBTRACTIVE); }
 	bool IsAdditive() { return !!(lightflags & LF_ADDITIVE); }
+
+	// Links of lights moved while the thinkers run get batched up until FinishLinkBatch.
+	static void BeginLinkBatch();
+	static void FinishLinkBatch();
+
 	FState *targetState;
 	FLightNode * touching_sides;
 	FLightNode * touching_subsectors;
 	FLightNode * touching_sector;
 
 private:
-	double DistToSeg(const DVector3 &pos, seg_t *seg);
-	void CollectWithinRadius(const DVector3 &pos, subsector_t *subSec, float radius);
+	static double DistToSeg(const DVector3 &pos, seg_t *seg);
+	void CollectWithinRadius(FLightLinkCollector &collector, FLightLinks &links, const DVector3 &pos, subsector_t *subSec, float radius) const;
+	void CollectLinks(FLightLinkCollector &collector, FLightLinks &links) const;
+	void ApplyLinks(const FLightLinks &links);
 
 protected:
 	DVector3 m_off;
@@ -125,6 +135,7 @@ public:
 	bool visibletoplayer;
 	bool swapped;
 	bool shadowmapped;
+	bool linkpending;
 	int bufferindex;
 	LightFlags lightflags;
 
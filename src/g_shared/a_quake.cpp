@@ -152,6 +152,7 @@ void DEarthquake::Tick ()
 					}
 					// Thrust player around
 					DAngle an = victim->Angles.Yaw + pr_quake();
+					victim->StopSleeping();
 					victim->Vel.X += m_Intensity.X * an.Cos() * 0.5;
 					victim->Vel.Y += m_Intensity.Y * an.Sin() * 0.5;
 				}
@@ -57,6 +57,7 @@
 #include "events.h"
 #include "types.h"
 #include "vm.h"
+#include "dthinkerprofile.h"
 
 extern void LoadActors ();
 extern void InitBotStuff();
@@ -131,6 +132,8 @@ bool FState::CallAction(AActor *self, AActor *stateowner, FStateParamInfo *info,
 	{
 		ActionCycles.Clock();
 
+		FProfiledAction profile(ThinkerProfiler.Active ? ActionFunc : nullptr);
+
 		VMValue params[3] = { self, stateowner, VMValue(info) };
 		// If the function returns a state, store it at *stateret.
 		// If it doesn't return a state but stateret is non-nullptr, we need
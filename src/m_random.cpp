@@ -402,6 +402,49 @@ FRandom *FRandom::StaticFindRNG (const char *name)
 	return probe;
 }
 
+//==========================================================================
+//
+// FRandom :: StaticFindRNGByCRC
+//
+// Returns an existing RNG with the given name CRC or NULL if there is none.
+// The script cache uses this to restore RNG references in compiled code.
+//
+//==========================================================================
+
+FRandom *FRandom::StaticFindRNGByCRC (uint32_t crc)
+{
+	if (crc == 0) return &pr_exrandom;
+
+	for (FRandom *probe = RNGList; probe != NULL && probe->NameCRC <= crc; probe = probe->Next)
+	{
+		if (probe->NameCRC == crc)
+		{
+			return probe;
+		}
+	}
+	return NULL;
+}
+
+//==========================================================================
+//
+// FRandom :: StaticGetRNGCRC
+//
+// Returns the name CRC of a registered RNG or 0 if it is not in the list.
+//
+//==========================================================================
+
+uint32_t FRandom::StaticGetRNGCRC (const FRandom *rng)
+{
+	for (FRandom *probe = RNGList; probe != NULL; probe = probe->Next)
+	{
+		if (probe == rng)
+		{
+			return probe->NameCRC;
+		}
+	}
+	return 0;
+}
+
 //==========================================================================
 //
 // FRandom :: StaticPrintSeeds
@@ -800,6 +800,7 @@ xx(BuiltinHandleRuntimeState)
 xx(BuiltinGetDefault)
 xx(BuiltinClassCast)
 xx(BuiltinFormat)
+xx(BuiltinWakeActor)
 xx(Damage)
 xx(Noattack)
 
@@ -419,6 +419,9 @@ void P_Recalculate3DFloors(sector_t * sector)
 	lightlist_t newlight;
 	lightlist_t resetlight;	// what it goes back to after FF_DOUBLESHADOW
 
+	// Sight checks look at the sorted 3D floors.
+	P_SightGeometryChanged();
+
 	TArray<F3DFloor*> & ffloors=sector->e->XFloor.ffloors;
 	TArray<lightlist_t> & lightlist = sector->e->XFloor.lightlist;
 
@@ -924,6 +924,18 @@ FACSStack::~FACSStack()
 //     about always having the same libraries loaded in the same order on
 //     every map that needs to use those strings.
 //
+// Most strings are per-tic temporaries (strparam results that are printed
+// and forgotten), so new strings start out in a nursery. At the end of each
+// tic the nursery is collected against a cheap root set: the ACS stacks,
+// running scripts' local variables and the scalar map, world and global
+// variables. Strings stored into map, world or global arrays are promoted
+// right away when the store happens, so the arrays, which can be huge, never
+// need to be scanned for a nursery collection. The same goes for values that
+// leave ACS altogether: script results returned to the game, arguments of
+// deferred scripts, int arguments to ScriptCall, actor user variables and
+// line and thing special arguments. Anything that survives is promoted to the
+// long-lived generation and is only reclaimed by the full collection above.
+//
 //----------------------------------------------------------------------------
 
 ACSStringPool GlobalACSStrings;
@@ -947,8 +959,11 @@ void ACSStringPool::PoolEntry::Unlock()
 
 ACSStringPool::ACSStringPool()
 {
-	memset(PoolBuckets, 0xFF, sizeof(PoolBuckets));
 	FirstFreeEntry = 0;
+	LiveCount = 0;
+	Lookups = Hits = 0;
+	Inserted = Freed = FreedYoung = 0;
+	ResizeBuckets(MIN_BUCKETS);
 }
 
 //============================================================================
@@ -962,8 +977,35 @@ ACSStringPool::ACSStringPool()
 void ACSStringPool::Clear()
 {
 	Pool.Clear();
-	memset(PoolBuckets, 0xFF, sizeof(PoolBuckets));
+	Nursery.Clear();
 	FirstFreeEntry = 0;
+	LiveCount = 0;
+	ResizeBuckets(MIN_BUCKETS);
+}
+
+//============================================================================
+//
+// ACSStringPool :: ResizeBuckets
+//
+// Sets the number of hash buckets and relinks every string in the pool.
+//
+//============================================================================
+
+void ACSStringPool::ResizeBuckets(unsigned int numbuckets)
+{
+	assert((numbuckets & (numbuckets - 1)) == 0);
+	PoolBuckets.Resize(numbuckets);
+	memset(&PoolBuckets[0], 0xFF, numbuckets * sizeof(unsigned int));
+	for (unsigned int i = 0; i < Pool.Size(); ++i)
+	{
+		PoolEntry *entry = &Pool[i];
+		if (entry->Next != FREE_ENTRY)
+		{
+			unsigned int h = BucketFor(entry->Hash);
+			entry->Next = PoolBuckets[h];
+			PoolBuckets[h] = i;
+		}
+	}
 }
 
 //============================================================================
@@ -980,26 +1022,24 @@ int ACSStringPool::AddString(const char *str)
 	if (str == nullptr) str = "";
 	size_t len = strlen(str);
 	unsigned int h = SuperFastHash(str, len);
-	unsigned int bucketnum = h % NUM_BUCKETS;
-	int i = FindString(str, len, h, bucketnum);
+	int i = FindString(str, len, h, BucketFor(h));
 	if (i >= 0)
 	{
 		return i | STRPOOL_LIBRARYID_OR;
 	}
 	FString fstr(str);
-	return InsertString(fstr, h, bucketnum);
+	return InsertString(fstr, h);
 }
 
 int ACSStringPool::AddString(FString &str)
 {
 	unsigned int h = SuperFastHash(str.GetChars(), str.Len());
-	unsigned int bucketnum = h % NUM_BUCKETS;
-	int i = FindString(str, str.Len(), h, bucketnum);
+	int i = FindString(str, str.Len(), h, BucketFor(h));
 	if (i >= 0)
 	{
 		return i | STRPOOL_LIBRARYID_OR;
 	}
-	return InsertString(str, h, bucketnum);
+	return InsertString(str, h);
 }
 
 //============================================================================
@@ -1180,6 +1220,55 @@ void ACSStringPool::MarkStringMap(const FWorldGlobalArray &aray)
 //
 //============================================================================
 
+//============================================================================
+//
+// ACSStringPool :: ResetMarks
+//
+// Clears every entry's mark. A nursery collection marks whatever long-lived
+// strings its roots happen to reference, so a full collection starts from
+// a clean slate.
+//
+//============================================================================
+
+void ACSStringPool::ResetMarks()
+{
+	for (unsigned int i = 0; i < Pool.Size(); ++i)
+	{
+		Pool[i].Mark = false;
+	}
+}
+
+//============================================================================
+//
+// ACSStringPool :: PromoteString
+//
+// Moves a string out of the nursery so that nursery collections will leave
+// it alone. Values that are not strings in this pool are silently ignored.
+// Called when a string is stored somewhere a nursery collection does not
+// look at.
+//
+//============================================================================
+
+void ACSStringPool::PromoteString(int strnum)
+{
+	if ((strnum & LIBRARYID_MASK) == STRPOOL_LIBRARYID_OR)
+	{
+		strnum &= ~LIBRARYID_MASK;
+		if ((unsigned)strnum < Pool.Size())
+		{
+			Pool[strnum].Young = false;
+		}
+	}
+}
+
+void ACSStringPool::PromoteStringArray(const int *strnum, unsigned int count)
+{
+	for (unsigned int i = 0; i < count; ++i)
+	{
+		PromoteString(strnum[i]);
+	}
+}
+
 void ACSStringPool::UnlockAll()
 {
 	for (unsigned int i = 0; i < Pool.Size(); ++i)
@@ -1201,7 +1290,7 @@ void ACSStringPool::PurgeStrings()
 {
 	// Clear the hash buckets. We'll rebuild them as we decide what strings
 	// to keep and which to toss.
-	memset(PoolBuckets, 0xFF, sizeof(PoolBuckets));
+	memset(&PoolBuckets[0], 0xFF, PoolBuckets.Size() * sizeof(unsigned int));
 	size_t usedcount = 0, freedcount = 0;
 	for (unsigned int i = 0; i < Pool.Size(); ++i)
 	{
@@ -1224,14 +1313,68 @@ void ACSStringPool::PurgeStrings()
 			{
 				usedcount++;
 				// Rehash this entry.
-				unsigned int h = entry->Hash % NUM_BUCKETS;
+				unsigned int h = BucketFor(entry->Hash);
 				entry->Next = PoolBuckets[h];
 				PoolBuckets[h] = i;
-				// Remove MarkString's mark.
+				// Remove MarkString's mark. Everything left is long-lived now.
 				entry->Mark = false;
+				entry->Young = false;
 			}
 		}
 	}
+	Nursery.Clear();
+	LiveCount = (unsigned int)usedcount;
+	Freed += (unsigned int)freedcount;
+}
+
+//============================================================================
+//
+// ACSStringPool :: PurgeNursery
+//
+// Removes all unmarked, unlocked strings that were added since the last
+// collection and promotes the rest. Strings outside the nursery are not
+// touched, so the cost depends only on how many strings were made since
+// last time.
+//
+//============================================================================
+
+void ACSStringPool::PurgeNursery()
+{
+	for (unsigned int i = 0; i < Nursery.Size(); ++i)
+	{
+		unsigned int index = Nursery[i];
+		PoolEntry *entry = &Pool[index];
+		assert(entry->Next != FREE_ENTRY);
+		if (!entry->Young)
+		{ // Already promoted.
+			continue;
+		}
+		entry->Young = false;
+		if (entry->Locks.Size() != 0 || entry->Mark)
+		{
+			entry->Mark = false;
+			continue;
+		}
+		// Unlink this entry from its hash chain.
+		unsigned int *link = &PoolBuckets[BucketFor(entry->Hash)];
+		while (*link != index)
+		{
+			assert(*link != NO_ENTRY);
+			link = &Pool[*link].Next;
+		}
+		*link = entry->Next;
+		// Mark this entry as free and free the string.
+		entry->Next = FREE_ENTRY;
+		entry->Str = "";
+		if (index < FirstFreeEntry)
+		{
+			FirstFreeEntry = index;
+		}
+		LiveCount--;
+		Freed++;
+		FreedYoung++;
+	}
+	Nursery.Clear();
 }
 
 //============================================================================
@@ -1253,10 +1396,13 @@ int ACSStringPool::FindString(const char *str, size_t len, unsigned int h, unsig
 		if (entry->Hash == h && entry->Str.Len() == len &&
 			memcmp(entry->Str.GetChars(), str, len) == 0)
 		{
+			Lookups++;
+			Hits++;
 			return i;
 		}
 		i = entry->Next;
 	}
+	Lookups++;
 	return -1;
 }
 
@@ -1268,7 +1414,7 @@ int ACSStringPool::FindString(const char *str, size_t len, unsigned int h, unsig
 //
 //============================================================================
 
-int ACSStringPool::InsertString(FString &str, unsigned int h, unsigned int bucketnum)
+int ACSStringPool::InsertString(FString &str, unsigned int h)
 {
 	unsigned int index = FirstFreeEntry;
 	if (index >= MIN_GC_SIZE && index == Pool.Max())
@@ -1280,6 +1426,10 @@ int ACSStringPool::InsertString(FString &str, unsigned int h, unsigned int bucke
 	{ // If we go any higher, we'll collide with the library ID marker.
 		return -1;
 	}
+	if (LiveCount >= PoolBuckets.Size())
+	{ // Keep the load factor at or below 1.
+		ResizeBuckets(PoolBuckets.Size() * 2);
+	}
 	if (index == Pool.Size())
 	{ // There were no free entries; make a new one.
 		Pool.Reserve(1);
@@ -1289,13 +1439,18 @@ int ACSStringPool::InsertString(FString &str, unsigned int h, unsigned int bucke
 	{ // Scan for the next free entry
 		FindFirstFreeEntry(FirstFreeEntry + 1);
 	}
+	unsigned int bucketnum = BucketFor(h);
 	PoolEntry *entry = &Pool[index];
 	entry->Str = str;
 	entry->Hash = h;
 	entry->Next = PoolBuckets[bucketnum];
 	entry->Mark = false;
+	entry->Young = true;
 	entry->Locks.Clear();
 	PoolBuckets[bucketnum] = index;
+	Nursery.Push(index);
+	LiveCount++;
+	Inserted++;
 	return index | STRPOOL_LIBRARYID_OR;
 }
 
@@ -1338,6 +1493,7 @@ void ACSStringPool::ReadStrings(FSerializer &file, const char *key)
 		{
 			p.Next = FREE_ENTRY;
 			p.Mark = false;
+			p.Young = false;
 			p.Locks.Clear();
 		}
 		if (file.BeginArray("pool"))
@@ -1349,21 +1505,26 @@ void ACSStringPool::ReadStrings(FSerializer &file, const char *key)
 				{
 					unsigned ii = UINT_MAX;
 					file("index", ii);
-					if (ii < Pool.Size())
+					if (ii < Pool.Size() && Pool[ii].Next == FREE_ENTRY)
 					{
 						file("string", Pool[ii].Str)
 							("locks", Pool[ii].Locks);
 
-						unsigned h = SuperFastHash(Pool[ii].Str, Pool[ii].Str.Len());
-						unsigned bucketnum = h % NUM_BUCKETS;
-						Pool[ii].Hash = h;
-						Pool[ii].Next = PoolBuckets[bucketnum];
-						PoolBuckets[bucketnum] = ii;
+						Pool[ii].Hash = SuperFastHash(Pool[ii].Str, Pool[ii].Str.Len());
+						Pool[ii].Next = NO_ENTRY;	// Linked by ResizeBuckets below
+						LiveCount++;
 					}
 					file.EndObject();
 				}
 			}
 		}
+		unsigned int numbuckets = MIN_BUCKETS;
+		while (numbuckets < LiveCount)
+		{
+			numbuckets <<= 1;
+		}
+		ResizeBuckets(numbuckets);
+		FindFirstFreeEntry(0);
 	}
 }
 
@@ -1428,6 +1589,22 @@ void ACSStringPool::Dump() const
 	Printf("First free %u\n", FirstFreeEntry);
 }
 
+//============================================================================
+//
+// ACSStringPool :: GetStats
+//
+//============================================================================
+
+FString ACSStringPool::GetStats() const
+{
+	FString out;
+	out.Format("Strings: %u live, %u slots, %u buckets, %u in nursery\n"
+		"Lookups: %u, %.1f%% hit, %u inserted, %u freed (%u young)",
+		LiveCount, Pool.Size(), PoolBuckets.Size(), Nursery.Size(),
+		Lookups, Lookups > 0 ? Hits * 100. / Lookups : 0., Inserted, Freed, FreedYoung);
+	return out;
+}
+
 
 void ACSStringPool::UnlockForLevel(int lnum)
 {
@@ -1484,6 +1661,7 @@ void P_MarkGlobalVarStrings()
 
 void P_CollectACSGlobalStrings()
 {
+	GlobalACSStrings.ResetMarks();
 	for (FACSStack *stack = FACSStack::head; stack != NULL; stack = stack->next)
 	{
 		GlobalACSStrings.MarkStringArray(stack->buffer, stack->sp);
@@ -1494,6 +1672,137 @@ void P_CollectACSGlobalStrings()
 	GlobalACSStrings.PurgeStrings();
 }
 
+//============================================================================
+//
+// P_CollectACSNurseryStrings
+//
+// Garbage collect only the strings made since the last collection. Arrays
+// are not scanned, since storing a string into one promotes it.
+//
+//============================================================================
+
+void P_CollectACSNurseryStrings()
+{
+	if (!GlobalACSStrings.HasNursery())
+	{
+		return;
+	}
+	for (FACSStack *stack = FACSStack::head; stack != NULL; stack = stack->next)
+	{
+		GlobalACSStrings.MarkStringArray(stack->buffer, stack->sp);
+	}
+	FBehavior::StaticMarkLevelVarStrings(false);
+	GlobalACSStrings.MarkStringArray(ACS_WorldVars, countof(ACS_WorldVars));
+	GlobalACSStrings.MarkStringArray(ACS_GlobalVars, countof(ACS_GlobalVars));
+	GlobalACSStrings.PurgeNursery();
+}
+
+//============================================================================
+//
+// CCMD acsstringtest
+//
+// Checks that a promoted string survives a nursery collection and that one
+// nobody references does not. Then looks for strings that were freed while
+// something outside ACS still had them: thing and line special arguments,
+// int variables of actors and the arguments of deferred scripts.
+//
+//============================================================================
+
+static bool IsFreedString(int strnum)
+{
+	return (strnum & LIBRARYID_MASK) == STRPOOL_LIBRARYID_OR && GlobalACSStrings.GetString(strnum) == NULL;
+}
+
+static int CheckActorStrings(AActor *actor)
+{
+	int numfreed = 0;
+	for (int i = 0; i < 5; i++)
+	{
+		numfreed += IsFreedString(actor->args[i]);
+	}
+	for (PClass *cls = actor->GetClass(); cls != NULL; cls = cls->ParentClass)
+	{
+		for (PField *field : cls->Fields)
+		{
+			if (field->Flags & (VARF_Native | VARF_Static | VARF_Meta))
+			{
+				continue;
+			}
+			auto addr = reinterpret_cast<const int *>(reinterpret_cast<uint8_t *>(actor) + field->Offset);
+			if (field->Type == TypeSInt32)
+			{
+				numfreed += IsFreedString(*addr);
+			}
+			else if (field->Type->isArray() && static_cast<PArray *>(field->Type)->ElementType == TypeSInt32)
+			{
+				for (unsigned i = 0; i < static_cast<PArray *>(field->Type)->ElementCount; i++)
+				{
+					numfreed += IsFreedString(addr[i]);
+				}
+			}
+		}
+	}
+	return numfreed;
+}
+
+CCMD(acsstringtest)
+{
+	static unsigned int testnum;
+	FString str;
+	bool failed = false;
+
+	str.Format("acsstringtest %u promoted", ++testnum);
+	int promoted = GlobalACSStrings.AddString(str);
+	str.Format("acsstringtest %u dropped", testnum);
+	int dropped = GlobalACSStrings.AddString(str);
+	GlobalACSStrings.PromoteString(promoted);
+	P_CollectACSNurseryStrings();
+	if (GlobalACSStrings.GetString(promoted) == NULL)
+	{
+		Printf(TEXTCOLOR_RED "A promoted string was collected with the nursery\n");
+		failed = true;
+	}
+	if (GlobalACSStrings.GetString(dropped) != NULL)
+	{
+		Printf(TEXTCOLOR_RED "An unreferenced string survived the nursery\n");
+		failed = true;
+	}
+
+	int numfreed = 0;
+	TThinkerIterator<AActor> it;
+	AActor *actor;
+	while ((actor = it.Next()) != NULL)
+	{
+		numfreed += CheckActorStrings(actor);
+	}
+	for (auto &line : level.lines)
+	{
+		for (int i = 0; i < 5; i++)
+		{
+			numfreed += IsFreedString(line.args[i]);
+		}
+	}
+	for (auto &info : wadlevelinfos)
+	{
+		for (auto &def : info.deferred)
+		{
+			for (auto arg : def.args)
+			{
+				numfreed += IsFreedString(arg);
+			}
+		}
+	}
+	if (numfreed > 0)
+	{
+		Printf(TEXTCOLOR_RED "%d stored values refer to freed ACS strings\n", numfreed);
+		failed = true;
+	}
+	if (!failed)
+	{
+		Printf("ACS string pool OK\n");
+	}
+}
+
 #ifdef _DEBUG
 CCMD(acsgc)
 {
@@ -2154,12 +2463,12 @@ FBehavior *FBehavior::StaticGetModule (int lib)
 	return StaticModules[lib];
 }
 
-void FBehavior::StaticMarkLevelVarStrings()
+void FBehavior::StaticMarkLevelVarStrings(bool arrays)
 {
 	// Mark map variables.
 	for (uint32_t modnum = 0; modnum < StaticModules.Size(); ++modnum)
 	{
-		StaticModules[modnum]->MarkMapVarStrings();
+		StaticModules[modnum]->MarkMapVarStrings(arrays);
 	}
 	// Mark running scripts' local variables.
 	if (DACSThinker::ActiveThinker != NULL)
@@ -2193,10 +2502,10 @@ void FBehavior::StaticUnlockLevelVarStrings()
 	GlobalACSStrings.UnlockForLevel(level.levelnum);
 }
 
-void FBehavior::MarkMapVarStrings() const
+void FBehavior::MarkMapVarStrings(bool arrays) const
 {
 	GlobalACSStrings.MarkStringArray(MapVarStore, NUM_MAPVARS);
-	for (int i = 0; i < NumArrays; ++i)
+	for (int i = 0; arrays && i < NumArrays; ++i)
 	{
 		GlobalACSStrings.MarkStringArray(ArrayStore[i].Elements, ArrayStore[i].ArraySize);
 	}
@@ -2371,7 +2680,7 @@ FBehavior::FBehavior()
 	memset (MapVarStore, 0, sizeof(MapVarStore));
 	ModuleName[0] = 0;
 	FunctionProfileData = NULL;
-
+	CodeThreaded = false;
 }
 	
 	
@@ -2664,6 +2973,7 @@ bool FBehavior::Init(int lumpnum, FileReader * fr, int len)
 							if (str != NULL)
 							{
 								*elems = GlobalACSStrings.AddString(str);
+								GlobalACSStrings.PromoteString(*elems);
 							}
 						}
 					}
@@ -2698,6 +3008,7 @@ bool FBehavior::Init(int lumpnum, FileReader * fr, int len)
 								if (str != NULL)
 								{
 									*elems = GlobalACSStrings.AddString(str);
+									GlobalACSStrings.PromoteString(*elems);
 								}
 							}
 						}
@@ -2829,6 +3140,11 @@ bool FBehavior::Init(int lumpnum, FileReader * fr, int len)
 		}
 	}
 
+	if (Format != ACS_Unknown)
+	{
+		DecodeCode ();
+	}
+
 	DPrintf (DMSG_NOTIFY, "Loaded %d scripts, %d functions\n", NumScripts, NumFunctions);
 	return true;
 }
@@ -2875,6 +3191,615 @@ FBehavior::~FBehavior ()
 	}
 }
 
+//==========================================================================
+//
+// GetOperandLayout
+//
+// Describes the operands DLevelScript::RunScript reads for a p-code, one
+// character per operand: 'b' is read with NEXTBYTE, 's' with NEXTSHORT,
+// 'w' is a word, 'j' a word holding a jump target and 'r' a byte in every
+// format. Returns NULL for p-codes RunScript does not know. This must be
+// kept in sync with RunScript.
+//
+//==========================================================================
+
+static const char *GetOperandLayout (int pcd, bool &terminal)
+{
+	terminal = false;
+	switch (pcd)
+	{
+	case PCD_TERMINATE:
+	case PCD_RESTART:
+	case PCD_GOTOSTACK:
+	case PCD_RETURNVOID:
+	case PCD_RETURNVAL:
+		terminal = true;
+		return "";
+
+	case PCD_GOTO:
+		terminal = true;
+		return "j";
+
+	case PCD_IFGOTO:
+	case PCD_IFNOTGOTO:
+		return "j";
+
+	case PCD_CASEGOTO:
+		return "wj";
+
+	case PCD_LSPEC1:
+	case PCD_LSPEC2:
+	case PCD_LSPEC3:
+	case PCD_LSPEC4:
+	case PCD_LSPEC5:
+	case PCD_LSPEC5RESULT:
+	case PCD_PUSHFUNCTION:
+	case PCD_CALL:
+	case PCD_CALLDISCARD:
+	case PCD_ASSIGNSCRIPTVAR:
+	case PCD_ASSIGNMAPVAR:
+	case PCD_ASSIGNWORLDVAR:
+	case PCD_ASSIGNGLOBALVAR:
+	case PCD_ASSIGNSCRIPTARRAY:
+	case PCD_ASSIGNMAPARRAY:
+	case PCD_ASSIGNWORLDARRAY:
+	case PCD_ASSIGNGLOBALARRAY:
+	case PCD_PUSHSCRIPTVAR:
+	case PCD_PUSHMAPVAR:
+	case PCD_PUSHWORLDVAR:
+	case PCD_PUSHGLOBALVAR:
+	case PCD_PUSHSCRIPTARRAY:
+	case PCD_PUSHMAPARRAY:
+	case PCD_PUSHWORLDARRAY:
+	case PCD_PUSHGLOBALARRAY:
+	case PCD_ADDSCRIPTVAR:
+	case PCD_ADDMAPVAR:
+	case PCD_ADDWORLDVAR:
+	case PCD_ADDGLOBALVAR:
+	case PCD_ADDSCRIPTARRAY:
+	case PCD_ADDMAPARRAY:
+	case PCD_ADDWORLDARRAY:
+	case PCD_ADDGLOBALARRAY:
+	case PCD_SUBSCRIPTVAR:
+	case PCD_SUBMAPVAR:
+	case PCD_SUBWORLDVAR:
+	case PCD_SUBGLOBALVAR:
+	case PCD_SUBSCRIPTARRAY:
+	case PCD_SUBMAPARRAY:
+	case PCD_SUBWORLDARRAY:
+	case PCD_SUBGLOBALARRAY:
+	case PCD_MULSCRIPTVAR:
+	case PCD_MULMAPVAR:
+	case PCD_MULWORLDVAR:
+	case PCD_MULGLOBALVAR:
+	case PCD_MULSCRIPTARRAY:
+	case PCD_MULMAPARRAY:
+	case PCD_MULWORLDARRAY:
+	case PCD_MULGLOBALARRAY:
+	case PCD_DIVSCRIPTVAR:
+	case PCD_DIVMAPVAR:
+	case PCD_DIVWORLDVAR:
+	case PCD_DIVGLOBALVAR:
+	case PCD_DIVSCRIPTARRAY:
+	case PCD_DIVMAPARRAY:
+	case PCD_DIVWORLDARRAY:
+	case PCD_DIVGLOBALARRAY:
+	case PCD_MODSCRIPTVAR:
+	case PCD_MODMAPVAR:
+	case PCD_MODWORLDVAR:
+	case PCD_MODGLOBALVAR:
+	case PCD_MODSCRIPTARRAY:
+	case PCD_MODMAPARRAY:
+	case PCD_MODWORLDARRAY:
+	case PCD_MODGLOBALARRAY:
+	case PCD_ANDSCRIPTVAR:
+	case PCD_ANDMAPVAR:
+	case PCD_ANDWORLDVAR:
+	case PCD_ANDGLOBALVAR:
+	case PCD_ANDSCRIPTARRAY:
+	case PCD_ANDMAPARRAY:
+	case PCD_ANDWORLDARRAY:
+	case PCD_ANDGLOBALARRAY:
+	case PCD_EORSCRIPTVAR:
+	case PCD_EORMAPVAR:
+	case PCD_EORWORLDVAR:
+	case PCD_EORGLOBALVAR:
+	case PCD_EORSCRIPTARRAY:
+	case PCD_EORMAPARRAY:
+	case PCD_EORWORLDARRAY:
+	case PCD_EORGLOBALARRAY:
+	case PCD_ORSCRIPTVAR:
+	case PCD_ORMAPVAR:
+	case PCD_ORWORLDVAR:
+	case PCD_ORGLOBALVAR:
+	case PCD_ORSCRIPTARRAY:
+	case PCD_ORMAPARRAY:
+	case PCD_ORWORLDARRAY:
+	case PCD_ORGLOBALARRAY:
+	case PCD_LSSCRIPTVAR:
+	case PCD_LSMAPVAR:
+	case PCD_LSWORLDVAR:
+	case PCD_LSGLOBALVAR:
+	case PCD_LSSCRIPTARRAY:
+	case PCD_LSMAPARRAY:
+	case PCD_LSWORLDARRAY:
+	case PCD_LSGLOBALARRAY:
+	case PCD_RSSCRIPTVAR:
+	case PCD_RSMAPVAR:
+	case PCD_RSWORLDVAR:
+	case PCD_RSGLOBALVAR:
+	case PCD_RSSCRIPTARRAY:
+	case PCD_RSMAPARRAY:
+	case PCD_RSWORLDARRAY:
+	case PCD_RSGLOBALARRAY:
+	case PCD_INCSCRIPTVAR:
+	case PCD_INCMAPVAR:
+	case PCD_INCWORLDVAR:
+	case PCD_INCGLOBALVAR:
+	case PCD_INCSCRIPTARRAY:
+	case PCD_INCMAPARRAY:
+	case PCD_INCWORLDARRAY:
+	case PCD_INCGLOBALARRAY:
+	case PCD_DECSCRIPTVAR:
+	case PCD_DECMAPVAR:
+	case PCD_DECWORLDVAR:
+	case PCD_DECGLOBALVAR:
+	case PCD_DECSCRIPTARRAY:
+	case PCD_DECMAPARRAY:
+	case PCD_DECWORLDARRAY:
+	case PCD_DECGLOBALARRAY:
+		return "b";
+
+	case PCD_CALLFUNC:
+		return "bs";
+
+	case PCD_LSPEC1DIRECT:
+		return "bw";
+
+	case PCD_LSPEC2DIRECT:
+		return "bww";
+
+	case PCD_LSPEC3DIRECT:
+		return "bwww";
+
+	case PCD_LSPEC4DIRECT:
+		return "bwwww";
+
+	case PCD_LSPEC5DIRECT:
+		return "bwwwww";
+
+	case PCD_PUSHNUMBER:
+	case PCD_LSPEC5EX:
+	case PCD_LSPEC5EXRESULT:
+	case PCD_DELAYDIRECT:
+	case PCD_TAGWAITDIRECT:
+	case PCD_POLYWAITDIRECT:
+	case PCD_SCRIPTWAITDIRECT:
+	case PCD_SETFONTDIRECT:
+	case PCD_SETGRAVITYDIRECT:
+	case PCD_SETAIRCONTROLDIRECT:
+	case PCD_CHECKINVENTORYDIRECT:
+		return "w";
+
+	case PCD_RANDOMDIRECT:
+	case PCD_THINGCOUNTDIRECT:
+	case PCD_CHANGEFLOORDIRECT:
+	case PCD_CHANGECEILINGDIRECT:
+	case PCD_GIVEINVENTORYDIRECT:
+	case PCD_TAKEINVENTORYDIRECT:
+		return "ww";
+
+	case PCD_SETMUSICDIRECT:
+	case PCD_LOCALSETMUSICDIRECT:
+	case PCD_CONSOLECOMMANDDIRECT:
+		return "www";
+
+	case PCD_SPAWNSPOTDIRECT:
+		return "wwww";
+
+	case PCD_SPAWNDIRECT:
+		return "wwwwww";
+
+	case PCD_PUSH2BYTES:
+		return "rr";
+
+	case PCD_PUSH3BYTES:
+		return "rrr";
+
+	case PCD_PUSH4BYTES:
+		return "rrrr";
+
+	case PCD_PUSH5BYTES:
+		return "rrrrr";
+
+	case PCD_PLAYERBLUESKULL:
+	case PCD_PLAYERREDSKULL:
+	case PCD_PLAYERYELLOWSKULL:
+	case PCD_PLAYERMASTERSKULL:
+	case PCD_PLAYERBLUECARD:
+	case PCD_PLAYERREDCARD:
+	case PCD_PLAYERYELLOWCARD:
+	case PCD_PLAYERMASTERCARD:
+	case PCD_PLAYERBLACKSKULL:
+	case PCD_PLAYERSILVERSKULL:
+	case PCD_PLAYERGOLDSKULL:
+	case PCD_PLAYERBLACKCARD:
+	case PCD_PLAYERSILVERCARD:
+	case PCD_PLAYEREXPERT:
+	case PCD_BLUETEAMCOUNT:
+	case PCD_REDTEAMCOUNT:
+	case PCD_BLUETEAMSCORE:
+	case PCD_REDTEAMSCORE:
+	case PCD_ISONEFLAGCTF:
+	case PCD_LSPEC6:
+	case PCD_LSPEC6DIRECT:
+	case PCD_SETSTYLE:
+	case PCD_SETSTYLEDIRECT:
+	case PCD_WRITETOINI:
+	case PCD_GETFROMINI:
+	case PCD_GRABINPUT:
+	case PCD_SETMOUSEPOINTER:
+	case PCD_MOVEMOUSEPOINTER:
+		return NULL;
+
+	default:
+		return (unsigned)pcd < PCODE_COMMAND_COUNT ? "" : NULL;
+	}
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodeInstruction
+//
+// Appends the decoded form of the instruction at ofs to code and returns
+// the instruction's size in the module, or 0 if it cannot be decoded.
+// Jump targets are left as offsets into Data, and their positions in code
+// are added to jumps.
+//
+//==========================================================================
+
+int FBehavior::DecodeInstruction (uint32_t ofs, TArray<int> &code, TArray<unsigned> &jumps, bool &terminal) const
+{
+	const uint32_t start = ofs;
+	const char *layout;
+	int pcd, val, count;
+
+	auto readbyte = [&](int &val) -> bool
+	{
+		if (ofs >= (uint32_t)DataSize) return false;
+		val = Data[ofs++];
+		return true;
+	};
+	auto readshort = [&](int &val) -> bool
+	{
+		if (ofs + 2 > (uint32_t)DataSize) return false;
+		val = (int16_t)(Data[ofs] | (Data[ofs+1] << 8));
+		ofs += 2;
+		return true;
+	};
+	auto readword = [&](int &val) -> bool
+	{
+		if (ofs + 4 > (uint32_t)DataSize) return false;
+		val = Data[ofs] | (Data[ofs+1] << 8) | (Data[ofs+2] << 16) | (Data[ofs+3] << 24);
+		ofs += 4;
+		return true;
+	};
+	auto emit = [&](int val)
+	{
+		code.Push(LittleLong(val));
+	};
+
+	if (Format == ACS_LittleEnhanced)
+	{
+		if (!readbyte(pcd)) return 0;
+		if (pcd >= 256-16)
+		{
+			if (!readbyte(val)) return 0;
+			pcd = (256-16) + ((pcd - (256-16)) << 8) + val;
+		}
+	}
+	else if (!readword(pcd))
+	{
+		return 0;
+	}
+
+	terminal = false;
+	switch (pcd)
+	{
+	// These read their operands as bytes in every format, so they are turned into the
+	// variants that take words.
+	case PCD_PUSHBYTE:			pcd = PCD_PUSHNUMBER;		layout = "r";		break;
+	case PCD_LSPEC1DIRECTB:		pcd = PCD_LSPEC1DIRECT;		layout = "rr";		break;
+	case PCD_LSPEC2DIRECTB:		pcd = PCD_LSPEC2DIRECT;		layout = "rrr";		break;
+	case PCD_LSPEC3DIRECTB:		pcd = PCD_LSPEC3DIRECT;		layout = "rrrr";	break;
+	case PCD_LSPEC4DIRECTB:		pcd = PCD_LSPEC4DIRECT;		layout = "rrrrr";	break;
+	case PCD_LSPEC5DIRECTB:		pcd = PCD_LSPEC5DIRECT;		layout = "rrrrrr";	break;
+	case PCD_DELAYDIRECTB:		pcd = PCD_DELAYDIRECT;		layout = "r";		break;
+	case PCD_RANDOMDIRECTB:		pcd = PCD_RANDOMDIRECT;		layout = "rr";		break;
+
+	case PCD_PUSHBYTES:
+		emit(pcd);
+		if (!readbyte(count)) return 0;
+		emit(count);
+		while (count-- > 0)
+		{
+			if (!readbyte(val)) return 0;
+			emit(val);
+		}
+		return ofs - start;
+
+	case PCD_CASEGOTOSORTED:
+		emit(pcd);
+		// The count and jump table are 4-byte aligned
+		ofs = (ofs + 3) & ~3;
+		if (!readword(count) || count < 0) return 0;
+		emit(count);
+		while (count-- > 0)
+		{
+			if (!readword(val)) return 0;
+			emit(val);
+			if (!readword(val)) return 0;
+			jumps.Push(code.Size());
+			emit(val);
+		}
+		return ofs - start;
+
+	default:
+		layout = GetOperandLayout(pcd, terminal);
+		if (layout == NULL)
+		{
+			// RunScript stops at p-codes it does not know, so nothing after this is executed.
+			terminal = true;
+			layout = "";
+		}
+		break;
+	}
+
+	emit(pcd);
+	for (; *layout != 0; ++layout)
+	{
+		bool good;
+		switch (*layout)
+		{
+		case 'b':	good = Format == ACS_LittleEnhanced ? readbyte(val) : readword(val);	break;
+		case 's':	good = Format == ACS_LittleEnhanced ? readshort(val) : readword(val);	break;
+		case 'r':	good = readbyte(val);	break;
+		default:	good = readword(val);	break;
+		}
+		if (!good) return 0;
+		if (*layout == 'j') jumps.Push(code.Size());
+		emit(val);
+	}
+	return ofs - start;
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodeCode
+//
+// Translates the module's code into a stream RunScript can execute without
+// caring about the module's format: Compressed opcodes are expanded, every
+// operand takes up one aligned word and jump targets are resolved to
+// offsets into the decoded stream. Only code reachable from a script, a
+// function or a jump point is translated, keeping the order it has in the
+// module. If any of it cannot be decoded, the module is executed directly.
+//
+//==========================================================================
+
+void FBehavior::DecodeCode ()
+{
+	TArray<uint8_t> visited;
+	TArray<uint32_t> work;
+	TArray<int> scratch;
+	TArray<unsigned> jumps;
+	bool terminal;
+	bool good = true;
+	int i;
+
+	visited.Resize(DataSize);
+	memset(&visited[0], 0, DataSize);
+
+	auto addentry = [&](uint32_t ofs)
+	{
+		if (ofs >= (uint32_t)DataSize)
+		{
+			good = false;
+		}
+		else if (!visited[ofs])
+		{
+			visited[ofs] = true;
+			work.Push(ofs);
+		}
+	};
+
+	for (i = 0; i < NumScripts; ++i)
+	{
+		addentry(Scripts[i].Address);
+	}
+	for (i = 0; i < NumFunctions; ++i)
+	{
+		if (Functions[i].ImportNum == 0 && Functions[i].Address != 0)
+		{
+			addentry(Functions[i].Address);
+		}
+	}
+	for (auto ofs : JumpPoints)
+	{
+		addentry(ofs);
+	}
+
+	// Find all instructions that can be reached.
+	uint32_t ofs;
+	while (good && work.Pop(ofs))
+	{
+		scratch.Clear();
+		jumps.Clear();
+		int size = DecodeInstruction(ofs, scratch, jumps, terminal);
+		if (size == 0)
+		{
+			good = false;
+			break;
+		}
+		if (!terminal)
+		{
+			addentry(ofs + size);
+		}
+		for (auto j : jumps)
+		{
+			addentry(LittleLong(scratch[j]));
+		}
+	}
+
+	// Decode them in the order they appear in the module, so that each instruction
+	// is still followed by the one it falls through to.
+	uint32_t end = 0;
+	jumps.Clear();
+	for (ofs = 0; good && ofs < (uint32_t)DataSize; ++ofs)
+	{
+		if (visited[ofs])
+		{
+			if (ofs < end)
+			{
+				// Overlapping instructions
+				good = false;
+				break;
+			}
+			CodeMapEntry entry = { ofs, DecodedCode.Size() };
+			CodeMap.Push(entry);
+			end = ofs + DecodeInstruction(ofs, DecodedCode, jumps, terminal);
+		}
+	}
+
+	if (!good || DecodedCode.Size() == 0)
+	{
+		if (!good) DPrintf (DMSG_NOTIFY, "%s: ACS code could not be decoded\n", ModuleName);
+		DecodedCode.Reset();
+		CodeMap.Reset();
+		return;
+	}
+	DecodedCode.ShrinkToFit();
+	CodeMap.ShrinkToFit();
+
+	for (auto j : jumps)
+	{
+		int *target = DecodePC(Ofs2PC(LittleLong(DecodedCode[j])));
+		DecodedCode[j] = LittleLong(int((uint8_t *)target - GetCodeBase(true)));
+	}
+	for (i = 0; i < NumFunctions; ++i)
+	{
+		ScriptFunction *func = &Functions[i];
+		func->DecodedAddress = 0;
+		if (func->ImportNum == 0 && func->Address != 0)
+		{
+			func->DecodedAddress = uint32_t((uint8_t *)DecodePC(Ofs2PC(func->Address)) - GetCodeBase(true));
+		}
+	}
+}
+
+//==========================================================================
+//
+// FBehavior :: DecodePC
+//
+// Returns the position in the decoded code of the instruction at pc, or
+// NULL if there is none.
+//
+//==========================================================================
+
+int *FBehavior::DecodePC (int *pc) const
+{
+	uint32_t ofs = PC2Ofs(pc);
+	unsigned min = 0, max = CodeMap.Size();
+
+	while (min < max)
+	{
+		unsigned mid = (min + max) / 2;
+		if (CodeMap[mid].Ofs < ofs)
+		{
+			min = mid + 1;
+		}
+		else
+		{
+			max = mid;
+		}
+	}
+	if (min < CodeMap.Size() && CodeMap[min].Ofs == ofs)
+	{
+		return &DecodedCode[CodeMap[min].DecodedOfs];
+	}
+	return NULL;
+}
+
+//==========================================================================
+//
+// FBehavior :: EncodePC
+//
+// The reverse of DecodePC: Returns the position in the module of a decoded
+// instruction.
+//
+//==========================================================================
+
+int *FBehavior::EncodePC (int *pc) const
+{
+	uint32_t index = uint32_t(pc - &DecodedCode[0]);
+	unsigned min = 0, max = CodeMap.Size();
+
+	while (min < max)
+	{
+		unsigned mid = (min + max) / 2;
+		if (CodeMap[mid].DecodedOfs < index)
+		{
+			min = mid + 1;
+		}
+		else
+		{
+			max = mid;
+		}
+	}
+	assert(min < CodeMap.Size() && CodeMap[min].DecodedOfs == index);
+	return Ofs2PC(CodeMap[min].Ofs);
+}
+
+// Threaded code keeps each instruction's p-code below its handler's offset.
+enum
+{
+	PCODE_THREAD_SHIFT = 9,
+	PCODE_THREAD_MASK = (1 << PCODE_THREAD_SHIFT) - 1
+};
+
+//==========================================================================
+//
+// FBehavior :: MakeThreadedCode
+//
+// Replaces the p-code of every decoded instruction with the offset of its
+// handler in RunScript, shifted up past the p-code, which stays in the low
+// bits. RunScript can then jump from the end of one handler straight to the
+// next. Only RunScript knows where its handlers are, so it does this the
+// first time it runs the module's decoded code. Returns false if an offset
+// does not fit, which leaves the p-codes as they are.
+//
+//==========================================================================
+
+bool FBehavior::MakeThreadedCode (const int *handlers)
+{
+	static_assert(PCODE_COMMAND_COUNT <= PCODE_THREAD_MASK + 1, "ACS p-codes don't fit below the handler offsets");
+
+	for (int i = 0; i < PCODE_COMMAND_COUNT; ++i)
+	{
+		if (handlers[i] < (INT_MIN >> PCODE_THREAD_SHIFT) || handlers[i] > (INT_MAX >> PCODE_THREAD_SHIFT))
+		{
+			return false;
+		}
+	}
+	for (auto &entry : CodeMap)
+	{
+		int &code = DecodedCode[entry.DecodedOfs];
+		int pcd = LittleLong(code);
+		code = int(unsigned(handlers[pcd]) << PCODE_THREAD_SHIFT) | pcd;
+	}
+	CodeThreaded = true;
+	return true;
+}
+
 void FBehavior::LoadScriptsDirectory ()
 {
 	union
@@ -3307,6 +4232,7 @@ void FBehavior::SetArrayVal (int arraynum, int index, int value)
 	if ((unsigned)index >= (unsigned)array->ArraySize)
 		return;
 	array->Elements[index] = value;
+	GlobalACSStrings.PromoteString(value);
 }
 
 inline bool FBehavior::CopyStringToArray(int arraynum, int index, int maxLength, const char *string)
@@ -3576,7 +4502,8 @@ void DACSThinker::Tick ()
 		script = next;
 	}
 
-//	GlobalACSStrings.Clear();
+	// Strings made during this tic that nothing holds on to can go now.
+	P_CollectACSNurseryStrings();
 
 	if (ACS_StringBuilderStack.Size())
 	{
@@ -5063,6 +5990,7 @@ static void SetUserVariable(AActor *self, FName varname, int index, int value)
 	{
 		if (!type->isFloat())
 		{
+			GlobalACSStrings.PromoteString(value);
 			type->SetValue(addr, value);
 		}
 		else
@@ -5394,6 +6322,7 @@ static int ScriptCall(AActor *activator, unsigned argc, int32_t *args)
 			// The only types allowed are int, bool, double, Name, Sound, Color and String
 			if (argtype == TypeSInt32 || argtype == TypeColor)
 			{
+				GlobalACSStrings.PromoteString(args[i]);
 				params.Push(args[i]);
 			}
 			else if (argtype == TypeBool)
@@ -6379,6 +7308,7 @@ doplaysound:			if (funcIndex == ACSF_PlayActorSound)
 				{
 					level.lines[line].activation = args[1];
 				}
+				P_SightGeometryChanged();
 			}
 			break;
 
@@ -6859,9 +7789,48 @@ enum
 };
 
 
+// Run scripts from the decoded code instead of the module's data. This can be
+// turned off to compare both.
+CVAR(Bool, acs_decodedcode, true, 0)
+
+// With GCC's labels as values, the decoded code is threaded: every instruction
+// holds the offset of its handler, and each handler jumps straight to the next
+// one instead of going back through the loop and the switch.
+#if !defined(COMPGOTO) && defined(__GNUC__)
+#define COMPGOTO 1
+#endif
+
+#if COMPGOTO
+#define PCODE(x)		case PCD_##x: pcd_##x
+#define PCODE_DEFAULT	default: pcd_default
+#define PCODE_HANDLER(x)	int((const char *)&&pcd_##x - (const char *)&&pcd_NOP)
+#define PCODE_JUMP(ofs)		goto *((const char *)&&pcd_NOP + (ofs))
+// Runs the next threaded instruction, with the loop's checks. Anything else
+// goes back to the loop. Only for where no block's locals are in scope, since
+// a computed goto out of a block skips their destructors.
+#define NEXTPCODE \
+	if (threaded && state == SCRIPT_Running && runaway < 2000000) \
+	{ \
+		++runaway; \
+		temp = *pc++; \
+		pcd = temp & PCODE_THREAD_MASK; \
+		PCODE_JUMP(temp >> PCODE_THREAD_SHIFT); \
+	} \
+	break
+#define SETTHREADED()	(threaded = decoded && activeBehavior->ThreadCode(pcodes))
+#else
+#define PCODE(x)		case PCD_##x
+#define PCODE_DEFAULT	default
+#define NEXTPCODE		break
+#define SETTHREADED()
+#endif
+
 #define NEXTWORD	(LittleLong(*pc++))
 #define NEXTBYTE	(fmt==ACS_LittleEnhanced?getbyte(pc):NEXTWORD)
 #define NEXTSHORT	(fmt==ACS_LittleEnhanced?getshort(pc):NEXTWORD)
+// Operands that are bytes in every format, except in the decoded code.
+#define NEXTRAWBYTE	(decoded?NEXTWORD:getbyte(pc))
+#define CODEPTR(ofs)	((int *)(codebase + (ofs)))
 #define STACK(a)	(Stack[sp - (a)])
 #define PushToStack(a)	(Stack[sp++] = (a))
 // Direct instructions that take strings need to have the tag applied.
@@ -7007,8 +7976,16 @@ int DLevelScript::RunScript ()
 	int32_t *Stack = stackobj.buffer;
 	int &sp = stackobj.sp;
 
-	int *pc = this->pc;
-	ACSFormat fmt = activeBehavior->GetFormat();
+	bool usedecoded = acs_decodedcode;
+	bool decoded = usedecoded && activeBehavior->HasDecodedCode();
+	int *pc = decoded ? activeBehavior->DecodePC(this->pc) : this->pc;
+	if (pc == NULL)
+	{
+		usedecoded = decoded = false;
+		pc = this->pc;
+	}
+	const uint8_t *codebase = activeBehavior->GetCodeBase(decoded);
+	ACSFormat fmt = activeBehavior->GetCodeFormat(decoded);
 	FBehavior* const savedActiveBehavior = activeBehavior;
 	unsigned int runaway = 0;	// used to prevent infinite loops
 	int pcd;
@@ -7016,6 +7993,402 @@ int DLevelScript::RunScript ()
 	const char *lookup;
 	int optstart = -1;
 	int temp;
+#if COMPGOTO
+	// The offset of every p-code's handler, in the order of the PCD enum. The decoded
+	// code only contains valid p-codes, so it can jump through this without a check.
+	static const int pcodes[] =
+	{
+/*  0*/	PCODE_HANDLER(NOP),
+		PCODE_HANDLER(TERMINATE),
+		PCODE_HANDLER(SUSPEND),
+		PCODE_HANDLER(PUSHNUMBER),
+		PCODE_HANDLER(LSPEC1),
+		PCODE_HANDLER(LSPEC2),
+		PCODE_HANDLER(LSPEC3),
+		PCODE_HANDLER(LSPEC4),
+		PCODE_HANDLER(LSPEC5),
+		PCODE_HANDLER(LSPEC1DIRECT),
+/* 10*/	PCODE_HANDLER(LSPEC2DIRECT),
+		PCODE_HANDLER(LSPEC3DIRECT),
+		PCODE_HANDLER(LSPEC4DIRECT),
+		PCODE_HANDLER(LSPEC5DIRECT),
+		PCODE_HANDLER(ADD),
+		PCODE_HANDLER(SUBTRACT),
+		PCODE_HANDLER(MULTIPLY),
+		PCODE_HANDLER(DIVIDE),
+		PCODE_HANDLER(MODULUS),
+		PCODE_HANDLER(EQ),
+/* 20*/	PCODE_HANDLER(NE),
+		PCODE_HANDLER(LT),
+		PCODE_HANDLER(GT),
+		PCODE_HANDLER(LE),
+		PCODE_HANDLER(GE),
+		PCODE_HANDLER(ASSIGNSCRIPTVAR),
+		PCODE_HANDLER(ASSIGNMAPVAR),
+		PCODE_HANDLER(ASSIGNWORLDVAR),
+		PCODE_HANDLER(PUSHSCRIPTVAR),
+		PCODE_HANDLER(PUSHMAPVAR),
+/* 30*/	PCODE_HANDLER(PUSHWORLDVAR),
+		PCODE_HANDLER(ADDSCRIPTVAR),
+		PCODE_HANDLER(ADDMAPVAR),
+		PCODE_HANDLER(ADDWORLDVAR),
+		PCODE_HANDLER(SUBSCRIPTVAR),
+		PCODE_HANDLER(SUBMAPVAR),
+		PCODE_HANDLER(SUBWORLDVAR),
+		PCODE_HANDLER(MULSCRIPTVAR),
+		PCODE_HANDLER(MULMAPVAR),
+		PCODE_HANDLER(MULWORLDVAR),
+/* 40*/	PCODE_HANDLER(DIVSCRIPTVAR),
+		PCODE_HANDLER(DIVMAPVAR),
+		PCODE_HANDLER(DIVWORLDVAR),
+		PCODE_HANDLER(MODSCRIPTVAR),
+		PCODE_HANDLER(MODMAPVAR),
+		PCODE_HANDLER(MODWORLDVAR),
+		PCODE_HANDLER(INCSCRIPTVAR),
+		PCODE_HANDLER(INCMAPVAR),
+		PCODE_HANDLER(INCWORLDVAR),
+		PCODE_HANDLER(DECSCRIPTVAR),
+/* 50*/	PCODE_HANDLER(DECMAPVAR),
+		PCODE_HANDLER(DECWORLDVAR),
+		PCODE_HANDLER(GOTO),
+		PCODE_HANDLER(IFGOTO),
+		PCODE_HANDLER(DROP),
+		PCODE_HANDLER(DELAY),
+		PCODE_HANDLER(DELAYDIRECT),
+		PCODE_HANDLER(RANDOM),
+		PCODE_HANDLER(RANDOMDIRECT),
+		PCODE_HANDLER(THINGCOUNT),
+/* 60*/	PCODE_HANDLER(THINGCOUNTDIRECT),
+		PCODE_HANDLER(TAGWAIT),
+		PCODE_HANDLER(TAGWAITDIRECT),
+		PCODE_HANDLER(POLYWAIT),
+		PCODE_HANDLER(POLYWAITDIRECT),
+		PCODE_HANDLER(CHANGEFLOOR),
+		PCODE_HANDLER(CHANGEFLOORDIRECT),
+		PCODE_HANDLER(CHANGECEILING),
+		PCODE_HANDLER(CHANGECEILINGDIRECT),
+		PCODE_HANDLER(RESTART),
+/* 70*/	PCODE_HANDLER(ANDLOGICAL),
+		PCODE_HANDLER(ORLOGICAL),
+		PCODE_HANDLER(ANDBITWISE),
+		PCODE_HANDLER(ORBITWISE),
+		PCODE_HANDLER(EORBITWISE),
+		PCODE_HANDLER(NEGATELOGICAL),
+		PCODE_HANDLER(LSHIFT),
+		PCODE_HANDLER(RSHIFT),
+		PCODE_HANDLER(UNARYMINUS),
+		PCODE_HANDLER(IFNOTGOTO),
+/* 80*/	PCODE_HANDLER(LINESIDE),
+		PCODE_HANDLER(SCRIPTWAIT),
+		PCODE_HANDLER(SCRIPTWAITDIRECT),
+		PCODE_HANDLER(CLEARLINESPECIAL),
+		PCODE_HANDLER(CASEGOTO),
+		PCODE_HANDLER(BEGINPRINT),
+		PCODE_HANDLER(ENDPRINT),
+		PCODE_HANDLER(PRINTSTRING),
+		PCODE_HANDLER(PRINTNUMBER),
+		PCODE_HANDLER(PRINTCHARACTER),
+/* 90*/	PCODE_HANDLER(PLAYERCOUNT),
+		PCODE_HANDLER(GAMETYPE),
+		PCODE_HANDLER(GAMESKILL),
+		PCODE_HANDLER(TIMER),
+		PCODE_HANDLER(SECTORSOUND),
+		PCODE_HANDLER(AMBIENTSOUND),
+		PCODE_HANDLER(SOUNDSEQUENCE),
+		PCODE_HANDLER(SETLINETEXTURE),
+		PCODE_HANDLER(SETLINEBLOCKING),
+		PCODE_HANDLER(SETLINESPECIAL),
+/*100*/	PCODE_HANDLER(THINGSOUND),
+		PCODE_HANDLER(ENDPRINTBOLD),
+		PCODE_HANDLER(ACTIVATORSOUND),
+		PCODE_HANDLER(LOCALAMBIENTSOUND),
+		PCODE_HANDLER(SETLINEMONSTERBLOCKING),
+		PCODE_HANDLER(default),	// PCD_PLAYERBLUESKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERREDSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERYELLOWSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERMASTERSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERBLUECARD
+/*110*/	PCODE_HANDLER(default),	// PCD_PLAYERREDCARD
+		PCODE_HANDLER(default),	// PCD_PLAYERYELLOWCARD
+		PCODE_HANDLER(default),	// PCD_PLAYERMASTERCARD
+		PCODE_HANDLER(default),	// PCD_PLAYERBLACKSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERSILVERSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERGOLDSKULL
+		PCODE_HANDLER(default),	// PCD_PLAYERBLACKCARD
+		PCODE_HANDLER(default),	// PCD_PLAYERSILVERCARD
+		PCODE_HANDLER(ISNETWORKGAME),
+		PCODE_HANDLER(PLAYERTEAM),
+/*120*/	PCODE_HANDLER(PLAYERHEALTH),
+		PCODE_HANDLER(PLAYERARMORPOINTS),
+		PCODE_HANDLER(PLAYERFRAGS),
+		PCODE_HANDLER(default),	// PCD_PLAYEREXPERT
+		PCODE_HANDLER(default),	// PCD_BLUETEAMCOUNT
+		PCODE_HANDLER(default),	// PCD_REDTEAMCOUNT
+		PCODE_HANDLER(default),	// PCD_BLUETEAMSCORE
+		PCODE_HANDLER(default),	// PCD_REDTEAMSCORE
+		PCODE_HANDLER(default),	// PCD_ISONEFLAGCTF
+		PCODE_HANDLER(default),	// PCD_LSPEC6
+/*130*/	PCODE_HANDLER(default),	// PCD_LSPEC6DIRECT
+		PCODE_HANDLER(PRINTNAME),
+		PCODE_HANDLER(MUSICCHANGE),
+		PCODE_HANDLER(CONSOLECOMMANDDIRECT),
+		PCODE_HANDLER(CONSOLECOMMAND),
+		PCODE_HANDLER(SINGLEPLAYER),
+		PCODE_HANDLER(FIXEDMUL),
+		PCODE_HANDLER(FIXEDDIV),
+		PCODE_HANDLER(SETGRAVITY),
+		PCODE_HANDLER(SETGRAVITYDIRECT),
+/*140*/	PCODE_HANDLER(SETAIRCONTROL),
+		PCODE_HANDLER(SETAIRCONTROLDIRECT),
+		PCODE_HANDLER(CLEARINVENTORY),
+		PCODE_HANDLER(GIVEINVENTORY),
+		PCODE_HANDLER(GIVEINVENTORYDIRECT),
+		PCODE_HANDLER(TAKEINVENTORY),
+		PCODE_HANDLER(TAKEINVENTORYDIRECT),
+		PCODE_HANDLER(CHECKINVENTORY),
+		PCODE_HANDLER(CHECKINVENTORYDIRECT),
+		PCODE_HANDLER(SPAWN),
+/*150*/	PCODE_HANDLER(SPAWNDIRECT),
+		PCODE_HANDLER(SPAWNSPOT),
+		PCODE_HANDLER(SPAWNSPOTDIRECT),
+		PCODE_HANDLER(SETMUSIC),
+		PCODE_HANDLER(SETMUSICDIRECT),
+		PCODE_HANDLER(LOCALSETMUSIC),
+		PCODE_HANDLER(LOCALSETMUSICDIRECT),
+		PCODE_HANDLER(PRINTFIXED),
+		PCODE_HANDLER(PRINTLOCALIZED),
+		PCODE_HANDLER(MOREHUDMESSAGE),
+/*160*/	PCODE_HANDLER(OPTHUDMESSAGE),
+		PCODE_HANDLER(ENDHUDMESSAGE),
+		PCODE_HANDLER(ENDHUDMESSAGEBOLD),
+		PCODE_HANDLER(default),	// PCD_SETSTYLE
+		PCODE_HANDLER(default),	// PCD_SETSTYLEDIRECT
+		PCODE_HANDLER(SETFONT),
+		PCODE_HANDLER(SETFONTDIRECT),
+		PCODE_HANDLER(PUSHBYTE),
+		PCODE_HANDLER(LSPEC1DIRECTB),
+		PCODE_HANDLER(LSPEC2DIRECTB),
+/*170*/	PCODE_HANDLER(LSPEC3DIRECTB),
+		PCODE_HANDLER(LSPEC4DIRECTB),
+		PCODE_HANDLER(LSPEC5DIRECTB),
+		PCODE_HANDLER(DELAYDIRECTB),
+		PCODE_HANDLER(RANDOMDIRECTB),
+		PCODE_HANDLER(PUSHBYTES),
+		PCODE_HANDLER(PUSH2BYTES),
+		PCODE_HANDLER(PUSH3BYTES),
+		PCODE_HANDLER(PUSH4BYTES),
+		PCODE_HANDLER(PUSH5BYTES),
+/*180*/	PCODE_HANDLER(SETTHINGSPECIAL),
+		PCODE_HANDLER(ASSIGNGLOBALVAR),
+		PCODE_HANDLER(PUSHGLOBALVAR),
+		PCODE_HANDLER(ADDGLOBALVAR),
+		PCODE_HANDLER(SUBGLOBALVAR),
+		PCODE_HANDLER(MULGLOBALVAR),
+		PCODE_HANDLER(DIVGLOBALVAR),
+		PCODE_HANDLER(MODGLOBALVAR),
+		PCODE_HANDLER(INCGLOBALVAR),
+		PCODE_HANDLER(DECGLOBALVAR),
+/*190*/	PCODE_HANDLER(FADETO),
+		PCODE_HANDLER(FADERANGE),
+		PCODE_HANDLER(CANCELFADE),
+		PCODE_HANDLER(PLAYMOVIE),
+		PCODE_HANDLER(SETFLOORTRIGGER),
+		PCODE_HANDLER(SETCEILINGTRIGGER),
+		PCODE_HANDLER(GETACTORX),
+		PCODE_HANDLER(GETACTORY),
+		PCODE_HANDLER(GETACTORZ),
+		PCODE_HANDLER(STARTTRANSLATION),
+/*200*/	PCODE_HANDLER(TRANSLATIONRANGE1),
+		PCODE_HANDLER(TRANSLATIONRANGE2),
+		PCODE_HANDLER(ENDTRANSLATION),
+		PCODE_HANDLER(CALL),
+		PCODE_HANDLER(CALLDISCARD),
+		PCODE_HANDLER(RETURNVOID),
+		PCODE_HANDLER(RETURNVAL),
+		PCODE_HANDLER(PUSHMAPARRAY),
+		PCODE_HANDLER(ASSIGNMAPARRAY),
+		PCODE_HANDLER(ADDMAPARRAY),
+/*210*/	PCODE_HANDLER(SUBMAPARRAY),
+		PCODE_HANDLER(MULMAPARRAY),
+		PCODE_HANDLER(DIVMAPARRAY),
+		PCODE_HANDLER(MODMAPARRAY),
+		PCODE_HANDLER(INCMAPARRAY),
+		PCODE_HANDLER(DECMAPARRAY),
+		PCODE_HANDLER(DUP),
+		PCODE_HANDLER(SWAP),
+		PCODE_HANDLER(default),	// PCD_WRITETOINI
+		PCODE_HANDLER(default),	// PCD_GETFROMINI
+/*220*/	PCODE_HANDLER(SIN),
+		PCODE_HANDLER(COS),
+		PCODE_HANDLER(VECTORANGLE),
+		PCODE_HANDLER(CHECKWEAPON),
+		PCODE_HANDLER(SETWEAPON),
+		PCODE_HANDLER(TAGSTRING),
+		PCODE_HANDLER(PUSHWORLDARRAY),
+		PCODE_HANDLER(ASSIGNWORLDARRAY),
+		PCODE_HANDLER(ADDWORLDARRAY),
+		PCODE_HANDLER(SUBWORLDARRAY),
+/*230*/	PCODE_HANDLER(MULWORLDARRAY),
+		PCODE_HANDLER(DIVWORLDARRAY),
+		PCODE_HANDLER(MODWORLDARRAY),
+		PCODE_HANDLER(INCWORLDARRAY),
+		PCODE_HANDLER(DECWORLDARRAY),
+		PCODE_HANDLER(PUSHGLOBALARRAY),
+		PCODE_HANDLER(ASSIGNGLOBALARRAY),
+		PCODE_HANDLER(ADDGLOBALARRAY),
+		PCODE_HANDLER(SUBGLOBALARRAY),
+		PCODE_HANDLER(MULGLOBALARRAY),
+/*240*/	PCODE_HANDLER(DIVGLOBALARRAY),
+		PCODE_HANDLER(MODGLOBALARRAY),
+		PCODE_HANDLER(INCGLOBALARRAY),
+		PCODE_HANDLER(DECGLOBALARRAY),
+		PCODE_HANDLER(SETMARINEWEAPON),
+		PCODE_HANDLER(SETACTORPROPERTY),
+		PCODE_HANDLER(GETACTORPROPERTY),
+		PCODE_HANDLER(PLAYERNUMBER),
+		PCODE_HANDLER(ACTIVATORTID),
+		PCODE_HANDLER(SETMARINESPRITE),
+/*250*/	PCODE_HANDLER(GETSCREENWIDTH),
+		PCODE_HANDLER(GETSCREENHEIGHT),
+		PCODE_HANDLER(THING_PROJECTILE2),
+		PCODE_HANDLER(STRLEN),
+		PCODE_HANDLER(SETHUDSIZE),
+		PCODE_HANDLER(GETCVAR),
+		PCODE_HANDLER(CASEGOTOSORTED),
+		PCODE_HANDLER(SETRESULTVALUE),
+		PCODE_HANDLER(GETLINEROWOFFSET),
+		PCODE_HANDLER(GETACTORFLOORZ),
+/*260*/	PCODE_HANDLER(GETACTORANGLE),
+		PCODE_HANDLER(GETSECTORFLOORZ),
+		PCODE_HANDLER(GETSECTORCEILINGZ),
+		PCODE_HANDLER(LSPEC5RESULT),
+		PCODE_HANDLER(GETSIGILPIECES),
+		PCODE_HANDLER(GETLEVELINFO),
+		PCODE_HANDLER(CHANGESKY),
+		PCODE_HANDLER(PLAYERINGAME),
+		PCODE_HANDLER(PLAYERISBOT),
+		PCODE_HANDLER(SETCAMERATOTEXTURE),
+/*270*/	PCODE_HANDLER(ENDLOG),
+		PCODE_HANDLER(GETAMMOCAPACITY),
+		PCODE_HANDLER(SETAMMOCAPACITY),
+		PCODE_HANDLER(PRINTMAPCHARARRAY),
+		PCODE_HANDLER(PRINTWORLDCHARARRAY),
+		PCODE_HANDLER(PRINTGLOBALCHARARRAY),
+		PCODE_HANDLER(SETACTORANGLE),
+		PCODE_HANDLER(default),	// PCD_GRABINPUT
+		PCODE_HANDLER(default),	// PCD_SETMOUSEPOINTER
+		PCODE_HANDLER(default),	// PCD_MOVEMOUSEPOINTER
+/*280*/	PCODE_HANDLER(SPAWNPROJECTILE),
+		PCODE_HANDLER(GETSECTORLIGHTLEVEL),
+		PCODE_HANDLER(GETACTORCEILINGZ),
+		PCODE_HANDLER(SETACTORPOSITION),
+		PCODE_HANDLER(CLEARACTORINVENTORY),
+		PCODE_HANDLER(GIVEACTORINVENTORY),
+		PCODE_HANDLER(TAKEACTORINVENTORY),
+		PCODE_HANDLER(CHECKACTORINVENTORY),
+		PCODE_HANDLER(THINGCOUNTNAME),
+		PCODE_HANDLER(SPAWNSPOTFACING),
+/*290*/	PCODE_HANDLER(PLAYERCLASS),
+		PCODE_HANDLER(ANDSCRIPTVAR),
+		PCODE_HANDLER(ANDMAPVAR),
+		PCODE_HANDLER(ANDWORLDVAR),
+		PCODE_HANDLER(ANDGLOBALVAR),
+		PCODE_HANDLER(ANDMAPARRAY),
+		PCODE_HANDLER(ANDWORLDARRAY),
+		PCODE_HANDLER(ANDGLOBALARRAY),
+		PCODE_HANDLER(EORSCRIPTVAR),
+		PCODE_HANDLER(EORMAPVAR),
+/*300*/	PCODE_HANDLER(EORWORLDVAR),
+		PCODE_HANDLER(EORGLOBALVAR),
+		PCODE_HANDLER(EORMAPARRAY),
+		PCODE_HANDLER(EORWORLDARRAY),
+		PCODE_HANDLER(EORGLOBALARRAY),
+		PCODE_HANDLER(ORSCRIPTVAR),
+		PCODE_HANDLER(ORMAPVAR),
+		PCODE_HANDLER(ORWORLDVAR),
+		PCODE_HANDLER(ORGLOBALVAR),
+		PCODE_HANDLER(ORMAPARRAY),
+/*310*/	PCODE_HANDLER(ORWORLDARRAY),
+		PCODE_HANDLER(ORGLOBALARRAY),
+		PCODE_HANDLER(LSSCRIPTVAR),
+		PCODE_HANDLER(LSMAPVAR),
+		PCODE_HANDLER(LSWORLDVAR),
+		PCODE_HANDLER(LSGLOBALVAR),
+		PCODE_HANDLER(LSMAPARRAY),
+		PCODE_HANDLER(LSWORLDARRAY),
+		PCODE_HANDLER(LSGLOBALARRAY),
+		PCODE_HANDLER(RSSCRIPTVAR),
+/*320*/	PCODE_HANDLER(RSMAPVAR),
+		PCODE_HANDLER(RSWORLDVAR),
+		PCODE_HANDLER(RSGLOBALVAR),
+		PCODE_HANDLER(RSMAPARRAY),
+		PCODE_HANDLER(RSWORLDARRAY),
+		PCODE_HANDLER(RSGLOBALARRAY),
+		PCODE_HANDLER(GETPLAYERINFO),
+		PCODE_HANDLER(CHANGELEVEL),
+		PCODE_HANDLER(SECTORDAMAGE),
+		PCODE_HANDLER(REPLACETEXTURES),
+/*330*/	PCODE_HANDLER(NEGATEBINARY),
+		PCODE_HANDLER(GETACTORPITCH),
+		PCODE_HANDLER(SETACTORPITCH),
+		PCODE_HANDLER(PRINTBIND),
+		PCODE_HANDLER(SETACTORSTATE),
+		PCODE_HANDLER(THINGDAMAGE2),
+		PCODE_HANDLER(USEINVENTORY),
+		PCODE_HANDLER(USEACTORINVENTORY),
+		PCODE_HANDLER(CHECKACTORCEILINGTEXTURE),
+		PCODE_HANDLER(CHECKACTORFLOORTEXTURE),
+/*340*/	PCODE_HANDLER(GETACTORLIGHTLEVEL),
+		PCODE_HANDLER(SETMUGSHOTSTATE),
+		PCODE_HANDLER(THINGCOUNTSECTOR),
+		PCODE_HANDLER(THINGCOUNTNAMESECTOR),
+		PCODE_HANDLER(CHECKPLAYERCAMERA),
+		PCODE_HANDLER(MORPHACTOR),
+		PCODE_HANDLER(UNMORPHACTOR),
+		PCODE_HANDLER(GETPLAYERINPUT),
+		PCODE_HANDLER(CLASSIFYACTOR),
+		PCODE_HANDLER(PRINTBINARY),
+/*350*/	PCODE_HANDLER(PRINTHEX),
+		PCODE_HANDLER(CALLFUNC),
+		PCODE_HANDLER(SAVESTRING),
+		PCODE_HANDLER(PRINTMAPCHRANGE),
+		PCODE_HANDLER(PRINTWORLDCHRANGE),
+		PCODE_HANDLER(PRINTGLOBALCHRANGE),
+		PCODE_HANDLER(STRCPYTOMAPCHRANGE),
+		PCODE_HANDLER(STRCPYTOWORLDCHRANGE),
+		PCODE_HANDLER(STRCPYTOGLOBALCHRANGE),
+		PCODE_HANDLER(PUSHFUNCTION),
+/*360*/	PCODE_HANDLER(CALLSTACK),
+		PCODE_HANDLER(SCRIPTWAITNAMED),
+		PCODE_HANDLER(TRANSLATIONRANGE3),
+		PCODE_HANDLER(GOTOSTACK),
+		PCODE_HANDLER(ASSIGNSCRIPTARRAY),
+		PCODE_HANDLER(PUSHSCRIPTARRAY),
+		PCODE_HANDLER(ADDSCRIPTARRAY),
+		PCODE_HANDLER(SUBSCRIPTARRAY),
+		PCODE_HANDLER(MULSCRIPTARRAY),
+		PCODE_HANDLER(DIVSCRIPTARRAY),
+/*370*/	PCODE_HANDLER(MODSCRIPTARRAY),
+		PCODE_HANDLER(INCSCRIPTARRAY),
+		PCODE_HANDLER(DECSCRIPTARRAY),
+		PCODE_HANDLER(ANDSCRIPTARRAY),
+		PCODE_HANDLER(EORSCRIPTARRAY),
+		PCODE_HANDLER(ORSCRIPTARRAY),
+		PCODE_HANDLER(LSSCRIPTARRAY),
+		PCODE_HANDLER(RSSCRIPTARRAY),
+		PCODE_HANDLER(PRINTSCRIPTCHARARRAY),
+		PCODE_HANDLER(PRINTSCRIPTCHRANGE),
+/*380*/	PCODE_HANDLER(STRCPYTOSCRIPTCHRANGE),
+		PCODE_HANDLER(LSPEC5EX),
+		PCODE_HANDLER(LSPEC5EXRESULT),
+		PCODE_HANDLER(TRANSLATIONRANGE4),
+		PCODE_HANDLER(TRANSLATIONRANGE5),
+	};
+	static_assert(countof(pcodes) == PCODE_COMMAND_COUNT, "ACS p-code table is out of sync with the PCD enum");
+	bool threaded;
+	SETTHREADED();
+#endif
+
 
 	while (state == SCRIPT_Running)
 	{
@@ -7026,6 +8399,19 @@ int DLevelScript::RunScript ()
 			break;
 		}
 
+#if COMPGOTO
+		if (threaded)
+		{
+			temp = *pc++;
+			pcd = temp & PCODE_THREAD_MASK;
+			PCODE_JUMP(temp >> PCODE_THREAD_SHIFT);
+		}
+		else if (decoded)
+		{
+			pcd = NEXTWORD;
+			PCODE_JUMP(pcodes[pcd]);
+		}
+#endif
 		if (fmt == ACS_LittleEnhanced)
 		{
 			pcd = getbyte(pc);
@@ -7041,120 +8427,114 @@ int DLevelScript::RunScript ()
 
 		switch (pcd)
 		{
-		default:
+		PCODE_DEFAULT:
 			Printf ("Unknown P-Code %d in %s\n", pcd, ScriptPresentation(script).GetChars());
 			activeBehavior = savedActiveBehavior;
 			// fall through
-		case PCD_TERMINATE:
+		PCODE(TERMINATE):
 			DPrintf (DMSG_NOTIFY, "%s finished\n", ScriptPresentation(script).GetChars());
 			state = SCRIPT_PleaseRemove;
-			break;
+			NEXTPCODE;
 
-		case PCD_NOP:
-			break;
+		PCODE(NOP):
+			NEXTPCODE;
 
-		case PCD_SUSPEND:
+		PCODE(SUSPEND):
 			state = SCRIPT_Suspended;
-			break;
+			NEXTPCODE;
 
-		case PCD_TAGSTRING:
+		PCODE(TAGSTRING):
 			//Stack[sp-1] |= activeBehavior->GetLibraryID();
 			Stack[sp-1] = GlobalACSStrings.AddString(activeBehavior->LookupString(Stack[sp-1]));
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHNUMBER:
+		PCODE(PUSHNUMBER):
 			PushToStack (uallong(pc[0]));
 			pc++;
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHBYTE:
+		PCODE(PUSHBYTE):
 			PushToStack (*(uint8_t *)pc);
 			pc = (int *)((uint8_t *)pc + 1);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSH2BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
+		PCODE(PUSH2BYTES):
+			Stack[sp] = NEXTRAWBYTE;
+			Stack[sp+1] = NEXTRAWBYTE;
 			sp += 2;
-			pc = (int *)((uint8_t *)pc + 2);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSH3BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
+		PCODE(PUSH3BYTES):
+			Stack[sp] = NEXTRAWBYTE;
+			Stack[sp+1] = NEXTRAWBYTE;
+			Stack[sp+2] = NEXTRAWBYTE;
 			sp += 3;
-			pc = (int *)((uint8_t *)pc + 3);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSH4BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
-			Stack[sp+3] = ((uint8_t *)pc)[3];
+		PCODE(PUSH4BYTES):
+			Stack[sp] = NEXTRAWBYTE;
+			Stack[sp+1] = NEXTRAWBYTE;
+			Stack[sp+2] = NEXTRAWBYTE;
+			Stack[sp+3] = NEXTRAWBYTE;
 			sp += 4;
-			pc = (int *)((uint8_t *)pc + 4);
-			break;
-
-		case PCD_PUSH5BYTES:
-			Stack[sp] = ((uint8_t *)pc)[0];
-			Stack[sp+1] = ((uint8_t *)pc)[1];
-			Stack[sp+2] = ((uint8_t *)pc)[2];
-			Stack[sp+3] = ((uint8_t *)pc)[3];
-			Stack[sp+4] = ((uint8_t *)pc)[4];
+			NEXTPCODE;
+
+		PCODE(PUSH5BYTES):
+			Stack[sp] = NEXTRAWBYTE;
+			Stack[sp+1] = NEXTRAWBYTE;
+			Stack[sp+2] = NEXTRAWBYTE;
+			Stack[sp+3] = NEXTRAWBYTE;
+			Stack[sp+4] = NEXTRAWBYTE;
 			sp += 5;
-			pc = (int *)((uint8_t *)pc + 5);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHBYTES:
-			temp = *(uint8_t *)pc;
-			pc = (int *)((uint8_t *)pc + temp + 1);
-			for (temp = -temp; temp; temp++)
+		PCODE(PUSHBYTES):
+			for (temp = NEXTRAWBYTE; temp; temp--)
 			{
-				PushToStack (*((uint8_t *)pc + temp));
+				PushToStack (NEXTRAWBYTE);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DUP:
+		PCODE(DUP):
 			Stack[sp] = Stack[sp-1];
 			sp++;
-			break;
+			NEXTPCODE;
 
-		case PCD_SWAP:
+		PCODE(SWAP):
 			swapvalues(Stack[sp-2], Stack[sp-1]);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC1:
+		PCODE(LSPEC1):
 			P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(1) & specialargmask, 0, 0, 0, 0);
 			sp -= 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC2:
+		PCODE(LSPEC2):
 			P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask, 0, 0, 0);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC3:
+		PCODE(LSPEC3):
 			P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(3) & specialargmask,
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask, 0, 0);
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC4:
+		PCODE(LSPEC4):
 			P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(4) & specialargmask,
 									STACK(3) & specialargmask,
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask, 0);
 			sp -= 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5:
+		PCODE(LSPEC5):
 			P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(5) & specialargmask,
 									STACK(4) & specialargmask,
@@ -7162,9 +8542,9 @@ int DLevelScript::RunScript ()
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask);
 			sp -= 5;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5RESULT:
+		PCODE(LSPEC5RESULT):
 			STACK(5) = P_ExecuteSpecial(NEXTBYTE, activationline, activator, backSide,
 									STACK(5) & specialargmask,
 									STACK(4) & specialargmask,
@@ -7172,9 +8552,9 @@ int DLevelScript::RunScript ()
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask);
 			sp -= 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5EX:
+		PCODE(LSPEC5EX):
 			P_ExecuteSpecial(NEXTWORD, activationline, activator, backSide,
 									STACK(5) & specialargmask,
 									STACK(4) & specialargmask,
@@ -7182,9 +8562,9 @@ int DLevelScript::RunScript ()
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask);
 			sp -= 5;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5EXRESULT:
+		PCODE(LSPEC5EXRESULT):
 			STACK(5) = P_ExecuteSpecial(NEXTWORD, activationline, activator, backSide,
 									STACK(5) & specialargmask,
 									STACK(4) & specialargmask,
@@ -7192,33 +8572,33 @@ int DLevelScript::RunScript ()
 									STACK(2) & specialargmask,
 									STACK(1) & specialargmask);
 			sp -= 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC1DIRECT:
+		PCODE(LSPEC1DIRECT):
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(temp, activationline, activator, backSide,
 								uallong(pc[0]) & specialargmask ,0, 0, 0, 0);
 			pc += 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC2DIRECT:
+		PCODE(LSPEC2DIRECT):
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(temp, activationline, activator, backSide,
 								uallong(pc[0]) & specialargmask,
 								uallong(pc[1]) & specialargmask, 0, 0, 0);
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC3DIRECT:
+		PCODE(LSPEC3DIRECT):
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(temp, activationline, activator, backSide,
 								uallong(pc[0]) & specialargmask,
 								uallong(pc[1]) & specialargmask,
 								uallong(pc[2]) & specialargmask, 0, 0);
 			pc += 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC4DIRECT:
+		PCODE(LSPEC4DIRECT):
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(temp, activationline, activator, backSide,
 								uallong(pc[0]) & specialargmask,
@@ -7226,9 +8606,9 @@ int DLevelScript::RunScript ()
 								uallong(pc[2]) & specialargmask,
 								uallong(pc[3]) & specialargmask, 0);
 			pc += 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5DIRECT:
+		PCODE(LSPEC5DIRECT):
 			temp = NEXTBYTE;
 			P_ExecuteSpecial(temp, activationline, activator, backSide,
 								uallong(pc[0]) & specialargmask,
@@ -7237,42 +8617,42 @@ int DLevelScript::RunScript ()
 								uallong(pc[3]) & specialargmask,
 								uallong(pc[4]) & specialargmask);
 			pc += 5;
-			break;
+			NEXTPCODE;
 
 		// Parameters for PCD_LSPEC?DIRECTB are by definition bytes so never need and-ing.
-		case PCD_LSPEC1DIRECTB:
+		PCODE(LSPEC1DIRECTB):
 			P_ExecuteSpecial(((uint8_t *)pc)[0], activationline, activator, backSide,
 				((uint8_t *)pc)[1], 0, 0, 0, 0);
 			pc = (int *)((uint8_t *)pc + 2);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC2DIRECTB:
+		PCODE(LSPEC2DIRECTB):
 			P_ExecuteSpecial(((uint8_t *)pc)[0], activationline, activator, backSide,
 				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], 0, 0, 0);
 			pc = (int *)((uint8_t *)pc + 3);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC3DIRECTB:
+		PCODE(LSPEC3DIRECTB):
 			P_ExecuteSpecial(((uint8_t *)pc)[0], activationline, activator, backSide,
 				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3], 0, 0);
 			pc = (int *)((uint8_t *)pc + 4);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC4DIRECTB:
+		PCODE(LSPEC4DIRECTB):
 			P_ExecuteSpecial(((uint8_t *)pc)[0], activationline, activator, backSide,
 				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3],
 				((uint8_t *)pc)[4], 0);
 			pc = (int *)((uint8_t *)pc + 5);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSPEC5DIRECTB:
+		PCODE(LSPEC5DIRECTB):
 			P_ExecuteSpecial(((uint8_t *)pc)[0], activationline, activator, backSide,
 				((uint8_t *)pc)[1], ((uint8_t *)pc)[2], ((uint8_t *)pc)[3],
 				((uint8_t *)pc)[4], ((uint8_t *)pc)[5]);
 			pc = (int *)((uint8_t *)pc + 6);
-			break;
+			NEXTPCODE;
 
-		case PCD_CALLFUNC:
+		PCODE(CALLFUNC):
 			{
 				int argCount = NEXTBYTE;
 				int funcIndex = NEXTSHORT;
@@ -7281,18 +8661,18 @@ int DLevelScript::RunScript ()
 				sp -= argCount-1;
 				STACK(1) = retval;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHFUNCTION:
+		PCODE(PUSHFUNCTION):
 		{
 			int funcnum = NEXTBYTE;
 			// Not technically a string, but since we use the same tagging mechanism
 			PushToStack(TAGSTR(funcnum));
 			break;
 		}
-		case PCD_CALL:
-		case PCD_CALLDISCARD:
-		case PCD_CALLSTACK:
+		PCODE(CALL):
+		PCODE(CALLDISCARD):
+		PCODE(CALLSTACK):
 			{
 				int funcnum;
 				int i;
@@ -7336,19 +8716,22 @@ int DLevelScript::RunScript ()
 					Stack[sp+i] = 0;
 				}
 				sp += i;
-				::new(&Stack[sp]) CallReturn(activeBehavior->PC2Ofs(pc), activeFunction,
+				::new(&Stack[sp]) CallReturn(int((uint8_t *)pc - codebase), activeFunction,
 					activeBehavior, mylocals, localarrays, pcd == PCD_CALLDISCARD, runaway);
 				sp += (sizeof(CallReturn) + sizeof(int) - 1) / sizeof(int);
-				pc = module->Ofs2PC (func->Address);
+				decoded = usedecoded && module->HasDecodedCode();
+				codebase = module->GetCodeBase(decoded);
+				pc = CODEPTR(decoded ? func->DecodedAddress : func->Address);
 				localarrays = &func->LocalArrays;
 				activeFunction = func;
 				activeBehavior = module;
-				fmt = module->GetFormat();
+				fmt = module->GetCodeFormat(decoded);
+				SETTHREADED();
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_RETURNVOID:
-		case PCD_RETURNVAL:
+		PCODE(RETURNVOID):
+		PCODE(RETURNVAL):
 			{
 				int value;
 				union
@@ -7369,10 +8752,13 @@ int DLevelScript::RunScript ()
 				retsp = &Stack[sp];
 				activeBehavior->GetFunctionProfileData(activeFunction)->AddRun(runaway - ret->EntryInstrCount);
 				sp = int(locals - Stack);
-				pc = ret->ReturnModule->Ofs2PC(ret->ReturnAddress);
+				decoded = usedecoded && ret->ReturnModule->HasDecodedCode();
+				codebase = ret->ReturnModule->GetCodeBase(decoded);
+				pc = CODEPTR(ret->ReturnAddress);
 				activeFunction = ret->ReturnFunction;
 				activeBehavior = ret->ReturnModule;
-				fmt = activeBehavior->GetFormat();
+				fmt = activeBehavior->GetCodeFormat(decoded);
+				SETTHREADED();
 				locals = ret->ReturnLocals;
 				localarrays = ret->ReturnArrays;
 				if (!ret->bDiscardResult)
@@ -7381,24 +8767,24 @@ int DLevelScript::RunScript ()
 				}
 				ret->~CallReturn();
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ADD:
+		PCODE(ADD):
 			STACK(2) = STACK(2) + STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBTRACT:
+		PCODE(SUBTRACT):
 			STACK(2) = STACK(2) - STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_MULTIPLY:
+		PCODE(MULTIPLY):
 			STACK(2) = STACK(2) * STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVIDE:
+		PCODE(DIVIDE):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7408,9 +8794,9 @@ int DLevelScript::RunScript ()
 				STACK(2) = STACK(2) / STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODULUS:
+		PCODE(MODULUS):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7420,271 +8806,273 @@ int DLevelScript::RunScript ()
 				STACK(2) = STACK(2) % STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_EQ:
+		PCODE(EQ):
 			STACK(2) = (STACK(2) == STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_NE:
+		PCODE(NE):
 			STACK(2) = (STACK(2) != STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LT:
+		PCODE(LT):
 			STACK(2) = (STACK(2) < STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_GT:
+		PCODE(GT):
 			STACK(2) = (STACK(2) > STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LE:
+		PCODE(LE):
 			STACK(2) = (STACK(2) <= STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_GE:
+		PCODE(GE):
 			STACK(2) = (STACK(2) >= STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNSCRIPTVAR:
+		PCODE(ASSIGNSCRIPTVAR):
 			locals[NEXTBYTE] = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
 
-		case PCD_ASSIGNMAPVAR:
+		PCODE(ASSIGNMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNWORLDVAR:
+		PCODE(ASSIGNWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNGLOBALVAR:
+		PCODE(ASSIGNGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNSCRIPTARRAY:
+		PCODE(ASSIGNSCRIPTARRAY):
 			localarrays->Set(locals, NEXTBYTE, STACK(2), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNMAPARRAY:
+		PCODE(ASSIGNMAPARRAY):
 			activeBehavior->SetArrayVal (*(activeBehavior->MapVars[NEXTBYTE]), STACK(2), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNWORLDARRAY:
+		PCODE(ASSIGNWORLDARRAY):
 			ACS_WorldArrays[NEXTBYTE][STACK(2)] = STACK(1);
+			GlobalACSStrings.PromoteString(STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_ASSIGNGLOBALARRAY:
+		PCODE(ASSIGNGLOBALARRAY):
 			ACS_GlobalArrays[NEXTBYTE][STACK(2)] = STACK(1);
+			GlobalACSStrings.PromoteString(STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHSCRIPTVAR:
+		PCODE(PUSHSCRIPTVAR):
 			PushToStack (locals[NEXTBYTE]);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHMAPVAR:
+		PCODE(PUSHMAPVAR):
 			PushToStack (*(activeBehavior->MapVars[NEXTBYTE]));
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHWORLDVAR:
+		PCODE(PUSHWORLDVAR):
 			PushToStack (ACS_WorldVars[NEXTBYTE]);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHGLOBALVAR:
+		PCODE(PUSHGLOBALVAR):
 			PushToStack (ACS_GlobalVars[NEXTBYTE]);
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHSCRIPTARRAY:
+		PCODE(PUSHSCRIPTARRAY):
 			STACK(1) = localarrays->Get(locals, NEXTBYTE, STACK(1));
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHMAPARRAY:
+		PCODE(PUSHMAPARRAY):
 			STACK(1) = activeBehavior->GetArrayVal (*(activeBehavior->MapVars[NEXTBYTE]), STACK(1));
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHWORLDARRAY:
+		PCODE(PUSHWORLDARRAY):
 			STACK(1) = ACS_WorldArrays[NEXTBYTE][STACK(1)];
-			break;
+			NEXTPCODE;
 
-		case PCD_PUSHGLOBALARRAY:
+		PCODE(PUSHGLOBALARRAY):
 			STACK(1) = ACS_GlobalArrays[NEXTBYTE][STACK(1)];
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDSCRIPTVAR:
+		PCODE(ADDSCRIPTVAR):
 			locals[NEXTBYTE] += STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDMAPVAR:
+		PCODE(ADDMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) += STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDWORLDVAR:
+		PCODE(ADDWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] += STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDGLOBALVAR:
+		PCODE(ADDGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] += STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDSCRIPTARRAY:
+		PCODE(ADDSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) + STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDMAPARRAY:
+		PCODE(ADDMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) + STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDWORLDARRAY:
+		PCODE(ADDWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] += STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ADDGLOBALARRAY:
+		PCODE(ADDGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] += STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBSCRIPTVAR:
+		PCODE(SUBSCRIPTVAR):
 			locals[NEXTBYTE] -= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBMAPVAR:
+		PCODE(SUBMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) -= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBWORLDVAR:
+		PCODE(SUBWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] -= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBGLOBALVAR:
+		PCODE(SUBGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] -= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBSCRIPTARRAY:
+		PCODE(SUBSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) - STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBMAPARRAY:
+		PCODE(SUBMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) - STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBWORLDARRAY:
+		PCODE(SUBWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] -= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SUBGLOBALARRAY:
+		PCODE(SUBGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] -= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MULSCRIPTVAR:
+		PCODE(MULSCRIPTVAR):
 			locals[NEXTBYTE] *= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_MULMAPVAR:
+		PCODE(MULMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) *= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_MULWORLDVAR:
+		PCODE(MULWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] *= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_MULGLOBALVAR:
+		PCODE(MULGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] *= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_MULSCRIPTARRAY:
+		PCODE(MULSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) * STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MULMAPARRAY:
+		PCODE(MULMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) * STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MULWORLDARRAY:
+		PCODE(MULWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] *= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MULGLOBALARRAY:
+		PCODE(MULGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] *= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVSCRIPTVAR:
+		PCODE(DIVSCRIPTVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7694,9 +9082,9 @@ int DLevelScript::RunScript ()
 				locals[NEXTBYTE] /= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVMAPVAR:
+		PCODE(DIVMAPVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7706,9 +9094,9 @@ int DLevelScript::RunScript ()
 				*(activeBehavior->MapVars[NEXTBYTE]) /= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVWORLDVAR:
+		PCODE(DIVWORLDVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7718,9 +9106,9 @@ int DLevelScript::RunScript ()
 				ACS_WorldVars[NEXTBYTE] /= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVGLOBALVAR:
+		PCODE(DIVGLOBALVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7730,9 +9118,9 @@ int DLevelScript::RunScript ()
 				ACS_GlobalVars[NEXTBYTE] /= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVSCRIPTARRAY:
+		PCODE(DIVSCRIPTARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7743,9 +9131,9 @@ int DLevelScript::RunScript ()
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) / STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVMAPARRAY:
+		PCODE(DIVMAPARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7757,9 +9145,9 @@ int DLevelScript::RunScript ()
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) / STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVWORLDARRAY:
+		PCODE(DIVWORLDARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7770,9 +9158,9 @@ int DLevelScript::RunScript ()
 				ACS_WorldArrays[a][STACK(2)] /= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DIVGLOBALARRAY:
+		PCODE(DIVGLOBALARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_DivideBy0;
@@ -7783,9 +9171,9 @@ int DLevelScript::RunScript ()
 				ACS_GlobalArrays[a][STACK(2)] /= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODSCRIPTVAR:
+		PCODE(MODSCRIPTVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7795,9 +9183,9 @@ int DLevelScript::RunScript ()
 				locals[NEXTBYTE] %= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODMAPVAR:
+		PCODE(MODMAPVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7807,9 +9195,9 @@ int DLevelScript::RunScript ()
 				*(activeBehavior->MapVars[NEXTBYTE]) %= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODWORLDVAR:
+		PCODE(MODWORLDVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7819,9 +9207,9 @@ int DLevelScript::RunScript ()
 				ACS_WorldVars[NEXTBYTE] %= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODGLOBALVAR:
+		PCODE(MODGLOBALVAR):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7831,9 +9219,9 @@ int DLevelScript::RunScript ()
 				ACS_GlobalVars[NEXTBYTE] %= STACK(1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODSCRIPTARRAY:
+		PCODE(MODSCRIPTARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7844,9 +9232,9 @@ int DLevelScript::RunScript ()
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) % STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODMAPARRAY:
+		PCODE(MODMAPARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7858,9 +9246,9 @@ int DLevelScript::RunScript ()
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) % STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODWORLDARRAY:
+		PCODE(MODWORLDARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7871,9 +9259,9 @@ int DLevelScript::RunScript ()
 				ACS_WorldArrays[a][STACK(2)] %= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_MODGLOBALARRAY:
+		PCODE(MODGLOBALARRAY):
 			if (STACK(1) == 0)
 			{
 				state = SCRIPT_ModulusBy0;
@@ -7884,581 +9272,583 @@ int DLevelScript::RunScript ()
 				ACS_GlobalArrays[a][STACK(2)] %= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
 		//[MW] start
-		case PCD_ANDSCRIPTVAR:
+		PCODE(ANDSCRIPTVAR):
 			locals[NEXTBYTE] &= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDMAPVAR:
+		PCODE(ANDMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) &= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDWORLDVAR:
+		PCODE(ANDWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] &= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDGLOBALVAR:
+		PCODE(ANDGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] &= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDSCRIPTARRAY:
+		PCODE(ANDSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) & STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDMAPARRAY:
+		PCODE(ANDMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) & STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDWORLDARRAY:
+		PCODE(ANDWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] &= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDGLOBALARRAY:
+		PCODE(ANDGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] &= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_EORSCRIPTVAR:
+		PCODE(EORSCRIPTVAR):
 			locals[NEXTBYTE] ^= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_EORMAPVAR:
+		PCODE(EORMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) ^= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_EORWORLDVAR:
+		PCODE(EORWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] ^= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_EORGLOBALVAR:
+		PCODE(EORGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] ^= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_EORSCRIPTARRAY:
+		PCODE(EORSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) ^ STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_EORMAPARRAY:
+		PCODE(EORMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) ^ STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_EORWORLDARRAY:
+		PCODE(EORWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] ^= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_EORGLOBALARRAY:
+		PCODE(EORGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] ^= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ORSCRIPTVAR:
+		PCODE(ORSCRIPTVAR):
 			locals[NEXTBYTE] |= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORMAPVAR:
+		PCODE(ORMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) |= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORWORLDVAR:
+		PCODE(ORWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] |= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORGLOBALVAR:
+		PCODE(ORGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] |= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORSCRIPTARRAY:
+		PCODE(ORSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) | STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ORMAPARRAY:
+		PCODE(ORMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) | STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ORWORLDARRAY:
+		PCODE(ORWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] |= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ORGLOBALARRAY:
+		PCODE(ORGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				int i = STACK(2);
 				ACS_GlobalArrays[a][STACK(2)] |= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_LSSCRIPTVAR:
+		PCODE(LSSCRIPTVAR):
 			locals[NEXTBYTE] <<= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSMAPVAR:
+		PCODE(LSMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) <<= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSWORLDVAR:
+		PCODE(LSWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] <<= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSGLOBALVAR:
+		PCODE(LSGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] <<= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LSSCRIPTARRAY:
+		PCODE(LSSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) << STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_LSMAPARRAY:
+		PCODE(LSMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) << STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_LSWORLDARRAY:
+		PCODE(LSWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] <<= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_LSGLOBALARRAY:
+		PCODE(LSGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] <<= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_RSSCRIPTVAR:
+		PCODE(RSSCRIPTVAR):
 			locals[NEXTBYTE] >>= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RSMAPVAR:
+		PCODE(RSMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) >>= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RSWORLDVAR:
+		PCODE(RSWORLDVAR):
 			ACS_WorldVars[NEXTBYTE] >>= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RSGLOBALVAR:
+		PCODE(RSGLOBALVAR):
 			ACS_GlobalVars[NEXTBYTE] >>= STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RSSCRIPTARRAY:
+		PCODE(RSSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(2);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) >> STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_RSMAPARRAY:
+		PCODE(RSMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(2);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) >> STACK(1));
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_RSWORLDARRAY:
+		PCODE(RSWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(2)] >>= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_RSGLOBALARRAY:
+		PCODE(RSGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(2)] >>= STACK(1);
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 		//[MW] end
 
-		case PCD_INCSCRIPTVAR:
+		PCODE(INCSCRIPTVAR):
 			++locals[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_INCMAPVAR:
+		PCODE(INCMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) += 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_INCWORLDVAR:
+		PCODE(INCWORLDVAR):
 			++ACS_WorldVars[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_INCGLOBALVAR:
+		PCODE(INCGLOBALVAR):
 			++ACS_GlobalVars[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_INCSCRIPTARRAY:
+		PCODE(INCSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(1);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) + 1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_INCMAPARRAY:
+		PCODE(INCMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(1);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) + 1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_INCWORLDARRAY:
+		PCODE(INCWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(1)] += 1;
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_INCGLOBALARRAY:
+		PCODE(INCGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_GlobalArrays[a][STACK(1)] += 1;
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DECSCRIPTVAR:
+		PCODE(DECSCRIPTVAR):
 			--locals[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_DECMAPVAR:
+		PCODE(DECMAPVAR):
 			*(activeBehavior->MapVars[NEXTBYTE]) -= 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_DECWORLDVAR:
+		PCODE(DECWORLDVAR):
 			--ACS_WorldVars[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_DECGLOBALVAR:
+		PCODE(DECGLOBALVAR):
 			--ACS_GlobalVars[NEXTBYTE];
-			break;
+			NEXTPCODE;
 
-		case PCD_DECSCRIPTARRAY:
+		PCODE(DECSCRIPTARRAY):
 			{
 				int a = NEXTBYTE, i = STACK(1);
 				localarrays->Set(locals, a, i, localarrays->Get(locals, a, i) - 1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DECMAPARRAY:
+		PCODE(DECMAPARRAY):
 			{
 				int a = *(activeBehavior->MapVars[NEXTBYTE]);
 				int i = STACK(1);
 				activeBehavior->SetArrayVal (a, i, activeBehavior->GetArrayVal (a, i) - 1);
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DECWORLDARRAY:
+		PCODE(DECWORLDARRAY):
 			{
 				int a = NEXTBYTE;
 				ACS_WorldArrays[a][STACK(1)] -= 1;
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DECGLOBALARRAY:
+		PCODE(DECGLOBALARRAY):
 			{
 				int a = NEXTBYTE;
 				int i = STACK(1);
 				ACS_GlobalArrays[a][STACK(1)] -= 1;
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GOTO:
-			pc = activeBehavior->Ofs2PC (LittleLong(*pc));
-			break;
+		PCODE(GOTO):
+			pc = CODEPTR (LittleLong(*pc));
+			NEXTPCODE;
 
-		case PCD_GOTOSTACK:
+		PCODE(GOTOSTACK):
 			pc = activeBehavior->Jump2PC (STACK(1));
+			if (decoded) pc = activeBehavior->DecodePC (pc);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_IFGOTO:
+		PCODE(IFGOTO):
 			if (STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = CODEPTR (LittleLong(*pc));
 			else
 				pc++;
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETRESULTVALUE:
+		PCODE(SETRESULTVALUE):
 			resultValue = STACK(1);
-		case PCD_DROP: //fall through.
+		PCODE(DROP): //fall through.
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_DELAY:
+		PCODE(DELAY):
 			statedata = STACK(1) + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
 			if (statedata > 0)
 			{
 				state = SCRIPT_Delayed;
 			}
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_DELAYDIRECT:
+		PCODE(DELAYDIRECT):
 			statedata = uallong(pc[0]) + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
 			pc++;
 			if (statedata > 0)
 			{
 				state = SCRIPT_Delayed;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_DELAYDIRECTB:
+		PCODE(DELAYDIRECTB):
 			statedata = *(uint8_t *)pc + (fmt == ACS_Old && gameinfo.gametype == GAME_Hexen);
 			if (statedata > 0)
 			{
 				state = SCRIPT_Delayed;
 			}
 			pc = (int *)((uint8_t *)pc + 1);
-			break;
+			NEXTPCODE;
 
-		case PCD_RANDOM:
+		PCODE(RANDOM):
 			STACK(2) = Random (STACK(2), STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RANDOMDIRECT:
+		PCODE(RANDOMDIRECT):
 			PushToStack (Random (uallong(pc[0]), uallong(pc[1])));
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_RANDOMDIRECTB:
+		PCODE(RANDOMDIRECTB):
 			PushToStack (Random (((uint8_t *)pc)[0], ((uint8_t *)pc)[1]));
 			pc = (int *)((uint8_t *)pc + 2);
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGCOUNT:
+		PCODE(THINGCOUNT):
 			STACK(2) = ThingCount (STACK(2), -1, STACK(1), -1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGCOUNTDIRECT:
+		PCODE(THINGCOUNTDIRECT):
 			PushToStack (ThingCount (uallong(pc[0]), -1, uallong(pc[1]), -1));
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGCOUNTNAME:
+		PCODE(THINGCOUNTNAME):
 			STACK(2) = ThingCount (-1, STACK(2), STACK(1), -1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGCOUNTNAMESECTOR:
+		PCODE(THINGCOUNTNAMESECTOR):
 			STACK(3) = ThingCount (-1, STACK(3), STACK(2), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGCOUNTSECTOR:
+		PCODE(THINGCOUNTSECTOR):
 			STACK(3) = ThingCount (STACK(3), -1, STACK(2), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_TAGWAIT:
+		PCODE(TAGWAIT):
 			state = SCRIPT_TagWait;
 			statedata = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_TAGWAITDIRECT:
+		PCODE(TAGWAITDIRECT):
 			state = SCRIPT_TagWait;
 			statedata = uallong(pc[0]);
 			pc++;
-			break;
+			NEXTPCODE;
 
-		case PCD_POLYWAIT:
+		PCODE(POLYWAIT):
 			state = SCRIPT_PolyWait;
 			statedata = STACK(1);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_POLYWAITDIRECT:
+		PCODE(POLYWAITDIRECT):
 			state = SCRIPT_PolyWait;
 			statedata = uallong(pc[0]);
 			pc++;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGEFLOOR:
+		PCODE(CHANGEFLOOR):
 			ChangeFlat (STACK(2), STACK(1), 0);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGEFLOORDIRECT:
+		PCODE(CHANGEFLOORDIRECT):
 			ChangeFlat (uallong(pc[0]), TAGSTR(uallong(pc[1])), 0);
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGECEILING:
+		PCODE(CHANGECEILING):
 			ChangeFlat (STACK(2), STACK(1), 1);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGECEILINGDIRECT:
+		PCODE(CHANGECEILINGDIRECT):
 			ChangeFlat (uallong(pc[0]), TAGSTR(uallong(pc[1])), 1);
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_RESTART:
+		PCODE(RESTART):
 			{
 				const ScriptPtr *scriptp;
 
 				scriptp = activeBehavior->FindScript (script);
 				pc = activeBehavior->GetScriptAddress (scriptp);
+				if (decoded) pc = activeBehavior->DecodePC (pc);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDLOGICAL:
+		PCODE(ANDLOGICAL):
 			STACK(2) = (STACK(2) && STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORLOGICAL:
+		PCODE(ORLOGICAL):
 			STACK(2) = (STACK(2) || STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ANDBITWISE:
+		PCODE(ANDBITWISE):
 			STACK(2) = (STACK(2) & STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_ORBITWISE:
+		PCODE(ORBITWISE):
 			STACK(2) = (STACK(2) | STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_EORBITWISE:
+		PCODE(EORBITWISE):
 			STACK(2) = (STACK(2) ^ STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_NEGATELOGICAL:
+		PCODE(NEGATELOGICAL):
 			STACK(1) = !STACK(1);
-			break;
+			NEXTPCODE;
 
 
 
 
-		case PCD_NEGATEBINARY:
+		PCODE(NEGATEBINARY):
 			STACK(1) = ~STACK(1);
-			break;
+			NEXTPCODE;
 
-		case PCD_LSHIFT:
+		PCODE(LSHIFT):
 			STACK(2) = (STACK(2) << STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_RSHIFT:
+		PCODE(RSHIFT):
 			STACK(2) = (STACK(2) >> STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_UNARYMINUS:
+		PCODE(UNARYMINUS):
 			STACK(1) = -STACK(1);
-			break;
+			NEXTPCODE;
 
-		case PCD_IFNOTGOTO:
+		PCODE(IFNOTGOTO):
 			if (!STACK(1))
-				pc = activeBehavior->Ofs2PC (LittleLong(*pc));
+				pc = CODEPTR (LittleLong(*pc));
 			else
 				pc++;
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_LINESIDE:
+		PCODE(LINESIDE):
 			PushToStack (backSide);
-			break;
+			NEXTPCODE;
 
-		case PCD_SCRIPTWAIT:
+		PCODE(SCRIPTWAIT):
 			statedata = STACK(1);
 			sp--;
 scriptwait:
@@ -8467,39 +9857,40 @@ scriptwait:
 			else
 				state = SCRIPT_ScriptWaitPre;
 			PutLast ();
-			break;
+			NEXTPCODE;
 
-		case PCD_SCRIPTWAITDIRECT:
+		PCODE(SCRIPTWAITDIRECT):
 			statedata = uallong(pc[0]);
 			pc++;
 			goto scriptwait;
 
-		case PCD_SCRIPTWAITNAMED:
+		PCODE(SCRIPTWAITNAMED):
 			statedata = -FName(FBehavior::StaticLookupString(STACK(1)));
 			sp--;
 			goto scriptwait;
 
-		case PCD_CLEARLINESPECIAL:
+		PCODE(CLEARLINESPECIAL):
 			if (activationline != NULL)
 			{
 				activationline->special = 0;
+				P_SightGeometryChanged();
 				DPrintf(DMSG_SPAMMY, "Cleared line special on line %d\n", activationline->Index());
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_CASEGOTO:
+		PCODE(CASEGOTO):
 			if (STACK(1) == uallong(pc[0]))
 			{
-				pc = activeBehavior->Ofs2PC (uallong(pc[1]));
+				pc = CODEPTR (uallong(pc[1]));
 				sp--;
 			}
 			else
 			{
 				pc += 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_CASEGOTOSORTED:
+		PCODE(CASEGOTOSORTED):
 			// The count and jump table are 4-byte aligned
 			pc = (int *)(((size_t)pc + 3) & ~3);
 			{
@@ -8511,7 +9902,7 @@ scriptwait:
 					int32_t caseval = LittleLong(pc[mid*2]);
 					if (caseval == STACK(1))
 					{
-						pc = activeBehavior->Ofs2PC (LittleLong(pc[mid*2+1]));
+						pc = CODEPTR (LittleLong(pc[mid*2+1]));
 						sp--;
 						break;
 					}
@@ -8530,14 +9921,14 @@ scriptwait:
 					pc += numcases * 2;
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_BEGINPRINT:
+		PCODE(BEGINPRINT):
 			STRINGBUILDER_START(work);
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTSTRING:
-		case PCD_PRINTLOCALIZED:
+		PCODE(PRINTSTRING):
+		PCODE(PRINTLOCALIZED):
 			lookup = FBehavior::StaticLookupString (STACK(1));
 			if (pcd == PCD_PRINTLOCALIZED)
 			{
@@ -8548,38 +9939,38 @@ scriptwait:
 				work += lookup;
 			}
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTNUMBER:
+		PCODE(PRINTNUMBER):
 			work.AppendFormat ("%d", STACK(1));
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTBINARY:
+		PCODE(PRINTBINARY):
 			IGNORE_FORMAT_PRE
 			work.AppendFormat ("%B", STACK(1));
 			IGNORE_FORMAT_POST
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTHEX:
+		PCODE(PRINTHEX):
 			work.AppendFormat ("%X", STACK(1));
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTCHARACTER:
+		PCODE(PRINTCHARACTER):
 			work += (char)STACK(1);
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_PRINTFIXED:
+		PCODE(PRINTFIXED):
 			work.AppendFormat ("%g", ACSToDouble(STACK(1)));
 			--sp;
-			break;
+			NEXTPCODE;
 
 		// [BC] Print activator's name
 		// [RH] Fancied up a bit
-		case PCD_PRINTNAME:
+		PCODE(PRINTNAME):
 			{
 				player_t *player = NULL;
 
@@ -8658,11 +10049,11 @@ scriptwait:
 				}
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
 		// Print script character array
-		case PCD_PRINTSCRIPTCHARARRAY:
-		case PCD_PRINTSCRIPTCHRANGE:
+		PCODE(PRINTSCRIPTCHARARRAY):
+		PCODE(PRINTSCRIPTCHRANGE):
 			{
 				int capacity, offset, a, c;
 				if (CharArrayParms(capacity, offset, a, Stack, sp, pcd == PCD_PRINTSCRIPTCHRANGE))
@@ -8674,11 +10065,11 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
 		// [JB] Print map character array
-		case PCD_PRINTMAPCHARARRAY:
-		case PCD_PRINTMAPCHRANGE:
+		PCODE(PRINTMAPCHARARRAY):
+		PCODE(PRINTMAPCHRANGE):
 			{
 				int capacity, offset, a, c;
 				if (CharArrayParms(capacity, offset, a, Stack, sp, pcd == PCD_PRINTMAPCHRANGE))
@@ -8690,11 +10081,11 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
 		// [JB] Print world character array
-		case PCD_PRINTWORLDCHARARRAY:
-		case PCD_PRINTWORLDCHRANGE:
+		PCODE(PRINTWORLDCHARARRAY):
+		PCODE(PRINTWORLDCHRANGE):
 			{
 				int capacity, offset, a, c;
 				if (CharArrayParms(capacity, offset, a, Stack, sp, pcd == PCD_PRINTWORLDCHRANGE))
@@ -8706,11 +10097,11 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
 		// [JB] Print global character array
-		case PCD_PRINTGLOBALCHARARRAY:
-		case PCD_PRINTGLOBALCHRANGE:
+		PCODE(PRINTGLOBALCHARARRAY):
+		PCODE(PRINTGLOBALCHRANGE):
 			{
 				int capacity, offset, a, c;
 				if (CharArrayParms(capacity, offset, a, Stack, sp, pcd == PCD_PRINTGLOBALCHRANGE))
@@ -8722,10 +10113,10 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
 		// [GRB] Print key name(s) for a command
-		case PCD_PRINTBIND:
+		PCODE(PRINTBIND):
 			lookup = FBehavior::StaticLookupString (STACK(1));
 			if (lookup != NULL)
 			{
@@ -8741,12 +10132,12 @@ scriptwait:
 					work << "??? (" << (char *)lookup << ')';
 			}
 			--sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_ENDPRINT:
-		case PCD_ENDPRINTBOLD:
-		case PCD_MOREHUDMESSAGE:
-		case PCD_ENDLOG:
+		PCODE(ENDPRINT):
+		PCODE(ENDPRINTBOLD):
+		PCODE(MOREHUDMESSAGE):
+		PCODE(ENDLOG):
 			if (pcd == PCD_ENDLOG)
 			{
 				Printf ("%s\n", work.GetChars());
@@ -8778,14 +10169,14 @@ scriptwait:
 			{
 				optstart = -1;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_OPTHUDMESSAGE:
+		PCODE(OPTHUDMESSAGE):
 			optstart = sp;
-			break;
+			NEXTPCODE;
 
-		case PCD_ENDHUDMESSAGE:
-		case PCD_ENDHUDMESSAGEBOLD:
+		PCODE(ENDHUDMESSAGE):
+		PCODE(ENDHUDMESSAGEBOLD):
 			if (optstart == -1)
 			{
 				optstart = sp;
@@ -8888,23 +10279,23 @@ scriptwait:
 			}
 			STRINGBUILDER_FINISH(work);
 			sp = optstart-6;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETFONT:
+		PCODE(SETFONT):
 			DoSetFont (STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETFONTDIRECT:
+		PCODE(SETFONTDIRECT):
 			DoSetFont (TAGSTR(uallong(pc[0])));
 			pc++;
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERCOUNT:
+		PCODE(PLAYERCOUNT):
 			PushToStack (CountPlayers ());
-			break;
+			NEXTPCODE;
 
-		case PCD_GAMETYPE:
+		PCODE(GAMETYPE):
 			if (gamestate == GS_TITLELEVEL)
 				PushToStack (GAME_TITLE_MAP);
 			else if (deathmatch)
@@ -8913,32 +10304,32 @@ scriptwait:
 				PushToStack (GAME_NET_COOPERATIVE);
 			else
 				PushToStack (GAME_SINGLE_PLAYER);
-			break;
+			NEXTPCODE;
 
-		case PCD_GAMESKILL:
+		PCODE(GAMESKILL):
 			PushToStack (G_SkillProperty(SKILLP_ACSReturn));
-			break;
+			NEXTPCODE;
 
 // [BC] Start ST PCD's
-		case PCD_ISNETWORKGAME:
+		PCODE(ISNETWORKGAME):
 			PushToStack(netgame);
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERTEAM:
+		PCODE(PLAYERTEAM):
 			if ( activator && activator->player )
 				PushToStack( activator->player->userinfo.GetTeam() );
 			else
 				PushToStack( 0 );
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERHEALTH:
+		PCODE(PLAYERHEALTH):
 			if (activator)
 				PushToStack (activator->health);
 			else
 				PushToStack (0);
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERARMORPOINTS:
+		PCODE(PLAYERARMORPOINTS):
 			if (activator)
 			{
 				auto armor = activator->FindInventory(NAME_BasicArmor);
@@ -8948,34 +10339,34 @@ scriptwait:
 			{
 				PushToStack (0);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERFRAGS:
+		PCODE(PLAYERFRAGS):
 			if (activator && activator->player)
 				PushToStack (activator->player->fragcount);
 			else
 				PushToStack (0);
-			break;
+			NEXTPCODE;
 
-		case PCD_MUSICCHANGE:
+		PCODE(MUSICCHANGE):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL)
 			{
 				S_ChangeMusic (lookup, STACK(1));
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SINGLEPLAYER:
+		PCODE(SINGLEPLAYER):
 			PushToStack (!multiplayer);
-			break;
+			NEXTPCODE;
 // [BC] End ST PCD's
 
-		case PCD_TIMER:
+		PCODE(TIMER):
 			PushToStack (level.time);
-			break;
+			NEXTPCODE;
 
-		case PCD_SECTORSOUND:
+		PCODE(SECTORSOUND):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -8998,9 +10389,9 @@ scriptwait:
 				}
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_AMBIENTSOUND:
+		PCODE(AMBIENTSOUND):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -9009,9 +10400,9 @@ scriptwait:
 						 (float)(STACK(1)) / 127.f, ATTN_NONE);
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_LOCALAMBIENTSOUND:
+		PCODE(LOCALAMBIENTSOUND):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL && activator->CheckLocalView (consoleplayer))
 			{
@@ -9020,9 +10411,9 @@ scriptwait:
 						 (float)(STACK(1)) / 127.f, ATTN_NONE);
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_ACTIVATORSOUND:
+		PCODE(ACTIVATORSOUND):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -9040,9 +10431,9 @@ scriptwait:
 				}
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SOUNDSEQUENCE:
+		PCODE(SOUNDSEQUENCE):
 			lookup = FBehavior::StaticLookupString (STACK(1));
 			if (lookup != NULL)
 			{
@@ -9052,14 +10443,14 @@ scriptwait:
 				}
 			}
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETLINETEXTURE:
+		PCODE(SETLINETEXTURE):
 			SetLineTexture (STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_REPLACETEXTURES:
+		PCODE(REPLACETEXTURES):
 		{
 			const char *fromname = FBehavior::StaticLookupString(STACK(3));
 			const char *toname = FBehavior::StaticLookupString(STACK(2));
@@ -9069,7 +10460,7 @@ scriptwait:
 			break;
 		}
 
-		case PCD_SETLINEBLOCKING:
+		PCODE(SETLINEBLOCKING):
 			{
 				int lineno;
 
@@ -9101,12 +10492,14 @@ scriptwait:
 						break;
 					}
 				}
+				// ML_BLOCKEVERYTHING blocks sight.
+				P_SightGeometryChanged();
 
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETLINEMONSTERBLOCKING:
+		PCODE(SETLINEMONSTERBLOCKING):
 			{
 				int line;
 
@@ -9121,9 +10514,9 @@ scriptwait:
 
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETLINESPECIAL:
+		PCODE(SETLINESPECIAL):
 			{
 				int linenum = -1;
 				int specnum = STACK(6);
@@ -9136,6 +10529,7 @@ scriptwait:
 					arg0 = -FName(FBehavior::StaticLookupString(arg0));
 				}
 
+				GlobalACSStrings.PromoteStringArray(&STACK(5), 5);
 				FLineIdIterator itr(STACK(7));
 				while ((linenum = itr.Next()) >= 0)
 				{
@@ -9149,11 +10543,13 @@ scriptwait:
 					DPrintf(DMSG_SPAMMY, "Set special on line %d (id %d) to %d(%d,%d,%d,%d,%d)\n",
 						linenum, STACK(7), specnum, arg0, STACK(4), STACK(3), STACK(2), STACK(1));
 				}
+				// Monsters may look past block everything lines with a script special.
+				P_SightGeometryChanged();
 				sp -= 7;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETTHINGSPECIAL:
+		PCODE(SETTHINGSPECIAL):
 			{
 				int specnum = STACK(6);
 				int arg0 = STACK(5);
@@ -9165,6 +10561,7 @@ scriptwait:
 					arg0 = -FName(FBehavior::StaticLookupString(arg0));
 				}
 
+				GlobalACSStrings.PromoteStringArray(&STACK(5), 5);
 				if (STACK(7) != 0)
 				{
 					FActorIterator iterator (STACK(7));
@@ -9191,9 +10588,9 @@ scriptwait:
 				}
 				sp -= 7;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGSOUND:
+		PCODE(THINGSOUND):
 			lookup = FBehavior::StaticLookupString (STACK(2));
 			if (lookup != NULL)
 			{
@@ -9208,70 +10605,70 @@ scriptwait:
 				}
 			}
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_FIXEDMUL:
+		PCODE(FIXEDMUL):
 			STACK(2) = FixedMul (STACK(2), STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_FIXEDDIV:
+		PCODE(FIXEDDIV):
 			STACK(2) = FixedDiv (STACK(2), STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETGRAVITY:
+		PCODE(SETGRAVITY):
 			level.gravity = ACSToDouble(STACK(1));
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETGRAVITYDIRECT:
+		PCODE(SETGRAVITYDIRECT):
 			level.gravity = ACSToDouble(uallong(pc[0]));
 			pc++;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETAIRCONTROL:
+		PCODE(SETAIRCONTROL):
 			level.aircontrol = ACSToDouble(STACK(1));
 			sp--;
 			G_AirControlChanged ();
-			break;
+			NEXTPCODE;
 
-		case PCD_SETAIRCONTROLDIRECT:
+		PCODE(SETAIRCONTROLDIRECT):
 			level.aircontrol = ACSToDouble(uallong(pc[0]));
 			pc++;
 			G_AirControlChanged ();
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWN:
+		PCODE(SPAWN):
 			STACK(6) = DoSpawn (STACK(6), STACK(5), STACK(4), STACK(3), STACK(2), STACK(1), false);
 			sp -= 5;
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWNDIRECT:
+		PCODE(SPAWNDIRECT):
 			PushToStack (DoSpawn (TAGSTR(uallong(pc[0])), uallong(pc[1]), uallong(pc[2]), uallong(pc[3]), uallong(pc[4]), uallong(pc[5]), false));
 			pc += 6;
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWNSPOT:
+		PCODE(SPAWNSPOT):
 			STACK(4) = DoSpawnSpot (STACK(4), STACK(3), STACK(2), STACK(1), false);
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWNSPOTDIRECT:
+		PCODE(SPAWNSPOTDIRECT):
 			PushToStack (DoSpawnSpot (TAGSTR(uallong(pc[0])), uallong(pc[1]), uallong(pc[2]), uallong(pc[3]), false));
 			pc += 4;
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWNSPOTFACING:
+		PCODE(SPAWNSPOTFACING):
 			STACK(3) = DoSpawnSpotFacing (STACK(3), STACK(2), STACK(1), false);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CLEARINVENTORY:
+		PCODE(CLEARINVENTORY):
 			ClearInventory (activator);
-			break;
+			NEXTPCODE;
 
-		case PCD_CLEARACTORINVENTORY:
+		PCODE(CLEARACTORINVENTORY):
 			if (STACK(1) == 0)
 			{
 				ClearInventory(NULL);
@@ -9286,14 +10683,14 @@ scriptwait:
 				}
 			}
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_GIVEINVENTORY:
+		PCODE(GIVEINVENTORY):
 			GiveInventory (activator, FBehavior::StaticLookupString (STACK(2)), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_GIVEACTORINVENTORY:
+		PCODE(GIVEACTORINVENTORY):
 			{
 				const char *type = FBehavior::StaticLookupString(STACK(2));
 				if (STACK(3) == 0)
@@ -9311,19 +10708,19 @@ scriptwait:
 				}
 				sp -= 3;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GIVEINVENTORYDIRECT:
+		PCODE(GIVEINVENTORYDIRECT):
 			GiveInventory (activator, FBehavior::StaticLookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_TAKEINVENTORY:
+		PCODE(TAKEINVENTORY):
 			TakeInventory (activator, FBehavior::StaticLookupString (STACK(2)), STACK(1));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_TAKEACTORINVENTORY:
+		PCODE(TAKEACTORINVENTORY):
 			{
 				const char *type = FBehavior::StaticLookupString(STACK(2));
 				if (STACK(3) == 0)
@@ -9341,33 +10738,33 @@ scriptwait:
 				}
 				sp -= 3;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TAKEINVENTORYDIRECT:
+		PCODE(TAKEINVENTORYDIRECT):
 			TakeInventory (activator, FBehavior::StaticLookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
 			pc += 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKINVENTORY:
+		PCODE(CHECKINVENTORY):
 			STACK(1) = CheckInventory (activator, FBehavior::StaticLookupString (STACK(1)), false);
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKACTORINVENTORY:
+		PCODE(CHECKACTORINVENTORY):
 			STACK(2) = CheckInventory (SingleActorFromTID(STACK(2), NULL),
 										FBehavior::StaticLookupString (STACK(1)), false);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKINVENTORYDIRECT:
+		PCODE(CHECKINVENTORYDIRECT):
 			PushToStack (CheckInventory (activator, FBehavior::StaticLookupString (TAGSTR(uallong(pc[0]))), false));
 			pc += 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_USEINVENTORY:
+		PCODE(USEINVENTORY):
 			STACK(1) = UseInventory (activator, FBehavior::StaticLookupString (STACK(1)));
-			break;
+			NEXTPCODE;
 
-		case PCD_USEACTORINVENTORY:
+		PCODE(USEACTORINVENTORY):
 			{
 				int ret = 0;
 				const char *type = FBehavior::StaticLookupString(STACK(1));
@@ -9387,9 +10784,9 @@ scriptwait:
 				STACK(2) = ret;
 				sp--;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETSIGILPIECES:
+		PCODE(GETSIGILPIECES):
 			{
 				AInventory *sigil;
 
@@ -9402,9 +10799,9 @@ scriptwait:
 					PushToStack (sigil->health);
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETAMMOCAPACITY:
+		PCODE(GETAMMOCAPACITY):
 			if (activator != NULL)
 			{
 				PClass *type = PClass::FindClass (FBehavior::StaticLookupString (STACK(1)));
@@ -9431,9 +10828,9 @@ scriptwait:
 			{
 				STACK(1) = 0;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETAMMOCAPACITY:
+		PCODE(SETAMMOCAPACITY):
 			if (activator != NULL)
 			{
 				PClassActor *type = PClass::FindActor (FBehavior::StaticLookupString (STACK(2)));
@@ -9458,46 +10855,46 @@ scriptwait:
 				}
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETMUSIC:
+		PCODE(SETMUSIC):
 			S_ChangeMusic (FBehavior::StaticLookupString (STACK(3)), STACK(2));
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETMUSICDIRECT:
+		PCODE(SETMUSICDIRECT):
 			S_ChangeMusic (FBehavior::StaticLookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
 			pc += 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_LOCALSETMUSIC:
+		PCODE(LOCALSETMUSIC):
 			if (activator == players[consoleplayer].mo)
 			{
 				S_ChangeMusic (FBehavior::StaticLookupString (STACK(3)), STACK(2));
 			}
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_LOCALSETMUSICDIRECT:
+		PCODE(LOCALSETMUSICDIRECT):
 			if (activator == players[consoleplayer].mo)
 			{
 				S_ChangeMusic (FBehavior::StaticLookupString (TAGSTR(uallong(pc[0]))), uallong(pc[1]));
 			}
 			pc += 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_FADETO:
+		PCODE(FADETO):
 			DoFadeTo (STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 5;
-			break;
+			NEXTPCODE;
 
-		case PCD_FADERANGE:
+		PCODE(FADERANGE):
 			DoFadeRange (STACK(9), STACK(8), STACK(7), STACK(6),
 						 STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 9;
-			break;
+			NEXTPCODE;
 
-		case PCD_CANCELFADE:
+		PCODE(CANCELFADE):
 			{
 				TThinkerIterator<DFlashFader> iterator;
 				DFlashFader *fader;
@@ -9510,13 +10907,13 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYMOVIE:
+		PCODE(PLAYMOVIE):
 			STACK(1) = -1;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETACTORPOSITION:
+		PCODE(SETACTORPOSITION):
 			{
 				bool result = false;
 				AActor *actor = SingleActorFromTID (STACK(5), activator);
@@ -9525,11 +10922,11 @@ scriptwait:
 				sp -= 4;
 				STACK(1) = result;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORX:
-		case PCD_GETACTORY:
-		case PCD_GETACTORZ:
+		PCODE(GETACTORX):
+		PCODE(GETACTORY):
+		PCODE(GETACTORZ):
 			{
 				AActor *actor = SingleActorFromTID(STACK(1), activator);
 				if (actor == NULL)
@@ -9545,37 +10942,37 @@ scriptwait:
 					STACK(1) = DoubleToACS(pcd == PCD_GETACTORX ? actor->X() : actor->Y());
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORFLOORZ:
+		PCODE(GETACTORFLOORZ):
 			{
 				AActor *actor = SingleActorFromTID(STACK(1), activator);
 				STACK(1) = actor == NULL ? 0 : DoubleToACS(actor->floorz);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORCEILINGZ:
+		PCODE(GETACTORCEILINGZ):
 			{
 				AActor *actor = SingleActorFromTID(STACK(1), activator);
 				STACK(1) = actor == NULL ? 0 : DoubleToACS(actor->ceilingz);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORANGLE:
+		PCODE(GETACTORANGLE):
 			{
 				AActor *actor = SingleActorFromTID(STACK(1), activator);
 				STACK(1) = actor == NULL ? 0 : AngleToACS(actor->Angles.Yaw);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORPITCH:
+		PCODE(GETACTORPITCH):
 			{
 				AActor *actor = SingleActorFromTID(STACK(1), activator);
 				STACK(1) = actor == NULL ? 0 : PitchToACS(actor->Angles.Pitch);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETLINEROWOFFSET:
+		PCODE(GETLINEROWOFFSET):
 			if (activationline != NULL)
 			{
 				PushToStack (int(activationline->sidedef[0]->GetTextureYOffset(side_t::mid)));
@@ -9584,10 +10981,10 @@ scriptwait:
 			{
 				PushToStack (0);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETSECTORFLOORZ:
-		case PCD_GETSECTORCEILINGZ:
+		PCODE(GETSECTORFLOORZ):
+		PCODE(GETSECTORCEILINGZ):
 			// Arguments are (tag, x, y). If you don't use slopes, then (x, y) don't
 			// really matter and can be left as (0, 0) if you like.
 			// [Dusk] If tag = 0, then this returns the z height at whatever sector
@@ -9618,9 +11015,9 @@ scriptwait:
 				sp -= 2;
 				STACK(1) = DoubleToACS(z);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETSECTORLIGHTLEVEL:
+		PCODE(GETSECTORLIGHTLEVEL):
 			{
 				int secnum = P_FindFirstSectorFromTag (STACK(1));
 				int z = -1;
@@ -9631,21 +11028,21 @@ scriptwait:
 				}
 				STACK(1) = z;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETFLOORTRIGGER:
+		PCODE(SETFLOORTRIGGER):
 			Create<DPlaneWatcher> (activator, activationline, backSide, false, STACK(8),
 				STACK(7), STACK(6), STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 8;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETCEILINGTRIGGER:
+		PCODE(SETCEILINGTRIGGER):
 			Create<DPlaneWatcher> (activator, activationline, backSide, true, STACK(8),
 				STACK(7), STACK(6), STACK(5), STACK(4), STACK(3), STACK(2), STACK(1));
 			sp -= 8;
-			break;
+			NEXTPCODE;
 
-		case PCD_STARTTRANSLATION:
+		PCODE(STARTTRANSLATION):
 			{
 				int i = STACK(1);
 				sp--;
@@ -9660,9 +11057,9 @@ scriptwait:
 					translation->MakeIdentity();
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TRANSLATIONRANGE1:
+		PCODE(TRANSLATIONRANGE1):
 			{ // translation using palette shifting
 				int start = STACK(4);
 				int end = STACK(3);
@@ -9673,9 +11070,9 @@ scriptwait:
 				if (translation != NULL)
 					translation->AddIndexRange(start, end, pal1, pal2);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TRANSLATIONRANGE2:
+		PCODE(TRANSLATIONRANGE2):
 			{ // translation using RGB values
 			  // (would HSV be a good idea too?)
 				int start = STACK(8);
@@ -9691,9 +11088,9 @@ scriptwait:
 				if (translation != NULL)
 					translation->AddColorRange(start, end, r1, g1, b1, r2, g2, b2);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TRANSLATIONRANGE3:
+		PCODE(TRANSLATIONRANGE3):
 			{ // translation using desaturation
 				int start = STACK(8);
 				int end = STACK(7);
@@ -9710,9 +11107,9 @@ scriptwait:
 						ACSToDouble(r1), ACSToDouble(g1), ACSToDouble(b1),
 						ACSToDouble(r2), ACSToDouble(g2), ACSToDouble(b2));
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TRANSLATIONRANGE4:
+		PCODE(TRANSLATIONRANGE4):
 			{ // Colourise translation
 				int start = STACK(5);
 				int end = STACK(4);
@@ -9724,9 +11121,9 @@ scriptwait:
 				if (translation != NULL)
 					translation->AddColourisation(start, end, r, g, b);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_TRANSLATIONRANGE5:
+		PCODE(TRANSLATIONRANGE5):
 			{ // Tint translation
 				int start = STACK(6);
 				int end = STACK(5);
@@ -9739,30 +11136,30 @@ scriptwait:
 				if (translation != NULL)
 					translation->AddTint(start, end, r, g, b, a);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ENDTRANSLATION:
+		PCODE(ENDTRANSLATION):
 			if (translation != NULL)
 			{
 				translation->UpdateNative();
 				translation = NULL;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SIN:
+		PCODE(SIN):
 			STACK(1) = DoubleToACS(ACSToAngle(STACK(1)).Sin());
-			break;
+			NEXTPCODE;
 
-		case PCD_COS:
+		PCODE(COS):
 			STACK(1) = DoubleToACS(ACSToAngle(STACK(1)).Cos());
-			break;
+			NEXTPCODE;
 
-		case PCD_VECTORANGLE:
+		PCODE(VECTORANGLE):
 			STACK(2) = AngleToACS(VecToAngle(STACK(2), STACK(1)).Degrees);
 			sp--;
-			break;
+			NEXTPCODE;
 
-        case PCD_CHECKWEAPON:
+		PCODE(CHECKWEAPON):
             if (activator == NULL || activator->player == NULL || // Non-players do not have weapons
                 activator->player->ReadyWeapon == NULL)
             {
@@ -9774,7 +11171,7 @@ scriptwait:
             }
             break;
 
-		case PCD_SETWEAPON:
+		PCODE(SETWEAPON):
 			if (activator == NULL || activator->player == NULL)
 			{
 				STACK(1) = 0;
@@ -9810,9 +11207,9 @@ scriptwait:
 					}
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETMARINEWEAPON:
+		PCODE(SETMARINEWEAPON):
 			if (STACK(2) != 0)
 			{
 				AActor *marine;
@@ -9831,9 +11228,9 @@ scriptwait:
 				}
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETMARINESPRITE:
+		PCODE(SETMARINESPRITE):
 			{
 				PClassActor *type = PClass::FindActor(FBehavior::StaticLookupString (STACK(1)));
 
@@ -9863,24 +11260,24 @@ scriptwait:
 				}
 			}
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETACTORPROPERTY:
+		PCODE(SETACTORPROPERTY):
 			SetActorProperty (STACK(3), STACK(2), STACK(1));
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORPROPERTY:
+		PCODE(GETACTORPROPERTY):
 			STACK(2) = GetActorProperty (STACK(2), STACK(1));
 			sp -= 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_GETPLAYERINPUT:
+		PCODE(GETPLAYERINPUT):
 			STACK(2) = GetPlayerInput (STACK(2), STACK(1));
 			sp -= 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERNUMBER:
+		PCODE(PLAYERNUMBER):
 			if (activator == NULL || activator->player == NULL)
 			{
 				PushToStack (-1);
@@ -9889,9 +11286,9 @@ scriptwait:
 			{
 				PushToStack (int(activator->player - players));
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERINGAME:
+		PCODE(PLAYERINGAME):
 			if (STACK(1) < 0 || STACK(1) >= MAXPLAYERS)
 			{
 				STACK(1) = false;
@@ -9900,9 +11297,9 @@ scriptwait:
 			{
 				STACK(1) = playeringame[STACK(1)];
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERISBOT:
+		PCODE(PLAYERISBOT):
 			if (STACK(1) < 0 || STACK(1) >= MAXPLAYERS || !playeringame[STACK(1)])
 			{
 				STACK(1) = false;
@@ -9911,9 +11308,9 @@ scriptwait:
 			{
 				STACK(1) = (players[STACK(1)].Bot != NULL);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_ACTIVATORTID:
+		PCODE(ACTIVATORTID):
 			if (activator == NULL)
 			{
 				PushToStack (0);
@@ -9922,33 +11319,33 @@ scriptwait:
 			{
 				PushToStack (activator->tid);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETSCREENWIDTH:
+		PCODE(GETSCREENWIDTH):
 			PushToStack (SCREENWIDTH);
-			break;
+			NEXTPCODE;
 
-		case PCD_GETSCREENHEIGHT:
+		PCODE(GETSCREENHEIGHT):
 			PushToStack (SCREENHEIGHT);
-			break;
+			NEXTPCODE;
 
-		case PCD_THING_PROJECTILE2:
+		PCODE(THING_PROJECTILE2):
 			// Like Thing_Projectile(Gravity) specials, but you can give the
 			// projectile a TID.
 			// Thing_Projectile2 (tid, type, angle, speed, vspeed, gravity, newtid);
 			P_Thing_Projectile(STACK(7), activator, STACK(6), NULL, STACK(5) * (360. / 256.),
 				STACK(4) / 8., STACK(3) / 8., 0, NULL, STACK(2), STACK(1), false);
 			sp -= 7;
-			break;
+			NEXTPCODE;
 
-		case PCD_SPAWNPROJECTILE:
+		PCODE(SPAWNPROJECTILE):
 			// Same, but takes an actor name instead of a spawn ID.
 			P_Thing_Projectile(STACK(7), activator, 0, FBehavior::StaticLookupString(STACK(6)), STACK(5) * (360. / 256.),
 				STACK(4) / 8., STACK(3) / 8., 0, NULL, STACK(2), STACK(1), false);
 			sp -= 7;
-			break;
+			NEXTPCODE;
 
-		case PCD_STRLEN:
+		PCODE(STRLEN):
 			{
 				const char *str = FBehavior::StaticLookupString(STACK(1));
 				if (str != NULL)
@@ -9965,13 +11362,13 @@ scriptwait:
 				}
 				STACK(1) = 0;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETCVAR:
+		PCODE(GETCVAR):
 			STACK(1) = DoGetCVar(GetCVar(activator, FBehavior::StaticLookupString(STACK(1))), false);
-			break;
+			NEXTPCODE;
 
-		case PCD_SETHUDSIZE:
+		PCODE(SETHUDSIZE):
 			hudwidth = abs (STACK(3));
 			hudheight = abs (STACK(2));
 			if (STACK(1) != 0)
@@ -9979,9 +11376,9 @@ scriptwait:
 				hudheight = -hudheight;
 			}
 			sp -= 3;
-			break;
+			NEXTPCODE;
 
-		case PCD_GETLEVELINFO:
+		PCODE(GETLEVELINFO):
 			switch (STACK(1))
 			{
 			case LEVELINFO_PAR_TIME:		STACK(1) = level.partime;			break;
@@ -9996,9 +11393,9 @@ scriptwait:
 			case LEVELINFO_KILLED_MONSTERS:	STACK(1) = level.killed_monsters;	break;
 			default:						STACK(1) = 0;						break;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGESKY:
+		PCODE(CHANGESKY):
 			{
 				const char *sky1name, *sky2name;
 
@@ -10015,9 +11412,9 @@ scriptwait:
 				R_InitSkyMap ();
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETCAMERATOTEXTURE:
+		PCODE(SETCAMERATOTEXTURE):
 			{
 				const char *picname = FBehavior::StaticLookupString (STACK(2));
 				AActor *camera;
@@ -10046,19 +11443,19 @@ scriptwait:
 				}
 				sp -= 3;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SETACTORANGLE:		// [GRB]
+		PCODE(SETACTORANGLE):		// [GRB]
 			SetActorAngle(activator, STACK(2), STACK(1), false);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETACTORPITCH:
+		PCODE(SETACTORPITCH):
 			SetActorPitch(activator, STACK(2), STACK(1), false);
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_SETACTORSTATE:
+		PCODE(SETACTORSTATE):
 			{
 				const char *statename = FBehavior::StaticLookupString (STACK(2));
 				FState *state;
@@ -10098,9 +11495,9 @@ scriptwait:
 				}
 				sp -= 2;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_PLAYERCLASS:		// [GRB]
+		PCODE(PLAYERCLASS):		// [GRB]
 			if (STACK(1) < 0 || STACK(1) >= MAXPLAYERS || !playeringame[STACK(1)])
 			{
 				STACK(1) = -1;
@@ -10109,9 +11506,9 @@ scriptwait:
 			{
 				STACK(1) = players[STACK(1)].CurrentPlayerClass;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_GETPLAYERINFO:		// [GRB]
+		PCODE(GETPLAYERINFO):		// [GRB]
 			if (STACK(2) < 0 || STACK(2) >= MAXPLAYERS || !playeringame[STACK(2)])
 			{
 				STACK(2) = -1;
@@ -10136,16 +11533,16 @@ scriptwait:
 				}
 			}
 			sp -= 1;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHANGELEVEL:
+		PCODE(CHANGELEVEL):
 			{
 				G_ChangeLevel(FBehavior::StaticLookupString(STACK(4)), STACK(3), STACK(2), STACK(1));
 				sp -= 4;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_SECTORDAMAGE:
+		PCODE(SECTORDAMAGE):
 			{
 				int tag = STACK(5);
 				int amount = STACK(4);
@@ -10157,24 +11554,24 @@ scriptwait:
 
 				P_SectorDamage(tag, amount, type, protectClass, flags);
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_THINGDAMAGE2:
+		PCODE(THINGDAMAGE2):
 			STACK(3) = P_Thing_Damage (STACK(3), activator, STACK(2), FName(FBehavior::StaticLookupString(STACK(1))));
 			sp -= 2;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKACTORCEILINGTEXTURE:
+		PCODE(CHECKACTORCEILINGTEXTURE):
 			STACK(2) = DoCheckActorTexture(STACK(2), activator, STACK(1), false);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKACTORFLOORTEXTURE:
+		PCODE(CHECKACTORFLOORTEXTURE):
 			STACK(2) = DoCheckActorTexture(STACK(2), activator, STACK(1), true);
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_GETACTORLIGHTLEVEL:
+		PCODE(GETACTORLIGHTLEVEL):
 		{
 			AActor *actor = SingleActorFromTID(STACK(1), activator);
 			if (actor != NULL)
@@ -10204,15 +11601,15 @@ scriptwait:
 			break;
 		}
 
-		case PCD_SETMUGSHOTSTATE:
+		PCODE(SETMUGSHOTSTATE):
 			if (!multiplayer || (activator != nullptr && activator->CheckLocalView(consoleplayer)))
 			{
 				StatusBar->SetMugShotState(FBehavior::StaticLookupString(STACK(1)));
 			}
 			sp--;
-			break;
+			NEXTPCODE;
 
-		case PCD_CHECKPLAYERCAMERA:
+		PCODE(CHECKPLAYERCAMERA):
 			{
 				int playernum = STACK(1);
 
@@ -10225,13 +11622,13 @@ scriptwait:
 					STACK(1) = players[playernum].camera->tid;
 				}
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_CLASSIFYACTOR:
+		PCODE(CLASSIFYACTOR):
 			STACK(1) = DoClassifyActor(STACK(1));
-			break;
+			NEXTPCODE;
 
-		case PCD_MORPHACTOR:
+		PCODE(MORPHACTOR):
 			{
 				int tag = STACK(7);
 				FName playerclass_name = FBehavior::StaticLookupString(STACK(6));
@@ -10279,9 +11676,9 @@ scriptwait:
 				STACK(7) = changes;
 				sp -= 6;
 			}	
-			break;
+			NEXTPCODE;
 
-		case PCD_UNMORPHACTOR:
+		PCODE(UNMORPHACTOR):
 			{
 				int tag = STACK(2);
 				bool force = !!STACK(1);
@@ -10339,21 +11736,21 @@ scriptwait:
 				STACK(2) = changes;
 				sp -= 1;
 			}	
-			break;
+			NEXTPCODE;
 
-		case PCD_SAVESTRING:
+		PCODE(SAVESTRING):
 			// Saves the string
 			{
 				const int str = GlobalACSStrings.AddString(work);
 				PushToStack(str);
 				STRINGBUILDER_FINISH(work);
 			}		
-			break;
+			NEXTPCODE;
 
-		case PCD_STRCPYTOSCRIPTCHRANGE:
-		case PCD_STRCPYTOMAPCHRANGE:
-		case PCD_STRCPYTOWORLDCHRANGE:
-		case PCD_STRCPYTOGLOBALCHRANGE:
+		PCODE(STRCPYTOSCRIPTCHRANGE):
+		PCODE(STRCPYTOMAPCHRANGE):
+		PCODE(STRCPYTOWORLDCHRANGE):
+		PCODE(STRCPYTOGLOBALCHRANGE):
 			// source: stringid(2); stringoffset(1)
 			// destination: capacity (3); stringoffset(4); arrayid (5); offset(6)
 
@@ -10444,16 +11841,16 @@ scriptwait:
 				}
 				sp -= 5;
 			}
-			break;
+			NEXTPCODE;
 
-		case PCD_CONSOLECOMMAND:
-		case PCD_CONSOLECOMMANDDIRECT:
+		PCODE(CONSOLECOMMAND):
+		PCODE(CONSOLECOMMANDDIRECT):
 			Printf (TEXTCOLOR_RED GAMENAME " doesn't support execution of console commands from scripts\n");
 			if (pcd == PCD_CONSOLECOMMAND)
 				sp -= 3;
 			else
 				pc += 3;
-			break;
+			NEXTPCODE;
  		}
  	}
 
@@ -10493,7 +11890,7 @@ scriptwait:
 	}
 	else
 	{
-		this->pc = pc;
+		this->pc = decoded ? activeBehavior->EncodePC(pc) : pc;
 		assert (sp == 0);
 	}
 	return resultValue;
@@ -10632,6 +12029,7 @@ static void addDefered (level_info_t *i, acsdefered_t::EType type, int script, c
 		{
 			def.args[j] = args[j];
 		}
+		GlobalACSStrings.PromoteStringArray(def.args, j);
 		while ((size_t)j < countof(def.args))
 		{
 			def.args[j++] = 0;
@@ -10681,7 +12079,9 @@ int P_StartScript (AActor *who, line_t *where, int script, const char *map, cons
 			{
 				if (flags & ACS_WANTRESULT)
 				{
-					return runningScript->RunScript();
+					int result = runningScript->RunScript();
+					GlobalACSStrings.PromoteString(result);
+					return result;
 				}
 				return true;
 			}
@@ -11030,3 +12430,8 @@ ADD_STAT(ACS)
 {
 	return FStringf("ACS time: %f ms", ACSTime.TimeMS());
 }
+
+ADD_STAT(acsstrings)
+{
+	return GlobalACSStrings.GetStats();
+}
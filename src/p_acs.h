@@ -90,19 +90,27 @@ public:
 	void UnlockStringArray(const int *strnum, unsigned int count);
 	void MarkStringArray(const int *strnum, unsigned int count);
 	void MarkStringMap(const FWorldGlobalArray &array);
+	void ResetMarks();
+	void PromoteString(int strnum);
+	void PromoteStringArray(const int *strnum, unsigned int count);
 	void PurgeStrings();
+	void PurgeNursery();
+	bool HasNursery() const { return Nursery.Size() > 0; }
 	void Clear();
 	void Dump() const;
+	FString GetStats() const;
 	void UnlockForLevel(int level)	;
 	void ReadStrings(FSerializer &file, const char *key);
 	void WriteStrings(FSerializer &file, const char *key) const;
 
 private:
 	int FindString(const char *str, size_t len, unsigned int h, unsigned int bucketnum);
-	int InsertString(FString &str, unsigned int h, unsigned int bucketnum);
+	int InsertString(FString &str, unsigned int h);
 	void FindFirstFreeEntry(unsigned int base);
+	void ResizeBuckets(unsigned int numbuckets);
+	unsigned int BucketFor(unsigned int h) const { return h & (PoolBuckets.Size() - 1); }
 
-	enum { NUM_BUCKETS = 251 };
+	enum { MIN_BUCKETS = 256 };			// Must be a power of 2
 	enum { FREE_ENTRY = 0xFFFFFFFE };	// Stored in PoolEntry's Next field
 	enum { NO_ENTRY = 0xFFFFFFFF };
 	enum { MIN_GC_SIZE = 100 };			// Don't auto-collect until there are this many strings
@@ -112,18 +120,26 @@ private:
 		unsigned int Hash;
 		unsigned int Next;
 		bool Mark;
+		bool Young;						// Still in the nursery
 		TArray<int> Locks;
 
 		void Lock();
 		void Unlock();
 	};
 	TArray<PoolEntry> Pool;
-	unsigned int PoolBuckets[NUM_BUCKETS];
+	TArray<unsigned int> PoolBuckets;
+	TArray<unsigned int> Nursery;		// Entries added since the last collection
 	unsigned int FirstFreeEntry;
+	unsigned int LiveCount;
+
+	// Statistics
+	unsigned int Lookups, Hits;
+	unsigned int Inserted, Freed, FreedYoung;
 };
 extern ACSStringPool GlobalACSStrings;
 
 void P_CollectACSGlobalStrings();
+void P_CollectACSNurseryStrings();
 void P_ReadACSVars(FSerializer &);
 void P_WriteACSVars(FSerializer &);
 void P_ClearACSVars(bool);
@@ -254,6 +270,7 @@ struct ScriptFunction
 	uint8_t ImportNum;
 	int  LocalCount;
 	uint32_t Address;
+	uint32_t DecodedAddress;	// offset into the module's decoded code
 	ACSLocalArrays LocalArrays;
 };
 
@@ -302,6 +319,13 @@ public:
 	int *Ofs2PC (uint32_t ofs) const {	return (int *)(Data + ofs); }
 	int *Jump2PC (uint32_t jumpPoint) const { return Ofs2PC(JumpPoints[jumpPoint]); }
 	ACSFormat GetFormat() const { return Format; }
+	bool HasDecodedCode() const { return DecodedCode.Size() > 0; }
+	// The decoded code uses words for all operands, so it reads like an uncompressed module.
+	ACSFormat GetCodeFormat(bool decoded) const { return decoded && Format == ACS_LittleEnhanced ? ACS_Enhanced : Format; }
+	uint8_t *GetCodeBase(bool decoded) const { return decoded ? (uint8_t *)&DecodedCode[0] : Data; }
+	int *DecodePC(int *pc) const;
+	int *EncodePC(int *pc) const;
+	bool ThreadCode(const int *handlers) { return CodeThreaded || MakeThreadedCode(handlers); }
 	ScriptFunction *GetFunction (int funcnum, FBehavior *&module) const;
 	int GetArrayVal (int arraynum, int index) const;
 	void SetArrayVal (int arraynum, int index, int value);
@@ -329,7 +353,7 @@ public:
 	static bool StaticCheckAllGood ();
 	static FBehavior *StaticGetModule (int lib);
 	static void StaticSerializeModuleStates (FSerializer &arc);
-	static void StaticMarkLevelVarStrings();
+	static void StaticMarkLevelVarStrings(bool arrays = true);
 	static void StaticLockLevelVarStrings();
 	static void StaticUnlockLevelVarStrings();
 
@@ -340,6 +364,11 @@ public:
 
 private:
 	struct ArrayInfo;
+	struct CodeMapEntry
+	{
+		uint32_t Ofs;			// offset into Data
+		uint32_t DecodedOfs;	// index into DecodedCode
+	};
 
 	ACSFormat Format;
 
@@ -362,10 +391,16 @@ private:
 	uint32_t LibraryID;
 	char ModuleName[9];
 	TArray<int> JumpPoints;
+	TArray<int> DecodedCode;
+	TArray<CodeMapEntry> CodeMap;
+	bool CodeThreaded;		// DecodedCode holds handler offsets (see MakeThreadedCode)
 
 	static TArray<FBehavior *> StaticModules;
 
 	void LoadScriptsDirectory ();
+	void DecodeCode ();
+	int DecodeInstruction (uint32_t ofs, TArray<int> &code, TArray<unsigned> &jumps, bool &terminal) const;
+	bool MakeThreadedCode (const int *handlers);
 
 	static int SortScripts (const void *a, const void *b);
 	void UnencryptStrings ();
@@ -375,7 +410,7 @@ private:
 	void SerializeVars (FSerializer &arc);
 	void SerializeVarSet (FSerializer &arc, int32_t *vars, int max);
 
-	void MarkMapVarStrings() const;
+	void MarkMapVarStrings(bool arrays = true) const;
 	void LockMapVarStrings() const;
 	void UnlockMapVarStrings() const;
 
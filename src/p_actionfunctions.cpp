@@ -4737,6 +4737,7 @@ DEFINE_ACTION_FUNCTION(AActor, A_ChangeVelocity)
 		vel.X = x*cosa - y*sina;
 		vel.Y = x*sina + y*cosa;
 	}
+	ref->StopSleeping();
 	if (flags & 2)	// discard old velocity - replace old velocity with new velocity
 	{
 		ref->Vel = vel;
@@ -5438,7 +5439,8 @@ enum RadiusGiveFlags
 						RGF_ITEMS,
 };
 
-static bool DoRadiusGive(AActor *self, AActor *thing, PClassActor *item, int amount, double distance, int flags, PClassActor *filter, FName species, double mindist)
+// query is the radius iterator that found the thing, if any, so that its sight check gets counted.
+static bool DoRadiusGive(AActor *self, AActor *thing, PClassActor *item, int amount, double distance, int flags, PClassActor *filter, FName species, double mindist, FRadiusThingsIterator *query)
 {
 	
 	bool doPass = false;
@@ -5545,7 +5547,8 @@ static bool DoRadiusGive(AActor *self, AActor *thing, PClassActor *item, int amo
 			}
 		}
 
-		if ((flags & RGF_NOSIGHT) || P_CheckSight(thing, self, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
+		const int sightflags = SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY;
+		if ((flags & RGF_NOSIGHT) || (query != nullptr ? query->CheckSight(thing, sightflags) : P_CheckSight(thing, self, sightflags)))
 		{ // OK to give; target is in direct path, or the monster doesn't care about it being in line of sight.
 			AInventory *gift = static_cast<AInventory *>(Spawn(item));
 			if (gift->IsKindOf(NAME_Health))
@@ -5601,19 +5604,18 @@ DEFINE_ACTION_FUNCTION(AActor, A_RadiusGive)
 		TThinkerIterator<AActor> it;
 		while ((thing = it.Next()) && ((unlimited) || (given < limit)))
 		{
-			given += DoRadiusGive(self, thing, item, amount, distance, flags, filter, species, mindist);
+			given += DoRadiusGive(self, thing, item, amount, distance, flags, filter, species, mindist, nullptr);
 		}
 	}
 	else
 	{
-		FPortalGroupArray check(FPortalGroupArray::PGA_Full3d);
 		double mid = self->Center();
-		FMultiBlockThingsIterator it(check, self->X(), self->Y(), mid-distance, mid+distance, distance, false, self->Sector);
-		FMultiBlockThingsIterator::CheckResult cres;
+		FRadiusThingsIterator it(self, mid-distance, mid+distance, distance, distance, (flags & RGF_CUBE) ? RTF_CENTER|RTF_CUBE : RTF_CENTER);
+		FRadiusThingsIterator::CheckResult cres;
 
 		while ((it.Next(&cres)) && ((unlimited) || (given < limit)))
 		{
-			given += DoRadiusGive(self, cres.thing, item, amount, distance, flags, filter, species, mindist);
+			given += DoRadiusGive(self, cres.thing, item, amount, distance, flags, filter, species, mindist, &it);
 		}
 	}
 	ACTION_RETURN_INT(given);
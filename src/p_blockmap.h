@@ -2,8 +2,10 @@
 #define __P_BLOCKMAP_H
 
 #include "doomtype.h"
+#include "tarray.h"
 
 class AActor;
+class FBlockThingsIterator;
 
 // [RH] Like msecnode_t, but for the blockmap
 struct FBlockNode
@@ -15,6 +17,7 @@ struct FBlockNode
 	FBlockNode *NextActor;			// next actor in this block
 	FBlockNode **PrevBlock;			// previous block this actor is in
 	FBlockNode *NextBlock;			// next block this actor is in
+	unsigned ThingIndex;			// position of this node in the block's things array
 
 	static FBlockNode *Create (AActor *who, int x, int y, int group = -1);
 	void Release ();
@@ -22,6 +25,15 @@ struct FBlockNode
 	static FBlockNode *FreeBlocks;
 };
 
+// One entry of a block's things array, so iterating a block
+// doesn't have to chase the nodes all over memory.
+struct FBlockThing
+{
+	AActor *Me;
+	FBlockNode *Node;				// node this entry belongs to
+	bool SingleBlock;				// actor isn't linked into any other block
+};
+
 // BLOCKMAP
 // Created from axis aligned bounding box
 // of the map, a rectangular array of
@@ -41,6 +53,14 @@ struct FBlockmap
 	double				bmaporgy;		// origin of block map
 	FBlockNode**		blocklinks; 	// for thing chains
 
+	// Per block arrays of the things, kept next to the chains. Removal swaps the
+	// last entry into the freed slot, so the order is not the same as the chain's.
+	TArray<FBlockThing>* blockthings;
+	// Iterators that are in the middle of one of these arrays. UnlinkThing has to
+	// keep the entries they already returned apart from the ones they didn't.
+	TArray<FBlockThingsIterator *> thingiterators;
+	unsigned			linechanges;	// counts every time polyobject lines get moved
+
 	// mapblocks are used to check movement
 	// against lines and things
 	enum
@@ -75,6 +95,15 @@ struct FBlockmap
 
 	bool VerifyBlockMap(int count);
 
+	void LinkThing(FBlockNode *node);
+	void UnlinkThing(FBlockNode *node);
+	void RelinkThing(FBlockNode *node);
+
+	void LinesChanged()
+	{
+		linechanges++;
+	}
+
 	void Clear()
 	{
 		if (blockmaplump != NULL)
@@ -87,6 +116,12 @@ struct FBlockmap
 			delete[] blocklinks;
 			blocklinks = NULL;
 		}
+		if (blockthings != NULL)
+		{
+			delete[] blockthings;
+			blockthings = NULL;
+		}
+		thingiterators.Clear();
 	}
 
 };
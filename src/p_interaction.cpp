@@ -1660,6 +1660,7 @@ DEFINE_ACTION_FUNCTION(AActor, DamageMobj)
 
 int P_DamageMobj(AActor *target, AActor *inflictor, AActor *source, int damage, FName mod, int flags, DAngle angle)
 {
+	target->StopSleeping();
 	IFVIRTUALPTR(target, AActor, DamageMobj)
 	{
 		VMValue params[7] = { target, inflictor, source, damage, mod.GetIndex(), flags, angle.Degrees };
@@ -1251,6 +1251,7 @@ FUNC(LS_ThrustThingZ)	// [BC]
 
 		while ( (victim = iterator.Next ()) )
 		{
+			victim->StopSleeping();
 			if (!arg3)
 				victim->Vel.Z = thrust;
 			else
@@ -1260,6 +1261,7 @@ FUNC(LS_ThrustThingZ)	// [BC]
 	}
 	else if (it)
 	{
+		it->StopSleeping();
 		if (!arg3)
 			it->Vel.Z = thrust;
 		else
@@ -3840,6 +3842,8 @@ int P_ExecuteSpecial(int			num,
 {
 	if (num >= 0 && num < (int)countof(LineSpecials))
 	{
+		// Specials can change lines and sectors in ways a cached sight check can't know about
+		P_SightGeometryChanged();
 		return LineSpecials[num](line, activator, backSide, arg1, arg2, arg3, arg4, arg5);
 	}
 	return 0;
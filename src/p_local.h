@@ -120,6 +120,7 @@ void	P_BloodSplatter (const DVector3 &pos, AActor *originator, DAngle hitangle);
 void	P_BloodSplatter2 (const DVector3 &pos, AActor *originator, DAngle hitangle);
 void	P_RipperBlood (AActor *mo, AActor *bleeder);
 int		P_GetThingFloorType (AActor *thing);
+void	P_UpdateThinkerSleep ();
 void	P_ExplodeMissile (AActor *missile, line_t *explodeline, AActor *target, bool onsky = false);
 
 AActor *P_OldSpawnMissile(AActor *source, AActor *owner, AActor *dest, PClassActor *type);
@@ -290,6 +291,10 @@ enum ESightFlags
 };
 
 void	P_ResetSightCounters (bool full);
+void	P_SightPrepass ();
+void	P_ClearSightPrepass ();
+void	P_SightGeometryChanged ();
+void	P_SightForget (AActor *actor);
 bool	P_TalkFacing (AActor *player);
 void	P_UseLines (player_t* player);
 bool	P_UsePuzzleItem (AActor *actor, int itemType);
@@ -408,6 +413,8 @@ template<class nodetype, class linktype>
 nodetype* P_DelSecnode(nodetype *, nodetype *linktype::*head);
 
 msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead);
+void	P_FreeSecNodeCache(AActor *thing);
+void	P_ClearSecnodes();
 double	P_GetMoveFactor(const AActor *mo, double *frictionp);	// phares  3/6/98
 double		P_GetFriction(const AActor *mo, double *frictionfactor);
 
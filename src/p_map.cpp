@@ -1450,6 +1450,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 		if (!(thing->flags2 & MF2_BOSS) && (thing->flags3 & MF3_ISMONSTER) && !(thing->flags3 & MF3_DONTBLAST))
 		{
 			// ideally this should take the mass factor into account
+			thing->StopSleeping();
 			thing->Vel += tm.thing->Vel.XY();
 			if (fabs(thing->Vel.X) + fabs(thing->Vel.Y) > 3.)
 			{
@@ -1587,6 +1588,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 					{ // Push thing
 						if (thing->lastpush != tm.PushTime)
 						{
+							thing->StopSleeping();
 							thing->Vel += tm.thing->Vel.XY() * thing->pushfactor;
 							thing->lastpush = tm.PushTime;
 						}
@@ -1645,6 +1647,7 @@ bool PIT_CheckThing(FMultiBlockThingsIterator &it, FMultiBlockThingsIterator::Ch
 	{ // Push thing
 		if (thing->lastpush != tm.PushTime)
 		{
+			thing->StopSleeping();
 			thing->Vel += tm.thing->Vel.XY() * thing->pushfactor;
 			thing->lastpush = tm.PushTime;
 		}
@@ -5645,9 +5648,17 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 	double bombdistancefloat = 1. / (double)(bombdistance - fulldamagedistance);
 	double bombdamagefloat = (double)bombdamage;
 
-	FPortalGroupArray grouplist(FPortalGroupArray::PGA_Full3d);
-	FMultiBlockThingsIterator it(grouplist, bombspot->X(), bombspot->Y(), bombspot->Z() - bombdistance, bombspot->Height + bombdistance*2, bombdistance, false, bombspot->Sector);
-	FMultiBlockThingsIterator::CheckResult cres;
+	// Nothing outside the blast radius gets hurt or thrust, unless zero damage is forced
+	// or a negative RadiusDamageFactor turns the damage around. The old code only
+	// looks at the horizontal distance.
+	double reach = (bombspot->flags7 & MF7_FORCEZERORADIUSDMG) ? 0. : bombdistance;
+	int rtflags = RTF_DAMAGEFACTOR;
+	if ((flags & RADF_NODAMAGE) || !(bombspot->flags5 & MF5_OLDRADIUSDMG))
+	{
+		rtflags |= RTF_CHECKZ;
+	}
+	FRadiusThingsIterator it(bombspot, bombspot->Z() - bombdistance, bombspot->Height + bombdistance*2, bombdistance, reach, rtflags);
+	FRadiusThingsIterator::CheckResult cres;
 
 	if (flags & RADF_SOURCEISSPOT)
 	{ // The source is actually the same as the spot, even if that wasn't what we received.
@@ -5697,7 +5708,7 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 			double dx, dy;
 			double boxradius;
 
-			DVector2 vec = bombspot->Vec2To(thing);
+			DVector2 vec = cres.Vec;
 			dx = fabs(vec.X);
 			dy = fabs(vec.Y);
 			boxradius = thing->radius;
@@ -5743,7 +5754,7 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 
 			double check = int(points) * bombdamage;
 			// points and bombdamage should be the same sign (the double cast of 'points' is needed to prevent overflows and incorrect values slipping through.)
-			if ((check > 0 || (check == 0 && bombspot->flags7 & MF7_FORCEZERORADIUSDMG)) && P_CheckSight(thing, bombspot, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
+			if ((check > 0 || (check == 0 && bombspot->flags7 & MF7_FORCEZERORADIUSDMG)) && it.CheckSight(thing, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
 			{ // OK to damage; target is in direct path
 				double vz;
 				double thrust;
@@ -5800,7 +5811,7 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 			// [RH] Old code just for barrels
 			double dx, dy, dist;
 
-			DVector2 vec = bombspot->Vec2To(thing);
+			DVector2 vec = cres.Vec;
 			dx = fabs(vec.X);
 			dy = fabs(vec.Y);
 
@@ -5813,7 +5824,7 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 			if (dist >= bombdistance)
 				continue;  // out of range
 
-			if (P_CheckSight(thing, bombspot, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
+			if (it.CheckSight(thing, SF_IGNOREVISIBILITY | SF_IGNOREWATERBOUNDARY))
 			{ // OK to damage; target is in direct path
 				dist = clamp<double>(dist - fulldamagedistance, 0, dist);
 				int damage = Scale(bombdamage, bombdistance - int(dist), bombdistance);
@@ -5834,6 +5845,92 @@ int P_RadiusAttack(AActor *bombspot, AActor *bombsource, int bombdamage, int bom
 	return count;
 }
 
+//==========================================================================
+//
+// blockmapbench
+//
+// Times P_CheckPosition for every solid actor and a P_RadiusAttack style
+// blast query around every monster, once with the linked block chains and
+// once with sv_compactblockmap. Usage: blockmapbench [passes]
+//
+//==========================================================================
+
+EXTERN_CVAR(Bool, sv_compactblockmap)
+
+CCMD(blockmapbench)
+{
+	if (gamestate != GS_LEVEL || netgame || demorecording || demoplayback)
+	{
+		Printf("blockmapbench can only be used in a single player game\n");
+		return;
+	}
+
+	int passes = argv.argc() > 1 ? MAX(atoi(argv[1]), 1) : 10;
+	const double blastradius = 128;
+
+	TArray<AActor *> movers, spots;
+	TThinkerIterator<AActor> it;
+	AActor *mo;
+	while ((mo = it.Next()))
+	{
+		// P_CheckPosition has side effects for missiles and pickups
+		if ((mo->flags & MF_SOLID) && !(mo->flags & (MF_MISSILE | MF_PICKUP | MF_NOBLOCKMAP)))
+		{
+			movers.Push(mo);
+		}
+		if (mo->flags3 & MF3_ISMONSTER)
+		{
+			spots.Push(mo);
+		}
+	}
+
+	bool compact = sv_compactblockmap;
+	for (int mode = 0; mode < 2; mode++)
+	{
+		sv_compactblockmap = mode != 0;
+
+		cycle_t checkcycles, blastcycles;
+		checkcycles.Reset();
+		blastcycles.Reset();
+		int found = 0;
+
+		for (int pass = 0; pass < passes; pass++)
+		{
+			checkcycles.Clock();
+			for (auto mover : movers)
+			{
+				AActor *blockingmobj = mover->BlockingMobj;
+				line_t *blockingline = mover->BlockingLine;
+				P_CheckPosition(mover, mover->Pos(), false);
+				mover->BlockingMobj = blockingmobj;
+				mover->BlockingLine = blockingline;
+			}
+			checkcycles.Unclock();
+
+			blastcycles.Clock();
+			for (auto spot : spots)
+			{
+				FPortalGroupArray grouplist(FPortalGroupArray::PGA_Full3d);
+				FMultiBlockThingsIterator bit(grouplist, spot->X(), spot->Y(), spot->Z() - blastradius, spot->Height + blastradius * 2, blastradius, false, spot->Sector);
+				FMultiBlockThingsIterator::CheckResult cres;
+				while (bit.Next(&cres))
+				{
+					if ((cres.thing->flags & MF_SHOOTABLE) && cres.thing->Distance2D(spot) < blastradius + cres.thing->radius)
+					{
+						found++;
+					}
+				}
+			}
+			blastcycles.Unclock();
+		}
+
+		Printf("%s: P_CheckPosition %u x %d: %.3f ms, blast query %u x %d: %.3f ms (%d hits)\n",
+			mode == 0 ? "block chains" : "compact blocks",
+			movers.Size(), passes, checkcycles.TimeMS(), spots.Size(), passes, blastcycles.TimeMS(), found);
+	}
+	sv_compactblockmap = compact;
+}
+
 //==========================================================================
 //
 // SECTOR HEIGHT CHANGING
@@ -6548,9 +6645,13 @@ bool P_ChangeSector(sector_t *sector, int crunch, double amt, int floorOrCeil, b
 	// killough 4/7/98: simplified to avoid using complicated counter
 
 	// Mark all things invalid
+	// and wake up the sleeping ones, their floor may have changed.
 
 	for (n = sector->touching_thinglist; n; n = n->m_snext)
+	{
 		n->visited = false;
+		n->m_thing->StopSleeping();
+	}
 
 	do
 	{
@@ -82,11 +82,18 @@
 #include "po_man.h"
 #include "g_levellocals.h"
 #include "vm.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "c_dispatch.h"
+#include "v_text.h"
 
 // SM64
 #include "d_mario.h"
 #include "d_player.h"
 
+// Iterate the things in a block through a compact array instead of the linked nodes
+CVAR(Bool, sv_compactblockmap, false, CVAR_SERVERINFO)
+
 sector_t *P_PointInSectorBuggy(double x, double y);
 int P_VanillaPointOnDivlineSide(double x, double y, const divline_t* line);
 
@@ -341,12 +348,18 @@ void AActor::UnlinkFromWorld (FLinkContext *ctx)
 				block->NextActor->PrevActor = block->PrevActor;
 			}
 			*(block->PrevActor) = block->NextActor;
+			level.blockmap.UnlinkThing(block);
 			FBlockNode *next = block->NextBlock;
 			block->Release ();
 			block = next;
 		}
 		BlockNode = NULL;
 	}
+	if (ctx == nullptr)
+	{
+		// Not coming back soon, or at all.
+		P_FreeSecNodeCache(this);
+	}
 }
 
 
@@ -454,6 +467,8 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 {
 	bool spawning = spawningmapthing;
 
+	StopSleeping();
+
 	if (spawning)
 	{
 		if ((flags4 & MF4_FIXMAPTHINGPOS) && sector == NULL)
@@ -559,6 +574,7 @@ void AActor::LinkToWorld(FLinkContext *ctx, bool spawningmapthing, sector_t *sec
 						node->NextBlock = NULL;
 						(*alink) = node;
 						alink = &node->NextBlock;
+						level.blockmap.LinkThing(node);
 					}
 				}
 			}
@@ -637,6 +653,104 @@ void FBlockNode::Release ()
 	FreeBlocks = this;
 }
 
+//===========================================================================
+//
+// FBlockmap :: LinkThing
+//
+// Appends a node to its block's things array. The node must already be
+// linked into its actor's block list.
+//
+//===========================================================================
+
+void FBlockmap::LinkThing(FBlockNode *node)
+{
+	TArray<FBlockThing> &things = blockthings[node->BlockIndex];
+	AActor *me = node->Me;
+	bool single = node->PrevBlock == &me->BlockNode;
+
+	if (!single)
+	{ // The actor's first node is no longer its only one.
+		FBlockNode *first = me->BlockNode;
+		blockthings[first->BlockIndex][first->ThingIndex].SingleBlock = false;
+	}
+	node->ThingIndex = things.Push({ me, node, single });
+}
+
+//===========================================================================
+//
+// FBlockmap :: UnlinkThing
+//
+// Removes a node from its block's things array by moving the last entry
+// into its slot. The node keeps its ThingIndex so that RelinkThing can
+// undo this.
+//
+// An iterator in this block has returned everything from its cursor up.
+// If the slot is below a cursor, it gets filled from right below that
+// cursor instead and the cursor moves down by one, so that the iterator
+// neither returns the moved entry again nor skips one.
+//
+//===========================================================================
+
+void FBlockmap::UnlinkThing(FBlockNode *node)
+{
+	TArray<FBlockThing> &things = blockthings[node->BlockIndex];
+	unsigned hole = node->ThingIndex;
+
+	for (;;)
+	{
+		// Take the cursors from the lowest up, so that each move keeps
+		// the entries on the same side of all of them.
+		unsigned *cursor = NULL;
+		for (auto it : thingiterators)
+		{
+			if (it->things == &things && it->thingindex > hole && (cursor == NULL || it->thingindex < *cursor))
+			{
+				cursor = &it->thingindex;
+			}
+		}
+		if (cursor == NULL) break;
+
+		--*cursor;
+		things[hole] = things[*cursor];
+		things[hole].Node->ThingIndex = hole;
+		hole = *cursor;
+	}
+
+	unsigned last = things.Size() - 1;
+	if (hole != last)
+	{
+		things[hole] = things[last];
+		things[hole].Node->ThingIndex = hole;
+	}
+	things.Pop();
+}
+
+//===========================================================================
+//
+// FBlockmap :: RelinkThing
+//
+// Undoes UnlinkThing, putting the node back at its old position. Nodes have
+// to be relinked in the opposite order they were unlinked in, and no iterator
+// may be walking the block in between.
+//
+//===========================================================================
+
+void FBlockmap::RelinkThing(FBlockNode *node)
+{
+	TArray<FBlockThing> &things = blockthings[node->BlockIndex];
+	FBlockThing thing = { node->Me, node, node->NextBlock == NULL && node->PrevBlock == &node->Me->BlockNode };
+
+	if (node->ThingIndex < things.Size())
+	{
+		things[node->ThingIndex].Node->ThingIndex = things.Push(things[node->ThingIndex]);
+		things[node->ThingIndex] = thing;
+	}
+	else
+	{
+		things.Push(thing);
+	}
+}
+
 //
 // BLOCK MAP ITERATORS
 // For each line/thing in the given mapblock,
@@ -1018,11 +1132,13 @@ FBlockThingsIterator::FBlockThingsIterator()
 	miny = maxy = 0;
 	ClearHash();
 	block = NULL;
+	things = NULL;
 }
 
 FBlockThingsIterator::FBlockThingsIterator(int _minx, int _miny, int _maxx, int _maxy)
 : DynHash(0)
 {
+	things = NULL;
 	minx = _minx;
 	maxx = _maxx;
 	miny = _miny;
@@ -1064,9 +1180,21 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 {
 	curx = x;
 	cury = y;
+	SetThings(NULL);
 	if (level.blockmap.isValidBlock(x, y))
 	{
-		block = level.blockmap.blocklinks[y*level.blockmap.bmapwidth + x];
+		int index = y*level.blockmap.bmapwidth + x;
+		if (sv_compactblockmap && level.blockmap.blockthings != NULL)
+		{
+			// Walk the array from the back so that the newest things come first, like in the chain.
+			SetThings(&level.blockmap.blockthings[index]);
+			thingindex = things->Size();
+			block = NULL;
+		}
+		else
+		{
+			block = level.blockmap.blocklinks[index];
+		}
 	}
 	else
 	{
@@ -1075,6 +1203,34 @@ void FBlockThingsIterator::StartBlock(int x, int y)
 	}
 }
 
+//===========================================================================
+//
+// FBlockThingsIterator :: SetThings
+//
+// The blockmap needs to know about every iterator that is in the middle
+// of a things array, so that unlinking can move its cursor along.
+//
+//===========================================================================
+
+void FBlockThingsIterator::SetThings(const TArray<FBlockThing> *newthings)
+{
+	auto &iterators = level.blockmap.thingiterators;
+	if (things != NULL && newthings == NULL)
+	{
+		unsigned i = iterators.Find(this);
+		if (i < iterators.Size())
+		{
+			iterators[i] = iterators.Last();
+			iterators.Pop();
+		}
+	}
+	else if (things == NULL && newthings != NULL)
+	{
+		iterators.Push(this);
+	}
+	things = newthings;
+}
+
 //===========================================================================
 //
 // FBlockThingsIterator :: SwitchBlock
@@ -1098,16 +1254,37 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 {
 	for (;;)
 	{
-		while (block != NULL)
+		for (;;)
 		{
-			AActor *me = block->Me;
-			FBlockNode *mynode = block;
+			AActor *me;
+			bool singleblock;
 			HashEntry *entry;
 			int i;
 
-			block = block->NextActor;
+			if (things != NULL)
+			{
+				// FBlockmap::UnlinkThing keeps the cursor in step with the array.
+				assert(thingindex <= things->Size());
+				if (thingindex == 0)
+				{
+					SetThings(NULL);
+					break;
+				}
+				const FBlockThing &thing = (*things)[--thingindex];
+				me = thing.Me;
+				singleblock = thing.SingleBlock;
+			}
+			else
+			{
+				if (block == NULL) break;
+				FBlockNode *mynode = block;
+				me = block->Me;
+				block = block->NextActor;
+				singleblock = mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode;
+			}
+
 			// Don't recheck things that were already checked
-			if (mynode->NextBlock == NULL && mynode->PrevBlock == &me->BlockNode)
+			if (singleblock)
 			{ // This actor doesn't span blocks, so we know it can only ever be checked once.
 				return me;
 			}
@@ -1172,6 +1349,90 @@ AActor *FBlockThingsIterator::Next(bool centeronly)
 	}
 }
 
+//===========================================================================
+//
+// CCMD blockmaptest
+//
+// Walks every block with more than one thing and unlinks things from it on
+// the way, alternately one the iterator has not got to yet and one it has
+// already returned. Everything that is still linked when the iterator gets
+// to it must be returned exactly once. The arrays are put back afterwards,
+// so the game is not affected.
+//
+//===========================================================================
+
+CCMD(blockmaptest)
+{
+	auto &blockmap = level.blockmap;
+	if (!sv_compactblockmap || blockmap.blockthings == NULL)
+	{
+		Printf("sv_compactblockmap is off\n");
+		return;
+	}
+
+	int numblocks = 0, numfailed = 0;
+	for (int y = 0; y < blockmap.bmapheight; y++)
+	{
+		for (int x = 0; x < blockmap.bmapwidth; x++)
+		{
+			TArray<FBlockThing> &things = blockmap.blockthings[y * blockmap.bmapwidth + x];
+			if (things.Size() < 2)
+			{
+				continue;
+			}
+			numblocks++;
+
+			TArray<FBlockThing> saved = things;
+			TMap<AActor *, int> visits;
+			TArray<AActor *> removed;
+			{
+				FBlockThingsIterator it(x, y, x, y);
+				AActor *mo;
+				int step = 0;
+				while ((mo = it.Next()) != NULL)
+				{
+					int *count = visits.CheckKey(mo);
+					if (count != NULL) (*count)++;
+					else visits.Insert(mo, 1);
+
+					if (things.Size() > 0)
+					{
+						FBlockThing &thing = things[(step++ & 1) ? things.Size() - 1 : 0];
+						if (visits.CheckKey(thing.Me) == NULL)
+						{
+							removed.Push(thing.Me);
+						}
+						blockmap.UnlinkThing(thing.Node);
+					}
+				}
+			}
+
+			bool failed = false;
+			for (auto &thing : saved)
+			{
+				int *count = visits.CheckKey(thing.Me);
+				int expected = removed.Find(thing.Me) < removed.Size() ? 0 : 1;
+				if ((count != NULL ? *count : 0) != expected)
+				{
+					failed = true;
+				}
+			}
+			if (failed)
+			{
+				Printf(TEXTCOLOR_RED "Block (%d, %d): things were skipped or returned twice\n", x, y);
+				numfailed++;
+			}
+
+			things = saved;
+			for (unsigned i = 0; i < things.Size(); i++)
+			{
+				things[i].Node->ThingIndex = i;
+			}
+		}
+	}
+	Printf("%d blocks checked, %d failed\n", numblocks, numfailed);
+}
+
 
 
 //===========================================================================
@@ -1276,6 +1537,108 @@ void FMultiBlockThingsIterator::Reset()
 	startIteratorForGroup(basegroup);
 }
 
+//===========================================================================
+//
+// FRadiusThingsIterator
+//
+//===========================================================================
+
+int FRadiusThingsIterator::Queries;
+int FRadiusThingsIterator::Visited;
+int FRadiusThingsIterator::Accepted;
+int FRadiusThingsIterator::SightChecks;
+
+FRadiusThingsIterator::FRadiusThingsIterator(AActor *origin, double bottom, double height, double radius, double maxreach, int rtflags)
+	: grouplist(FPortalGroupArray::PGA_Full3d),
+	  it(grouplist, origin->X(), origin->Y(), bottom, height, radius, false, origin->Sector)
+{
+	spot = origin;
+	reach = maxreach;
+	flags = rtflags;
+	Queries++;
+}
+
+//===========================================================================
+//
+// Cheapest checks first. Everything skipped here must be something the
+// callers would reject anyway.
+//
+//===========================================================================
+
+bool FRadiusThingsIterator::InReach(AActor *thing, const DVector3 &vec)
+{
+	if (reach <= 0 || ((flags & RTF_DAMAGEFACTOR) && thing->RadiusDamageFactor < 0))
+	{
+		return true;
+	}
+
+	if (flags & RTF_CENTER)
+	{
+		DVector3 diff(vec.X, vec.Y, vec.Z + thing->Height * 0.5);
+		if (flags & RTF_CUBE)
+		{
+			return fabs(diff.X) <= reach && fabs(diff.Y) <= reach && fabs(diff.Z) <= reach;
+		}
+		return diff.LengthSquared() <= reach * reach;
+	}
+
+	// The damage pattern is square, not circular.
+	double dx = fabs(vec.X);
+	double dy = fabs(vec.Y);
+	if ((dx > dy ? dx : dy) - thing->radius >= reach)
+	{
+		return false;
+	}
+
+	if ((flags & RTF_CHECKZ) && !(thing->flags5 & MF5_OLDRADIUSDMG))
+	{
+		double dz = spot->Z() > thing->Z() ? spot->Z() - thing->Top() : thing->Z() - spot->Z();
+		if (dz >= reach)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool FRadiusThingsIterator::Next(CheckResult *item)
+{
+	FMultiBlockThingsIterator::CheckResult cres;
+
+	while (it.Next(&cres))
+	{
+		Visited++;
+		DVector3 vec = spot->Vec3To(cres.thing);
+		if (InReach(cres.thing, vec))
+		{
+			Accepted++;
+			item->thing = cres.thing;
+			item->Vec = vec;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool FRadiusThingsIterator::CheckSight(AActor *thing, int sightflags)
+{
+	SightChecks++;
+	return P_CheckSight(thing, spot, sightflags);
+}
+
+void FRadiusThingsIterator::ResetStats()
+{
+	Queries = Visited = Accepted = SightChecks = 0;
+}
+
+ADD_STAT(radius)
+{
+	FString out;
+	out.Format("Radius queries = %d, %d things visited, %d accepted, %d sight checks",
+		FRadiusThingsIterator::Queries, FRadiusThingsIterator::Visited, FRadiusThingsIterator::Accepted, FRadiusThingsIterator::SightChecks);
+	return out;
+}
+
 //===========================================================================
 //
 // and the scriptable version
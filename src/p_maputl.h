@@ -8,6 +8,7 @@
 
 extern int validcount;
 struct FBlockNode;
+struct FBlockThing;
 
 struct divline_t
 {
@@ -281,6 +282,11 @@ class FBlockThingsIterator
 
 	FBlockNode *block;
 
+	// Used instead of the chain in block when sv_compactblockmap is on.
+	// Everything from thingindex up has already been returned.
+	const TArray<FBlockThing> *things;
+	unsigned thingindex;
+
 	int Buckets[32];
 
 	struct HashEntry
@@ -297,6 +303,7 @@ class FBlockThingsIterator
 	void StartBlock(int x, int y);
 	void SwitchBlock(int x, int y);
 	void ClearHash();
+	void SetThings(const TArray<FBlockThing> *newthings);
 
 	// The following is only for use in the path traverser 
 	// and therefore declared private.
@@ -304,13 +311,21 @@ class FBlockThingsIterator
 
 	friend class FPathTraverse;
 	friend class FMultiBlockThingsIterator;
+	friend struct FBlockmap;
 
 public:
 	FBlockThingsIterator(int minx, int miny, int maxx, int maxy);
 	FBlockThingsIterator(const FBoundingBox &box)
 	{
+		things = NULL;
 		init(box);
 	}
+	FBlockThingsIterator(const FBlockThingsIterator &) = delete;
+	FBlockThingsIterator &operator=(const FBlockThingsIterator &) = delete;
+	~FBlockThingsIterator()
+	{
+		SetThings(NULL);
+	}
 	void init(const FBoundingBox &box);
 	AActor *Next(bool centeronly = false);
 	void Reset() { StartBlock(minx, miny); }
@@ -349,6 +364,50 @@ public:
 	}
 };
 
+//============================================================================
+//
+// Iterates the things around a spot for explosions and other radius effects.
+// Things that are obviously out of reach get skipped before the caller sees
+// them, so that its own checks and especially the sight check only run for
+// the rest.
+//
+//============================================================================
+
+enum ERadiusThingsFlags
+{
+	RTF_CENTER = 1,			// reach is measured from the thing's center as a sphere, not from its bounding box
+	RTF_CUBE = 2,			// with RTF_CENTER, use a cube instead of a sphere
+	RTF_CHECKZ = 4,			// also skip bounding boxes that are out of reach vertically, except for MF5_OLDRADIUSDMG things
+	RTF_DAMAGEFACTOR = 8,	// never skip things with a negative RadiusDamageFactor
+};
+
+class FRadiusThingsIterator
+{
+	FPortalGroupArray grouplist;
+	FMultiBlockThingsIterator it;
+	AActor *spot;
+	double reach;
+	int flags;
+
+	bool InReach(AActor *thing, const DVector3 &vec);
+
+public:
+	struct CheckResult
+	{
+		AActor *thing;
+		DVector3 Vec;		// same as spot->Vec3To(thing)
+	};
+
+	// bottom, height and radius select the blocks to search, just like for FMultiBlockThingsIterator.
+	// A reach of 0 or less skips nothing.
+	FRadiusThingsIterator(AActor *spot, double bottom, double height, double radius, double reach, int flags = 0);
+	bool Next(CheckResult *item);
+	bool CheckSight(AActor *thing, int sightflags);
+
+	static void ResetStats();
+	static int Queries, Visited, Accepted, SightChecks;
+};
+
 
 
 class FPathTraverse
@@ -171,6 +171,10 @@ CVAR (Bool, cl_missiledecals, true, CVAR_ARCHIVE)
 CVAR (Bool, addrocketexplosion, false, CVAR_ARCHIVE)
 CVAR (Int, cl_pufftype, 0, CVAR_ARCHIVE);
 CVAR (Int, cl_bloodtype, 0, CVAR_ARCHIVE);
+CVAR (Bool, sv_thinkersleep, false, CVAR_SERVERINFO)
+
+bool ThinkersSleep;
+static bool SleepRespawnMonsters;
 
 // CODE --------------------------------------------------------------------
 
@@ -660,6 +664,7 @@ bool AActor::SetState (FState *newstate, bool nofunction)
 {
 	if (debugfile && player && (player->cheats & CF_PREDICTING))
 		fprintf (debugfile, "for pl %td: SetState while predicting!\n", player-players);
+	StopSleeping();
 	do
 	{
 		if (newstate == NULL)
@@ -4065,6 +4070,133 @@ DEFINE_ACTION_FUNCTION(AActor, CheckPortalTransition)
 	return 0;
 }
 
+//==========================================================================
+//
+// AActor :: CanSleep
+//
+// Checks whether the next call to Tick would leave the actor exactly
+// as it is, apart from counting down the current state's tics. Decorations,
+// corpses and pickups lying around spend most of their time like that.
+// A sleeping actor is not looked at again until its tics run out, so
+// changes to anything checked here have to wake it: SetState, linking,
+// damage, sector movement and every change of velocity do, including
+// script stores to Vel and tics. Scripts that change a sleeping actor's
+// other fields from elsewhere do not, which is why sleeping is a server
+// setting. Reading a sleeping actor's tics gives the value it went to
+// sleep with.
+//
+//==========================================================================
+
+bool AActor::CanSleep()
+{
+	if (!StaysAsleep())
+	{
+		return false;
+	}
+
+	// Only the native Tick is known to do nothing.
+	IFVIRTUAL(AActor, Tick)
+	{
+		static VMFunction *actortick, *inventorytick;
+		if (actortick == nullptr)
+		{
+			actortick = RUNTIME_CLASS(AActor)->Virtuals[VIndex];
+			inventorytick = RUNTIME_CLASS(AInventory)->Virtuals[VIndex];
+		}
+		if (func != actortick)
+		{
+			if (func != inventorytick) return false;
+			auto item = static_cast<AInventory *>(this);
+			if (item->Owner != nullptr || item->DropTime != 0) return false;
+		}
+	}
+
+	// CheckPortalTransition and UpdateRenderSectorList
+	if (!Sector->PortalBlocksMovement(sector_t::ceiling) || !Sector->PortalBlocksMovement(sector_t::floor) || PortalBlockmap.containsLines)
+	{
+		return false;
+	}
+	if (flags5 & MF5_NOINTERACTION)
+	{
+		return true;
+	}
+
+	// UpdateWaterLevel
+	if (Sector->GetHeightSec() != nullptr || Sector->e->XFloor.ffloors.Size() > 0 || floorsector->e->XFloor.ffloors.Size() > 0)
+	{
+		return false;
+	}
+
+	// Sliding down steep slopes
+	if ((flags & MF_SOLID) && !(flags & (MF_NOCLIP|MF_NOGRAVITY|MF_NOBLOCKMAP)) && floorsector->floorplane.fC() < STEEPSLOPE)
+	{
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// AActor :: StaysAsleep
+//
+//==========================================================================
+
+bool AActor::StaysAsleep()
+{
+	if ((tics != -1 && (tics <= 1 || state->GetCanRaise())) || !Vel.isZero() || player != nullptr || Inventory != nullptr || BlockingMobj != nullptr ||
+		effects != 0 || PoisonDurationReceived != 0 || boomwaterlevel != waterlevel)
+	{
+		return false;
+	}
+	if ((flags & (MF_SKULLFLY|MF_MISSILE|MF_UNMORPHED|MF_STEALTH)) || (flags2 & (MF2_BLASTED|MF2_WINDTHRUST)) ||
+		(flags4 & (MF4_VFRICTION|MF4_SCROLLMOVE)) || (flags5 & MF5_ALWAYSRESPAWN) || (flags6 & MF6_BOSSCUBE) ||
+		(flags7 & MF7_HANDLENODELAY) || (flags8 & MF8_INSCROLLSEC))
+	{
+		return false;
+	}
+	if ((flags6 & (MF6_TOUCHY|MF6_ARMED)) == MF6_TOUCHY)
+	{
+		return false;	// would arm itself
+	}
+	if (((flags & MF_CORPSE) || (flags6 & MF6_KILLED)) && !(flags3 & MF3_CRASHED) && !(flags & MF_ICECORPSE) && !(flags6 & MF6_DONTCORPSE))
+	{
+		return false;	// would enter its crash state
+	}
+	if (SleepRespawnMonsters && (flags3 & MF3_ISMONSTER) && !(flags2 & MF2_DORMANT) && !(flags5 & MF5_NEVERRESPAWN))
+	{
+		return false;
+	}
+	if (flags5 & MF5_NOINTERACTION)
+	{
+		return !!(flags & MF_NOBLOCKMAP);
+	}
+	return Z() == floorz;
+}
+
+//==========================================================================
+//
+// P_UpdateThinkerSleep
+//
+// Called at the start of each tic for the conditions that are not
+// stored in the actors.
+//
+//==========================================================================
+
+void P_UpdateThinkerSleep()
+{
+	bool sleep = ThinkersSleep;
+	bool respawn = SleepRespawnMonsters;
+
+	// Bots look at all monsters, missiles and pickups from their Tick.
+	ThinkersSleep = sv_thinkersleep && !(bglobal.botnum && !demoplayback);
+	SleepRespawnMonsters = G_SkillProperty(SKILLP_Respawn) != 0;
+
+	if ((sleep && !ThinkersSleep) || (SleepRespawnMonsters && !respawn))
+	{
+		DThinker::WakeSleepers();
+	}
+}
+
 //
 // P_MobjThinker
 //
@@ -4909,7 +5041,6 @@ bool AActor::UpdateWaterLevel(bool dosplash)
 
 	double fh = -FLT_MAX;
 	bool reset = false;
-	bool isMario = (player && player->marioInstance);
 
 	waterlevel = 0;
 
@@ -4987,12 +5118,6 @@ bool AActor::UpdateWaterLevel(bool dosplash)
 		}
 	}
 
-	if (isMario)
-	{
-		if (fh == -FLT_MAX) fh = -32768;
-		sm64_set_mario_water_level(player->marioInstance->ID(), (int)(fh*MARIO_SCALE));
-	}
-
 	return false;	// we did the splash ourselves
 }
 
@@ -5466,6 +5591,7 @@ void AActor::OnDestroy ()
 	//      note: if OnDestroy is ever made optional, E_WorldThingDestroyed should still be called for ANY thing.
 	E_WorldThingDestroyed(this);
 
+	P_SightForget(this);
 	ClearRenderSectorList();
 	ClearRenderLineList();
 
@@ -7082,13 +7208,20 @@ AActor *P_SpawnMissile(AActor *source, AActor *dest, PClassActor *type, AActor *
 	return P_SpawnMissileXYZ(source->PosPlusZ(32 + source->GetBobOffset()), source, dest, type, true, owner);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, SpawnMissile)
+static AActor *SpawnMissileNative(AActor *self, AActor *dest, PClassActor *type, AActor *owner)
+{
+	if (self == nullptr) NullParam("self");
+	if (dest == nullptr) NullParam("dest");
+	return P_SpawnMissile(self, dest, type, owner);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, SpawnMissile, SpawnMissileNative)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(dest, AActor);
 	PARAM_CLASS(type, AActor);
 	PARAM_OBJECT_DEF(owner, AActor);
-	ACTION_RETURN_OBJECT(P_SpawnMissile(self, dest, type, owner));
+	ACTION_RETURN_OBJECT(SpawnMissileNative(self, dest, type, owner));
 }
 
 AActor *P_SpawnMissileZ(AActor *source, double z, AActor *dest, PClassActor *type)
@@ -8185,11 +8318,18 @@ DEFINE_ACTION_FUNCTION(AActor, absangle)	// should this be global?
 	ACTION_RETURN_FLOAT(absangle(DAngle(a1), DAngle(a2)).Degrees);
 }
 
-DEFINE_ACTION_FUNCTION(AActor, Distance2D)
+static double Distance2DNative(AActor *self, AActor *other)
+{
+	if (self == nullptr) NullParam("self");
+	if (other == nullptr) NullParam("other");
+	return self->Distance2D(other);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, Distance2D, Distance2DNative)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(other, AActor);
-	ACTION_RETURN_FLOAT(self->Distance2D(other));
+	ACTION_RETURN_FLOAT(Distance2DNative(self, other));
 }
 
 DEFINE_ACTION_FUNCTION(AActor, Distance3D)
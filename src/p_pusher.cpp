@@ -330,6 +330,7 @@ void DPusher::Tick ()
 				pushvel = m_PushVec; // full force
 			}
 		}
+		thing->StopSleeping();
 		thing->Vel += pushvel / PUSH_FACTOR;
 	}
 }
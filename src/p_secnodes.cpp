@@ -30,6 +30,13 @@
 #include "p_blockmap.h"
 #include "memarena.h"
 #include "actor.h"
+#include "p_local.h"
+#include "c_cvars.h"
+#include "templates.h"
+
+// The cached lines come in a different order than the blockmap gives them for the
+// actor's own box, which reorders touching_sectorlist, so this has to match in netgames and demos.
+CVAR(Bool, sv_secnodecache, false, CVAR_SERVERINFO)
 
 //=============================================================================
 // phares 3/21/98
@@ -40,6 +47,34 @@
 msecnode_t *headsecnode = nullptr;
 FMemArena secnodearena;
 
+//=============================================================================
+//
+// The lines around an actor's last position. As long as it stays inside
+// the box they were collected for, only these need to be checked to find
+// the sectors it touches, instead of searching the blockmap again.
+//
+//=============================================================================
+
+enum
+{
+	SECNODECACHE_LINES = 64,
+};
+
+// How far an actor can move before its lines have to be collected again.
+static const double SECNODECACHE_MARGIN = 64;
+
+struct FSecNodeCache
+{
+	FSecNodeCache *next;		// for the freelist
+	FBoundingBox box;
+	unsigned linechanges;		// level.blockmap.linechanges when this was collected
+	int numlines;
+	line_t *lines[SECNODECACHE_LINES];
+};
+
+static FSecNodeCache *headsecnodecache = nullptr;
+static TArray<line_t *> secnodelines;
+
 //=============================================================================
 //
 // P_GetSecnode
@@ -79,6 +114,109 @@ void P_PutSecnode(msecnode_t *node)
 	headsecnode = node;
 }
 
+//=============================================================================
+//
+// P_ClearSecnodes
+//
+// Releases all nodes of the current level at once. Only to be called
+// when no actor is linked into the level anymore.
+//
+//=============================================================================
+
+void P_ClearSecnodes()
+{
+	secnodearena.FreeAll();
+	headsecnode = nullptr;
+	headsecnodecache = nullptr;
+}
+
+//=============================================================================
+//
+// P_FreeSecNodeCache
+//
+//=============================================================================
+
+void P_FreeSecNodeCache(AActor *thing)
+{
+	FSecNodeCache *cache = thing->secnodecache;
+	if (cache != nullptr)
+	{
+		cache->next = headsecnodecache;
+		headsecnodecache = cache;
+		thing->secnodecache = nullptr;
+	}
+}
+
+//=============================================================================
+//
+// P_GetSecNodeLines
+//
+// Returns the lines that may cross box. Uses the actor's cache if box is
+// still inside it, otherwise searches the blockmap for an area large enough
+// for the next moves and caches that, if there aren't too many lines in it.
+//
+//=============================================================================
+
+static line_t **P_GetSecNodeLines(AActor *thing, double radius, const FBoundingBox &box, int *numlines)
+{
+	FSecNodeCache *cache = thing->secnodecache;
+	if (cache != nullptr && cache->linechanges == level.blockmap.linechanges &&
+		box.Left() >= cache->box.Left() && box.Right() <= cache->box.Right() &&
+		box.Bottom() >= cache->box.Bottom() && box.Top() <= cache->box.Top())
+	{
+		*numlines = cache->numlines;
+		return cache->lines;
+	}
+
+	// Cover both lists kept for the actor and extend the area into the
+	// direction it is moving, so that fast projectiles also get some use out of it.
+	double cacheradius = MAX(MAX(radius, thing->radius), thing->renderradius) + SECNODECACHE_MARGIN;
+	FBoundingBox cachebox(thing->X(), thing->Y(), cacheradius);
+	cachebox = cachebox | FBoundingBox(thing->X() + thing->Vel.X, thing->Y() + thing->Vel.Y, cacheradius);
+
+	secnodelines.Clear();
+	FBlockLinesIterator it(cachebox);
+	line_t *ld;
+
+	while ((ld = it.Next()))
+	{
+		if (cachebox.inRange(ld))
+		{
+			secnodelines.Push(ld);
+		}
+	}
+
+	if (secnodelines.Size() > SECNODECACHE_LINES)
+	{
+		P_FreeSecNodeCache(thing);
+	}
+	else
+	{
+		if (cache == nullptr)
+		{
+			if (headsecnodecache != nullptr)
+			{
+				cache = headsecnodecache;
+				headsecnodecache = headsecnodecache->next;
+			}
+			else
+			{
+				cache = new(secnodearena.Alloc(sizeof(FSecNodeCache))) FSecNodeCache;
+			}
+			thing->secnodecache = cache;
+		}
+		cache->box = cachebox;
+		cache->linechanges = level.blockmap.linechanges;
+		cache->numlines = secnodelines.Size();
+		if (cache->numlines > 0)
+		{
+			memcpy(cache->lines, &secnodelines[0], cache->numlines * sizeof(line_t *));
+		}
+	}
+	*numlines = secnodelines.Size();
+	return secnodelines.Size() > 0 ? &secnodelines[0] : nullptr;
+}
+
 //=============================================================================
 // phares 3/16/98
 //
@@ -214,6 +352,40 @@ void P_DelSeclist(portnode_t *node, portnode_t *FLinePortal::*sechead)
 }
 
 
+//=============================================================================
+//
+// P_AddLineSecnodes
+//
+// Adds the sectors on both sides of ld if it crosses box.
+//
+//=============================================================================
+
+static msecnode_t *P_AddLineSecnodes(line_t *ld, AActor *thing, const FBoundingBox &box, msecnode_t *sector_list, msecnode_t *sector_t::*seclisthead)
+{
+	if (!box.inRange(ld) || box.BoxOnLineSide(ld) != -1)
+		return sector_list;
+
+	// This line crosses through the object.
+
+	// Collect the sector(s) from the line and add to the
+	// sector_list you're examining. If the Thing ends up being
+	// allowed to move to this position, then the sector_list
+	// will be attached to the Thing's AActor at touching_sectorlist.
+
+	sector_list = P_AddSecnode(ld->frontsector, thing, sector_list, ld->frontsector->*seclisthead);
+
+	// Don't assume all lines are 2-sided, since some Things
+	// like MT_TFOG are allowed regardless of whether their radius takes
+	// them beyond an impassable linedef.
+
+	// killough 3/27/98, 4/4/98:
+	// Use sidedefs instead of 2s flag to determine two-sidedness.
+
+	if (ld->backsector)
+		sector_list = P_AddSecnode(ld->backsector, thing, sector_list, ld->backsector->*seclisthead);
+	return sector_list;
+}
+
 //=============================================================================
 // phares 3/14/98
 //
@@ -240,32 +412,28 @@ msecnode_t *P_CreateSecNodeList(AActor *thing, double radius, msecnode_t *sector
 	}
 
 	FBoundingBox box(thing->X(), thing->Y(), radius);
-	FBlockLinesIterator it(box);
-	line_t *ld;
 
-	while ((ld = it.Next()))
+	if (sv_secnodecache)
 	{
-		if (!box.inRange(ld) || box.BoxOnLineSide(ld) != -1)
-			continue;
+		// Most moves stay close to the last position, so the lines found
+		// around that are usually all that need to be checked.
+		int numlines;
+		line_t **lines = P_GetSecNodeLines(thing, radius, box, &numlines);
 
-		// This line crosses through the object.
-
-		// Collect the sector(s) from the line and add to the
-		// sector_list you're examining. If the Thing ends up being
-		// allowed to move to this position, then the sector_list
-		// will be attached to the Thing's AActor at touching_sectorlist.
-
-		sector_list = P_AddSecnode(ld->frontsector, thing, sector_list, ld->frontsector->*seclisthead);
-
-		// Don't assume all lines are 2-sided, since some Things
-		// like MT_TFOG are allowed regardless of whether their radius takes
-		// them beyond an impassable linedef.
-
-		// killough 3/27/98, 4/4/98:
-		// Use sidedefs instead of 2s flag to determine two-sidedness.
+		for (int i = 0; i < numlines; i++)
+		{
+			sector_list = P_AddLineSecnodes(lines[i], thing, box, sector_list, seclisthead);
+		}
+	}
+	else
+	{
+		FBlockLinesIterator it(box);
+		line_t *ld;
 
-		if (ld->backsector)
-			sector_list = P_AddSecnode(ld->backsector, thing, sector_list, ld->backsector->*seclisthead);
+		while ((ld = it.Next()))
+		{
+			sector_list = P_AddLineSecnodes(ld, thing, box, sector_list, seclisthead);
+		}
 	}
 
 	// Add the sector of the (x,y) point to sector_list.
@@ -1481,6 +1481,7 @@ DEFINE_ACTION_FUNCTION(_Sector, NextLowestFloorAt)
 
  void sector_t::RemoveForceField()
  {
+	 P_SightGeometryChanged();
 	 for (auto line : Lines)
 	 {
 		 if (line->backsector != NULL && line->special == ForceField)
@@ -1856,6 +1857,7 @@ DEFINE_ACTION_FUNCTION(_Sector, NextLowestFloorAt)
 	 PARAM_SELF_STRUCT_PROLOGUE(sector_t);
 	 PARAM_INT(pos);
 	 self->ClearPortal(pos);
+	 P_SightGeometryChanged();
 	 return 0;
  }
 
@@ -3125,6 +3125,7 @@ void P_LoadBlockMap (MapData * map)
 	count = level.blockmap.bmapwidth*level.blockmap.bmapheight;
 	level.blockmap.blocklinks = new FBlockNode *[count];
 	memset (level.blockmap.blocklinks, 0, count*sizeof(*level.blockmap.blocklinks));
+	level.blockmap.blockthings = new TArray<FBlockThing>[count];
 	level.blockmap.blockmap = level.blockmap.blockmaplump+4;
 }
 
@@ -3525,6 +3526,7 @@ void P_FreeLevelData ()
 	FPolyObj::ClearAllSubsectorLinks(); // can't be done as part of the polyobj deletion process.
 	SN_StopAllSequences ();
 	DThinker::DestroyAllThinkers ();
+	P_ClearSecnodes();		// all actors are unlinked now
 	P_ClearPortals();
 	tagManager.Clear();
 	level.total_monsters = level.total_items = level.total_secrets =
@@ -3554,6 +3556,7 @@ void P_FreeLevelData ()
 	level.subsectors.Clear();
 	level.gamesubsectors.Reset();
 	level.rejectmatrix.Clear();
+	level.sightpvs.Clear();
 	level.Zones.Clear();
 	level.blockmap.Clear();
 
@@ -3595,6 +3598,20 @@ void P_FreeLevelData ()
 		if (level.dynamicObjects[i].ceiling.ID != UINT_MAX) sm64_surface_object_delete(level.dynamicObjects[i].ceiling.ID);
 	}
 	level.dynamicObjects.Clear();
+
+	for (auto &dynpoly : level.dynamicPolyobjs)
+	{
+		if (dynpoly.walls.ID != UINT_MAX) sm64_surface_object_delete(dynpoly.walls.ID);
+	}
+	level.dynamicPolyobjs.Clear();
+
+	for (auto &dynfloor : level.dynamic3DFloors)
+	{
+		if (dynfloor.top.ID != UINT_MAX) sm64_surface_object_delete(dynfloor.top.ID);
+		if (dynfloor.walls.ID != UINT_MAX) sm64_surface_object_delete(dynfloor.walls.ID);
+		if (dynfloor.bottom.ID != UINT_MAX) sm64_surface_object_delete(dynfloor.bottom.ID);
+	}
+	level.dynamic3DFloors.Clear();
 }
 
 //===========================================================================
@@ -3639,6 +3656,85 @@ struct DynamicSectorInfo
 	bool moveWalls;
 };
 
+// Sloped planes have to be sampled per vertex, otherwise the whole sector gets the height at its center.
+// Earcut points are already scaled to SM64 units.
+static float P_SM64PlaneZ(const secplane_t &plane, const Point &p)
+{
+	return plane.ZatPoint(p[0] / MARIO_SCALE, p[1] / MARIO_SCALE)*MARIO_SCALE;
+}
+
+static float P_SM64PlaneZ(const secplane_t &plane, const vertex_t *v)
+{
+	return plane.ZatPoint(v)*MARIO_SCALE;
+}
+
+// Pick the SM64 surface and terrain type for a sector floor from its Doom friction, damage and terrain.
+// Water is baked in at conversion time, so later changes to a heightsec's water level are not picked up.
+static void P_SetSM64FloorType(SM64Surface &surf, sector_t *sec)
+{
+	const FTerrainDef &terrain = Terrains[sec->GetTerrain(sector_t::floor)];
+	double friction = sec->GetFriction(sector_t::floor);
+	int damage = MAX(sec->damageamount, terrain.DamageAmount);
+
+	surf.type = SURFACE_DEFAULT;
+	surf.force = 0;
+	surf.terrain = TERRAIN_STONE;
+	surf.waterLevel = 0;
+
+	if (friction > ORIG_FRICTION)
+	{
+		surf.type = (friction >= 0.95) ? SURFACE_ICE : SURFACE_SLIPPERY;
+		surf.terrain = TERRAIN_SNOW;
+	}
+	else if (friction < ORIG_FRICTION)
+	{
+		surf.type = SURFACE_NOT_SLIPPERY;
+		surf.terrain = TERRAIN_SAND;
+	}
+
+	if (terrain.IsLiquid)
+		surf.terrain = TERRAIN_WATER;
+
+	// nukage and blood only hurt a little, lava-like floors make Mario jump
+	if (damage >= 20 || (terrain.IsLiquid && terrain.DamageAmount > 0))
+	{
+		surf.type = SURFACE_BURNING;
+		return;
+	}
+
+	double waterZ = -FLT_MAX;
+	if (sec->MoreFlags & SECF_UNDERWATER)
+	{
+		waterZ = sec->ceilingplane.ZatPoint(sec->centerspot);
+	}
+	else if (sector_t *hsec = sec->GetHeightSec())
+	{
+		if (hsec->MoreFlags & SECF_UNDERWATERMASK)
+			waterZ = hsec->floorplane.ZatPoint(sec->centerspot);
+	}
+	else
+	{
+		double floorZ = sec->floorplane.ZatPoint(sec->centerspot);
+		for (auto rover : sec->e->XFloor.ffloors)
+		{
+			if (!(rover->flags & FF_EXISTS)) continue;
+			if (rover->flags & FF_SOLID) continue;
+			if (!(rover->flags & FF_SWIMMABLE)) continue;
+			if (rover->bottom.plane->ZatPoint(sec->centerspot) > floorZ) continue;
+
+			waterZ = rover->top.plane->ZatPoint(sec->centerspot);
+			break;
+		}
+	}
+
+	if (waterZ > sec->floorplane.ZatPoint(sec->centerspot))
+	{
+		surf.type = SURFACE_WATER;
+		surf.terrain = TERRAIN_WATER;
+		surf.waterLevel = (int32_t)(waterZ*MARIO_SCALE);
+	}
+}
+
 std::vector<SM64DoomGround> triangulateGround(sector_t *sec)
 {
 	int i = sec->sectornum;
@@ -3648,7 +3744,10 @@ std::vector<SM64DoomGround> triangulateGround(sector_t *sec)
 
 	// first, create the floor for each sector by adding lines
 	for (line_t *line : sec->Lines)
-		remainingLines.push_back(line);
+	{
+		if (!(line->sidedef[0]->Flags & WALLF_POLYOBJ))
+			remainingLines.push_back(line);
+	}
 
 	bool holesAdded = false;
 	while (!remainingLines.empty())
@@ -3667,6 +3766,7 @@ std::vector<SM64DoomGround> triangulateGround(sector_t *sec)
 			{
 				// add the lines in sequential order (the next line's v1 must start where the previous line's v2 ends)
 				line_t *line = sec->Lines[j];
+				if (line->sidedef[0]->Flags & WALLF_POLYOBJ) continue; // polyobjects get their own surface objects
 
 				if (!holesAdded && line->frontsector && line->frontsector->sectornum != (int)i)
 				{
@@ -3806,11 +3906,12 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 
 				ceilingSurfaces[ceilingSurfaceCount-1].type = SURFACE_DEFAULT;
 				ceilingSurfaces[ceilingSurfaceCount-1].force = 0;
+				ceilingSurfaces[ceilingSurfaceCount-1].waterLevel = 0;
 				ceilingSurfaces[ceilingSurfaceCount-1].terrain = TERRAIN_STONE;
 
-				ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][0] = line3[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][1] = ceilingZ;	ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][2] = -line3[1];
-				ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][0] = line2[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][1] = ceilingZ;	ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][2] = -line2[1];
-				ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][0] = line1[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][1] = ceilingZ;	ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][2] = -line1[1];
+				ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][0] = line3[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][1] = P_SM64PlaneZ(sec->ceilingplane, line3);	ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][2] = -line3[1];
+				ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][0] = line2[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][1] = P_SM64PlaneZ(sec->ceilingplane, line2);	ceilingSurfaces[ceilingSurfaceCount-1].vertices[1][2] = -line2[1];
+				ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][0] = line1[0];	ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][1] = P_SM64PlaneZ(sec->ceilingplane, line1);	ceilingSurfaces[ceilingSurfaceCount-1].vertices[2][2] = -line1[1];
 
 				fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // ceiling %d/%d (%d actual lines), sector %d\n",
 					ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][0], ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][1], ceilingSurfaces[ceilingSurfaceCount-1].vertices[0][2],
@@ -3822,20 +3923,19 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 			floorSurfaceCount++;
 			floorSurfaces = (struct SM64Surface*)realloc(floorSurfaces, sizeof(struct SM64Surface) * floorSurfaceCount);
 
-			floorSurfaces[floorSurfaceCount-1].type = SURFACE_DEFAULT;
-			floorSurfaces[floorSurfaceCount-1].force = 0;
-			floorSurfaces[floorSurfaceCount-1].terrain = TERRAIN_STONE;
+			P_SetSM64FloorType(floorSurfaces[floorSurfaceCount-1], sec);
 
 			// floor
-			floorSurfaces[floorSurfaceCount-1].vertices[0][0] = line1[0];	floorSurfaces[floorSurfaceCount-1].vertices[0][1] = floorZ;	floorSurfaces[floorSurfaceCount-1].vertices[0][2] = -line1[1];
-			floorSurfaces[floorSurfaceCount-1].vertices[1][0] = line2[0];	floorSurfaces[floorSurfaceCount-1].vertices[1][1] = floorZ;	floorSurfaces[floorSurfaceCount-1].vertices[1][2] = -line2[1];
-			floorSurfaces[floorSurfaceCount-1].vertices[2][0] = line3[0];	floorSurfaces[floorSurfaceCount-1].vertices[2][1] = floorZ;	floorSurfaces[floorSurfaceCount-1].vertices[2][2] = -line3[1];
+			floorSurfaces[floorSurfaceCount-1].vertices[0][0] = line1[0];	floorSurfaces[floorSurfaceCount-1].vertices[0][1] = P_SM64PlaneZ(sec->floorplane, line1);	floorSurfaces[floorSurfaceCount-1].vertices[0][2] = -line1[1];
+			floorSurfaces[floorSurfaceCount-1].vertices[1][0] = line2[0];	floorSurfaces[floorSurfaceCount-1].vertices[1][1] = P_SM64PlaneZ(sec->floorplane, line2);	floorSurfaces[floorSurfaceCount-1].vertices[1][2] = -line2[1];
+			floorSurfaces[floorSurfaceCount-1].vertices[2][0] = line3[0];	floorSurfaces[floorSurfaceCount-1].vertices[2][1] = P_SM64PlaneZ(sec->floorplane, line3);	floorSurfaces[floorSurfaceCount-1].vertices[2][2] = -line3[1];
 
-			fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // ground %d/%d (%d actual lines), sector %d\n",
+			fprintf(f, "{0x%04X,0,%d,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}},%d}, // ground %d/%d (%d actual lines), sector %d\n",
+				floorSurfaces[floorSurfaceCount-1].type, floorSurfaces[floorSurfaceCount-1].terrain,
 				floorSurfaces[floorSurfaceCount-1].vertices[0][0], floorSurfaces[floorSurfaceCount-1].vertices[0][1], floorSurfaces[floorSurfaceCount-1].vertices[0][2],
 				floorSurfaces[floorSurfaceCount-1].vertices[1][0], floorSurfaces[floorSurfaceCount-1].vertices[1][1], floorSurfaces[floorSurfaceCount-1].vertices[1][2],
 				floorSurfaces[floorSurfaceCount-1].vertices[2][0], floorSurfaces[floorSurfaceCount-1].vertices[2][1], floorSurfaces[floorSurfaceCount-1].vertices[2][2],
-				j, indices.size(), sec->Lines.Size(), i);
+				floorSurfaces[floorSurfaceCount-1].waterLevel, j, indices.size(), sec->Lines.Size(), i);
 		}
 	}
 
@@ -3871,6 +3971,7 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 	for (uint32_t j=0; j<sec->Lines.Size(); j++)
 	{
 		line_t *line = sec->Lines[j];
+		if (line->sidedef[0]->Flags & WALLF_POLYOBJ) continue;
 		//if (std::find(dynamicLines.begin(), dynamicLines.end(), line->Index()) != dynamicLines.end()) Printf("%d (%d) is in dynamicLines, %.0f %.0f, %.0f %.0f\n", j, line->Index(), line->v1->p.X, line->v1->p.Y, line->v2->p.X, line->v2->p.Y);
 		
 		/*if (i == 77)
@@ -3882,30 +3983,31 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 		}*/
 
 		sector_t *sec = line->sidedef[0]->sector;
-		floorZ = sec->floorplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
-		ceilingZ = sec->ceilingplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
 
-		float bottomZ = 0;
-		float topZ = 0;
+		float bottomZ1 = 0, bottomZ2 = 0;
+		float topZ1 = 0, topZ2 = 0;
 		if (line->backsector) // this wall has a sector behind it
 		{
-			bottomZ = floorZ;
-			topZ = line->backsector->floorplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
+			bottomZ1 = P_SM64PlaneZ(sec->floorplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(sec->floorplane, line->v2);
+			topZ1 = P_SM64PlaneZ(line->backsector->floorplane, line->v1);
+			topZ2 = P_SM64PlaneZ(line->backsector->floorplane, line->v2);
 
 			wallSurfaceCount += 2;
 			wallSurfaces = (struct SM64Surface*)realloc(wallSurfaces, sizeof(struct SM64Surface) * wallSurfaceCount);
 
 			wallSurfaces[wallSurfaceCount-2].type = wallSurfaces[wallSurfaceCount-1].type = SURFACE_DEFAULT;
 			wallSurfaces[wallSurfaceCount-2].force = wallSurfaces[wallSurfaceCount-1].force = 0;
+			wallSurfaces[wallSurfaceCount-2].waterLevel = wallSurfaces[wallSurfaceCount-1].waterLevel = 0;
 			wallSurfaces[wallSurfaceCount-2].terrain = wallSurfaces[wallSurfaceCount-1].terrain = TERRAIN_STONE;
 
-			wallSurfaces[wallSurfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[0][1] = bottomZ;	wallSurfaces[wallSurfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
-			wallSurfaces[wallSurfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[1][1] = topZ;		wallSurfaces[wallSurfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
-			wallSurfaces[wallSurfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[2][1] = topZ;		wallSurfaces[wallSurfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[0][1] = bottomZ2;	wallSurfaces[wallSurfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[1][1] = topZ2;		wallSurfaces[wallSurfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[2][1] = topZ1;		wallSurfaces[wallSurfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
 
-			wallSurfaces[wallSurfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[0][1] = topZ;		wallSurfaces[wallSurfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
-			wallSurfaces[wallSurfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[1][1] = bottomZ;	wallSurfaces[wallSurfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
-			wallSurfaces[wallSurfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[2][1] = bottomZ;	wallSurfaces[wallSurfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[0][1] = topZ1;		wallSurfaces[wallSurfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[1][1] = bottomZ1;	wallSurfaces[wallSurfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
+			wallSurfaces[wallSurfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[2][1] = bottomZ2;	wallSurfaces[wallSurfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
 
 			fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // line %d (%d), sector %d, wall (1)\n",
 				wallSurfaces[wallSurfaceCount-2].vertices[0][0], wallSurfaces[wallSurfaceCount-2].vertices[0][1], wallSurfaces[wallSurfaceCount-2].vertices[0][2],
@@ -3919,13 +4021,17 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 				wallSurfaces[wallSurfaceCount-1].vertices[2][0], wallSurfaces[wallSurfaceCount-1].vertices[2][1], wallSurfaces[wallSurfaceCount-1].vertices[2][2],
 				j, line->Index(), i);
 
-			bottomZ = line->backsector->ceilingplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
-			topZ = ceilingZ;
+			bottomZ1 = P_SM64PlaneZ(line->backsector->ceilingplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(line->backsector->ceilingplane, line->v2);
+			topZ1 = P_SM64PlaneZ(sec->ceilingplane, line->v1);
+			topZ2 = P_SM64PlaneZ(sec->ceilingplane, line->v2);
 		}
 		else // this wall doesn't have a sector behind it
 		{
-			bottomZ = floorZ;
-			topZ = ceilingZ;
+			bottomZ1 = P_SM64PlaneZ(sec->floorplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(sec->floorplane, line->v2);
+			topZ1 = P_SM64PlaneZ(sec->ceilingplane, line->v1);
+			topZ2 = P_SM64PlaneZ(sec->ceilingplane, line->v2);
 		}
 
 		wallSurfaceCount += 2;
@@ -3933,15 +4039,16 @@ void P_AddSM64DynamicSector(DynamicSectorInfo& secinfo, std::vector<int>& dynami
 
 		wallSurfaces[wallSurfaceCount-2].type = wallSurfaces[wallSurfaceCount-1].type = SURFACE_DEFAULT;
 		wallSurfaces[wallSurfaceCount-2].force = wallSurfaces[wallSurfaceCount-1].force = 0;
+		wallSurfaces[wallSurfaceCount-2].waterLevel = wallSurfaces[wallSurfaceCount-1].waterLevel = 0;
 		wallSurfaces[wallSurfaceCount-2].terrain = wallSurfaces[wallSurfaceCount-1].terrain = TERRAIN_STONE;
 
-		wallSurfaces[wallSurfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[0][1] = bottomZ;	wallSurfaces[wallSurfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
-		wallSurfaces[wallSurfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[1][1] = topZ;		wallSurfaces[wallSurfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
-		wallSurfaces[wallSurfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[2][1] = topZ;		wallSurfaces[wallSurfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[0][1] = bottomZ2;	wallSurfaces[wallSurfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[1][1] = topZ2;		wallSurfaces[wallSurfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-2].vertices[2][1] = topZ1;		wallSurfaces[wallSurfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
 
-		wallSurfaces[wallSurfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[0][1] = topZ;		wallSurfaces[wallSurfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
-		wallSurfaces[wallSurfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[1][1] = bottomZ;	wallSurfaces[wallSurfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
-		wallSurfaces[wallSurfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[2][1] = bottomZ;	wallSurfaces[wallSurfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[0][1] = topZ1;		wallSurfaces[wallSurfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[1][1] = bottomZ1;	wallSurfaces[wallSurfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
+		wallSurfaces[wallSurfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	wallSurfaces[wallSurfaceCount-1].vertices[2][1] = bottomZ2;	wallSurfaces[wallSurfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
 
 		fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // line %d, sector %d, wall (1)\n",
 			wallSurfaces[wallSurfaceCount-2].vertices[0][0], wallSurfaces[wallSurfaceCount-2].vertices[0][1], wallSurfaces[wallSurfaceCount-2].vertices[0][2],
@@ -4003,21 +4110,23 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 			{
 				surfaces[k].type = SURFACE_DEFAULT;
 				surfaces[k].force = 0;
+				surfaces[k].waterLevel = 0;
 				surfaces[k].terrain = TERRAIN_STONE;
 			}
 
 			if (added == 2)
 			{
 				// ceiling
-				surfaces[surfaceCount-2].vertices[0][0] = line3[0];		surfaces[surfaceCount-2].vertices[0][1] = ceilingZ;		surfaces[surfaceCount-2].vertices[0][2] = -line3[1];
-				surfaces[surfaceCount-2].vertices[1][0] = line2[0];		surfaces[surfaceCount-2].vertices[1][1] = ceilingZ;		surfaces[surfaceCount-2].vertices[1][2] = -line2[1];
-				surfaces[surfaceCount-2].vertices[2][0] = line1[0];		surfaces[surfaceCount-2].vertices[2][1] = ceilingZ;		surfaces[surfaceCount-2].vertices[2][2] = -line1[1];
+				surfaces[surfaceCount-2].vertices[0][0] = line3[0];		surfaces[surfaceCount-2].vertices[0][1] = P_SM64PlaneZ(sec->ceilingplane, line3);		surfaces[surfaceCount-2].vertices[0][2] = -line3[1];
+				surfaces[surfaceCount-2].vertices[1][0] = line2[0];		surfaces[surfaceCount-2].vertices[1][1] = P_SM64PlaneZ(sec->ceilingplane, line2);		surfaces[surfaceCount-2].vertices[1][2] = -line2[1];
+				surfaces[surfaceCount-2].vertices[2][0] = line1[0];		surfaces[surfaceCount-2].vertices[2][1] = P_SM64PlaneZ(sec->ceilingplane, line1);		surfaces[surfaceCount-2].vertices[2][2] = -line1[1];
 			}
 
 			// floor
-			surfaces[surfaceCount-1].vertices[0][0] = line1[0];		surfaces[surfaceCount-1].vertices[0][1] = floorZ;	surfaces[surfaceCount-1].vertices[0][2] = -line1[1];
-			surfaces[surfaceCount-1].vertices[1][0] = line2[0];		surfaces[surfaceCount-1].vertices[1][1] = floorZ;	surfaces[surfaceCount-1].vertices[1][2] = -line2[1];
-			surfaces[surfaceCount-1].vertices[2][0] = line3[0];		surfaces[surfaceCount-1].vertices[2][1] = floorZ;	surfaces[surfaceCount-1].vertices[2][2] = -line3[1];
+			P_SetSM64FloorType(surfaces[surfaceCount-1], sec);
+			surfaces[surfaceCount-1].vertices[0][0] = line1[0];		surfaces[surfaceCount-1].vertices[0][1] = P_SM64PlaneZ(sec->floorplane, line1);	surfaces[surfaceCount-1].vertices[0][2] = -line1[1];
+			surfaces[surfaceCount-1].vertices[1][0] = line2[0];		surfaces[surfaceCount-1].vertices[1][1] = P_SM64PlaneZ(sec->floorplane, line2);	surfaces[surfaceCount-1].vertices[1][2] = -line2[1];
+			surfaces[surfaceCount-1].vertices[2][0] = line3[0];		surfaces[surfaceCount-1].vertices[2][1] = P_SM64PlaneZ(sec->floorplane, line3);	surfaces[surfaceCount-1].vertices[2][2] = -line3[1];
 
 			if (added == 2)
 			{
@@ -4028,11 +4137,12 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 					j, indices.size(), sec->Lines.Size(), i);
 			}
 
-			fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // ground %d/%d (%d actual lines), sector %d\n",
+			fprintf(f, "{0x%04X,0,%d,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}},%d}, // ground %d/%d (%d actual lines), sector %d\n",
+				surfaces[surfaceCount-1].type, surfaces[surfaceCount-1].terrain,
 				surfaces[surfaceCount-1].vertices[0][0], surfaces[surfaceCount-1].vertices[0][1], surfaces[surfaceCount-1].vertices[0][2],
 				surfaces[surfaceCount-1].vertices[1][0], surfaces[surfaceCount-1].vertices[1][1], surfaces[surfaceCount-1].vertices[1][2],
 				surfaces[surfaceCount-1].vertices[2][0], surfaces[surfaceCount-1].vertices[2][1], surfaces[surfaceCount-1].vertices[2][2],
-				j, indices.size(), sec->Lines.Size(), i);
+				surfaces[surfaceCount-1].waterLevel, j, indices.size(), sec->Lines.Size(), i);
 		}
 	}
 
@@ -4045,6 +4155,7 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 			//Printf("%d (%d) is in dynamicLines, %.0f %.0f (SKIP)\n", j, line->Index(), line->v1->p.X, line->v1->p.Y, line->v2->p.X, line->v2->p.Y);
 			continue; // skip this line
 		}
+		if (line->sidedef[0]->Flags & WALLF_POLYOBJ) continue;
 		
 		/*if (i == 77)
 		{
@@ -4054,27 +4165,30 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 			Printf("\n");
 		}*/
 
-		float bottomZ = 0;
-		float topZ = 0;
+		float bottomZ1 = 0, bottomZ2 = 0;
+		float topZ1 = 0, topZ2 = 0;
 		if (line->backsector) // this wall has a sector behind it
 		{
-			bottomZ = floorZ;
-			topZ = line->backsector->floorplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
+			bottomZ1 = P_SM64PlaneZ(sec->floorplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(sec->floorplane, line->v2);
+			topZ1 = P_SM64PlaneZ(line->backsector->floorplane, line->v1);
+			topZ2 = P_SM64PlaneZ(line->backsector->floorplane, line->v2);
 
 			surfaceCount += 2;
 			surfaces = (struct SM64Surface*)realloc(surfaces, sizeof(struct SM64Surface) * surfaceCount);
 
 			surfaces[surfaceCount-2].type = surfaces[surfaceCount-1].type = SURFACE_DEFAULT;
 			surfaces[surfaceCount-2].force = surfaces[surfaceCount-1].force = 0;
+			surfaces[surfaceCount-2].waterLevel = surfaces[surfaceCount-1].waterLevel = 0;
 			surfaces[surfaceCount-2].terrain = surfaces[surfaceCount-1].terrain = TERRAIN_STONE;
 
-			surfaces[surfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[0][1] = bottomZ;	surfaces[surfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
-			surfaces[surfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[1][1] = topZ;		surfaces[surfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
-			surfaces[surfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[2][1] = topZ;		surfaces[surfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[0][1] = bottomZ2;	surfaces[surfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[1][1] = topZ2;		surfaces[surfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[2][1] = topZ1;		surfaces[surfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
 
-			surfaces[surfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[0][1] = topZ;		surfaces[surfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
-			surfaces[surfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[1][1] = bottomZ;	surfaces[surfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
-			surfaces[surfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[2][1] = bottomZ;	surfaces[surfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[0][1] = topZ1;		surfaces[surfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[1][1] = bottomZ1;	surfaces[surfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
+			surfaces[surfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[2][1] = bottomZ2;	surfaces[surfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
 
 			fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // line %d (%d), sector %d, wall (1)\n",
 				surfaces[surfaceCount-2].vertices[0][0], surfaces[surfaceCount-2].vertices[0][1], surfaces[surfaceCount-2].vertices[0][2],
@@ -4088,13 +4202,17 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 				surfaces[surfaceCount-1].vertices[2][0], surfaces[surfaceCount-1].vertices[2][1], surfaces[surfaceCount-1].vertices[2][2],
 				j, line->Index(), i);
 
-			bottomZ = line->backsector->ceilingplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
-			topZ = ceilingZ;
+			bottomZ1 = P_SM64PlaneZ(line->backsector->ceilingplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(line->backsector->ceilingplane, line->v2);
+			topZ1 = P_SM64PlaneZ(sec->ceilingplane, line->v1);
+			topZ2 = P_SM64PlaneZ(sec->ceilingplane, line->v2);
 		}
 		else // this wall doesn't have a sector behind it
 		{
-			bottomZ = floorZ;
-			topZ = ceilingZ;
+			bottomZ1 = P_SM64PlaneZ(sec->floorplane, line->v1);
+			bottomZ2 = P_SM64PlaneZ(sec->floorplane, line->v2);
+			topZ1 = P_SM64PlaneZ(sec->ceilingplane, line->v1);
+			topZ2 = P_SM64PlaneZ(sec->ceilingplane, line->v2);
 		}
 
 		surfaceCount += 2;
@@ -4102,15 +4220,16 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 
 		surfaces[surfaceCount-2].type = surfaces[surfaceCount-1].type = SURFACE_DEFAULT;
 		surfaces[surfaceCount-2].force = surfaces[surfaceCount-1].force = 0;
+		surfaces[surfaceCount-2].waterLevel = surfaces[surfaceCount-1].waterLevel = 0;
 		surfaces[surfaceCount-2].terrain = surfaces[surfaceCount-1].terrain = TERRAIN_STONE;
 
-		surfaces[surfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[0][1] = bottomZ;	surfaces[surfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
-		surfaces[surfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[1][1] = topZ;		surfaces[surfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
-		surfaces[surfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[2][1] = topZ;		surfaces[surfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-2].vertices[0][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[0][1] = bottomZ2;	surfaces[surfaceCount-2].vertices[0][2] = -line->v2->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-2].vertices[1][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[1][1] = topZ2;		surfaces[surfaceCount-2].vertices[1][2] = -line->v2->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-2].vertices[2][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-2].vertices[2][1] = topZ1;		surfaces[surfaceCount-2].vertices[2][2] = -line->v1->p.Y*MARIO_SCALE;
 
-		surfaces[surfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[0][1] = topZ;		surfaces[surfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
-		surfaces[surfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[1][1] = bottomZ;	surfaces[surfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
-		surfaces[surfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[2][1] = bottomZ;	surfaces[surfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-1].vertices[0][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[0][1] = topZ1;		surfaces[surfaceCount-1].vertices[0][2] = -line->v1->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-1].vertices[1][0] = line->v1->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[1][1] = bottomZ1;	surfaces[surfaceCount-1].vertices[1][2] = -line->v1->p.Y*MARIO_SCALE;
+		surfaces[surfaceCount-1].vertices[2][0] = line->v2->p.X*MARIO_SCALE;	surfaces[surfaceCount-1].vertices[2][1] = bottomZ2;	surfaces[surfaceCount-1].vertices[2][2] = -line->v2->p.Y*MARIO_SCALE;
 
 		fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // line %d, sector %d, wall (1)\n",
 			surfaces[surfaceCount-2].vertices[0][0], surfaces[surfaceCount-2].vertices[0][1], surfaces[surfaceCount-2].vertices[0][2],
@@ -4128,6 +4247,214 @@ SM64Surface* P_AddSM64Sector(sector_t *sec, SM64Surface *surfaces, uint32_t& sur
 	return surfaces;
 }
 
+static void P_AddSM64Triangle(TArray<SM64Surface> &surfaces, float x1, float y1, float z1, float x2, float y2, float z2, float x3, float y3, float z3)
+{
+	SM64Surface surf;
+	surf.type = SURFACE_DEFAULT;
+	surf.force = 0;
+	surf.waterLevel = 0;
+	surf.terrain = TERRAIN_STONE;
+	surf.vertices[0][0] = x1;	surf.vertices[0][1] = y1;	surf.vertices[0][2] = z1;
+	surf.vertices[1][0] = x2;	surf.vertices[1][1] = y2;	surf.vertices[1][2] = z2;
+	surf.vertices[2][0] = x3;	surf.vertices[2][1] = y3;	surf.vertices[2][2] = z3;
+	surfaces.Push(surf);
+}
+
+// v1/v2 are in Doom map units, heights are already scaled
+static void P_AddSM64WallQuad(TArray<SM64Surface> &surfaces, const DVector2 &v1, const DVector2 &v2, float bottomZ1, float topZ1, float bottomZ2, float topZ2)
+{
+	float x1 = v1.X*MARIO_SCALE, z1 = -v1.Y*MARIO_SCALE;
+	float x2 = v2.X*MARIO_SCALE, z2 = -v2.Y*MARIO_SCALE;
+	P_AddSM64Triangle(surfaces, x2, bottomZ2, z2, x2, topZ2, z2, x1, topZ1, z1);
+	P_AddSM64Triangle(surfaces, x1, topZ1, z1, x1, bottomZ1, z1, x2, bottomZ2, z2);
+}
+
+static void P_AddSM64SectorPlane(TArray<SM64Surface> &surfaces, sector_t *sec, const secplane_t &plane, bool ceiling)
+{
+	std::vector<SM64DoomGround> grounds = triangulateGround(sec);
+	for (SM64DoomGround &ground : grounds)
+	{
+		std::vector<uint32_t> indices = mapbox::earcut<uint32_t>(ground.polygon);
+		for (uint32_t j=0; j<indices.size(); j+=3)
+		{
+			Point &p1 = ground.polygon[0][indices[j+0]];
+			Point &p2 = ground.polygon[0][indices[j+1]];
+			Point &p3 = ground.polygon[0][indices[j+2]];
+
+			float z1 = P_SM64PlaneZ(plane, p1), z2 = P_SM64PlaneZ(plane, p2), z3 = P_SM64PlaneZ(plane, p3);
+
+			if (ceiling)
+				P_AddSM64Triangle(surfaces, p3[0], z3, -p3[1], p2[0], z2, -p2[1], p1[0], z1, -p1[1]);
+			else
+				P_AddSM64Triangle(surfaces, p1[0], z1, -p1[1], p2[0], z2, -p2[1], p3[0], z3, -p3[1]);
+		}
+	}
+}
+
+static void P_DumpSM64Surfaces(FILE *f, const TArray<SM64Surface> &surfaces, const char *what, int index)
+{
+	for (const SM64Surface &s : surfaces)
+	{
+		fprintf(f, "{SURFACE_DEFAULT,0,TERRAIN_STONE,{{%d,%d,%d},{%d,%d,%d},{%d,%d,%d}}}, // %s %d\n",
+			s.vertices[0][0], s.vertices[0][1], s.vertices[0][2],
+			s.vertices[1][0], s.vertices[1][1], s.vertices[1][2],
+			s.vertices[2][0], s.vertices[2][1], s.vertices[2][2],
+			what, index);
+	}
+}
+
+static void P_CreateSM64Object(SM64DynamicObject &obj, TArray<SM64Surface> &surfaces)
+{
+	if (surfaces.Size() == 0)
+	{
+		obj.ID = UINT_MAX;
+		return;
+	}
+
+	SM64SurfaceObject surfaceObj;
+	surfaceObj.surfaces = &surfaces[0];
+	surfaceObj.surfaceCount = surfaces.Size();
+	surfaceObj.transform = obj.transform;
+	obj.ID = sm64_surface_object_create(&surfaceObj);
+}
+
+//===========================================================================
+//
+// P_AddSM64Polyobj
+//
+// Polyobject walls are built around the start spot with the polyobject's
+// original vertices, so moving and rotating only changes the transform.
+//
+//===========================================================================
+
+void P_AddSM64Polyobj(FPolyObj *poly, FILE *f)
+{
+	SM64DynamicPolyobj dynpoly;
+	dynpoly.poly = poly;
+	dynpoly.dirty = true;
+	memset(&dynpoly.walls.transform, 0, sizeof(SM64ObjectTransform));
+	dynpoly.walls.transform.position[0] = poly->StartSpot.pos.X*MARIO_SCALE;
+	dynpoly.walls.transform.position[2] = -poly->StartSpot.pos.Y*MARIO_SCALE;
+	dynpoly.walls.transform.eulerRotation[1] = -poly->Angle.Normalized180().Degrees;
+
+	// polyobjects block everything between floor and ceiling of the sector they sit in
+	sector_t *sec = poly->CenterSubsector ? poly->CenterSubsector->sector : P_PointInSector(poly->CenterSpot.pos);
+	float floorZ = sec->floorplane.ZatPoint(poly->CenterSpot.pos)*MARIO_SCALE;
+	float ceilingZ = sec->ceilingplane.ZatPoint(poly->CenterSpot.pos)*MARIO_SCALE;
+
+	TArray<SM64Surface> surfaces;
+	for (line_t *line : poly->Linedefs)
+	{
+		unsigned v1 = poly->Vertices.Find(line->v1);
+		unsigned v2 = poly->Vertices.Find(line->v2);
+		if (v1 == poly->Vertices.Size() || v2 == poly->Vertices.Size()) continue;
+
+		P_AddSM64WallQuad(surfaces, poly->OriginalPts[v1].pos, poly->OriginalPts[v2].pos, floorZ, ceilingZ, floorZ, ceilingZ);
+	}
+
+	P_DumpSM64Surfaces(f, surfaces, "polyobj", poly->tag);
+	P_CreateSM64Object(dynpoly.walls, surfaces);
+	level.dynamicPolyobjs.Push(dynpoly);
+}
+
+//===========================================================================
+//
+// P_AddSM64XFloor
+//
+// Solid 3D floors become a slab over their target sector: the top is a
+// floor for Mario, the bottom a ceiling, and the sector outline the sides.
+//
+//===========================================================================
+
+static void P_BuildSM64XFloorSides(SM64Dynamic3DFloor &dynfloor, TArray<SM64Surface> &walls, TArray<SM64Surface> &bottom)
+{
+	F3DFloor *ffloor = dynfloor.ffloor;
+	sector_t *sec = ffloor->target;
+	secplane_t &topplane = *ffloor->top.plane;
+	secplane_t &bottomplane = *ffloor->bottom.plane;
+
+	memset(&dynfloor.walls.transform, 0, sizeof(SM64ObjectTransform));
+	memset(&dynfloor.bottom.transform, 0, sizeof(SM64ObjectTransform));
+	dynfloor.wallsSpawnZ = topplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
+	dynfloor.bottomSpawnZ = bottomplane.ZatPoint(sec->centerspot)*MARIO_SCALE;
+	dynfloor.thickness = dynfloor.wallsSpawnZ - dynfloor.bottomSpawnZ;
+
+	if (dynfloor.thickness > 0)
+	{
+		P_AddSM64SectorPlane(bottom, sec, bottomplane, true);
+		for (line_t *line : sec->Lines)
+		{
+			if (line->sidedef[0]->Flags & WALLF_POLYOBJ) continue;
+			P_AddSM64WallQuad(walls, line->v1->fPos(), line->v2->fPos(),
+				P_SM64PlaneZ(bottomplane, line->v1), P_SM64PlaneZ(topplane, line->v1),
+				P_SM64PlaneZ(bottomplane, line->v2), P_SM64PlaneZ(topplane, line->v2));
+		}
+	}
+}
+
+void P_AddSM64XFloor(F3DFloor *ffloor, FILE *f)
+{
+	sector_t *sec = ffloor->target;
+
+	SM64Dynamic3DFloor dynfloor;
+	dynfloor.ffloor = ffloor;
+	dynfloor.dirty = true;
+	memset(&dynfloor.top.transform, 0, sizeof(SM64ObjectTransform));
+	dynfloor.topSpawnZ = ffloor->top.plane->ZatPoint(sec->centerspot)*MARIO_SCALE;
+
+	TArray<SM64Surface> top, walls, bottom;
+	P_AddSM64SectorPlane(top, sec, *ffloor->top.plane, false);
+	P_BuildSM64XFloorSides(dynfloor, walls, bottom);
+
+	P_DumpSM64Surfaces(f, top, "3d floor top, sector", sec->sectornum);
+	P_DumpSM64Surfaces(f, walls, "3d floor side, sector", sec->sectornum);
+	P_DumpSM64Surfaces(f, bottom, "3d floor bottom, sector", sec->sectornum);
+
+	P_CreateSM64Object(dynfloor.top, top);
+	P_CreateSM64Object(dynfloor.walls, walls);
+	P_CreateSM64Object(dynfloor.bottom, bottom);
+	level.dynamic3DFloors.Push(dynfloor);
+}
+
+//===========================================================================
+//
+// P_SM64RebuildXFloorSides
+//
+// Moving the whole slab only needs new transforms, but once the distance
+// between its top and bottom changes, the sides and the bottom have to be
+// built again at their new height.
+//
+//===========================================================================
+
+void P_SM64RebuildXFloorSides(SM64Dynamic3DFloor *dynfloor)
+{
+	if (dynfloor->walls.ID != UINT_MAX) sm64_surface_object_delete(dynfloor->walls.ID);
+	if (dynfloor->bottom.ID != UINT_MAX) sm64_surface_object_delete(dynfloor->bottom.ID);
+
+	TArray<SM64Surface> walls, bottom;
+	P_BuildSM64XFloorSides(*dynfloor, walls, bottom);
+	P_CreateSM64Object(dynfloor->walls, walls);
+	P_CreateSM64Object(dynfloor->bottom, bottom);
+}
+
+void P_SM64PolyobjMoved(FPolyObj *poly)
+{
+	unsigned index = unsigned(poly - polyobjs);
+	if (index < level.dynamicPolyobjs.Size())
+		level.dynamicPolyobjs[index].dirty = true;
+}
+
+void P_SM64SectorPlaneMoved(sector_t *sec)
+{
+	if (sec->e->XFloor.attached.Size() == 0) return;
+
+	for (auto &dynfloor : level.dynamic3DFloors)
+	{
+		if (dynfloor.ffloor->model == sec)
+			dynfloor.dirty = true;
+	}
+}
+
 //===========================================================================
 //
 // P_SetupLevel
@@ -4608,6 +4935,10 @@ void P_SetupLevel (const char *lumpname, int position)
 	P_FinalizePortals();	// finalize line portals after polyobjects have been initialized. This info is needed for properly flagging them.
 	times[16].Unclock();
 
+	times[18].Clock();
+	P_BuildSightPVS();
+	times[18].Unclock();
+
 	// SM64: load collision surfaces
 	// we're gonna have to convert doom lines/sectors/etc. to libsm64 triangles
 	struct SM64Surface *surfaces = NULL;
@@ -4708,6 +5039,19 @@ void P_SetupLevel (const char *lumpname, int position)
 			surfaces = P_AddSM64Sector(sec, surfaces, surfaceCount, dynamicSectors, dynamicLines, f);
 	}
 
+	// polyobjects and solid 3D floors are surface objects that follow their movement
+	for (int i=0; i<po_NumPolyobjs; i++)
+		P_AddSM64Polyobj(&polyobjs[i], f);
+
+	for (auto &sec : level.sectors)
+	{
+		for (F3DFloor *ffloor : sec.e->XFloor.ffloors)
+		{
+			if ((ffloor->flags & (FF_EXISTS | FF_SOLID)) != (FF_EXISTS | FF_SOLID) || (ffloor->flags & FF_DYNAMIC)) continue;
+			P_AddSM64XFloor(ffloor, f);
+		}
+	}
+
 	// get Mario spawn coordinates
 	int spawnX = (int)players[consoleplayer].mo->X()*MARIO_SCALE;
 	int spawnY = (int)players[consoleplayer].mo->Z()*MARIO_SCALE;
@@ -4721,6 +5065,7 @@ void P_SetupLevel (const char *lumpname, int position)
 	{
 		surfaces[i].type = SURFACE_DEFAULT;
 		surfaces[i].force = 0;
+		surfaces[i].waterLevel = 0;
 		surfaces[i].terrain = TERRAIN_STONE;
 	}
 	
@@ -4846,7 +5191,7 @@ void P_SetupLevel (const char *lumpname, int position)
 	if (showloadtimes)
 	{
 		Printf ("---Total load times---\n");
-		for (i = 0; i < 18; ++i)
+		for (i = 0; i < 19; ++i)
 		{
 			static const char *timenames[] =
 			{
@@ -4867,7 +5212,8 @@ void P_SetupLevel (const char *lumpname, int position)
 				"load things",
 				"translate teleports",
 				"init polys",
-				"precache"
+				"precache",
+				"build sight pvs"
 			};
 			Printf ("Time%3d:%9.4f ms (%s)\n", i, times[i].TimeMS(), timenames[i]);
 		}
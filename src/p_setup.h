@@ -130,6 +130,7 @@ bool P_LoadGLNodes(MapData * map);
 bool P_CheckNodes(MapData * map, bool rebuilt, int buildtime);
 bool P_CheckForGLNodes();
 void P_SetRenderSector();
+void P_BuildSightPVS();
 
 
 struct sidei_t	// [RH] Only keep BOOM sidedef init stuff around for init
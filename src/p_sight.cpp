@@ -21,6 +21,8 @@
 //-----------------------------------------------------------------------------
 //
 #include <assert.h>
+#include <algorithm>
+#include <thread>
 
 #include "doomdef.h"
 #include "i_system.h"
@@ -36,6 +38,9 @@
 #include "b_bot.h"
 #include "p_spec.h"
 #include "vm.h"
+#include "d_player.h"
+#include "c_cvars.h"
+#include "parallel_for.h"
 
 // State.
 #include "r_state.h"
@@ -47,6 +52,12 @@
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
 
+// Computes the sight checks monsters are about to make on a worker pool before they get to think.
+// The results are only ever used if nothing relevant changed, so they are identical to the serial ones.
+CVAR(Bool, sv_sightprepass, false, CVAR_SERVERINFO)
+// Remembers the sight checks made this tic, for all the monsters checking the same player.
+CVAR(Bool, sv_sightcache, false, CVAR_SERVERINFO)
+
 /*
 ==============================================================================
 
@@ -94,11 +105,29 @@ struct SightTask
 };
 
 
-static TArray<intercept_t> intercepts (128);
-static TArray<SightTask> portals(32);
+// Everything a sight check writes to while tracing
+struct SightContext
+{
+	TArray<intercept_t> intercepts;
+	TArray<SightTask> portals;
+
+	// Worker threads may not touch the validcount markers in the level data, so they keep their own.
+	bool local = false;
+	int validcount = 0;
+	TArray<int> lineMarks;
+	TArray<int> polyMarks;
+
+	int *counts = sightcounts;
+	int localcounts[6];
+
+	SightContext() : intercepts(128), portals(32) { }
+};
+
+static SightContext MainSight;
 
 class SightCheck
 {
+	SightContext *ctx;
 	DVector3 sightstart;
 	DVector2 sightend;
 	double Startfrac;
@@ -122,7 +151,24 @@ class SightCheck
 	bool P_SightTraverseIntercepts ();
 	bool LineBlocksSight(line_t *ld);
 
+	int &LineMark(line_t *ld)
+	{
+		return ctx->local ? ctx->lineMarks[ld->Index()] : ld->validcount;
+	}
+
+	int &PolyMark(FPolyObj *poly)
+	{
+		return ctx->local ? ctx->polyMarks[int(poly - polyobjs)] : poly->validcount;
+	}
+
+	int CurrentValidCount() const
+	{
+		return ctx->local ? ctx->validcount : validcount;
+	}
+
 public:
+	SightCheck(SightContext *context) : ctx(context) { }
+
 	bool P_SightPathTraverse ();
 
 	void init(AActor * t1, AActor * t2, sector_t *startsector, SightTask *task, int flags)
@@ -277,16 +323,16 @@ bool SightCheck::PTR_SightTraverse (intercept_t *in)
 
 		if (portaldir != sector_t::floor && (open.portalflags & SO_TOPBACK) && !(open.portalflags & SO_TOPFRONT))
 		{
-			portals.Push({ in->frac, topslope, bottomslope, sector_t::ceiling, backsec->GetOppositePortalGroup(sector_t::ceiling) });
+			ctx->portals.Push({ in->frac, topslope, bottomslope, sector_t::ceiling, backsec->GetOppositePortalGroup(sector_t::ceiling) });
 		}
 		if (portaldir != sector_t::ceiling && (open.portalflags & SO_BOTTOMBACK) && !(open.portalflags & SO_BOTTOMFRONT))
 		{
-			portals.Push({ in->frac, topslope, bottomslope, sector_t::floor, backsec->GetOppositePortalGroup(sector_t::floor) });
+			ctx->portals.Push({ in->frac, topslope, bottomslope, sector_t::floor, backsec->GetOppositePortalGroup(sector_t::floor) });
 		}
 	}
 	if (lport != nullptr && lport->mDestination != nullptr)
 	{
-		portals.Push({ in->frac, topslope, bottomslope, portaldir, lport->mDestination->frontsector->PortalGroup });
+		ctx->portals.Push({ in->frac, topslope, bottomslope, portaldir, lport->mDestination->frontsector->PortalGroup });
 		return false;
 	}
 
@@ -432,11 +478,12 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 {
 	divline_t dl;
 
-	if (ld->validcount == validcount)
+	int &mark = LineMark(ld);
+	if (mark == CurrentValidCount())
 	{
 		return true;
 	}
-	ld->validcount = validcount;
+	mark = CurrentValidCount();
 	if (P_PointOnDivlineSide (ld->v1->fPos(), &Trace) ==
 		P_PointOnDivlineSide (ld->v2->fPos(), &Trace))
 	{
@@ -454,12 +501,12 @@ bool SightCheck::P_SightCheckLine (line_t *ld)
 		if (LineBlocksSight(ld)) return false;
 	}
 
-	sightcounts[3]++;
+	ctx->counts[3]++;
 	// store the line for later intersection testing
 	intercept_t newintercept;
 	newintercept.isaline = true;
 	newintercept.d.line = ld;
-	intercepts.Push (newintercept);
+	ctx->intercepts.Push (newintercept);
 
 	return true;
 }
@@ -494,9 +541,10 @@ int SightCheck::P_SightBlockLinesIterator (int x, int y)
 	{
 		if (polyLink->polyobj)
 		{ // only check non-empty links
-			if (polyLink->polyobj->validcount != validcount)
+			int &mark = PolyMark(polyLink->polyobj);
+			if (mark != CurrentValidCount())
 			{
-				polyLink->polyobj->validcount = validcount;
+				mark = CurrentValidCount();
 				for (i = 0; i < polyLink->polyobj->Linedefs.Size(); i++)
 				{
 					if (!P_SightCheckLine(polyLink->polyobj->Linedefs[i]))
@@ -539,6 +587,7 @@ bool SightCheck::P_SightTraverseIntercepts ()
 	unsigned scanpos;
 	divline_t dl;
 
+	TArray<intercept_t> &intercepts = ctx->intercepts;
 	count = intercepts.Size ();
 //
 // calculate intercept distance
@@ -626,8 +675,9 @@ bool SightCheck::P_SightPathTraverse ()
 	int mapx, mapy, mapxstep, mapystep;
 	int count;
 
-	validcount++;
-	intercepts.Clear ();
+	if (ctx->local) ctx->validcount++;
+	else validcount++;
+	ctx->intercepts.Clear ();
 	x1 = sightstart.X + Startfrac * Trace.dx;
 	y1 = sightstart.Y + Startfrac * Trace.dy;
 	x2 = sightend.X;
@@ -658,11 +708,11 @@ bool SightCheck::P_SightPathTraverse ()
 	// We also must check if the starting sector contains  portals, and start sight checks in those as well.
 	if (portaldir != sector_t::floor && checkceiling && !lastsector->PortalBlocksSight(sector_t::ceiling))
 	{
-		portals.Push({ 0, topslope, bottomslope, sector_t::ceiling, lastsector->GetOppositePortalGroup(sector_t::ceiling) });
+		ctx->portals.Push({ 0, topslope, bottomslope, sector_t::ceiling, lastsector->GetOppositePortalGroup(sector_t::ceiling) });
 	}
 	if (portaldir != sector_t::ceiling && checkfloor && !lastsector->PortalBlocksSight(sector_t::floor))
 	{
-		portals.Push({ 0, topslope, bottomslope, sector_t::floor, lastsector->GetOppositePortalGroup(sector_t::floor) });
+		ctx->portals.Push({ 0, topslope, bottomslope, sector_t::floor, lastsector->GetOppositePortalGroup(sector_t::floor) });
 	}
 
 	x1 -= level.blockmap.bmaporgx;
@@ -758,7 +808,7 @@ bool SightCheck::P_SightPathTraverse ()
 		itres = P_SightBlockLinesIterator(mapx, mapy);
 		if (itres == 0)
 		{
-			sightcounts[1]++;
+			ctx->counts[1]++;
 			return false;	// early out
 		}
 
@@ -769,7 +819,7 @@ bool SightCheck::P_SightPathTraverse ()
 		switch (((xs_FloorToInt(yintercept) == mapy) << 1) | (xs_FloorToInt(xintercept) == mapx))
 		{
 		case 0:		// neither xintercept nor yintercept match!
-sightcounts[5]++;
+ctx->counts[5]++;
 			// Continuing won't make things any better, so we might as well stop right here
 			count = 1000;
 			break;
@@ -789,7 +839,7 @@ sightcounts[5]++;
 			break;
 
 		case 3:		// xintercept and yintercept both match
-			sightcounts[4]++;
+			ctx->counts[4]++;
 			// The trace is exiting a block through its corner. Not only does the block
 			// being entered need to be checked (which will happen when this loop
 			// continues), but the other two blocks adjacent to the corner also need to
@@ -797,7 +847,7 @@ sightcounts[5]++;
 			if (!P_SightBlockLinesIterator (mapx + mapxstep, mapy) ||
 				!P_SightBlockLinesIterator (mapx, mapy + mapystep))
 			{
-sightcounts[1]++;
+ctx->counts[1]++;
 				return false;
 			}
 			xintercept += xstep;
@@ -816,7 +866,7 @@ sightcounts[1]++;
 //
 // couldn't early out, so go through the sorted list
 //
-sightcounts[2]++;
+ctx->counts[2]++;
 
 	bool traverseres = P_SightTraverseIntercepts ( );
 	if (itres == -1) return false;	// if the iterator had an early out there was no line of sight. The traverser was only called to collect more portals.
@@ -824,6 +874,350 @@ sightcounts[2]++;
 	return traverseres;
 }
 
+//==========================================================================
+//
+// P_SightTraverse
+//
+// The part of P_CheckSight that traces through the level. It only reads
+// from the level, so it can be run on any thread with its own context.
+//
+//==========================================================================
+
+static bool P_SightTraverse(SightContext *ctx, AActor *t1, AActor *t2, int flags)
+{
+	bool res;
+
+	if (ctx->local) ctx->validcount++;
+	else validcount++;
+	ctx->portals.Clear();
+
+	sector_t *sec;
+	double lookheight = t1->Z() + t1->Height*0.75;
+	t1->GetPortalTransition(lookheight, &sec);
+
+	double bottomslope = t2->Z() - lookheight;
+	double topslope = bottomslope + t2->Height;
+	SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
+
+
+	SightCheck s(ctx);
+	s.init(t1, t2, sec, &task, flags);
+	res = s.P_SightPathTraverse ();
+	if (!res)
+	{
+		double dist = t1->Distance2D(t2);
+		for (unsigned i = 0; i < ctx->portals.Size(); i++)
+		{
+			ctx->portals[i].Frac += 1 / dist;
+			s.init(t1, t2, NULL, &ctx->portals[i], flags);
+			if (s.P_SightPathTraverse())
+			{
+				res = true;
+				break;
+			}
+		}
+	}
+	return res;
+}
+
+//==========================================================================
+//
+// Cached sight checks
+//
+// A trace result stays valid as long as neither actor moves and the level
+// geometry doesn't change, so each cached result remembers where both
+// actors were. Anything that changes the level geometry or destroys one
+// of the actors throws all cached results away.
+//
+//==========================================================================
+
+// Only these flags affect the trace itself
+enum { SF_TRACEFLAGS = SF_SEEPASTSHOOTABLELINES | SF_SEEPASTBLOCKEVERYTHING | SF_IGNOREWATERBOUNDARY };
+
+struct SightCacheEntry
+{
+	AActor *t1, *t2;
+	int flags;
+	DVector3 pos1, pos2;
+	double height1, height2;
+	sector_t *sector1, *sector2;
+	unsigned epoch;
+	bool result;
+
+	void Set(AActor *a1, AActor *a2, int fl)
+	{
+		t1 = a1;
+		t2 = a2;
+		flags = fl & SF_TRACEFLAGS;
+		pos1 = a1->Pos();
+		pos2 = a2->Pos();
+		height1 = a1->Height;
+		height2 = a2->Height;
+		sector1 = a1->Sector;
+		sector2 = a2->Sector;
+	}
+
+	bool IsFor(AActor *a1, AActor *a2, int fl) const
+	{
+		return t1 == a1 && t2 == a2 && flags == (fl & SF_TRACEFLAGS);
+	}
+
+	bool IsCurrent() const
+	{
+		return t1->Pos() == pos1 && t2->Pos() == pos2 && t1->Height == height1 && t2->Height == height2 &&
+			t1->Sector == sector1 && t2->Sector == sector2;
+	}
+
+	bool operator<(const SightCacheEntry &other) const
+	{
+		if (t1 != other.t1) return uintptr_t(t1) < uintptr_t(other.t1);
+		if (t2 != other.t2) return uintptr_t(t2) < uintptr_t(other.t2);
+		return flags < other.flags;
+	}
+};
+
+static bool P_ActorLess(AActor *a, AActor *b)
+{
+	return uintptr_t(a) < uintptr_t(b);
+}
+
+static bool P_SightRejected(int pnum, const TArray<uint8_t> &matrix)
+{
+	return matrix.Size() > 0 && (matrix[pnum >> 3] & (1 << (pnum & 7)));
+}
+
+//==========================================================================
+//
+// Sight prepass
+//
+// Right before the monsters think, the sight checks they are likely to
+// make this tic are traced in parallel.
+//
+//==========================================================================
+
+static void P_ClearSightMemo();
+
+static TArray<SightCacheEntry> SightPrepassResults;
+static TArray<AActor *> SightPrepassActors;
+static TArray<SightContext *> SightWorkers;
+
+static void P_AddSightPrepass(AActor *t1, AActor *t2, int flags)
+{
+	int pnum = int(t1->Sector->Index()) * level.sectors.Size() + int(t2->Sector->Index());
+	if (P_SightRejected(pnum, level.rejectmatrix) || P_SightRejected(pnum, level.sightpvs))
+	{
+		return;	// P_CheckSight will not get as far as tracing
+	}
+
+	SightCacheEntry entry;
+	entry.Set(t1, t2, flags);
+	entry.epoch = 0;
+	entry.result = false;
+	SightPrepassResults.Push(entry);
+}
+void P_SightPrepass()
+{
+	P_ClearSightPrepass();
+	P_ClearSightMemo();	// a new tic starts
+	if (!sv_sightprepass)
+	{
+		return;
+	}
+
+	SightCycles.Clock();
+
+	// Collect the checks A_Look and A_Chase are going to make: the ones of monsters
+	// whose state runs out this tic, against their target or the players.
+	TThinkerIterator<AActor> it(STAT_DEFAULT);
+	AActor *actor;
+	while ((actor = it.Next()))
+	{
+		if (!(actor->flags3 & MF3_ISMONSTER) || (actor->flags2 & MF2_DORMANT) || actor->health <= 0 || actor->tics != 1)
+		{
+			continue;
+		}
+
+		if (actor->target != nullptr && actor->target->health > 0)
+		{
+			P_AddSightPrepass(actor, actor->target, 0);
+			P_AddSightPrepass(actor, actor->target, SF_SEEPASTBLOCKEVERYTHING);
+		}
+		else
+		{
+			for (int i = 0; i < MAXPLAYERS; i++)
+			{
+				if (playeringame[i] && players[i].mo != nullptr && players[i].health > 0)
+				{
+					P_AddSightPrepass(actor, players[i].mo, SF_SEEPASTSHOOTABLELINES);
+				}
+			}
+		}
+	}
+
+	if (SightPrepassResults.Size() == 0)
+	{
+		SightCycles.Unclock();
+		return;
+	}
+
+	int numWorkers = clamp((int)std::thread::hardware_concurrency(), 1, 16);
+	while ((int)SightWorkers.Size() < numWorkers)
+	{
+		SightContext *ctx = new SightContext;
+		ctx->local = true;
+		ctx->counts = ctx->localcounts;
+		SightWorkers.Push(ctx);
+	}
+	for (int i = 0; i < numWorkers; i++)
+	{
+		SightContext *ctx = SightWorkers[i];
+		if (ctx->lineMarks.Size() != level.lines.Size() || ctx->polyMarks.Size() != (unsigned)po_NumPolyobjs)
+		{
+			ctx->lineMarks.Resize(level.lines.Size());
+			ctx->polyMarks.Resize(po_NumPolyobjs);
+			for (auto &mark : ctx->lineMarks) mark = 0;
+			for (auto &mark : ctx->polyMarks) mark = 0;
+			ctx->validcount = 0;
+		}
+		memset(ctx->localcounts, 0, sizeof(ctx->localcounts));
+	}
+
+	unsigned count = SightPrepassResults.Size();
+	parallel_for(numWorkers, [=](int worker)
+	{
+		if (worker >= numWorkers) return;
+		SightContext *ctx = SightWorkers[worker];
+		for (unsigned i = worker; i < count; i += numWorkers)
+		{
+			SightCacheEntry &entry = SightPrepassResults[i];
+			entry.result = P_SightTraverse(ctx, entry.t1, entry.t2, entry.flags);
+		}
+	});
+
+	for (int i = 0; i < numWorkers; i++)
+	{
+		for (int j = 0; j < 6; j++)
+		{
+			sightcounts[j] += SightWorkers[i]->localcounts[j];
+		}
+	}
+
+	std::sort(&SightPrepassResults[0], &SightPrepassResults[0] + count);
+	for (auto &entry : SightPrepassResults)
+	{
+		SightPrepassActors.Push(entry.t1);
+		SightPrepassActors.Push(entry.t2);
+	}
+	std::sort(&SightPrepassActors[0], &SightPrepassActors[0] + SightPrepassActors.Size(), P_ActorLess);
+
+	SightCycles.Unclock();
+}
+
+void P_ClearSightPrepass()
+{
+	SightPrepassResults.Clear();
+	SightPrepassActors.Clear();
+}
+
+static bool P_GetSightPrepass(AActor *t1, AActor *t2, int flags, bool &result)
+{
+	if (SightPrepassResults.Size() == 0)
+	{
+		return false;
+	}
+
+	SightCacheEntry key;
+	key.t1 = t1;
+	key.t2 = t2;
+	key.flags = flags & SF_TRACEFLAGS;
+	auto end = &SightPrepassResults[0] + SightPrepassResults.Size();
+	auto entry = std::lower_bound(&SightPrepassResults[0], end, key);
+	if (entry == end || !entry->IsFor(t1, t2, flags) || !entry->IsCurrent())
+	{
+		return false;
+	}
+	result = entry->result;
+	return true;
+}
+
+//==========================================================================
+//
+// Sight memo
+//
+// A small direct mapped table of the traces made since the current tic
+// started. Entries from before the last invalidation are told apart by
+// their epoch.
+//
+//==========================================================================
+
+enum { SIGHTMEMO_SIZE = 4096 };
+
+static SightCacheEntry SightMemo[SIGHTMEMO_SIZE];
+static unsigned SightMemoEpoch = 1;
+static TMap<AActor *, bool> SightMemoActors;
+static int SightMemoHits, SightMemoMisses;
+
+static void P_ClearSightMemo()
+{
+	if (SightMemoActors.CountUsed() > 0)
+	{
+		SightMemoEpoch++;
+		SightMemoActors.Clear();
+	}
+}
+
+static SightCacheEntry &P_SightMemoSlot(AActor *t1, AActor *t2, int flags)
+{
+	uint32_t hash = uint32_t(uintptr_t(t1) >> 4) * 0x9E3779B1u ^ uint32_t(uintptr_t(t2) >> 4) * 0x85EBCA6Bu ^ uint32_t(flags & SF_TRACEFLAGS);
+	return SightMemo[(hash ^ (hash >> 16)) & (SIGHTMEMO_SIZE - 1)];
+}
+
+static bool P_GetSightMemo(AActor *t1, AActor *t2, int flags, bool &result)
+{
+	SightCacheEntry &entry = P_SightMemoSlot(t1, t2, flags);
+	if (entry.epoch != SightMemoEpoch || !entry.IsFor(t1, t2, flags) || !entry.IsCurrent())
+	{
+		SightMemoMisses++;
+		return false;
+	}
+	SightMemoHits++;
+	result = entry.result;
+	return true;
+}
+
+static void P_SetSightMemo(AActor *t1, AActor *t2, int flags, bool result)
+{
+	SightCacheEntry &entry = P_SightMemoSlot(t1, t2, flags);
+	entry.Set(t1, t2, flags);
+	entry.epoch = SightMemoEpoch;
+	entry.result = result;
+	SightMemoActors[t1] = true;
+	SightMemoActors[t2] = true;
+}
+
+// Called where the game changes what a sight check may see: movers, polyobjects,
+// line specials and the native functions that change lines or sectors. Scripts
+// writing to line or sector fields directly are not tracked, but the memo only
+// holds results for the current tic.
+void P_SightGeometryChanged()
+{
+	P_ClearSightPrepass();
+	P_ClearSightMemo();
+}
+
+void P_SightForget(AActor *actor)
+{
+	// The memory may get reused by another actor before the tic is over.
+	if (SightPrepassActors.Size() > 0 && std::binary_search(&SightPrepassActors[0], &SightPrepassActors[0] + SightPrepassActors.Size(), actor, P_ActorLess))
+	{
+		P_ClearSightPrepass();
+	}
+	if (SightMemoActors.CheckKey(actor) != nullptr)
+	{
+		P_ClearSightMemo();
+	}
+}
+
 /*
 =====================
 =
@@ -857,8 +1251,7 @@ bool P_CheckSight (AActor *t1, AActor *t2, int flags)
 //
 // check for trivial rejection
 //
-	if (level.rejectmatrix.Size() > 0 &&
-		(level.rejectmatrix[pnum>>3] & (1 << (pnum & 7))))
+	if (P_SightRejected(pnum, level.rejectmatrix))
 	{
 sightcounts[0]++;
 		res = false;			// can't possibly be connected
@@ -903,34 +1296,25 @@ sightcounts[0]++;
 	// An unobstructed LOS is possible.
 	// Now look from eyes of t1 to any part of t2.
 
-	validcount++;
-	portals.Clear();
+	// The generated PVS comes after the visibility check so it doesn't change the RNG calls from
+	// what they'd be without it.
+	if (P_SightRejected(pnum, level.sightpvs))
 	{
-		sector_t *sec;
-		double lookheight = t1->Z() + t1->Height*0.75;
-		t1->GetPortalTransition(lookheight, &sec);
-
-		double bottomslope = t2->Z() - lookheight;
-		double topslope = bottomslope + t2->Height;
-		SightTask task = { 0, topslope, bottomslope, -1, sec->PortalGroup };
-
+sightcounts[0]++;
+		res = false;
+		goto done;
+	}
 
-		SightCheck s;
-		s.init(t1, t2, sec, &task, flags);
-		res = s.P_SightPathTraverse ();
-		if (!res)
+	if (!P_GetSightPrepass(t1, t2, flags, res))
+	{
+		if (!sv_sightcache)
 		{
-			double dist = t1->Distance2D(t2);
-			for (unsigned i = 0; i < portals.Size(); i++)
-			{
-				portals[i].Frac += 1 / dist;
-				s.init(t1, t2, NULL, &portals[i], flags);
-				if (s.P_SightPathTraverse())
-				{
-					res = true;
-					break;
-				}
-			}
+			res = P_SightTraverse(&MainSight, t1, t2, flags);
+		}
+		else if (!P_GetSightMemo(t1, t2, flags, res))
+		{
+			res = P_SightTraverse(&MainSight, t1, t2, flags);
+			P_SetSightMemo(t1, t2, flags, res);
 		}
 	}
 
@@ -939,20 +1323,28 @@ done:
 	return res;
 }
 
-DEFINE_ACTION_FUNCTION(AActor, CheckSight)
+static int CheckSightNative(AActor *self, AActor *target, int flags)
+{
+	if (self == nullptr) NullParam("self");
+	if (target == nullptr) NullParam("target");
+	return P_CheckSight(self, target, flags);
+}
+
+DEFINE_ACTION_FUNCTION_NATIVE(AActor, CheckSight, CheckSightNative)
 {
 	PARAM_SELF_PROLOGUE(AActor);
 	PARAM_OBJECT_NOT_NULL(target, AActor);
 	PARAM_INT_DEF(flags);
-	ACTION_RETURN_BOOL(P_CheckSight(self, target, flags));
+	ACTION_RETURN_BOOL(CheckSightNative(self, target, flags));
 }
 
 ADD_STAT (sight)
 {
 	FString out;
-	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d\n",
+	out.Format ("%04.1f ms (%04.1f max), %5d %2d%4d%4d%4d%4d, cache %d/%d\n",
 		SightCycles.TimeMS(), MaxSightCycles.TimeMS(),
-		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5]);
+		sightcounts[3], sightcounts[0], sightcounts[1], sightcounts[2], sightcounts[4], sightcounts[5],
+		SightMemoHits, SightMemoHits + SightMemoMisses);
 	return out;
 }
 
@@ -968,4 +1360,5 @@ void P_ResetSightCounters (bool full)
 	}
 	SightCycles.Reset();
 	memset (sightcounts, 0, sizeof(sightcounts));
+	SightMemoHits = SightMemoMisses = 0;
 }
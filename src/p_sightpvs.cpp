@@ -0,0 +1,342 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Sector to sector potentially visible set for sight checks.
+//
+//		Most maps either come without a REJECT lump or with an empty one,
+//		so P_CheckSight has to trace every pair of actors. This builds a
+//		replacement from the GL nodes by flowing through the subsector
+//		boundaries, the same way a Quake style vis does. It ignores
+//		heights and all line flags, so it only ever rules out sector pairs
+//		no straight line can connect.
+//
+//-----------------------------------------------------------------------------
+
+#include "doomdef.h"
+#include "g_levellocals.h"
+#include "p_local.h"
+#include "p_setup.h"
+#include "po_man.h"
+#include "portal.h"
+#include "r_state.h"
+#include "c_cvars.h"
+#include "parallel_for.h"
+
+CVAR(Bool, sv_sightpvs, false, CVAR_SERVERINFO)
+
+// Distance in map units a portal may be outside a separator and still count as visible.
+// Keeps rounding errors on the safe side.
+static const double PVS_SLACK = 1. / 16;
+
+// Past these limits a sector just gets everything it is connected to.
+static const int PVS_MAXSTEPS = 1 << 15;
+static const int PVS_MAXDEPTH = 512;
+
+struct FPVSPortal
+{
+	DVector2 v1, v2;	// the subsector it leads out of is on the right side
+	int target;			// subsector it leads into
+};
+
+class FSightPVSBuilder
+{
+public:
+	bool Init();
+	void BuildRow(int sectornum, uint8_t *row);
+
+private:
+	struct FFlow
+	{
+		uint8_t *row;
+		TArray<uint8_t> onpath;
+		int steps;
+		bool overflow;
+	};
+
+	void Flow(FFlow &flow, const DVector2 &s1, const DVector2 &s2, const DVector2 &p1, const DVector2 &p2, int sub, int depth);
+	void Flood(uint8_t *row, int sectornum);
+
+	void Mark(uint8_t *row, int sub)
+	{
+		int sectornum = SubsectorSector[sub];
+		row[sectornum >> 3] |= 1 << (sectornum & 7);
+	}
+
+	TArray<FPVSPortal> Portals;
+	TArray<int> FirstPortal;		// per subsector, plus one for the end
+	TArray<int> SubsectorSector;
+	TArray<TArray<int>> SectorSubsectors;
+};
+
+//==========================================================================
+//
+// Clips a to b to the left (side > 0) or right (side < 0) of the line
+// through o in direction d. Returns false if nothing is left.
+//
+//==========================================================================
+
+static bool PVS_Clip(DVector2 &a, DVector2 &b, const DVector2 &o, const DVector2 &d, double side)
+{
+	double len = d.Length();
+	if (len < PVS_SLACK)
+	{
+		return true;	// the separator is degenerate and can't clip anything
+	}
+
+	double fa = side * (d.X * (a.Y - o.Y) - d.Y * (a.X - o.X)) / len + PVS_SLACK;
+	double fb = side * (d.X * (b.Y - o.Y) - d.Y * (b.X - o.X)) / len + PVS_SLACK;
+
+	if (fa < 0 && fb < 0) return false;
+	if (fa >= 0 && fb >= 0) return true;
+
+	DVector2 cut = a + (b - a) * (fa / (fa - fb));
+	if (fa < 0) a = cut;
+	else b = cut;
+	return true;
+}
+
+//==========================================================================
+//
+// Collects the subsector boundaries a sight line can cross.
+// Returns false if the nodes can't be trusted for this.
+//
+//==========================================================================
+
+bool FSightPVSBuilder::Init()
+{
+	unsigned numsubsectors = level.subsectors.Size();
+
+	FirstPortal.Resize(numsubsectors + 1);
+	SubsectorSector.Resize(numsubsectors);
+	SectorSubsectors.Resize(level.sectors.Size());
+
+	for (unsigned i = 0; i < numsubsectors; i++)
+	{
+		subsector_t *sub = &level.subsectors[i];
+		SubsectorSector[i] = sub->sector->Index();
+		SectorSubsectors[SubsectorSector[i]].Push(i);
+		FirstPortal[i] = Portals.Size();
+
+		double cx = 0, cy = 0;
+		for (uint32_t j = 0; j < sub->numlines; j++)
+		{
+			seg_t *seg = &sub->firstline[j];
+			cx += seg->v1->fX();
+			cy += seg->v1->fY();
+
+			if (seg->PartnerSeg == nullptr || seg->PartnerSeg->Subsector == nullptr)
+			{
+				// A missing partner is only fine on a one-sided line.
+				if (seg->linedef == nullptr || seg->linedef->backsector != nullptr) return false;
+				continue;
+			}
+			Portals.Push({ seg->v1->fPos(), seg->v2->fPos(), seg->PartnerSeg->Subsector->Index() });
+		}
+
+		// Actors are sorted into sectors with the gameplay nodes, which may disagree
+		// with the GL nodes on maps that depend on their original node build.
+		if (sub->numlines > 0 && P_PointInSector(cx / sub->numlines, cy / sub->numlines) != sub->sector)
+		{
+			return false;
+		}
+	}
+	FirstPortal[numsubsectors] = Portals.Size();
+	return true;
+}
+
+//==========================================================================
+//
+// Recursively follows all portals that can be seen through the source
+// portal s1-s2 and the current pass portal p1-p2.
+//
+//==========================================================================
+
+void FSightPVSBuilder::Flow(FFlow &flow, const DVector2 &s1, const DVector2 &s2, const DVector2 &p1, const DVector2 &p2, int sub, int depth)
+{
+	for (int i = FirstPortal[sub]; i < FirstPortal[sub + 1]; i++)
+	{
+		const FPVSPortal &portal = Portals[i];
+		if (flow.onpath[portal.target])
+		{
+			continue;
+		}
+
+		// Everything seen through both portals lies between the lines connecting their opposite ends.
+		DVector2 t1 = portal.v1, t2 = portal.v2;
+		if (!PVS_Clip(t1, t2, s1, p2 - s1, 1) || !PVS_Clip(t1, t2, s2, p1 - s2, -1))
+		{
+			continue;
+		}
+
+		Mark(flow.row, portal.target);
+
+		if (++flow.steps > PVS_MAXSTEPS || depth >= PVS_MAXDEPTH)
+		{
+			flow.overflow = true;
+			return;
+		}
+
+		flow.onpath[portal.target] = true;
+		Flow(flow, s1, s2, t1, t2, portal.target, depth + 1);
+		flow.onpath[portal.target] = false;
+		if (flow.overflow)
+		{
+			return;
+		}
+	}
+}
+
+//==========================================================================
+//
+// Fallback for sectors that take too long: everything they connect to
+//
+//==========================================================================
+
+void FSightPVSBuilder::Flood(uint8_t *row, int sectornum)
+{
+	TArray<uint8_t> visited;
+	TArray<int> stack;
+
+	visited.Resize(SubsectorSector.Size());
+	for (auto &v : visited) v = false;
+
+	for (int sub : SectorSubsectors[sectornum])
+	{
+		visited[sub] = true;
+		stack.Push(sub);
+	}
+
+	int sub;
+	while (stack.Pop(sub))
+	{
+		Mark(row, sub);
+		for (int i = FirstPortal[sub]; i < FirstPortal[sub + 1]; i++)
+		{
+			int target = Portals[i].target;
+			if (!visited[target])
+			{
+				visited[target] = true;
+				stack.Push(target);
+			}
+		}
+	}
+}
+
+//==========================================================================
+//
+// Sets a bit in row for every sector visible from sectornum
+//
+//==========================================================================
+
+void FSightPVSBuilder::BuildRow(int sectornum, uint8_t *row)
+{
+	FFlow flow;
+	flow.row = row;
+	flow.steps = 0;
+	flow.overflow = false;
+	flow.onpath.Resize(SubsectorSector.Size());
+	for (auto &p : flow.onpath) p = false;
+
+	row[sectornum >> 3] |= 1 << (sectornum & 7);
+
+	for (int sub : SectorSubsectors[sectornum])
+	{
+		flow.onpath[sub] = true;
+		for (int i = FirstPortal[sub]; i < FirstPortal[sub + 1] && !flow.overflow; i++)
+		{
+			const FPVSPortal &portal = Portals[i];
+			Mark(row, portal.target);
+			if (flow.onpath[portal.target])
+			{
+				continue;
+			}
+
+			flow.onpath[portal.target] = true;
+			Flow(flow, portal.v1, portal.v2, portal.v1, portal.v2, portal.target, 1);
+			flow.onpath[portal.target] = false;
+		}
+		flow.onpath[sub] = false;
+
+		if (flow.overflow)
+		{
+			Flood(row, sectornum);
+			return;
+		}
+	}
+}
+
+//==========================================================================
+//
+// P_BuildSightPVS
+//
+// Creates level.sightpvs in the same layout as the reject matrix.
+//
+//==========================================================================
+
+void P_BuildSightPVS()
+{
+	level.sightpvs.Reset();
+
+	// A REJECT lump that is there gets used as is.
+	if (!sv_sightpvs || !hasglnodes || level.rejectmatrix.Size() > 0)
+	{
+		return;
+	}
+
+	// Polyobjects and portals move or teleport sight lines in ways the subsectors don't show.
+	if (po_NumPolyobjs > 0 || linePortals.Size() > 0 || Displacements.size > 1)
+	{
+		return;
+	}
+
+	FSightPVSBuilder builder;
+	if (!builder.Init())
+	{
+		DPrintf(DMSG_NOTIFY, "Nodes not usable for a sight PVS\n");
+		return;
+	}
+
+	int numsectors = level.sectors.Size();
+	int rowbytes = (numsectors + 7) >> 3;
+	TArray<uint8_t> rows;
+	rows.Resize(numsectors * rowbytes);
+	memset(&rows[0], 0, rows.Size());
+
+	parallel_for(numsectors, [&](int sectornum)
+	{
+		if (sectornum < numsectors)
+		{
+			builder.BuildRow(sectornum, &rows[sectornum * rowbytes]);
+		}
+	});
+
+	// Same meaning as the reject matrix: a set bit means the sectors can't see each other.
+	level.sightpvs.Resize((numsectors * numsectors + 7) >> 3);
+	memset(&level.sightpvs[0], 0, level.sightpvs.Size());
+	for (int i = 0; i < numsectors; i++)
+	{
+		for (int j = 0; j < numsectors; j++)
+		{
+			if (!(rows[i * rowbytes + (j >> 3)] & (1 << (j & 7))))
+			{
+				int pnum = i * numsectors + j;
+				level.sightpvs[pnum >> 3] |= 1 << (pnum & 7);
+			}
+		}
+	}
+}
@@ -489,6 +489,7 @@ void P_Thing_SetVelocity(AActor *actor, const DVector3 &vec, bool add, bool setb
 {
 	if (actor != NULL)
 	{
+		actor->StopSleeping();
 		if (!add)
 		{
 			actor->Vel.Zero();
@@ -906,6 +907,7 @@ int P_Thing_Warp(AActor *caller, AActor *reference, double xofs, double yofs, do
 			
 			if (flags & WARPF_COPYVELOCITY)
 			{
+				caller->StopSleeping();
 				caller->Vel = reference->Vel;
 			}
 			if (flags & WARPF_STOP)
@@ -41,6 +41,8 @@
 #include "g_levellocals.h"
 #include "events.h"
 #include "actorinlines.h"
+#include "a_dynlight.h"
+#include "p_maputl.h"
 
 extern gamestate_t wipegamestate;
 
@@ -118,6 +120,7 @@ void P_Ticker (void)
 		S_ResumeSound (false);
 
 	P_ResetSightCounters (false);
+	FRadiusThingsIterator::ResetStats();
 	R_ClearInterpolationPath();
 
 	// Reset all actor interpolations for all actors before the current thinking turn so that indirect actor movement gets properly interpolated.
@@ -143,7 +146,9 @@ void P_Ticker (void)
 	E_WorldTick();
 	StatusBar->CallTick ();		// [RH] moved this here
 	level.Tick ();			// [RH] let the level tick
+	ADynamicLight::BeginLinkBatch();
 	DThinker::RunThinkers ();
+	ADynamicLight::FinishLinkBatch();
 
 	//if added by MC: Freeze mode.
 	if (!bglobal.freeze && !(level.flags2 & LEVEL2_FROZEN))
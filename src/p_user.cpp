@@ -141,6 +141,7 @@ static int PredictionLerptics;
 static player_t PredictionPlayerBackup;
 static uint8_t PredictionActorBackup[sizeof(APlayerPawn)];
 static TArray<AActor *> PredictionSectorListBackup;
+static TArray<FBlockNode *> PredictionBlockNodesBackup;
 
 static TArray<sector_t *> PredictionTouchingSectorsBackup;
 static TArray<msecnode_t *> PredictionTouchingSectors_sprev_Backup;
@@ -2491,6 +2492,7 @@ void P_PredictPlayer (player_t *player)
 	// without releasing them. (They will be used again in P_UnpredictPlayer).
 	FBlockNode *block = act->BlockNode;
 
+	PredictionBlockNodesBackup.Clear();
 	while (block != NULL)
 	{
 		if (block->NextActor != NULL)
@@ -2498,6 +2500,8 @@ void P_PredictPlayer (player_t *player)
 			block->NextActor->PrevActor = block->PrevActor;
 		}
 		*(block->PrevActor) = block->NextActor;
+		level.blockmap.UnlinkThing(block);
+		PredictionBlockNodesBackup.Push(block);
 		block = block->NextBlock;
 	}
 	act->BlockNode = NULL;
@@ -2589,7 +2593,10 @@ void P_UnPredictPlayer ()
 		act->touching_lineportallist = nullptr;
 
 		act->UnlinkFromWorld(&ctx);
+		// The line cache may have been replaced or freed during prediction. What it holds is still valid.
+		auto secnodecache = act->secnodecache;
 		memcpy(&act->snext, PredictionActorBackup, sizeof(APlayerPawn) - ((uint8_t *)&act->snext - (uint8_t *)act));
+		act->secnodecache = secnodecache;
 
 		// The blockmap ordering needs to remain unchanged, too.
 		// Restore sector links and refrences.
@@ -2635,6 +2642,12 @@ void P_UnPredictPlayer ()
 			block = block->NextBlock;
 		}
 
+		// and put them back where they were in the blocks' things arrays.
+		for (unsigned i = PredictionBlockNodesBackup.Size(); i-- > 0;)
+		{
+			level.blockmap.RelinkThing(PredictionBlockNodesBackup[i]);
+		}
+
 		act->InvSel = InvSel;
 		player->inventorytics = inventorytics;
 	}
@@ -864,6 +864,7 @@ void FPolyObj::ThrustMobj (AActor *actor, side_t *side)
 	}
 
 	DVector2 thrust = thrustAngle.ToVector(force);
+	actor->StopSleeping();
 	actor->Vel += thrust;
 
 	if (crush)
@@ -968,6 +969,8 @@ bool FPolyObj::MovePolyobj (const DVector2 &pos, bool force)
 	LinkPolyobj ();
 	ClearSubsectorLinks();
 	RecalcActorFloorCeil(Bounds | oldbounds);
+	P_SM64PolyobjMoved(this);
+	P_SightGeometryChanged();
 	return true;
 }
 
@@ -1062,6 +1065,8 @@ bool FPolyObj::RotatePolyobj (DAngle angle, bool fromsave)
 	LinkPolyobj();
 	ClearSubsectorLinks();
 	RecalcActorFloorCeil(Bounds | oldbounds);
+	P_SM64PolyobjMoved(this);
+	P_SightGeometryChanged();
 	return true;
 }
 
@@ -1077,6 +1082,8 @@ void FPolyObj::UnLinkPolyobj ()
 	int i, j;
 	int index;
 
+	level.blockmap.LinesChanged();
+
 	// remove the polyobj from each blockmap section
 	for(j = bbox[BOXBOTTOM]; j <= bbox[BOXTOP]; j++)
 	{
@@ -1246,6 +1253,8 @@ void FPolyObj::LinkPolyobj ()
 	int bmapwidth = level.blockmap.bmapwidth;
 	int bmapheight = level.blockmap.bmapheight;
 
+	level.blockmap.LinesChanged();
+
 	// calculate the polyobj bbox
 	Bounds.ClearBox();
 	for(unsigned i = 0; i < Sidedefs.Size(); i++)
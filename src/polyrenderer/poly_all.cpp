@@ -17,3 +17,4 @@
 #include "scene/poly_wall.cpp"
 #include "scene/poly_wallsprite.cpp"
 #include "scene/poly_light.cpp"
+#include "scene/poly_mario.cpp"
@@ -34,6 +34,7 @@
 #include "g_levellocals.h"
 #include "p_effect.h"
 #include "polyrenderer/scene/poly_light.h"
+#include "polyrenderer/scene/poly_mario.h"
 #include "swrenderer/scene/r_scene.h"
 #include "swrenderer/drawers/r_draw_rgba.h"
 #include "swrenderer/viewport/r_viewport.h"
@@ -137,6 +138,7 @@ void PolyRenderer::RenderActorView(AActor *actor, bool dontmaplines)
 	ClearBuffers();
 	SetSceneViewport();
 	SetupPerspectiveMatrix();
+	RenderPolyMario::Prepare();
 	MainPortal.SetViewpoint(WorldToClip, PolyClipPlane(0.0f, 0.0f, 0.0f, 1.0f), GetNextStencilValue());
 	MainPortal.Render(0);
 	Skydome.Render(Threads.MainThread(), WorldToClip);
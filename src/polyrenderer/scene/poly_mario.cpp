@@ -0,0 +1,239 @@
+// SM64 additions
+
+#include <stdlib.h>
+#include "templates.h"
+#include "doomdef.h"
+#include "d_player.h"
+#include "doomstat.h"
+#include "v_video.h"
+#include "v_palette.h"
+#include "polyrenderer/poly_renderer.h"
+#include "poly_mario.h"
+#include "polyrenderer/scene/poly_light.h"
+#include "polyrenderer/poly_renderthread.h"
+#include "swrenderer/r_swcolormaps.h"
+
+uint32_t RenderPolyMario::SlotColors[MaxColorSlots];
+int RenderPolyMario::NumSlots = 0;
+uint32_t RenderPolyMario::AtlasBgra[SlotWidth * AtlasHeight];
+uint8_t RenderPolyMario::AtlasPal[SlotWidth * AtlasHeight];
+const uint8_t *RenderPolyMario::BakedTexture;
+PalEntry RenderPolyMario::BakedPalette[256];
+
+bool RenderPolyMario::IsMario(AActor *thing)
+{
+	return thing->player && thing->player->mo == thing && thing->player->marioInstance;
+}
+
+void RenderPolyMario::Render(PolyRenderThread *thread, const TriMatrix &worldToClip, const PolyClipPlane &clipPlane, AActor *thing, subsector_t *sub, uint32_t stencilValue)
+{
+	MarioInstance *mario = thing->player->marioInstance;
+	if (mario->first < 2 || MarioGlobal::texture == nullptr)
+		return;
+
+	const SM64MarioGeometryBuffers &geometry = mario->geometry;
+	int numTriangles = geometry.numTrianglesUsed;
+	if (numTriangles <= 0)
+		return;
+
+	const auto &viewpoint = PolyRenderer::Instance()->Viewpoint;
+
+	// Same light as the GL shader: a fixed (1,1,1) direction in view space
+	FVector3 lightDir((float)(viewpoint.Sin - viewpoint.Cos), (float)(-viewpoint.Cos - viewpoint.Sin), 1.0f);
+	lightDir.MakeUnit();
+
+	// The drawers only know one light level per draw call, so triangles get sorted into a few shade levels
+	uint8_t *shadeLevels = thread->FrameMemory->AllocMemory<uint8_t>(numTriangles);
+	uint8_t *colorSlots = thread->FrameMemory->AllocMemory<uint8_t>(numTriangles);
+	int levelCounts[NumShadeLevels] = { 0 };
+
+	for (int i = 0; i < numTriangles; i++)
+	{
+		// positions and normals are stored as (x, z, y) for the GL renderer
+		const float *n = &geometry.normal[i * 9];
+		float nx = n[0] + n[3] + n[6];
+		float ny = n[2] + n[5] + n[8];
+		float nz = n[1] + n[4] + n[7];
+		float len = sqrtf(nx * nx + ny * ny + nz * nz);
+		float lambert = (len > 0.0f) ? clamp((nx * lightDir.X + ny * lightDir.Y + nz * lightDir.Z) / len, 0.0f, 1.0f) : 0.0f;
+
+		int level = (int)(lambert * (NumShadeLevels - 1) + 0.5f);
+		shadeLevels[i] = level;
+		colorSlots[i] = FindColorSlot(GetColorRGB(&geometry.color[i * 9]));
+		levelCounts[level]++;
+	}
+
+	bool foggy = false;
+	int actualextralight = foggy ? 0 : viewpoint.extralight << 4;
+	int lightlevel = thing->Sector->lightlevel + actualextralight;
+	bool bgra = PolyRenderer::Instance()->RenderTarget->IsBgra();
+
+	for (int level = 0; level < NumShadeLevels; level++)
+	{
+		if (levelCounts[level] == 0)
+			continue;
+
+		TriVertex *vertices = thread->FrameMemory->AllocMemory<TriVertex>(levelCounts[level] * 3);
+		TriVertex *vertex = vertices;
+
+		for (int i = 0; i < numTriangles; i++)
+		{
+			if (shadeLevels[i] != level)
+				continue;
+
+			float slotTop = (float)(colorSlots[i] * SlotHeight);
+			for (int j = 0; j < 3; j++)
+			{
+				const float *p = &geometry.position[(i * 3 + j) * 3];
+				const float *uv = &geometry.uv[(i * 3 + j) * 2];
+
+				float u, v;
+				if (uv[0] >= 1.0f && uv[1] >= 1.0f)
+				{
+					// untextured triangle, GL samples the clamped bottom right texel
+					u = SlotWidth - 0.5f;
+					v = SlotHeight - 0.5f;
+				}
+				else
+				{
+					u = clamp(uv[0] * SlotWidth, 0.5f, SlotWidth - 0.5f);
+					v = clamp(uv[1] * SlotHeight, 0.5f, SlotHeight - 0.5f);
+				}
+
+				vertex->x = p[0];
+				vertex->y = p[2];
+				vertex->z = p[1];
+				vertex->w = 1.0f;
+				vertex->u = u / SlotWidth;
+				vertex->v = (slotTop + v) / AtlasHeight;
+				vertex++;
+			}
+		}
+
+		float shade = 0.5f + 0.5f * level / (NumShadeLevels - 1);
+
+		PolyDrawArgs args;
+		args.SetLight(GetColorTable(sub->sector->Colormap, sub->sector->SpecialColors[sector_t::sprites], true), (int)(lightlevel * shade), PolyRenderer::Instance()->Light.SpriteGlobVis(foggy), false);
+		args.SetTransform(&worldToClip);
+		args.SetFaceCullCCW(false);
+		args.SetStencilTestValue(stencilValue);
+		args.SetWriteStencil(false);
+		args.SetClipPlane(0, clipPlane);
+		args.SetTexture(bgra ? (const uint8_t *)AtlasBgra : AtlasPal, SlotWidth, AtlasHeight);
+		args.SetStyle(TriBlendMode::TextureOpaque);
+		args.SetDepthTest(true);
+		args.SetWriteDepth(true);
+		args.DrawArray(thread, vertices, levelCounts[level] * 3, PolyDrawMode::Triangles);
+	}
+}
+
+void RenderPolyMario::Prepare()
+{
+	if (MarioGlobal::texture == nullptr)
+		return;
+
+	// The paletted atlas depends on the palette, and everything on the texture.
+	if (BakedTexture != MarioGlobal::texture)
+	{
+		BakedTexture = MarioGlobal::texture;
+		NumSlots = 0;
+	}
+	else if (memcmp(BakedPalette, GPalette.BaseColors, sizeof(BakedPalette)) != 0)
+	{
+		for (int i = 0; i < NumSlots; i++)
+		{
+			BakeColorSlot(i, SlotColors[i]);
+		}
+	}
+	memcpy(BakedPalette, GPalette.BaseColors, sizeof(BakedPalette));
+
+	for (int p = 0; p < MAXPLAYERS; p++)
+	{
+		if (!playeringame[p] || players[p].mo == nullptr || !IsMario(players[p].mo))
+			continue;
+
+		MarioInstance *mario = players[p].marioInstance;
+		if (mario->first < 2)
+			continue;
+
+		const SM64MarioGeometryBuffers &geometry = mario->geometry;
+		for (int i = 0; i < geometry.numTrianglesUsed && NumSlots < MaxColorSlots; i++)
+		{
+			AddColorSlot(GetColorRGB(&geometry.color[i * 9]));
+		}
+	}
+}
+
+uint32_t RenderPolyMario::GetColorRGB(const float *color)
+{
+	int r = clamp((int)(color[0] * 255.0f + 0.5f), 0, 255);
+	int g = clamp((int)(color[1] * 255.0f + 0.5f), 0, 255);
+	int b = clamp((int)(color[2] * 255.0f + 0.5f), 0, 255);
+	return MAKERGB(r, g, b);
+}
+
+void RenderPolyMario::AddColorSlot(uint32_t rgb)
+{
+	for (int i = 0; i < NumSlots; i++)
+	{
+		if (SlotColors[i] == rgb)
+			return;
+	}
+	BakeColorSlot(NumSlots, rgb);
+	SlotColors[NumSlots++] = rgb;
+}
+
+int RenderPolyMario::FindColorSlot(uint32_t rgb)
+{
+	for (int i = 0; i < NumSlots; i++)
+	{
+		if (SlotColors[i] == rgb)
+			return i;
+	}
+
+	// Out of slots. Mario only uses a handful of colors, so settle for the closest one.
+	int r = RPART(rgb);
+	int g = GPART(rgb);
+	int b = BPART(rgb);
+	int best = 0;
+	int bestDist = INT_MAX;
+	for (int i = 0; i < NumSlots; i++)
+	{
+		int dr = RPART(SlotColors[i]) - r;
+		int dg = GPART(SlotColors[i]) - g;
+		int db = BPART(SlotColors[i]) - b;
+		int dist = dr * dr + dg * dg + db * db;
+		if (dist < bestDist)
+		{
+			best = i;
+			bestDist = dist;
+		}
+	}
+	return best;
+}
+
+void RenderPolyMario::BakeColorSlot(int slot, uint32_t rgb)
+{
+	// The GL shader mixes the vertex color with the texture by its alpha.
+	// Bake that mix for each vertex color into its own copy of the texture.
+	int cr = RPART(rgb);
+	int cg = GPART(rgb);
+	int cb = BPART(rgb);
+
+	for (int y = 0; y < SlotHeight; y++)
+	{
+		for (int x = 0; x < SlotWidth; x++)
+		{
+			const uint8_t *texel = &MarioGlobal::texture[(y * SlotWidth + x) * 4];
+			int a = texel[3];
+			int r = (cr * (255 - a) + texel[0] * a) / 255;
+			int g = (cg * (255 - a) + texel[1] * a) / 255;
+			int b = (cb * (255 - a) + texel[2] * a) / 255;
+
+			// the drawers read textures column by column
+			int index = x * AtlasHeight + slot * SlotHeight + y;
+			AtlasBgra[index] = MAKEARGB(255, r, g, b);
+			AtlasPal[index] = RGB256k.All[((r >> 2) << 12) | ((g >> 2) << 6) | (b >> 2)];
+		}
+	}
+}
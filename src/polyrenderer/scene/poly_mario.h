@@ -0,0 +1,57 @@
+// SM64 additions
+
+#pragma once
+
+#include "polyrenderer/drawers/poly_triangle.h"
+#include "d_mario.h"
+
+// Draws the SM64 Mario mesh with the poly triangle drawers, so he shows up without the GL renderer
+class RenderPolyMario
+{
+public:
+	void Render(PolyRenderThread *thread, const TriMatrix &worldToClip, const PolyClipPlane &clipPlane, AActor *thing, subsector_t *sub, uint32_t stencilValue);
+
+	static bool IsMario(AActor *thing);
+
+	// Bakes the texture for new vertex colors and after palette changes.
+	// Render only reads the baked slots, so this must run on the main thread before the scene is drawn.
+	static void Prepare();
+
+private:
+	static uint32_t GetColorRGB(const float *color);
+	static int FindColorSlot(uint32_t rgb);
+	static void AddColorSlot(uint32_t rgb);
+	static void BakeColorSlot(int slot, uint32_t rgb);
+
+	enum
+	{
+		NumShadeLevels = 8,
+		MaxColorSlots = 16,
+		SlotWidth = SM64_TEXTURE_WIDTH,
+		SlotHeight = SM64_TEXTURE_HEIGHT,
+		AtlasHeight = SlotHeight * MaxColorSlots
+	};
+
+	static uint32_t SlotColors[MaxColorSlots];
+	static int NumSlots;
+	static uint32_t AtlasBgra[SlotWidth * AtlasHeight];
+	static uint8_t AtlasPal[SlotWidth * AtlasHeight];
+	static const uint8_t *BakedTexture;
+	static PalEntry BakedPalette[256];
+};
+
+class PolyTranslucentMario : public PolyTranslucentObject
+{
+public:
+	PolyTranslucentMario(AActor *thing, subsector_t *sub, uint32_t subsectorDepth, double dist, uint32_t stencilValue) : PolyTranslucentObject(subsectorDepth, dist), thing(thing), sub(sub), StencilValue(stencilValue) { }
+
+	void Render(PolyRenderThread *thread, const TriMatrix &worldToClip, const PolyClipPlane &portalPlane) override
+	{
+		RenderPolyMario mario;
+		mario.Render(thread, worldToClip, portalPlane, thing, sub, StencilValue + 1);
+	}
+
+	AActor *thing = nullptr;
+	subsector_t *sub = nullptr;
+	uint32_t StencilValue = 0;
+};
@@ -34,6 +34,7 @@
 #include "polyrenderer/scene/poly_plane.h"
 #include "polyrenderer/scene/poly_particle.h"
 #include "polyrenderer/scene/poly_sprite.h"
+#include "polyrenderer/scene/poly_mario.h"
 
 EXTERN_CVAR(Int, r_portal_recursions)
 
@@ -376,6 +377,18 @@ void RenderPolyScene::RenderTranslucent(int portalDepth)
 	{
 		for (AActor *thing = sector->thinglist; thing != nullptr; thing = thing->snext)
 		{
+			if (RenderPolyMario::IsMario(thing))
+			{
+				// Mario is drawn as a mesh instead of his sprite
+				subsector_t *sub = thing->subsector;
+				if (!RenderPolySprite::IsThingCulled(thing) && Cull.SubsectorDepths[sub->Index()] != 0xffffffff)
+				{
+					double distanceSquared = (thing->Pos() - viewpoint.Pos).LengthSquared();
+					TranslucentObjects[thread->ThreadIndex].push_back(thread->FrameMemory->NewObject<PolyTranslucentMario>(thing, sub, Cull.SubsectorDepths[sub->Index()], distanceSquared, StencilValue));
+				}
+				continue;
+			}
+
 			DVector2 left, right;
 			if (!RenderPolySprite::GetLine(thing, left, right))
 				continue;
@@ -284,6 +284,63 @@ static PSymbol *FindBuiltinFunction(FName funcname, VMNativeFunction::NativeCall
 	return sym;
 }
 
+//==========================================================================
+//
+// Actor wake-ups
+//
+// A sleeping actor is not ticked until its tics run out, so it does not
+// notice when a script gives it some velocity or changes its tics. A
+// store to either is followed by a call that wakes it up if it is asleep.
+//
+//==========================================================================
+
+int BuiltinWakeActor(VMValue *param, TArray<VMValue> &defaultparam, int numparam, VMReturn *ret, int numret)
+{
+	PARAM_PROLOGUE;
+	PARAM_POINTER(address, uint8_t);
+	PARAM_INT(offset);
+	auto actor = reinterpret_cast<AActor *>(address - offset);
+	if (offset == myoffsetof(AActor, tics))
+	{
+		// Waking catches up on the countdown the actor went to sleep with, which the script has just replaced.
+		int tics = actor->tics;
+		actor->StopSleeping();
+		actor->tics = tics;
+	}
+	else
+	{
+		actor->StopSleeping();
+	}
+	return 0;
+}
+
+static int GetWakeOffset(FxExpression *base)
+{
+	if (base->ExprType != EFX_ClassMember) return -1;
+	auto member = static_cast<FxClassMember *>(base);
+	PType *type = member->classx->ValueType;
+	if (!type->isObjectPointer() || !static_cast<PObjectPointer *>(type)->PointedClass()->IsDescendantOf(RUNTIME_CLASS(AActor))) return -1;
+
+	// Stores to a single component of the vector have the component's offset.
+	size_t offset = member->membervar->Offset;
+	if (offset == myoffsetof(AActor, tics) || (offset >= myoffsetof(AActor, Vel) && offset < myoffsetof(AActor, Vel) + sizeof(DVector3)))
+	{
+		return (int)offset;
+	}
+	return -1;
+}
+
+static void EmitWakeActor(VMFunctionBuilder *build, const ExpEmit &pointer, int offset)
+{
+	PSymbol *sym = FindBuiltinFunction(NAME_BuiltinWakeActor, BuiltinWakeActor);
+
+	assert(sym->IsKindOf(RUNTIME_CLASS(PSymbolVMFunction)));
+	assert(((PSymbolVMFunction *)sym)->Function != nullptr);
+	build->Emit(OP_PARAM, 0, REGT_POINTER, pointer.RegNum);
+	build->Emit(OP_PARAM, 0, REGT_INT | REGT_KONST, build->GetConstantInt(offset));
+	build->Emit(OP_CALL_K, build->GetConstantAddress(((PSymbolVMFunction *)sym)->Function), 2, 0);
+}
+
 //==========================================================================
 //
 //
@@ -514,6 +571,34 @@ static int EncodeRegType(ExpEmit reg)
 	return regtype;
 }
 
+//==========================================================================
+//
+// Evaluates an argument for a direct native call. CALL_N only reads the
+// registers when the call is made, so a local variable gets copied if a
+// later argument might change it.
+//
+//==========================================================================
+
+static ExpEmit EmitDirectParameter(VMFunctionBuilder *build, ExpEmit where, bool copylocal)
+{
+	static const uint8_t moves[] = { OP_MOVE, OP_MOVEF, OP_MOVES, OP_MOVEA };
+
+	assert(where.RegCount == 1 && where.RegType <= REGT_TYPE && !where.Target);
+	// The implicit parameters are never written to.
+	if (!copylocal || !where.Fixed || where.Konst || (where.RegType == REGT_POINTER && where.RegNum < build->NumImplicits))
+	{
+		return where;
+	}
+	ExpEmit copy(build, where.RegType);
+	build->Emit(moves[where.RegType], copy.RegNum, where.RegNum);
+	return copy;
+}
+
+static bool MayChangeLocals(FxExpression *operand)
+{
+	return !operand->isConstant() && operand->ExprType != EFX_LocalVariable && operand->ExprType != EFX_Self;
+}
+
 //==========================================================================
 //
 //
@@ -2295,6 +2380,8 @@ ExpEmit FxPreIncrDecr::Emit(VMFunctionBuilder *build)
 	if (!pointer.Target)
 	{
 		build->Emit(ValueType->GetStoreOp(), pointer.RegNum, value.RegNum, zero);
+		int wake = GetWakeOffset(Base);
+		if (wake >= 0) EmitWakeActor(build, pointer, wake);
 	}
 
 	if (AddressRequested)
@@ -2376,6 +2463,8 @@ ExpEmit FxPostIncrDecr::Emit(VMFunctionBuilder *build)
 			build->Emit((Token == TK_Incr) ? OP_ADDF_RK : OP_SUBF_RK, assign.RegNum, out.RegNum, build->GetConstantFloat(1.));
 		}
 		build->Emit(ValueType->GetStoreOp(), pointer.RegNum, assign.RegNum, zero);
+		int wake = GetWakeOffset(Base);
+		if (wake >= 0) EmitWakeActor(build, pointer, wake);
 		pointer.Free(build);
 		assign.Free(build);
 		return out;
@@ -2578,6 +2667,8 @@ ExpEmit FxAssign::Emit(VMFunctionBuilder *build)
 			build->Emit(OP_SBIT, pointer.RegNum, result.RegNum, 1 << IsBitWrite);
 		}
 
+		int wake = GetWakeOffset(Base);
+		if (wake >= 0) EmitWakeActor(build, pointer, wake);
 	}
 
 	if (AddressRequested)
@@ -6826,6 +6917,27 @@ FxExpression *FxCVar::Resolve(FCompileContext &ctx)
 	return this;
 }
 
+//==========================================================================
+//
+// Returns the address of the variable holding the CVar's value.
+//
+//==========================================================================
+
+void *FxCVar::ValueAddress(FBaseCVar *cvar)
+{
+	switch (cvar->GetRealType())
+	{
+	case CVAR_Int:			return &static_cast<FIntCVar *>(cvar)->Value;
+	case CVAR_Color:		return &static_cast<FColorCVar *>(cvar)->Value;
+	case CVAR_Float:		return &static_cast<FFloatCVar *>(cvar)->Value;
+	case CVAR_Bool:			return &static_cast<FBoolCVar *>(cvar)->Value;
+	case CVAR_String:		return &static_cast<FStringCVar *>(cvar)->Value;
+	case CVAR_DummyBool:	return &static_cast<FFlagCVar *>(cvar)->ValueVar.Value;
+	case CVAR_DummyInt:		return &static_cast<FMaskCVar *>(cvar)->ValueVar.Value;
+	default:				return nullptr;
+	}
+}
+
 ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 {
 	ExpEmit dest(build, ValueType->GetRegType());
@@ -6834,34 +6946,34 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	switch (CVar->GetRealType())
 	{
 	case CVAR_Int:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FIntCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Color:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FColorCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Float:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FFloatCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LSP, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_Bool:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FBoolCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LBU, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_String:
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&static_cast<FStringCVar *>(CVar)->Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LCS, dest.RegNum, addr.RegNum, nul);
 		break;
 
 	case CVAR_DummyBool:
 	{
 		auto cv = static_cast<FFlagCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(1));
@@ -6871,7 +6983,7 @@ ExpEmit FxCVar::Emit(VMFunctionBuilder *build)
 	case CVAR_DummyInt:
 	{
 		auto cv = static_cast<FMaskCVar *>(CVar);
-		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(&cv->ValueVar.Value));
+		build->Emit(OP_LKP, addr.RegNum, build->GetConstantAddress(ValueAddress(CVar)));
 		build->Emit(OP_LW, dest.RegNum, addr.RegNum, nul);
 		build->Emit(OP_AND_RK, dest.RegNum, dest.RegNum, build->GetConstantInt(cv->BitVal));
 		build->Emit(OP_SRL_RI, dest.RegNum, dest.RegNum, cv->BitNum);
@@ -9038,6 +9150,25 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 	VMFunction *vmfunc = Function->Variants[0].Implementation;
 	bool staticcall = ((vmfunc->VarFlags & VARF_Final) || vmfunc->VirtualIndex == ~0u || NoVirtual);
 
+	// Natives with a direct entry point get called with CALL_N, which passes the argument registers as they are.
+	TArray<ExpEmit> directargs;
+	bool directcall = staticcall && !EmitTail && AssignCount == 0 && (vmfunc->VarFlags & VARF_Native) &&
+		static_cast<VMNativeFunction *>(vmfunc)->DirectInvoker != nullptr &&
+		(!(Function->Variants[0].Flags & VARF_Method) || Self->ValueType->isObjectPointer());
+	int directaddr = directcall ? build->GetConstantAddress(vmfunc) : 0;
+	int lastchange = -1;
+	if (directaddr > 255)
+	{
+		directcall = false;
+	}
+	else if (directcall)
+	{
+		for (unsigned i = 0; i < ArgList.Size(); ++i)
+		{
+			if (MayChangeLocals(ArgList[i])) lastchange = i;
+		}
+	}
+
 	count = 0;
 	// Emit code to pass implied parameters
 	ExpEmit selfemit;
@@ -9065,7 +9196,12 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 			}
 		}
 
-		if (selfemit.Fixed && selfemit.Target)
+		if (directcall)
+		{
+			selfemit = EmitDirectParameter(build, selfemit, lastchange >= 0);
+			directargs.Push(selfemit);
+		}
+		else if (selfemit.Fixed && selfemit.Target)
 		{
 			// Address of a local variable.
 			build->Emit(OP_PARAM, 0, selfemit.RegType | REGT_ADDROF, selfemit.RegNum);
@@ -9080,8 +9216,23 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 			static_assert(NAP == 3, "This code needs to be updated if NAP changes");
 			if (build->NumImplicits == NAP && selfemit.RegNum == 0)	// only pass this function's stateowner and stateinfo if the subfunction is run in self's context.
 			{
-				build->Emit(OP_PARAM, 0, REGT_POINTER, 1);
-				build->Emit(OP_PARAM, 0, REGT_POINTER, 2);
+				if (directcall)
+				{
+					directargs.Push(ExpEmit(1, REGT_POINTER, false, true));
+					directargs.Push(ExpEmit(2, REGT_POINTER, false, true));
+				}
+				else
+				{
+					build->Emit(OP_PARAM, 0, REGT_POINTER, 1);
+					build->Emit(OP_PARAM, 0, REGT_POINTER, 2);
+				}
+			}
+			else if (directcall)
+			{
+				ExpEmit stateowner = selfemit;
+				stateowner.Fixed = true;	// so that it only gets freed once
+				directargs.Push(stateowner);
+				directargs.Push(ExpEmit(build->GetConstantAddress(nullptr), REGT_POINTER, true));
 			}
 			else
 			{
@@ -9091,17 +9242,45 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 			}
 			count += 2;
 		}
-		if (staticcall) selfemit.Free(build);
+		if (staticcall && !directcall) selfemit.Free(build);
 	}
 	else staticcall = true;
 	// Emit code to pass explicit parameters
 	for (unsigned i = 0; i < ArgList.Size(); ++i)
 	{
-		count += EmitParameter(build, ArgList[i], ScriptPosition, &tempstrings);
+		if (directcall)
+		{
+			directargs.Push(EmitDirectParameter(build, ArgList[i]->Emit(build), (int)i < lastchange));
+			count++;
+		}
+		else
+		{
+			count += EmitParameter(build, ArgList[i], ScriptPosition, &tempstrings);
+		}
 	}
 	ArgList.DeleteAndClear();
 	ArgList.ShrinkToFit();
 
+	if (directcall)
+	{
+		// Omitted trailing arguments are taken from the defaults.
+		auto &defaults = vmfunc->DefaultArgs;
+		assert(count == (int)vmfunc->Proto->ArgumentTypes.Size() || defaults.Size() == vmfunc->Proto->ArgumentTypes.Size());
+		for (unsigned i = count; i < vmfunc->Proto->ArgumentTypes.Size(); i++)
+		{
+			switch (defaults[i].Type)
+			{
+			case REGT_INT:		directargs.Push(ExpEmit(build->GetConstantInt(defaults[i].i), REGT_INT, true)); break;
+			case REGT_FLOAT:	directargs.Push(ExpEmit(build->GetConstantFloat(defaults[i].f), REGT_FLOAT, true)); break;
+			default:			directargs.Push(ExpEmit(build->GetConstantAddress(defaults[i].a), REGT_POINTER, true)); break;
+			}
+		}
+		build->EmitDirectCall(directaddr, directargs, vmfunc->Proto->ReturnTypes.Size());
+		for (auto &arg : directargs) arg.Free(build);
+		if (vmfunc->Proto->ReturnTypes.Size() > 0) goto handlereturns;
+		return ExpEmit();
+	}
+
 	// Get a constant register for this function
 	if (staticcall)
 	{
@@ -9132,7 +9311,20 @@ ExpEmit FxVMFunctionCall::Emit(VMFunctionBuilder *build)
 		selfemit.Free(build);
 		ExpEmit funcreg(build, REGT_POINTER);
 
-		build->Emit(OP_VTBL, funcreg.RegNum, selfemit.RegNum, vmfunc->VirtualIndex);
+		// Each call site gets its own inline cache, which lives as long as the code does.
+		auto cache = (VMVirtualCache *)ClassDataAllocator.Alloc(sizeof(VMVirtualCache));
+		cache->Class[0] = cache->Class[1] = nullptr;
+		cache->Func[0] = cache->Func[1] = nullptr;
+		cache->Index = vmfunc->VirtualIndex;
+		int cacheaddr = build->GetConstantAddress(cache);
+		if (cacheaddr <= 255)
+		{
+			build->Emit(OP_VTBL_K, funcreg.RegNum, selfemit.RegNum, cacheaddr);
+		}
+		else
+		{
+			build->Emit(OP_VTBL, funcreg.RegNum, selfemit.RegNum, vmfunc->VirtualIndex);
+		}
 		if (EmitTail)
 		{ // Tail call
 			build->Emit(OP_TAIL, funcreg.RegNum, count, 0);
@@ -11479,3 +11671,37 @@ ExpEmit FxStaticArray::Emit(VMFunctionBuilder *build)
 	}
 	return ExpEmit();
 }
+
+//==========================================================================
+//
+// GetBuiltinFunction
+//
+// Returns the native function for one of the builtins the code generator
+// calls directly, creating its symbol if this hasn't happened yet.
+//
+//==========================================================================
+
+VMFunction *GetBuiltinFunction(FName funcname)
+{
+	static const struct { ENamedName Name; VMNativeFunction::NativeCallType Func; } builtins[] =
+	{
+		{ NAME_BuiltinRandom, BuiltinRandom },
+		{ NAME_BuiltinFRandom, BuiltinFRandom },
+		{ NAME_BuiltinRandomSeed, BuiltinRandomSeed },
+		{ NAME_BuiltinCallLineSpecial, BuiltinCallLineSpecial },
+		{ NAME_BuiltinNameToClass, BuiltinNameToClass },
+		{ NAME_BuiltinClassCast, BuiltinClassCast },
+		{ NAME_BuiltinWakeActor, BuiltinWakeActor },
+	};
+
+	for (auto &builtin : builtins)
+	{
+		if (funcname == builtin.Name)
+		{
+			PSymbol *sym = FindBuiltinFunction(builtin.Name, builtin.Func);
+			assert(sym->IsKindOf(RUNTIME_CLASS(PSymbolVMFunction)));
+			return ((PSymbolVMFunction *)sym)->Function;
+		}
+	}
+	return nullptr;
+}
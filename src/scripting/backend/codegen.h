@@ -1381,6 +1381,8 @@ public:
 	FxCVar(FBaseCVar*, const FScriptPosition&);
 	FxExpression *Resolve(FCompileContext&);
 	ExpEmit Emit(VMFunctionBuilder *build);
+
+	static void *ValueAddress(FBaseCVar *cvar);
 };
 
 
@@ -2183,4 +2185,6 @@ public:
 	}
 };
 
+VMFunction *GetBuiltinFunction(FName funcname);
+
 #endif
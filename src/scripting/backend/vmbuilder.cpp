@@ -690,6 +690,70 @@ size_t VMFunctionBuilder::EmitParamInt(int value)
 	}
 }
 
+//==========================================================================
+//
+// VMFunctionBuilder :: EmitDirectCall
+//
+// Emits a CALL_N to a native with a direct entry point. It is followed by
+// one PARAM or PARAMI per argument, which only tell CALL_N where to find
+// them and do not touch the parameter stack. Constants the PARAM cannot
+// address are loaded into a register first. The caller has to emit the
+// RESULTs.
+//
+//==========================================================================
+
+size_t VMFunctionBuilder::EmitDirectCall(int funcaddr, const TArray<ExpEmit> &args, int numret)
+{
+	static uint8_t opcodes[] = { OP_LK, OP_LKF, OP_LKS, OP_LKP };
+	TArray<VMOP> params;
+	TArray<ExpEmit> loaded;
+	VMOP op;
+
+	assert(funcaddr >= 0 && funcaddr <= 255);
+	assert(args.Size() <= VM_MAXDIRECTARGS && numret <= 1);
+	for (auto &arg : args)
+	{
+		assert(arg.RegCount == 1 && !arg.Target);
+		op.a = 0;
+		if (arg.Konst && arg.RegType == REGT_INT && ((IntConstantList[arg.RegNum] << 8) >> 8) == IntConstantList[arg.RegNum])
+		{
+			op.op = OP_PARAMI;
+			op.i24 = IntConstantList[arg.RegNum];
+		}
+		else if (arg.Konst && arg.RegNum > 255)
+		{
+			ExpEmit reg(this, arg.RegType);
+			Emit(opcodes[arg.RegType], reg.RegNum, arg.RegNum);
+			loaded.Push(reg);
+			op.op = OP_PARAM;
+			op.b = arg.RegType;
+			op.c = reg.RegNum;
+		}
+		else
+		{
+			op.op = OP_PARAM;
+			op.b = arg.RegType | (arg.Konst ? REGT_KONST : 0);
+			op.c = arg.RegNum;
+		}
+		params.Push(op);
+	}
+	// These are free again once the call has read its arguments.
+	for (auto &reg : loaded)
+	{
+		reg.Free(this);
+	}
+	op.op = OP_CALL_N;
+	op.a = funcaddr;
+	op.b = args.Size();
+	op.c = numret;
+	size_t addr = Code.Push(op);
+	for (auto &param : params)
+	{
+		Code.Push(param);
+	}
+	return addr;
+}
+
 //==========================================================================
 //
 // VMFunctionBuilder :: EmitLoadInt
@@ -840,14 +904,30 @@ void FFunctionBuildList::Build()
 	int errorcount = 0;
 	int codesize = 0;
 	int datasize = 0;
+	int unoptimizedsize = 0;
 	FILE *dump = nullptr;
+	bool optimize = !Args->CheckParm("-noscriptopt");
+	bool dumpdiff = optimize && Args->CheckParm("-dumpdisasmdiff");
+	TArray<VMOP> unoptimized;
 
-	if (Args->CheckParm("-dumpdisasm")) dump = fopen("disasm.txt", "w");
+	if (Args->CheckParm("-dumpdisasm") || dumpdiff) dump = fopen("disasm.txt", "w");
 
-	for (auto &item : mItems)
+	// Disassembly dumps need the code generator's output, so they always bypass the cache.
+	FScriptCache cache(mScriptLumps, optimize);
+	TArray<bool> cached;
+	bool fromcache = dump == nullptr && cache.Load(mItems, cached);
+
+	for (unsigned i = 0; i < mItems.Size(); i++)
 	{
+		auto &item = mItems[i];
 		assert(item.Code != NULL);
 
+		if (fromcache && cached[i])
+		{
+			delete item.Code;
+			continue;
+		}
+
 		// We don't know the return type in advance for anonymous functions.
 		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
 
@@ -864,6 +944,10 @@ void FFunctionBuildList::Build()
 			else local->RegNum = buildit.Registers[REGT_POINTER].Get(1);
 			ctx.FunctionArgs.Push(local);
 		}
+		for (int i = 0; i < 4; i++)
+		{
+			buildit.NumArgRegs[i] = buildit.Registers[i].GetMostUsed();
+		}
 
 		FScriptPosition::StrictErrors = !item.FromDecorate;
 		item.Code = item.Code->Resolve(ctx);
@@ -908,6 +992,7 @@ void FFunctionBuildList::Build()
 				buildit.BeginStatement(item.Code);
 				item.Code->Emit(&buildit);
 				buildit.EndStatement();
+				if (optimize) buildit.Optimize(dumpdiff ? &unoptimized : nullptr);
 				buildit.MakeFunction(sfunc);
 				sfunc->NumArgs = 0;
 				// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
@@ -919,7 +1004,15 @@ void FFunctionBuildList::Build()
 
 				if (dump != nullptr)
 				{
-					DumpFunction(dump, sfunc, item.PrintableName.GetChars(), (int)item.PrintableName.Len());
+					if (dumpdiff)
+					{
+						DumpFunction(dump, sfunc, item.PrintableName.GetChars(), (int)item.PrintableName.Len(), &unoptimized[0], unoptimized.Size());
+						unoptimizedsize += unoptimized.Size();
+					}
+					else
+					{
+						DumpFunction(dump, sfunc, item.PrintableName.GetChars(), (int)item.PrintableName.Len());
+					}
 					codesize += sfunc->CodeSize;
 					datasize += sfunc->LineInfoCount * sizeof(FStatementInfo) + sfunc->ExtraSpace + sfunc->NumKonstD * sizeof(int) +
 						sfunc->NumKonstA * sizeof(void*) + sfunc->NumKonstF * sizeof(double) + sfunc->NumKonstS * sizeof(FString);
@@ -941,10 +1034,16 @@ void FFunctionBuildList::Build()
 	if (dump != nullptr)
 	{
 		fprintf(dump, "\n*************************************************************************\n%i code bytes\n%i data bytes", codesize * 4, datasize);
+		if (dumpdiff) fprintf(dump, "\n%i code bytes before optimization", unoptimizedsize * 4);
 		fclose(dump);
 	}
+	else if (!fromcache && FScriptPosition::ErrorCounter == 0)
+	{
+		cache.Save(mItems);
+	}
 	FScriptPosition::StrictErrors = false;
 	mItems.Clear();
 	mItems.ShrinkToFit();
+	mScriptLumps.Clear();
 	FxAlloc.FreeAllBlocks();
 }
@@ -40,6 +40,7 @@ public:
 		int MostUsed;
 
 		friend class VMFunctionBuilder;
+		friend class FBytecodeOptimizer;
 	};
 
 	VMFunctionBuilder(int numimplicits);
@@ -49,6 +50,9 @@ public:
 	void EndStatement();
 	void MakeFunction(VMScriptFunction *func);
 
+	// Runs the peephole optimizer over the emitted code. Must be called before MakeFunction.
+	void Optimize(TArray<VMOP> *original = nullptr);
+
 	// Returns the constant register holding the value.
 	unsigned GetConstantInt(int val);
 	unsigned GetConstantFloat(double val);
@@ -71,6 +75,7 @@ public:
 	size_t EmitParamInt(int value);
 	size_t EmitLoadInt(int regnum, int value);
 	size_t EmitRetInt(int retnum, bool final, int value);
+	size_t EmitDirectCall(int funcaddr, const TArray<ExpEmit> &args, int numret);
 
 	void Backpatch(size_t addr, size_t target);
 	void BackpatchToHere(size_t addr);
@@ -92,6 +97,9 @@ public:
 	// amount of implicit parameters so that proper code can be emitted for method calls
 	int NumImplicits;
 
+	// registers taken by the function's arguments, per register type
+	int NumArgRegs[4] = { 0, 0, 0, 0 };
+
 	// keep the frame pointer, if needed, in a register because the LFP opcode is hideously inefficient, requiring more than 20 instructions on x64.
 	ExpEmit FramePointer;
 	TArray<FxLocalVariableDeclaration *> ConstructedStructs;
@@ -115,9 +123,10 @@ private:
 
 	TArray<VMOP> Code;
 
+	friend class FBytecodeOptimizer;
 };
 
-void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen);
+void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen, const VMOP *original = nullptr, int originalsize = 0);
 
 
 //==========================================================================
@@ -145,11 +154,41 @@ class FFunctionBuildList
 	};
 
 	TArray<Item> mItems;
+	TArray<int> mScriptLumps;
+
+	friend class FScriptCache;
 
 public:
 	VMFunction *AddFunction(PNamespace *curglobals, const VersionInfo &ver, PFunction *func, FxExpression *code, const FString &name, bool fromdecorate, int currentstate, int statecnt, int lumpnum);
+	void AddScriptLump(int lump) { mScriptLumps.Push(lump); }
 	void Build();
 };
 
 extern FFunctionBuildList FunctionBuildList;
+
+//==========================================================================
+//
+// FScriptCache
+//
+// Keeps the code FFunctionBuildList::Build generates on disk, so that
+// starting again with the same scripts and the same engine does not need
+// to resolve and emit every function once more.
+//
+//==========================================================================
+
+class FScriptCache
+{
+public:
+	FScriptCache(const TArray<int> &lumps, bool optimize);
+	bool Load(TArray<FFunctionBuildList::Item> &items, TArray<bool> &loaded);
+	void Save(TArray<FFunctionBuildList::Item> &items);
+
+private:
+	FString Path;
+	uint8_t Key[16];
+	int NumNames;				// names that existed before code generation started
+	unsigned NumFunctions;		// same for VM functions
+	unsigned NumClasses;		// and classes
+	bool Enabled;
+};
 #endif
@@ -0,0 +1,931 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		On-disk cache for the code generator's output.
+//
+//		Parsing the scripts and setting up the class layouts is cheap
+//		compared to resolving and emitting every function, so this only
+//		stores what FFunctionBuildList::Build produces: the finished
+//		bytecode, constants and frame layout of each function.
+//
+//		A cache file is only used if it was written from the very same
+//		input. Its key is a hash over the engine's VM and native layout,
+//		the contents of every script lump that was read, and all the
+//		global tables the compiled code refers to by index: names,
+//		sounds, sprites, classes and VM functions. Any difference means
+//		the cache is ignored and everything is compiled again.
+//
+//		The address constants are the only part that cannot be stored
+//		as is. They get written as references to things that can be
+//		found again on the next run - VM functions, classes, states,
+//		RNGs, CVars and native globals. A function that refers to
+//		anything else is simply not cached and gets compiled normally.
+//
+//		The state label table that the code generator fills is stored
+//		along with the functions, as are the names it created, so that
+//		the indices in the cached code stay valid.
+//
+//-----------------------------------------------------------------------------
+
+#include <zlib.h>
+#include "vmbuilder.h"
+#include "codegen.h"
+#include "info.h"
+#include "m_argv.h"
+#include "m_misc.h"
+#include "m_random.h"
+#include "md5.h"
+#include "w_wad.h"
+#include "c_cvars.h"
+#include "s_sound.h"
+#include "r_state.h"
+#include "version.h"
+#include "cmdlib.h"
+#include "thingdef.h"
+
+enum
+{
+	SCRIPTCACHE_VERSION = 4,
+};
+
+// How an address constant is stored.
+enum ECacheAddress
+{
+	CA_Null,
+	CA_Function,		// VM function that existed before code generation started
+	CA_Builtin,			// builtin function created by the code generator
+	CA_Class,
+	CA_State,
+	CA_RNG,
+	CA_CVar,			// the value of a CVar
+	CA_Global,			// a native global variable
+	CA_VirtualCache,	// the inline cache of a VTBL_K instruction
+};
+
+//==========================================================================
+//
+// Serialization helpers
+//
+//==========================================================================
+
+struct FCacheWriter
+{
+	TArray<uint8_t> Data;
+
+	void Byte(uint8_t v)
+	{
+		Data.Push(v);
+	}
+
+	void Long(uint32_t v)
+	{
+		int p = Data.Reserve(4);
+		Data[p] = (uint8_t)v;
+		Data[p + 1] = (uint8_t)(v >> 8);
+		Data[p + 2] = (uint8_t)(v >> 16);
+		Data[p + 3] = (uint8_t)(v >> 24);
+	}
+
+	void Quad(uint64_t v)
+	{
+		Long((uint32_t)v);
+		Long((uint32_t)(v >> 32));
+	}
+
+	void String(const char *s)
+	{
+		unsigned len = (unsigned)strlen(s);
+		Long(len);
+		int p = Data.Reserve(len);
+		memcpy(&Data[p], s, len);
+	}
+
+	void Append(const FCacheWriter &other)
+	{
+		Data.Append(other.Data);
+	}
+};
+
+// Reading past the end only sets a flag so that callers can check once at the end.
+struct FCacheReader
+{
+	const uint8_t *Data;
+	unsigned Size;
+	unsigned Pos = 0;
+	bool Failed = false;
+
+	FCacheReader(const uint8_t *data, unsigned size) : Data(data), Size(size) {}
+
+	bool Check(unsigned len)
+	{
+		if (Failed || Size - Pos < len)
+		{
+			Failed = true;
+			return false;
+		}
+		return true;
+	}
+
+	uint8_t Byte()
+	{
+		return Check(1) ? Data[Pos++] : 0;
+	}
+
+	uint32_t Long()
+	{
+		if (!Check(4)) return 0;
+		uint32_t v = Data[Pos] | (Data[Pos + 1] << 8) | (Data[Pos + 2] << 16) | ((uint32_t)Data[Pos + 3] << 24);
+		Pos += 4;
+		return v;
+	}
+
+	uint64_t Quad()
+	{
+		uint64_t v = Long();
+		return v | ((uint64_t)Long() << 32);
+	}
+
+	FString String()
+	{
+		unsigned len = Long();
+		if (!Check(len)) return FString();
+		FString s((const char *)Data + Pos, len);
+		Pos += len;
+		return s;
+	}
+
+	// For tables whose size is given by the file. Anything larger than what is
+	// left cannot be valid and must not be used to allocate memory.
+	unsigned Count(unsigned elementsize)
+	{
+		unsigned count = Long();
+		if (!Failed && (Size - Pos) / elementsize < count) Failed = true;
+		return Failed ? 0 : count;
+	}
+};
+
+static void HashString(MD5Context &md5, const char *s)
+{
+	md5.Update((const uint8_t *)s, (unsigned)strlen(s) + 1);
+}
+
+static void HashInt(MD5Context &md5, uint32_t v)
+{
+	uint8_t b[4] = { (uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24) };
+	md5.Update(b, 4);
+}
+
+static int CountNames()
+{
+	int count = 0;
+	while (FName(ENamedName(count)).IsValidName()) count++;
+	return count;
+}
+
+//==========================================================================
+//
+// The return types an anonymous function can be stored with.
+//
+//==========================================================================
+
+static int GetBasicTypeIndex(PType *type)
+{
+	PType *const basictypes[] = { TypeBool, TypeSInt32, TypeUInt32, TypeFloat64, TypeString, TypeName, TypeSound, TypeColor,
+		TypeState, TypeStateLabel, TypeSpriteID, TypeTextureID, TypeVector2, TypeVector3 };
+
+	for (unsigned i = 0; i < countof(basictypes); i++)
+	{
+		if (basictypes[i] == type) return i;
+	}
+	return -1;
+}
+
+static PType *GetBasicType(unsigned index)
+{
+	PType *const basictypes[] = { TypeBool, TypeSInt32, TypeUInt32, TypeFloat64, TypeString, TypeName, TypeSound, TypeColor,
+		TypeState, TypeStateLabel, TypeSpriteID, TypeTextureID, TypeVector2, TypeVector3 };
+
+	return index < countof(basictypes) ? basictypes[index] : nullptr;
+}
+
+//==========================================================================
+//
+// FAddressTable
+//
+// Maps everything an address constant can be restored from back to its
+// description. Only needed when writing the cache.
+//
+//==========================================================================
+
+class FAddressTable
+{
+	struct StateRange
+	{
+		FState *First;
+		unsigned Count;
+		unsigned ClassIndex;
+	};
+
+	TMap<const void *, unsigned> Functions;
+	TMap<const void *, unsigned> Classes;
+	TMap<const void *, FBaseCVar *> CVars;
+	TArray<StateRange> States;
+	unsigned NumFunctions;
+	unsigned NumClasses;
+
+public:
+	FAddressTable(unsigned numfunctions, unsigned numclasses);
+	bool WriteState(FCacheWriter &out, FState *state);
+	bool Write(FCacheWriter &out, void *ptr);
+};
+
+FAddressTable::FAddressTable(unsigned numfunctions, unsigned numclasses)
+{
+	NumFunctions = numfunctions;
+	NumClasses = numclasses;
+
+	for (unsigned i = 0; i < VMFunction::AllFunctions.Size(); i++)
+	{
+		Functions[VMFunction::AllFunctions[i]] = i;
+	}
+	for (unsigned i = 0; i < NumClasses; i++)
+	{
+		Classes[PClass::AllClasses[i]] = i;
+	}
+	for (auto cv = ::CVars; cv != nullptr; cv = cv->GetNext())
+	{
+		void *addr = FxCVar::ValueAddress(cv);
+		if (addr != nullptr) CVars[addr] = cv;
+	}
+	for (auto cls : PClassActor::AllActorClasses)
+	{
+		auto index = Classes.CheckKey(cls);
+		if (index != nullptr && cls->GetStateCount() > 0)
+		{
+			States.Push({ cls->GetStates(), cls->GetStateCount(), *index });
+		}
+	}
+	if (States.Size() > 1) std::sort(&States[0], &States[0] + States.Size(), [](const StateRange &a, const StateRange &b) { return a.First < b.First; });
+}
+
+bool FAddressTable::WriteState(FCacheWriter &out, FState *state)
+{
+	unsigned min = 0, max = States.Size();
+	while (min < max)
+	{
+		unsigned mid = (min + max) / 2;
+		if (States[mid].First > state) max = mid;
+		else min = mid + 1;
+	}
+	// min is now the first range starting after the state.
+	if (min == 0) return false;
+	auto &range = States[min - 1];
+	if (state >= range.First + range.Count) return false;
+	out.Long(range.ClassIndex);
+	out.Long(unsigned(state - range.First));
+	return true;
+}
+
+bool FAddressTable::Write(FCacheWriter &out, void *ptr)
+{
+	if (ptr == nullptr)
+	{
+		out.Byte(CA_Null);
+		return true;
+	}
+	if (auto index = Functions.CheckKey(ptr))
+	{
+		if (*index < NumFunctions)
+		{
+			out.Byte(CA_Function);
+			out.Long(*index);
+			return true;
+		}
+		auto func = (VMFunction *)ptr;
+		if (GetBuiltinFunction(func->Name) == func)
+		{
+			out.Byte(CA_Builtin);
+			out.String(func->Name.GetChars());
+			return true;
+		}
+		return false;
+	}
+	if (auto index = Classes.CheckKey(ptr))
+	{
+		out.Byte(CA_Class);
+		out.Long(*index);
+		return true;
+	}
+	if (auto cv = CVars.CheckKey(ptr))
+	{
+		out.Byte(CA_CVar);
+		out.String((*cv)->GetName());
+		out.Byte((*cv)->GetRealType());
+		return true;
+	}
+	uint32_t crc = FRandom::StaticGetRNGCRC((FRandom *)ptr);
+	if (crc != 0 || ptr == FRandom::StaticFindRNGByCRC(0))
+	{
+		out.Byte(CA_RNG);
+		out.Long(crc);
+		return true;
+	}
+	auto &fields = GetNativeFields();
+	for (unsigned i = 0; i < fields.Size(); i++)
+	{
+		// Globals are the only entries that store an absolute address.
+		if (fields[i].ClassName[0] == 0 && (size_t)ptr >= fields[i].FieldOffset && (size_t)ptr < fields[i].FieldOffset + fields[i].FieldSize)
+		{
+			out.Byte(CA_Global);
+			out.Long(i);
+			out.Long(uint32_t((size_t)ptr - fields[i].FieldOffset));
+			return true;
+		}
+	}
+	FCacheWriter state;
+	if (WriteState(state, (FState *)ptr))
+	{
+		out.Byte(CA_State);
+		out.Append(state);
+		return true;
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// Restores an address constant. Returns false if it cannot be found in
+// this session, in which case the function needs to be compiled.
+//
+//==========================================================================
+
+static FState *ReadState(FCacheReader &in, unsigned numclasses)
+{
+	unsigned classindex = in.Long();
+	unsigned stateindex = in.Long();
+	if (classindex >= numclasses) return nullptr;
+	auto cls = PClass::AllClasses[classindex];
+	if (!cls->IsDescendantOf(RUNTIME_CLASS(AActor))) return nullptr;
+	auto acls = static_cast<PClassActor *>(cls);
+	if (stateindex >= acls->GetStateCount()) return nullptr;
+	return acls->GetStates() + stateindex;
+}
+
+static bool ReadAddress(FCacheReader &in, void *&ptr, unsigned numfunctions, unsigned numclasses)
+{
+	ptr = nullptr;
+	switch (in.Byte())
+	{
+	case CA_Null:
+		return true;
+
+	case CA_Function:
+	{
+		unsigned index = in.Long();
+		if (index >= numfunctions) return false;
+		ptr = VMFunction::AllFunctions[index];
+		return true;
+	}
+
+	case CA_Builtin:
+		ptr = GetBuiltinFunction(FName(in.String()));
+		return ptr != nullptr;
+
+	case CA_Class:
+	{
+		unsigned index = in.Long();
+		if (index >= numclasses) return false;
+		ptr = PClass::AllClasses[index];
+		return true;
+	}
+
+	case CA_State:
+		ptr = ReadState(in, numclasses);
+		return ptr != nullptr;
+
+	case CA_RNG:
+		// Only use RNGs that already exist. If the code generator created this one, it must do so again.
+		ptr = FRandom::StaticFindRNGByCRC(in.Long());
+		return ptr != nullptr;
+
+	case CA_CVar:
+	{
+		FString name = in.String();
+		int type = in.Byte();
+		FBaseCVar *cv = FindCVar(name, nullptr);
+		// The instructions that read the value depend on the type.
+		if (cv == nullptr || cv->GetRealType() != type) return false;
+		ptr = FxCVar::ValueAddress(cv);
+		return ptr != nullptr;
+	}
+
+	case CA_Global:
+	{
+		auto &fields = GetNativeFields();
+		unsigned index = in.Long();
+		unsigned offset = in.Long();
+		if (index >= fields.Size() || fields[index].ClassName[0] != 0 || offset >= fields[index].FieldSize) return false;
+		ptr = (void *)(fields[index].FieldOffset + offset);
+		return true;
+	}
+
+	case CA_VirtualCache:
+	{
+		auto cache = (VMVirtualCache *)ClassDataAllocator.Alloc(sizeof(VMVirtualCache));
+		cache->Class[0] = cache->Class[1] = nullptr;
+		cache->Func[0] = cache->Func[1] = nullptr;
+		cache->Index = in.Long();
+		ptr = cache;
+		return true;
+	}
+
+	default:
+		in.Failed = true;
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: FScriptCache
+//
+// Takes a snapshot of everything the generated code depends on. This must
+// be done before the code generator runs.
+//
+//==========================================================================
+
+FScriptCache::FScriptCache(const TArray<int> &lumps, bool optimize)
+{
+	NumNames = CountNames();
+	NumFunctions = VMFunction::AllFunctions.Size();
+	NumClasses = PClass::AllClasses.Size();
+	memset(Key, 0, sizeof(Key));
+
+	// State labels are indices into a table the code generator fills, so it must start out empty.
+	Enabled = !Args->CheckParm("-noscriptcache") && StateLabels.Storage.Size() == 0;
+	if (!Enabled) return;
+
+	MD5Context md5;
+
+	HashString(md5, GetVersionString());
+	HashString(md5, GetGitHash());
+	HashInt(md5, SCRIPTCACHE_VERSION);
+	HashInt(md5, sizeof(void *));
+	HashInt(md5, optimize);
+	for (int i = 0; i < NUM_OPS; i++)
+	{
+		HashString(md5, OpInfo[i].Name);
+		HashInt(md5, OpInfo[i].Mode);
+	}
+
+	for (auto &field : GetNativeFields())
+	{
+		// Global addresses change between runs. Only their names and sizes are relevant.
+		HashString(md5, field.ClassName);
+		HashString(md5, field.FieldName);
+		HashInt(md5, field.ClassName[0] == 0 ? 0 : (uint32_t)field.FieldOffset);
+		HashInt(md5, field.FieldSize);
+		HashInt(md5, field.BitValue);
+	}
+
+	for (int lump : lumps)
+	{
+		if (lump < 0) continue;
+		FMemLump data = Wads.ReadLump(lump);
+		HashString(md5, Wads.GetLumpFullPath(lump));
+		HashInt(md5, (uint32_t)data.GetSize());
+		if (data.GetSize() > 0) md5.Update((const uint8_t *)data.GetMem(), (unsigned)data.GetSize());
+	}
+
+	HashInt(md5, NumNames);
+	for (int i = 0; i < NumNames; i++)
+	{
+		HashString(md5, FName(ENamedName(i)).GetChars());
+	}
+
+	HashInt(md5, NumFunctions);
+	for (auto func : VMFunction::AllFunctions)
+	{
+		HashString(md5, func->PrintableName);
+		HashInt(md5, func->VarFlags);
+		// Whether a native can be called directly changes the code for its calls.
+		if (func->VarFlags & VARF_Native) HashInt(md5, static_cast<VMNativeFunction *>(func)->DirectInvoker != nullptr);
+	}
+
+	HashInt(md5, NumClasses);
+	for (auto cls : PClass::AllClasses)
+	{
+		HashString(md5, cls->TypeName.GetChars());
+		HashString(md5, cls->ParentClass == nullptr ? "" : cls->ParentClass->TypeName.GetChars());
+		HashInt(md5, cls->Size);
+		HashInt(md5, cls->MetaSize);
+		HashInt(md5, cls->Virtuals.Size());
+		HashInt(md5, cls->IsDescendantOf(RUNTIME_CLASS(AActor)) ? static_cast<PClassActor *>(cls)->GetStateCount() : 0);
+	}
+
+	HashInt(md5, S_sfx.Size());
+	for (auto &sfx : S_sfx)
+	{
+		HashString(md5, sfx.name);
+	}
+
+	HashInt(md5, sprites.Size());
+	for (auto &spr : sprites)
+	{
+		HashString(md5, spr.name);
+	}
+
+	md5.Final(Key);
+
+	// Name the file after the load order, so that different setups don't keep replacing each other's caches
+	// while an update to one of the files still overwrites the old one.
+	MD5Context md5files;
+	uint8_t files[16];
+	for (int i = 0; i < Wads.GetNumWads(); i++)
+	{
+		HashString(md5files, Wads.GetWadFullName(i));
+	}
+	md5files.Final(files);
+	Path.Format("/zscript-%02x%02x%02x%02x%02x%02x%02x%02x.zsc", files[0], files[1], files[2], files[3], files[4], files[5], files[6], files[7]);
+}
+
+//==========================================================================
+//
+// FScriptCache :: Save
+//
+//==========================================================================
+
+void FScriptCache::Save(TArray<FFunctionBuildList::Item> &items)
+{
+	if (!Enabled) return;
+
+	FAddressTable addresses(NumFunctions, NumClasses);
+	FCacheWriter out;
+
+	// Names the code generator created.
+	int numnames = CountNames();
+	out.Long(NumNames);
+	out.Long(numnames - NumNames);
+	for (int i = NumNames; i < numnames; i++)
+	{
+		out.String(FName(ENamedName(i)).GetChars());
+	}
+
+	// The state label table. Entries are either a state pointer or a list of names.
+	auto &storage = StateLabels.Storage;
+	FCacheWriter labels;
+	unsigned numlabels = 0;
+	for (unsigned pos = 0; pos < storage.Size(); numlabels++)
+	{
+		int count;
+		memcpy(&count, &storage[pos], sizeof(int));
+		labels.Long(count);
+		if (count == 0)
+		{
+			FState *state;
+			memcpy(&state, &storage[pos + sizeof(int)], sizeof(state));
+			if (!addresses.WriteState(labels, state)) return;
+			pos += sizeof(int) + sizeof(state);
+		}
+		else
+		{
+			for (int i = 0; i < count; i++)
+			{
+				int name;
+				memcpy(&name, &storage[pos + sizeof(int) * (i + 1)], sizeof(int));
+				labels.Long(name);
+			}
+			pos += sizeof(int) + sizeof(FName) * count;
+		}
+	}
+	out.Long(numlabels);
+	out.Append(labels);
+
+	out.Long(items.Size());
+	for (auto &item : items)
+	{
+		VMScriptFunction *sfunc = item.Function;
+		FCacheWriter func;
+		bool ok = sfunc->Code != nullptr && sfunc->SpecialInits.Size() == 0;
+
+		out.String(item.PrintableName);
+
+		if (ok && item.Func->SymbolName == NAME_None)
+		{
+			func.Long(sfunc->Proto->ReturnTypes.Size());
+			for (auto type : sfunc->Proto->ReturnTypes)
+			{
+				int index = GetBasicTypeIndex(type);
+				if (index < 0) ok = false;
+				func.Byte(index);
+			}
+		}
+		if (ok)
+		{
+			func.String(sfunc->SourceFileName);
+			func.Byte(sfunc->NumRegD);
+			func.Byte(sfunc->NumRegF);
+			func.Byte(sfunc->NumRegS);
+			func.Byte(sfunc->NumRegA);
+			func.Long(sfunc->MaxParam);
+			func.Long(sfunc->ExtraSpace);
+			func.Byte(sfunc->NumArgs);
+			func.Byte(sfunc->Unsafe);
+
+			func.Long(sfunc->CodeSize);
+			for (int i = 0; i < sfunc->CodeSize; i++)
+			{
+				func.Long(sfunc->Code[i].word);
+			}
+			func.Long(sfunc->LineInfoCount);
+			for (unsigned i = 0; i < sfunc->LineInfoCount; i++)
+			{
+				func.Long(sfunc->LineInfo[i].InstructionIndex | (sfunc->LineInfo[i].LineNumber << 16));
+			}
+			func.Long(sfunc->NumKonstD);
+			for (int i = 0; i < sfunc->NumKonstD; i++)
+			{
+				func.Long(sfunc->KonstD[i]);
+			}
+			func.Long(sfunc->NumKonstF);
+			for (int i = 0; i < sfunc->NumKonstF; i++)
+			{
+				uint64_t v;
+				memcpy(&v, &sfunc->KonstF[i], sizeof(v));
+				func.Quad(v);
+			}
+			func.Long(sfunc->NumKonstS);
+			for (int i = 0; i < sfunc->NumKonstS; i++)
+			{
+				func.String(sfunc->KonstS[i]);
+			}
+
+			// Inline caches are private to their instruction and can only be recognized by it.
+			TArray<bool> vcache;
+			vcache.Resize(sfunc->NumKonstA);
+			for (int i = 0; i < sfunc->NumKonstA; i++) vcache[i] = false;
+			for (int i = 0; i < sfunc->CodeSize; i++)
+			{
+				if (sfunc->Code[i].op == OP_VTBL_K && sfunc->Code[i].c < sfunc->NumKonstA) vcache[sfunc->Code[i].c] = true;
+			}
+			func.Long(sfunc->NumKonstA);
+			for (int i = 0; i < sfunc->NumKonstA && ok; i++)
+			{
+				if (vcache[i])
+				{
+					func.Byte(CA_VirtualCache);
+					func.Long(((VMVirtualCache *)sfunc->KonstA[i].v)->Index);
+				}
+				else
+				{
+					ok = addresses.Write(func, sfunc->KonstA[i].v);
+				}
+			}
+		}
+
+		out.Byte(ok);
+		if (ok) out.Append(func);
+	}
+
+	uLongf packedsize = compressBound(out.Data.Size());
+	TArray<uint8_t> packed;
+	packed.Resize(28 + packedsize);
+	if (compress(&packed[28], &packedsize, &out.Data[0], out.Data.Size()) != Z_OK)
+	{
+		return;
+	}
+	memcpy(&packed[0], "ZSCC", 4);
+	memcpy(&packed[4], Key, 16);
+	uint32_t header[2] = { LittleLong(out.Data.Size()), LittleLong(uint32_t(packedsize)) };
+	memcpy(&packed[20], header, 8);
+
+	FString path = M_GetCachePath(true) + Path;
+	FILE *f = fopen(path, "wb");
+	if (f != nullptr)
+	{
+		if (fwrite(&packed[0], 28 + packedsize, 1, f) != 1)
+		{
+			Printf("Error saving script cache %s\n", path.GetChars());
+		}
+		fclose(f);
+	}
+}
+
+//==========================================================================
+//
+// FScriptCache :: Load
+//
+// Returns false if there is no usable cache. Otherwise everything got
+// restored and loaded tells which functions still need to be compiled.
+//
+//==========================================================================
+
+struct FCachedFunction
+{
+	bool Valid = false;
+	bool HasProto = false;
+	FString SourceFileName;
+	TArray<VMOP> Code;
+	TArray<FStatementInfo> LineInfo;
+	TArray<int> KonstD;
+	TArray<double> KonstF;
+	TArray<FString> KonstS;
+	TArray<void *> KonstA;
+	TArray<PType *> ReturnTypes;
+	int NumRegD, NumRegF, NumRegS, NumRegA;
+	int MaxParam;
+	int ExtraSpace;
+	int NumArgs;
+	bool Unsafe;
+};
+
+bool FScriptCache::Load(TArray<FFunctionBuildList::Item> &items, TArray<bool> &loaded)
+{
+	if (!Enabled) return false;
+
+	FString path = M_GetCachePath(false) + Path;
+	FILE *f = fopen(path, "rb");
+	if (f == nullptr) return false;
+
+	uint8_t header[28];
+	TArray<uint8_t> packed;
+	uint32_t size = 0, packedsize = 0;
+	bool ok = fread(header, 1, 28, f) == 28 && !memcmp(header, "ZSCC", 4) && !memcmp(header + 4, Key, 16);
+	if (ok)
+	{
+		memcpy(&size, header + 20, 4);
+		memcpy(&packedsize, header + 24, 4);
+		size = LittleLong(size);
+		packedsize = LittleLong(packedsize);
+		packed.Resize(packedsize);
+		ok = packedsize > 0 && fread(&packed[0], 1, packedsize, f) == packedsize;
+	}
+	fclose(f);
+	if (!ok) return false;
+
+	TArray<uint8_t> data;
+	data.Resize(size);
+	uLongf unpackedsize = size;
+	if (size == 0 || uncompress(&data[0], &unpackedsize, &packed[0], packedsize) != Z_OK || unpackedsize != size)
+	{
+		return false;
+	}
+	packed.Clear();
+
+	FCacheReader in(&data[0], size);
+
+	if ((int)in.Long() != NumNames) return false;
+	TArray<FString> names;
+	names.Resize(in.Count(4));
+	for (auto &name : names) name = in.String();
+
+	struct Label
+	{
+		FState *State;
+		TArray<FName> Names;
+	};
+	TArray<Label> labels;
+	labels.Resize(in.Count(4));
+	for (auto &label : labels)
+	{
+		unsigned count = in.Count(4);
+		label.State = nullptr;
+		if (count == 0)
+		{
+			label.State = ReadState(in, NumClasses);
+			if (label.State == nullptr) return false;
+		}
+		else
+		{
+			// Indices of names from this session or from the list above.
+			for (unsigned i = 0; i < count; i++)
+			{
+				label.Names.Push(ENamedName(in.Long()));
+			}
+			if (count == 1) return false;
+		}
+	}
+
+	if (in.Long() != items.Size()) return false;
+	TArray<FCachedFunction> funcs;
+	funcs.Resize(items.Size());
+	for (unsigned i = 0; i < items.Size() && !in.Failed; i++)
+	{
+		auto &item = items[i];
+		auto &func = funcs[i];
+		if (in.String() != item.PrintableName) return false;
+		if (!in.Byte()) continue;
+
+		func.Valid = true;
+		func.HasProto = item.Func->SymbolName == NAME_None;
+		if (func.HasProto)
+		{
+			func.ReturnTypes.Resize(in.Count(1));
+			for (auto &type : func.ReturnTypes)
+			{
+				type = GetBasicType(in.Byte());
+				if (type == nullptr) in.Failed = true;
+			}
+		}
+		func.SourceFileName = in.String();
+		func.NumRegD = in.Byte();
+		func.NumRegF = in.Byte();
+		func.NumRegS = in.Byte();
+		func.NumRegA = in.Byte();
+		func.MaxParam = in.Long();
+		func.ExtraSpace = in.Long();
+		func.NumArgs = in.Byte();
+		func.Unsafe = !!in.Byte();
+
+		func.Code.Resize(in.Count(4));
+		for (auto &op : func.Code) op.word = in.Long();
+		func.LineInfo.Resize(in.Count(4));
+		for (auto &line : func.LineInfo)
+		{
+			uint32_t v = in.Long();
+			line.InstructionIndex = uint16_t(v);
+			line.LineNumber = uint16_t(v >> 16);
+		}
+		func.KonstD.Resize(in.Count(4));
+		for (auto &k : func.KonstD) k = in.Long();
+		func.KonstF.Resize(in.Count(8));
+		for (auto &k : func.KonstF)
+		{
+			uint64_t v = in.Quad();
+			memcpy(&k, &v, sizeof(k));
+		}
+		func.KonstS.Resize(in.Count(4));
+		for (auto &k : func.KonstS) k = in.String();
+		func.KonstA.Resize(in.Count(1));
+		for (auto &k : func.KonstA)
+		{
+			// Keep reading after a failure so that the next function starts at the right place.
+			if (!ReadAddress(in, k, NumFunctions, NumClasses)) func.Valid = false;
+		}
+		if (func.Code.Size() == 0) in.Failed = true;
+	}
+	if (in.Failed) return false;
+
+	// Everything could be read, so recreate the names in the same order as before.
+	for (unsigned i = 0; i < names.Size(); i++)
+	{
+		if (FName(names[i]).GetIndex() != NumNames + (int)i) return false;
+	}
+
+	for (auto &label : labels)
+	{
+		if (label.State != nullptr) StateLabels.AddPointer(label.State);
+		else StateLabels.AddNames(label.Names);
+	}
+
+	int numloaded = 0;
+	loaded.Resize(items.Size());
+	for (unsigned i = 0; i < items.Size(); i++)
+	{
+		auto &func = funcs[i];
+		loaded[i] = func.Valid;
+		if (!func.Valid) continue;
+
+		VMScriptFunction *sfunc = items[i].Function;
+		sfunc->Alloc(func.Code.Size(), func.KonstD.Size(), func.KonstF.Size(), func.KonstS.Size(), func.KonstA.Size(), func.LineInfo.Size());
+		memcpy(sfunc->Code, &func.Code[0], func.Code.Size() * sizeof(VMOP));
+		if (func.LineInfo.Size() > 0) memcpy(sfunc->LineInfo, &func.LineInfo[0], func.LineInfo.Size() * sizeof(FStatementInfo));
+		if (func.KonstD.Size() > 0) memcpy(sfunc->KonstD, &func.KonstD[0], func.KonstD.Size() * sizeof(int));
+		if (func.KonstF.Size() > 0) memcpy(sfunc->KonstF, &func.KonstF[0], func.KonstF.Size() * sizeof(double));
+		for (unsigned j = 0; j < func.KonstS.Size(); j++) sfunc->KonstS[j] = func.KonstS[j];
+		for (unsigned j = 0; j < func.KonstA.Size(); j++) sfunc->KonstA[j].v = func.KonstA[j];
+
+		sfunc->NumRegD = func.NumRegD;
+		sfunc->NumRegF = func.NumRegF;
+		sfunc->NumRegS = func.NumRegS;
+		sfunc->NumRegA = func.NumRegA;
+		sfunc->MaxParam = func.MaxParam;
+		sfunc->ExtraSpace = func.ExtraSpace;
+		sfunc->StackSize = VMFrame::FrameSize(sfunc->NumRegD, sfunc->NumRegF, sfunc->NumRegS, sfunc->NumRegA, sfunc->MaxParam, sfunc->ExtraSpace);
+		sfunc->NumArgs = func.NumArgs;
+		sfunc->Unsafe = func.Unsafe;
+		sfunc->SourceFileName = func.SourceFileName;
+		if (sfunc->Proto == nullptr)
+		{
+			sfunc->Proto = NewPrototype(func.ReturnTypes, items[i].Func->Variants[0].Proto->ArgumentTypes);
+		}
+		numloaded++;
+	}
+	DPrintf(DMSG_NOTIFY, "Loaded %d of %d script functions from %s\n", numloaded, items.Size(), path.GetChars());
+	return true;
+}
@@ -146,6 +146,8 @@
 #define CVRK	MODE_ACMP | MODE_BV | MODE_CKV
 #define CPRR	MODE_ACMP | MODE_BP | MODE_CP
 #define CPRK	MODE_ACMP | MODE_BP | MODE_CKP
+#define CPKI	MODE_ACMP | MODE_BP | MODE_CKI
+#define CPI8	MODE_ACMP | MODE_BP | MODE_CIMMZ
 
 const VMOpInfo OpInfo[NUM_OPS] =
 {
@@ -330,11 +332,12 @@ void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction
 			break;
 
 		case OP_CALL_K:
+		case OP_CALL_N:
 		case OP_TAIL_K:
 		{
 			callfunc = (VMFunction *)func->KonstA[code[i].a].o;
 			col = printf_wrapper(out, "[%p],%d", callfunc, code[i].b);
-			if (code[i].op == OP_CALL_K)
+			if (code[i].op != OP_TAIL_K)
 			{
 				col += printf_wrapper(out, ",%d", code[i].c);
 			}
@@ -510,7 +513,7 @@ void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction
 			{
 				printf_wrapper(out, ",%d\n", code[++i].i24);
 			}
-			else if (code[i].op == OP_CALL_K || code[i].op == OP_TAIL_K)
+			else if (code[i].op == OP_CALL_K || code[i].op == OP_CALL_N || code[i].op == OP_TAIL_K)
 			{
 				printf_wrapper(out, "  [%s]\n", callfunc->PrintableName.GetChars());
 			}
@@ -641,13 +644,20 @@ static int print_reg(FILE *out, int col, int arg, int mode, int immshift, const
 //
 //==========================================================================
 
-void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen)
+void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int labellen, const VMOP *original, int originalsize)
 {
 	const char *marks = "=======================================================";
 	fprintf(dump, "\n%.*s %s %.*s", MAX(3, 38 - labellen / 2), marks, label, MAX(3, 38 - labellen / 2), marks);
 	fprintf(dump, "\nInteger regs: %-3d  Float regs: %-3d  Address regs: %-3d  String regs: %-3d\nStack size: %d\n",
 		sfunc->NumRegD, sfunc->NumRegF, sfunc->NumRegA, sfunc->NumRegS, sfunc->MaxParam);
 	VMDumpConstants(dump, sfunc);
+	if (original != nullptr)
+	{
+		// The unoptimized code refers to the same constant tables.
+		fprintf(dump, "\nBefore optimization (%d instructions):\n", originalsize);
+		VMDisasm(dump, original, originalsize, sfunc);
+		fprintf(dump, "\nAfter optimization (%d instructions):\n", sfunc->CodeSize);
+	}
 	fprintf(dump, "\nDisassembly @ %p:\n", sfunc->Code);
 	VMDisasm(dump, sfunc->Code, sfunc->CodeSize, sfunc);
 }
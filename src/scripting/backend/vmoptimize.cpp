@@ -0,0 +1,1462 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		Peephole optimizer for the script bytecode.
+//
+//		The code generator emits each expression on its own, so the
+//		result is full of values that get computed into a temporary just
+//		to be moved somewhere else, constants that get loaded into a
+//		register again in every statement and loads whose only purpose
+//		is to be tested once. This cleans up the finished code of a
+//		function before it is handed to the VM:
+//
+//		- jumps to jumps and jumps to returns are shortened
+//		- constants and copies are propagated within basic blocks, and
+//		  arithmetic and branches on known values are folded
+//		- instructions without side effects whose results are never read
+//		  are removed
+//		- a computation into a temporary followed by a move writes the
+//		  final register directly
+//		- a field load that is only tested against zero is fused with
+//		  the test into one instruction
+//		- unreachable code is removed
+//		- registers no instruction refers to anymore are cut off the end
+//		  of the frame
+//
+//		String registers are never rewritten, only trimmed.
+//
+//-----------------------------------------------------------------------------
+
+#include "templates.h"
+#include "vmbuilder.h"
+
+// Register types the optimizer keeps track of.
+enum
+{
+	OPT_INT,
+	OPT_FLOAT,
+	OPT_POINTER,
+	OPT_NUMTYPES
+};
+
+enum
+{
+	FIELD_A,
+	FIELD_B,
+	FIELD_C
+};
+
+static const int OPT_MAXPASSES = 8;
+
+struct FOptRemap
+{
+	uint8_t Op, AltOp, KReg, KType;
+};
+
+// Same table as opRemap in vmbuilder.cpp, used backwards here to find the constant variant of an instruction.
+#define xx(op, name, mode, alt, kreg, ktype) { OP_##op, OP_##alt, kreg, ktype }
+static const FOptRemap OptRemap[NUM_OPS] = {
+#include "vmops.h"
+};
+#undef xx
+
+static int TrackedType(int regtype)
+{
+	switch (regtype)
+	{
+	case REGT_INT:		return OPT_INT;
+	case REGT_FLOAT:	return OPT_FLOAT;
+	case REGT_POINTER:	return OPT_POINTER;
+	default:			return -1;
+	}
+}
+
+//==========================================================================
+//
+// One bit per register for each tracked type
+//
+//==========================================================================
+
+struct FOptRegSet
+{
+	uint32_t Bits[OPT_NUMTYPES][256 / 32];
+
+	void Clear()
+	{
+		memset(Bits, 0, sizeof(Bits));
+	}
+
+	void SetAll()
+	{
+		memset(Bits, 0xff, sizeof(Bits));
+	}
+
+	bool Get(int type, int reg) const
+	{
+		return !!(Bits[type][reg >> 5] & (1u << (reg & 31)));
+	}
+
+	void Set(int type, int reg)
+	{
+		Bits[type][reg >> 5] |= 1u << (reg & 31);
+	}
+
+	void Reset(int type, int reg)
+	{
+		Bits[type][reg >> 5] &= ~(1u << (reg & 31));
+	}
+
+	// this |= other & ~mask. Returns true if anything was added.
+	bool Merge(const FOptRegSet &other, const FOptRegSet *mask = nullptr)
+	{
+		bool changed = false;
+		for (int t = 0; t < OPT_NUMTYPES; t++)
+		{
+			for (int i = 0; i < 256 / 32; i++)
+			{
+				uint32_t bits = other.Bits[t][i];
+				if (mask != nullptr) bits &= ~mask->Bits[t][i];
+				if (bits & ~Bits[t][i])
+				{
+					Bits[t][i] |= bits;
+					changed = true;
+				}
+			}
+		}
+		return changed;
+	}
+};
+
+//==========================================================================
+//
+// Register operands of an instruction
+//
+//==========================================================================
+
+struct FOptOperand
+{
+	uint8_t Type;		// REGT_INT, REGT_FLOAT, REGT_STRING or REGT_POINTER
+	uint8_t Count;		// number of consecutive registers
+	uint8_t Field;		// where the first register's number is stored
+	bool Def;
+};
+
+static int GetField(const VMOP &op, int field)
+{
+	return field == FIELD_A ? op.a : field == FIELD_B ? op.b : op.c;
+}
+
+static void SetField(VMOP &op, int field, int value)
+{
+	if (field == FIELD_A) op.a = value;
+	else if (field == FIELD_B) op.b = value;
+	else op.c = value;
+}
+
+static int VectorSize(int op)
+{
+	switch (op)
+	{
+	case OP_LV2: case OP_LV2_R: case OP_SV2: case OP_SV2_R: case OP_MOVEV2:
+	case OP_NEGV2: case OP_ADDV2_RR: case OP_SUBV2_RR: case OP_DOTV2_RR:
+	case OP_MULVF2_RR: case OP_MULVF2_RK: case OP_DIVVF2_RR: case OP_DIVVF2_RK:
+	case OP_LENV2: case OP_EQV2_R: case OP_EQV2_K:
+		return 2;
+
+	default:
+		return 3;
+	}
+}
+
+// Instructions that have a register in A which is read, not written.
+static bool UsesA(int op)
+{
+	return (op >= OP_SB && op <= OP_SBIT) || op == OP_TEST || op == OP_TESTN || op == OP_IJMP ||
+		op == OP_BOUND || op == OP_BOUND_K || op == OP_BOUND_R || op == OP_CALL || op == OP_TAIL || op == OP_SCOPE;
+}
+
+// Instructions that conditionally skip the following JMP.
+static bool IsSkip(int op)
+{
+	return (OpInfo[op].Mode & MODE_ATYPE) == MODE_ACMP || op == OP_CMPS || op == OP_TEST || op == OP_TESTN;
+}
+
+static bool IsTerminator(const VMOP &op)
+{
+	switch (op.op)
+	{
+	case OP_RET:	return (op.a & RET_FINAL) || op.b == REGT_NIL;
+	case OP_RETI:	return !!(op.a & RET_FINAL);
+	case OP_TAIL:
+	case OP_TAIL_K:
+	case OP_THROW:	return true;
+	default:		return false;
+	}
+}
+
+//==========================================================================
+//
+// Fills in the register operands of an instruction and returns their
+// number, or -1 if the instruction's operands are unknown.
+//
+//==========================================================================
+
+static int GetOperands(const VMOP &op, FOptOperand *opnd)
+{
+	int n = 0;
+	auto add = [&](int type, int count, int field, bool def)
+	{
+		opnd[n++] = { (uint8_t)type, (uint8_t)count, (uint8_t)field, def };
+	};
+
+	switch (op.op)
+	{
+	case OP_PARAM:
+	case OP_RESULT:
+	case OP_RET:
+		if (op.b != REGT_NIL && !(op.b & REGT_KONST))
+		{
+			add(op.b & REGT_TYPE, (op.b & REGT_MULTIREG3) ? 3 : (op.b & REGT_MULTIREG2) ? 2 : 1, FIELD_C, op.op == OP_RESULT);
+		}
+		return n;
+
+	case OP_CAST:
+	case OP_CASTB:
+	{
+		int typea, typeb, countb = 1;
+		switch (op.c)
+		{
+		case CAST_I2F: case CAST_U2F:
+			typea = REGT_FLOAT; typeb = REGT_INT; break;
+		case CAST_F2I: case CAST_F2U: case CASTB_F:
+			typea = REGT_INT; typeb = REGT_FLOAT; break;
+		case CASTB_I:
+			typea = REGT_INT; typeb = REGT_INT; break;
+		case CASTB_A:
+			typea = REGT_INT; typeb = REGT_POINTER; break;
+		case CAST_S2I: case CAST_S2N: case CAST_S2Co: case CAST_S2So: case CASTB_S:
+			typea = REGT_INT; typeb = REGT_STRING; break;
+		case CAST_S2F:
+			typea = REGT_FLOAT; typeb = REGT_STRING; break;
+		case CAST_I2S: case CAST_U2S: case CAST_N2S: case CAST_Co2S: case CAST_So2S: case CAST_SID2S: case CAST_TID2S:
+			typea = REGT_STRING; typeb = REGT_INT; break;
+		case CAST_F2S:
+			typea = REGT_STRING; typeb = REGT_FLOAT; break;
+		case CAST_V22S:
+			typea = REGT_STRING; typeb = REGT_FLOAT; countb = 2; break;
+		case CAST_V32S:
+			typea = REGT_STRING; typeb = REGT_FLOAT; countb = 3; break;
+		case CAST_P2S:
+			typea = REGT_STRING; typeb = REGT_POINTER; break;
+		default:
+			return -1;
+		}
+		add(typea, 1, FIELD_A, true);
+		add(typeb, countb, FIELD_B, false);
+		return n;
+	}
+
+	case OP_MOVEV2:
+	case OP_MOVEV3:
+		add(REGT_FLOAT, VectorSize(op.op), FIELD_A, true);
+		add(REGT_FLOAT, VectorSize(op.op), FIELD_B, false);
+		return n;
+
+	case OP_DOTV2_RR:
+	case OP_DOTV3_RR:
+		add(REGT_FLOAT, 1, FIELD_A, true);
+		add(REGT_FLOAT, VectorSize(op.op), FIELD_B, false);
+		add(REGT_FLOAT, VectorSize(op.op), FIELD_C, false);
+		return n;
+
+	case OP_CMPS:
+		if (!(op.a & CMP_BK)) add(REGT_STRING, 1, FIELD_B, false);
+		if (!(op.a & CMP_CK)) add(REGT_STRING, 1, FIELD_C, false);
+		return n;
+
+	case OP_THROW:
+		if (op.a == 0) add(REGT_POINTER, 1, FIELD_B, false);
+		return n;
+
+	default:
+		break;
+	}
+
+	int mode = OpInfo[op.op].Mode;
+	int modes[3] = { (mode & MODE_ATYPE) >> MODE_ASHIFT, (mode & MODE_BTYPE) >> MODE_BSHIFT, (mode & MODE_CTYPE) >> MODE_CSHIFT };
+	// B and C form a single immediate or constant if the BC type is set, even without MODE_BCJOINT.
+	int lastfield = (mode & MODE_BCTYPE) ? FIELD_A : FIELD_C;
+	for (int field = FIELD_A; field <= lastfield; field++)
+	{
+		int type;
+		switch (modes[field])
+		{
+		case MODE_I:	type = REGT_INT; break;
+		case MODE_F:
+		case MODE_V:	type = REGT_FLOAT; break;
+		case MODE_S:	type = REGT_STRING; break;
+		case MODE_P:	type = REGT_POINTER; break;
+		case MODE_X:	return -1;
+		default:		continue;
+		}
+		add(type, modes[field] == MODE_V ? VectorSize(op.op) : 1, field, field == FIELD_A && !UsesA(op.op));
+	}
+	return n;
+}
+
+//==========================================================================
+//
+// Instructions that can be removed if nothing reads their result,
+// i.e. those that can neither throw nor change anything but registers.
+//
+//==========================================================================
+
+static bool IsPure(const VMOP &op)
+{
+	switch (op.op)
+	{
+	case OP_LI: case OP_LK: case OP_LKF: case OP_LKP: case OP_LK_R: case OP_LKF_R: case OP_LKP_R: case OP_LFP:
+	case OP_MOVE: case OP_MOVEF: case OP_MOVEA: case OP_MOVEV2: case OP_MOVEV3:
+	case OP_DYNCAST_R: case OP_DYNCAST_K: case OP_DYNCASTC_R: case OP_DYNCASTC_K:
+	case OP_SLL_RR: case OP_SLL_RI: case OP_SLL_KR: case OP_SRL_RR: case OP_SRL_RI: case OP_SRL_KR:
+	case OP_SRA_RR: case OP_SRA_RI: case OP_SRA_KR:
+	case OP_ADD_RR: case OP_ADD_RK: case OP_ADDI: case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:
+	case OP_MUL_RR: case OP_MUL_RK: case OP_AND_RR: case OP_AND_RK: case OP_OR_RR: case OP_OR_RK:
+	case OP_XOR_RR: case OP_XOR_RK: case OP_MIN_RR: case OP_MIN_RK: case OP_MAX_RR: case OP_MAX_RK:
+	case OP_ABS: case OP_NEG: case OP_NOT:
+	case OP_ADDF_RR: case OP_ADDF_RK: case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:
+	case OP_MULF_RR: case OP_MULF_RK: case OP_POWF_RR: case OP_POWF_RK: case OP_POWF_KR:
+	case OP_MINF_RR: case OP_MINF_RK: case OP_MAXF_RR: case OP_MAXF_RK: case OP_ATAN2: case OP_FLOP:
+	case OP_NEGV2: case OP_ADDV2_RR: case OP_SUBV2_RR: case OP_DOTV2_RR: case OP_MULVF2_RR: case OP_MULVF2_RK: case OP_LENV2:
+	case OP_NEGV3: case OP_ADDV3_RR: case OP_SUBV3_RR: case OP_DOTV3_RR: case OP_CROSSV_RR: case OP_MULVF3_RR: case OP_MULVF3_RK: case OP_LENV3:
+	case OP_ADDA_RR: case OP_ADDA_RK: case OP_SUBA:
+		return true;
+
+	case OP_CAST:
+		return op.c == CAST_I2F || op.c == CAST_U2F || op.c == CAST_F2I || op.c == CAST_F2U;
+
+	case OP_CASTB:
+		return op.c == CASTB_I || op.c == CASTB_F || op.c == CASTB_A;
+
+	default:
+		return false;
+	}
+}
+
+static bool IsFinalReturn(const VMOP &op)
+{
+	return (op.op == OP_RET || op.op == OP_RETI) && IsTerminator(op);
+}
+
+//==========================================================================
+//
+// FBytecodeOptimizer
+//
+//==========================================================================
+
+class FBytecodeOptimizer
+{
+public:
+	FBytecodeOptimizer(VMFunctionBuilder *build) : Build(build), Code(build->Code) {}
+	void Run();
+
+private:
+	struct FKnown
+	{
+		bool Valid;
+		int Copy;			// register this one holds a copy of, or -1
+		union
+		{
+			int Int;
+			double Float;
+			void *Pointer;
+		};
+	};
+
+	int Successors(int i, int *succ);
+	bool CheckJumps();
+	void BuildFlow();
+	void ComputeLiveness();
+	bool ThreadJumps();
+	bool Propagate();
+	bool Sweep();
+	bool Compact();
+	void TrimRegisters();
+
+	void Delete(int i);
+	bool IsLive(const FOptRegSet &live, int type, int reg) const;
+	void ForgetRegister(int type, int reg);
+	bool IntValue(const VMOP &op, int field, int &value);
+	void LoadInt(VMOP &op, int reg, int value);
+	bool FoldInt(int i);
+	bool FoldBranch(int i);
+	bool SubstituteConstant(VMOP &op, const FOptOperand &opnd, const FKnown &known);
+	bool Coalesce(int i, const FOptRegSet &live);
+	bool Fuse(int i, const FOptRegSet &live);
+
+	VMFunctionBuilder *Build;
+	TArray<VMOP> &Code;
+
+	FOptRegSet Escaped;				// registers whose address gets passed to a function
+	TArray<int> Targeted;			// number of jumps to each instruction
+	TArray<int> BlockStart;			// first instruction of each block, plus the end
+	TArray<int> BlockOf;			// block of each instruction, plus the end
+	TArray<FOptRegSet> LiveIn, LiveOut;
+	FKnown Known[OPT_NUMTYPES][256];
+};
+
+//==========================================================================
+//
+// Returns the number of instructions that may execute after instruction i.
+// Code.Size() stands for leaving the function.
+//
+//==========================================================================
+
+int FBytecodeOptimizer::Successors(int i, int *succ)
+{
+	const VMOP &op = Code[i];
+	if (op.op == OP_JMP)
+	{
+		succ[0] = i + 1 + op.i24;
+		return 1;
+	}
+	if (IsTerminator(op))
+	{
+		return 0;
+	}
+	if (IsSkip(op.op))
+	{
+		succ[0] = i + 1;
+		succ[1] = i + 2;
+		return 2;
+	}
+	succ[0] = i + 1;
+	return 1;
+}
+
+//==========================================================================
+//
+// Makes sure that the code has nothing the optimizer does not understand.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::CheckJumps()
+{
+	int n = Code.Size();
+	for (int i = 0; i < n; i++)
+	{
+		if (Code[i].op == OP_IJMP)
+		{
+			return false;	// jump tables depend on the exact code layout
+		}
+		if (Code[i].op == OP_JMP)
+		{
+			int target = i + 1 + Code[i].i24;
+			if (target < 0 || target > n) return false;
+		}
+		else if (IsSkip(Code[i].op) && (i + 1 >= n || Code[i + 1].op != OP_JMP))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Splits the code into basic blocks
+//
+//==========================================================================
+
+void FBytecodeOptimizer::BuildFlow()
+{
+	int n = Code.Size();
+	TArray<uint8_t> leader;
+
+	leader.Resize(n + 1);
+	Targeted.Resize(n + 1);
+	for (int i = 0; i <= n; i++)
+	{
+		leader[i] = false;
+		Targeted[i] = 0;
+	}
+	leader[0] = true;
+
+	for (int i = 0; i < n; i++)
+	{
+		int succ[2];
+		int count = Successors(i, succ);
+		if (Code[i].op == OP_JMP)
+		{
+			Targeted[succ[0]]++;
+			leader[succ[0]] = true;
+			leader[i + 1] = true;
+		}
+		else if (count != 1)
+		{
+			for (int j = 0; j < count; j++) leader[succ[j]] = true;
+			leader[i + 1] = true;
+		}
+	}
+
+	BlockStart.Clear();
+	BlockOf.Resize(n + 1);
+	for (int i = 0; i < n; i++)
+	{
+		if (leader[i]) BlockStart.Push(i);
+		BlockOf[i] = BlockStart.Size() - 1;
+	}
+	BlockOf[n] = BlockStart.Size();
+	BlockStart.Push(n);
+}
+
+//==========================================================================
+//
+// Calculates the registers that are live at the end of each block
+//
+//==========================================================================
+
+void FBytecodeOptimizer::ComputeLiveness()
+{
+	int numblocks = BlockStart.Size() - 1;
+	TArray<FOptRegSet> gen, kill;
+
+	gen.Resize(numblocks);
+	kill.Resize(numblocks);
+	LiveIn.Resize(numblocks);
+	LiveOut.Resize(numblocks);
+
+	for (int b = 0; b < numblocks; b++)
+	{
+		gen[b].Clear();
+		kill[b].Clear();
+		LiveIn[b].Clear();
+		LiveOut[b].Clear();
+
+		for (int i = BlockStart[b]; i < BlockStart[b + 1]; i++)
+		{
+			FOptOperand opnd[4];
+			int count = GetOperands(Code[i], opnd);
+			if (count < 0)
+			{
+				FOptRegSet all;
+				all.SetAll();
+				gen[b].Merge(all, &kill[b]);
+				continue;
+			}
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				if (type < 0 || opnd[j].Def) continue;
+				for (int r = GetField(Code[i], opnd[j].Field), k = 0; k < opnd[j].Count && r < 256; k++, r++)
+				{
+					if (!kill[b].Get(type, r)) gen[b].Set(type, r);
+				}
+			}
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				if (type < 0 || !opnd[j].Def) continue;
+				for (int r = GetField(Code[i], opnd[j].Field), k = 0; k < opnd[j].Count && r < 256; k++, r++)
+				{
+					kill[b].Set(type, r);
+				}
+			}
+		}
+	}
+
+	bool changed;
+	do
+	{
+		changed = false;
+		for (int b = numblocks - 1; b >= 0; b--)
+		{
+			int succ[2];
+			int count = Successors(BlockStart[b + 1] - 1, succ);
+			for (int j = 0; j < count; j++)
+			{
+				int sb = BlockOf[succ[j]];
+				if (sb < numblocks) LiveOut[b].Merge(LiveIn[sb]);
+			}
+			changed |= LiveIn[b].Merge(gen[b]);
+			changed |= LiveIn[b].Merge(LiveOut[b], &kill[b]);
+		}
+	} while (changed);
+}
+
+bool FBytecodeOptimizer::IsLive(const FOptRegSet &live, int type, int reg) const
+{
+	return live.Get(type, reg) || Escaped.Get(type, reg);
+}
+
+//==========================================================================
+//
+// Replaces an instruction with a NOP which Compact will remove.
+//
+//==========================================================================
+
+void FBytecodeOptimizer::Delete(int i)
+{
+	Code[i].word = 0;
+	Code[i].op = OP_NOP;
+}
+
+//==========================================================================
+//
+// Shortens chains of jumps, turns jumps to a return into the return
+// and removes jumps to the next instruction.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::ThreadJumps()
+{
+	bool changed = false;
+	int n = Code.Size();
+	for (int i = 0; i < n; i++)
+	{
+		if (Code[i].op != OP_JMP) continue;
+
+		int target = i + 1 + Code[i].i24;
+		for (int hops = 0; target < n && hops < 16; hops++)
+		{
+			int next;
+			if (Code[target].op == OP_NOP) next = target + 1;
+			else if (Code[target].op == OP_JMP) next = target + 1 + Code[target].i24;
+			else break;
+			if (next == target || next == i) break;
+			target = next;
+		}
+		if (target != i + 1 + Code[i].i24)
+		{
+			Code[i].i24 = target - i - 1;
+			changed = true;
+		}
+
+		// The JMP after a conditional instruction must stay where it is.
+		if (i > 0 && IsSkip(Code[i - 1].op))
+		{
+			continue;
+		}
+		if (target < n && IsFinalReturn(Code[target]))
+		{
+			Code[i] = Code[target];
+			changed = true;
+		}
+		else if (target == i + 1)
+		{
+			Delete(i);
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+//==========================================================================
+//
+// Forgets what is known about a register that gets written.
+//
+//==========================================================================
+
+void FBytecodeOptimizer::ForgetRegister(int type, int reg)
+{
+	Known[type][reg].Valid = false;
+	Known[type][reg].Copy = -1;
+	for (auto &k : Known[type])
+	{
+		if (k.Copy == reg) k.Copy = -1;
+	}
+}
+
+//==========================================================================
+//
+// Gets the value of an integer operand if it is a constant.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::IntValue(const VMOP &op, int field, int &value)
+{
+	int mode = OpInfo[op.op].Mode;
+	int fieldmode = field == FIELD_A ? (mode & MODE_ATYPE) >> MODE_ASHIFT : field == FIELD_B ? (mode & MODE_BTYPE) >> MODE_BSHIFT : (mode & MODE_CTYPE) >> MODE_CSHIFT;
+	int arg = GetField(op, field);
+
+	switch (fieldmode)
+	{
+	case MODE_I:
+		if (Escaped.Get(OPT_INT, arg) || !Known[OPT_INT][arg].Valid) return false;
+		value = Known[OPT_INT][arg].Int;
+		return true;
+
+	case MODE_KI:
+		value = Build->IntConstantList[arg];
+		return true;
+
+	case MODE_IMMS:
+		value = field == FIELD_C ? op.cs : op.bs;
+		return true;
+
+	case MODE_IMMZ:
+		value = arg;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// Turns op into an instruction that loads an integer constant.
+//
+//==========================================================================
+
+void FBytecodeOptimizer::LoadInt(VMOP &op, int reg, int value)
+{
+	op.word = 0;
+	op.a = reg;
+	if (value >= -32768 && value <= 32767)
+	{
+		op.op = OP_LI;
+		op.i16 = value;
+	}
+	else
+	{
+		op.op = OP_LK;
+		op.i16u = Build->GetConstantInt(value);
+	}
+}
+
+//==========================================================================
+//
+// Integer arithmetic on constants. Anything that would throw or is
+// undefined is left for runtime.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::FoldInt(int i)
+{
+	VMOP &op = Code[i];
+	int b, c, result;
+
+	switch (op.op)
+	{
+	case OP_ABS: case OP_NEG: case OP_NOT:
+		if (!IntValue(op, FIELD_B, b)) return false;
+		result = op.op == OP_ABS ? (b < 0 ? int(0u - unsigned(b)) : b) : op.op == OP_NEG ? int(0u - unsigned(b)) : ~b;
+		break;
+
+	case OP_ADD_RR: case OP_ADD_RK: case OP_ADDI: case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:
+	case OP_MUL_RR: case OP_MUL_RK: case OP_AND_RR: case OP_AND_RK: case OP_OR_RR: case OP_OR_RK:
+	case OP_XOR_RR: case OP_XOR_RK: case OP_MIN_RR: case OP_MIN_RK: case OP_MAX_RR: case OP_MAX_RK:
+	case OP_SLL_RR: case OP_SLL_RI: case OP_SLL_KR: case OP_SRL_RR: case OP_SRL_RI: case OP_SRL_KR:
+	case OP_SRA_RR: case OP_SRA_RI: case OP_SRA_KR:
+	case OP_DIV_RR: case OP_DIV_RK: case OP_DIV_KR: case OP_DIVU_RR: case OP_DIVU_RK: case OP_DIVU_KR:
+	case OP_MOD_RR: case OP_MOD_RK: case OP_MOD_KR: case OP_MODU_RR: case OP_MODU_RK: case OP_MODU_KR:
+		if (!IntValue(op, FIELD_B, b) || !IntValue(op, FIELD_C, c)) return false;
+		switch (op.op)
+		{
+		case OP_ADD_RR: case OP_ADD_RK: case OP_ADDI:	result = int(unsigned(b) + unsigned(c)); break;
+		case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:	result = int(unsigned(b) - unsigned(c)); break;
+		case OP_MUL_RR: case OP_MUL_RK:					result = int(unsigned(b) * unsigned(c)); break;
+		case OP_AND_RR: case OP_AND_RK:					result = b & c; break;
+		case OP_OR_RR: case OP_OR_RK:					result = b | c; break;
+		case OP_XOR_RR: case OP_XOR_RK:					result = b ^ c; break;
+		case OP_MIN_RR: case OP_MIN_RK:					result = b < c ? b : c; break;
+		case OP_MAX_RR: case OP_MAX_RK:					result = b > c ? b : c; break;
+
+		case OP_SLL_RR: case OP_SLL_RI: case OP_SLL_KR:
+			if (c < 0 || c > 31) return false;
+			result = int(unsigned(b) << c);
+			break;
+
+		case OP_SRL_RR: case OP_SRL_RI: case OP_SRL_KR:
+			if (c < 0 || c > 31) return false;
+			result = int(unsigned(b) >> c);
+			break;
+
+		case OP_SRA_RR: case OP_SRA_RI: case OP_SRA_KR:
+			if (c < 0 || c > 31) return false;
+			result = b >> c;
+			break;
+
+		case OP_DIV_RR: case OP_DIV_RK: case OP_DIV_KR:
+		case OP_MOD_RR: case OP_MOD_RK: case OP_MOD_KR:
+			if (c == 0 || (c == -1 && b == INT_MIN)) return false;
+			result = (op.op == OP_DIV_RR || op.op == OP_DIV_RK || op.op == OP_DIV_KR) ? b / c : b % c;
+			break;
+
+		default:
+			if (c == 0) return false;
+			result = (op.op == OP_DIVU_RR || op.op == OP_DIVU_RK || op.op == OP_DIVU_KR) ? int(unsigned(b) / unsigned(c)) : int(unsigned(b) % unsigned(c));
+			break;
+		}
+		break;
+
+	default:
+		return false;
+	}
+	LoadInt(op, op.a, result);
+	return true;
+}
+
+//==========================================================================
+//
+// Resolves an integer compare or switch test on constants. If the
+// branch is never taken, its JMP goes away as well, unless something
+// else jumps to it.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::FoldBranch(int i)
+{
+	VMOP &op = Code[i];
+	int b, c;
+	bool taken;
+
+	switch (op.op)
+	{
+	case OP_EQ_R: case OP_EQ_K: case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:
+	case OP_LE_RR: case OP_LE_RK: case OP_LE_KR: case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:
+	case OP_LEU_RR: case OP_LEU_RK: case OP_LEU_KR:
+	{
+		if (!IntValue(op, FIELD_B, b) || !IntValue(op, FIELD_C, c)) return false;
+		bool test;
+		switch (op.op)
+		{
+		case OP_EQ_R: case OP_EQ_K:						test = b == c; break;
+		case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:	test = b < c; break;
+		case OP_LE_RR: case OP_LE_RK: case OP_LE_KR:	test = b <= c; break;
+		case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:	test = unsigned(b) < unsigned(c); break;
+		default:										test = unsigned(b) <= unsigned(c); break;
+		}
+		taken = test == !!(op.a & CMP_CHECK);
+		break;
+	}
+
+	case OP_TEST:
+	case OP_TESTN:
+		if (Escaped.Get(OPT_INT, op.a) || !Known[OPT_INT][op.a].Valid) return false;
+		b = Known[OPT_INT][op.a].Int;
+		taken = unsigned(op.op == OP_TEST ? b : int(0u - unsigned(b))) == op.i16u;
+		break;
+
+	default:
+		return false;
+	}
+
+	if (!taken)
+	{
+		if (Targeted[i + 1] > 0) return false;
+		Delete(i + 1);
+	}
+	Delete(i);
+	return true;
+}
+
+//==========================================================================
+//
+// Replaces a register operand whose value is known with a constant.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::SubstituteConstant(VMOP &op, const FOptOperand &opnd, const FKnown &known)
+{
+	int type = TrackedType(opnd.Type);
+	int newop = -1;
+	int maxindex = 255;
+
+	switch (op.op)
+	{
+	case OP_MOVE:
+		LoadInt(op, op.a, known.Int);
+		return true;
+
+	case OP_MOVEF:
+	case OP_MOVEA:
+		newop = op.op == OP_MOVEF ? OP_LKF : OP_LKP;
+		maxindex = 65535;
+		break;
+
+	case OP_PARAM:
+		if (op.b & REGT_ADDROF) return false;
+		if (type == OPT_INT && ((known.Int << 8) >> 8) == known.Int)
+		{
+			op.op = OP_PARAMI;
+			op.i24 = known.Int;
+			return true;
+		}
+		newop = OP_PARAM;
+		break;
+
+	case OP_RET:
+		if (type == OPT_INT && known.Int >= -32768 && known.Int <= 32767)
+		{
+			op.op = OP_RETI;
+			op.i16 = known.Int;
+			return true;
+		}
+		newop = OP_RET;
+		break;
+
+	default:
+	{
+		// Look for an instruction that takes a constant in place of this operand.
+		static const uint8_t kregs[] = { 1, 2, 4 };
+		for (auto &remap : OptRemap)
+		{
+			if (remap.AltOp == op.op && remap.Op != op.op && remap.KReg == kregs[opnd.Field] && TrackedType(remap.KType) == type)
+			{
+				newop = remap.Op;
+				break;
+			}
+		}
+		break;
+	}
+	}
+	if (newop < 0)
+	{
+		return false;
+	}
+
+	unsigned index;
+	switch (type)
+	{
+	case OPT_INT:
+		index = Build->GetConstantInt(known.Int);
+		break;
+
+	case OPT_FLOAT:
+		// The constant table does not tell 0 and -0 apart.
+		index = Build->GetConstantFloat(known.Float);
+		if (memcmp(&Build->FloatConstantList[index], &known.Float, sizeof(double))) return false;
+		break;
+
+	default:
+		index = Build->GetConstantAddress(known.Pointer);
+		break;
+	}
+	if (index > (unsigned)maxindex)
+	{
+		return false;
+	}
+
+	op.op = newop;
+	if (newop == OP_LKF || newop == OP_LKP)
+	{
+		op.i16u = index;
+	}
+	else if (newop == OP_PARAM || newop == OP_RET)
+	{
+		op.b |= REGT_KONST;
+		op.c = index;
+	}
+	else
+	{
+		SetField(op, opnd.Field, index);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// Constant and copy propagation, one basic block at a time.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::Propagate()
+{
+	bool changed = false;
+
+	for (unsigned b = 0; b + 1 < BlockStart.Size(); b++)
+	{
+		for (auto &type : Known)
+		{
+			for (auto &k : type)
+			{
+				k.Valid = false;
+				k.Copy = -1;
+			}
+		}
+
+		for (int i = BlockStart[b]; i < BlockStart[b + 1]; i++)
+		{
+			VMOP &op = Code[i];
+			FOptOperand opnd[4];
+			int count = GetOperands(op, opnd);
+			if (count < 0)
+			{
+				for (int t = 0; t < OPT_NUMTYPES; t++)
+				{
+					for (int r = 0; r < 256; r++) ForgetRegister(t, r);
+				}
+				continue;
+			}
+
+			// Read the source of a copy instead of the copy itself.
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				int reg = GetField(op, opnd[j].Field);
+				if (opnd[j].Def || opnd[j].Count != 1 || type < 0 || Escaped.Get(type, reg)) continue;
+				if (Known[type][reg].Copy >= 0)
+				{
+					SetField(op, opnd[j].Field, Known[type][reg].Copy);
+					changed = true;
+				}
+			}
+
+			if (FoldBranch(i))
+			{
+				changed = true;
+				break;		// the rest of the block belongs to the JMP
+			}
+			if (FoldInt(i))
+			{
+				changed = true;
+			}
+			else
+			{
+				for (int j = 0; j < count; j++)
+				{
+					int type = TrackedType(opnd[j].Type);
+					int reg = GetField(op, opnd[j].Field);
+					if (opnd[j].Def || opnd[j].Count != 1 || type < 0 || Escaped.Get(type, reg) || !Known[type][reg].Valid) continue;
+					if (SubstituteConstant(op, opnd[j], Known[type][reg]))
+					{
+						changed = true;
+						break;
+					}
+				}
+			}
+
+			count = GetOperands(op, opnd);
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				if (!opnd[j].Def || type < 0) continue;
+				for (int r = GetField(op, opnd[j].Field), k = 0; k < opnd[j].Count && r < 256; k++, r++)
+				{
+					ForgetRegister(type, r);
+				}
+			}
+
+			int type = -1;
+			switch (op.op)
+			{
+			case OP_LI:		type = OPT_INT; Known[type][op.a].Int = op.i16; break;
+			case OP_LK:		type = OPT_INT; Known[type][op.a].Int = Build->IntConstantList[op.i16u]; break;
+			case OP_LKF:	type = OPT_FLOAT; Known[type][op.a].Float = Build->FloatConstantList[op.i16u]; break;
+			case OP_LKP:	type = OPT_POINTER; Known[type][op.a].Pointer = Build->AddressConstantList[op.i16u]; break;
+
+			case OP_MOVE:
+			case OP_MOVEF:
+			case OP_MOVEA:
+			{
+				int t = op.op == OP_MOVE ? OPT_INT : op.op == OP_MOVEF ? OPT_FLOAT : OPT_POINTER;
+				if (op.a != op.b && !Escaped.Get(t, op.a) && !Escaped.Get(t, op.b))
+				{
+					Known[t][op.a].Copy = op.b;
+				}
+				break;
+			}
+
+			default:
+				break;
+			}
+			if (type >= 0 && !Escaped.Get(type, op.a))
+			{
+				Known[type][op.a].Valid = true;
+			}
+		}
+	}
+	return changed;
+}
+
+//==========================================================================
+//
+// x = op(...); y = x  ->  y = op(...)  if x is not needed anymore.
+// i is the MOVE, live the registers that are live after it.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::Coalesce(int i, const FOptRegSet &live)
+{
+	VMOP &move = Code[i];
+	int type = move.op == OP_MOVE ? OPT_INT : move.op == OP_MOVEF ? OPT_FLOAT : OPT_POINTER;
+	int dest = move.a, src = move.b;
+
+	if (BlockStart[BlockOf[i]] == i || IsLive(live, type, src) || Escaped.Get(type, dest))
+	{
+		return false;
+	}
+
+	VMOP &prev = Code[i - 1];
+	FOptOperand opnd[4];
+	int count = GetOperands(prev, opnd);
+	int def = -1;
+	for (int j = 0; j < count; j++)
+	{
+		if (!opnd[j].Def) continue;
+		if (def >= 0) return false;
+		def = j;
+	}
+	if (def < 0 || TrackedType(opnd[def].Type) != type || opnd[def].Count != 1 || GetField(prev, opnd[def].Field) != src)
+	{
+		return false;
+	}
+
+	// All results of a call get written at the same time.
+	if (prev.op == OP_RESULT)
+	{
+		for (int j = i - 2; j >= 0 && Code[j].op == OP_RESULT; j--)
+		{
+			if (Code[j].c == dest && TrackedType(Code[j].b & REGT_TYPE) == type) return false;
+		}
+	}
+
+	SetField(prev, opnd[def].Field, dest);
+	Delete(i);
+	return true;
+}
+
+//==========================================================================
+//
+// A load into a register that is only tested against zero right after
+// becomes a single instruction. i is the test, live the registers that
+// are live after it.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::Fuse(int i, const FOptRegSet &live)
+{
+	VMOP &test = Code[i];
+	VMOP &prev = Code[i - 1];
+	int fused;
+
+	if (BlockStart[BlockOf[i]] == i || (test.a & ~CMP_CHECK) != 0)
+	{
+		return false;
+	}
+	if (test.op == OP_EQ_K)
+	{
+		if (Build->IntConstantList[test.c] != 0 || IsLive(live, OPT_INT, test.b)) return false;
+		switch (prev.op)
+		{
+		case OP_LB:
+		case OP_LBU:	fused = OP_EQ_LB; break;
+		case OP_LW:		fused = OP_EQ_LW; break;
+		case OP_LBIT:	fused = OP_EQ_LBIT; break;
+		default:		return false;
+		}
+	}
+	else if (test.op == OP_EQA_K)
+	{
+		if (Build->AddressConstantList[test.c] != nullptr || IsLive(live, OPT_POINTER, test.b)) return false;
+		switch (prev.op)
+		{
+		case OP_LP:		fused = OP_EQA_LP; break;
+		case OP_LO:		fused = OP_EQA_LO; break;
+		default:		return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+	if (prev.a != test.b)
+	{
+		return false;
+	}
+
+	// The JMP has to follow the test, so the fused instruction goes where the test was.
+	test.op = fused;
+	test.b = prev.b;
+	test.c = prev.c;
+	Delete(i - 1);
+	return true;
+}
+
+//==========================================================================
+//
+// Removes dead instructions and does the transformations that need to
+// know which registers are still needed. Works backwards through each
+// block so that removing one instruction can free its inputs right away.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::Sweep()
+{
+	bool changed = false;
+
+	for (unsigned b = 0; b + 1 < BlockStart.Size(); b++)
+	{
+		FOptRegSet live = LiveOut[b];
+
+		for (int i = BlockStart[b + 1] - 1; i >= BlockStart[b]; i--)
+		{
+			VMOP &op = Code[i];
+			if (op.op == OP_NOP)
+			{
+				continue;
+			}
+
+			FOptOperand opnd[4];
+			int count = GetOperands(op, opnd);
+			if (count < 0)
+			{
+				live.SetAll();
+				continue;
+			}
+
+			if (IsPure(op))
+			{
+				bool dead = true;
+				for (int j = 0; j < count && dead; j++)
+				{
+					int type = TrackedType(opnd[j].Type);
+					if (!opnd[j].Def) continue;
+					if (type < 0) dead = false;
+					for (int r = GetField(op, opnd[j].Field), k = 0; k < opnd[j].Count && r < 256 && dead; k++, r++)
+					{
+						if (IsLive(live, type, r)) dead = false;
+					}
+				}
+				if (dead || ((op.op == OP_MOVE || op.op == OP_MOVEF || op.op == OP_MOVEA) && op.a == op.b))
+				{
+					Delete(i);
+					changed = true;
+					continue;
+				}
+			}
+			if ((op.op == OP_MOVE || op.op == OP_MOVEF || op.op == OP_MOVEA) && Coalesce(i, live))
+			{
+				changed = true;
+				continue;
+			}
+			if ((op.op == OP_EQ_K || op.op == OP_EQA_K) && Fuse(i, live))
+			{
+				changed = true;
+				count = GetOperands(op, opnd);
+			}
+
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				if (!opnd[j].Def || type < 0) continue;
+				for (int r = GetField(op, opnd[j].Field), k = 0; k < opnd[j].Count && r < 256; k++, r++)
+				{
+					live.Reset(type, r);
+				}
+			}
+			for (int j = 0; j < count; j++)
+			{
+				int type = TrackedType(opnd[j].Type);
+				if (opnd[j].Def || type < 0) continue;
+				for (int r = GetField(op, opnd[j].Field), k = 0; k < opnd[j].Count && r < 256; k++, r++)
+				{
+					live.Set(type, r);
+				}
+			}
+		}
+	}
+	return changed;
+}
+
+//==========================================================================
+//
+// Removes deleted and unreachable instructions and fixes up the jumps
+// and line numbers.
+//
+//==========================================================================
+
+bool FBytecodeOptimizer::Compact()
+{
+	int n = Code.Size();
+	TArray<uint8_t> reached;
+	TArray<int> stack;
+	TArray<int> newindex;
+
+	reached.Resize(n);
+	for (auto &r : reached) r = false;
+	reached[0] = true;
+	stack.Push(0);
+
+	int i;
+	while (stack.Pop(i))
+	{
+		int succ[2];
+		int count = Successors(i, succ);
+		for (int j = 0; j < count; j++)
+		{
+			if (succ[j] < n && !reached[succ[j]])
+			{
+				reached[succ[j]] = true;
+				stack.Push(succ[j]);
+			}
+		}
+	}
+
+	newindex.Resize(n + 1);
+	int kept = 0;
+	for (i = 0; i < n; i++)
+	{
+		newindex[i] = kept;
+		if (reached[i] && Code[i].op != OP_NOP) kept++;
+	}
+	newindex[n] = kept;
+	if (kept == n)
+	{
+		return false;
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (!reached[i] || Code[i].op == OP_NOP) continue;
+		if (Code[i].op == OP_JMP)
+		{
+			Code[i].i24 = newindex[i + 1 + Code[i].i24] - newindex[i] - 1;
+		}
+		Code[newindex[i]] = Code[i];
+	}
+	Code.Resize(kept);
+
+	// When several statements lose all of their code, the last one's line is the one that is left.
+	auto &lines = Build->LineNumbers;
+	unsigned numlines = 0;
+	for (auto &line : lines)
+	{
+		int index = newindex[line.InstructionIndex < n ? line.InstructionIndex : n];
+		if (index >= kept) continue;
+		if (numlines > 0 && lines[numlines - 1].InstructionIndex == index) numlines--;
+		lines[numlines].InstructionIndex = (uint16_t)index;
+		lines[numlines].LineNumber = line.LineNumber;
+		numlines++;
+	}
+	lines.Resize(numlines);
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FBytecodeOptimizer::Run()
+{
+	if (Code.Size() == 0 || !CheckJumps())
+	{
+		return;
+	}
+
+	Escaped.Clear();
+	for (auto &op : Code)
+	{
+		if (op.op == OP_PARAM && (op.b & REGT_ADDROF))
+		{
+			int type = TrackedType(op.b & REGT_TYPE);
+			int count = (op.b & REGT_MULTIREG3) ? 3 : (op.b & REGT_MULTIREG2) ? 2 : 1;
+			for (int r = op.c; type >= 0 && r < op.c + count && r < 256; r++)
+			{
+				Escaped.Set(type, r);
+			}
+		}
+	}
+
+	for (int pass = 0; pass < OPT_MAXPASSES; pass++)
+	{
+		bool changed = ThreadJumps();
+		changed |= Compact();
+
+		BuildFlow();
+		if (Propagate())
+		{
+			changed = true;
+			Compact();
+			BuildFlow();
+		}
+
+		ComputeLiveness();
+		if (Sweep())
+		{
+			changed = true;
+			Compact();
+		}
+		if (!changed)
+		{
+			break;
+		}
+	}
+	TrimRegisters();
+}
+
+//==========================================================================
+//
+// Lowers each register type's count to the highest register the code
+// still refers to, which makes frames smaller and saves constructing and
+// destroying string registers nobody uses. The arguments' registers stay,
+// since the caller writes them either way.
+//
+//==========================================================================
+
+void FBytecodeOptimizer::TrimRegisters()
+{
+	FOptOperand opnd[4];
+	int used[4];
+
+	for (int type = 0; type < 4; type++)
+	{
+		used[type] = Build->NumArgRegs[type];
+	}
+	for (auto &op : Code)
+	{
+		int count = GetOperands(op, opnd);
+		if (count < 0)
+		{
+			return;
+		}
+		for (int j = 0; j < count; j++)
+		{
+			int end = GetField(op, opnd[j].Field) + opnd[j].Count;
+			used[opnd[j].Type] = MAX(used[opnd[j].Type], end);
+		}
+	}
+	for (int type = 0; type < 4; type++)
+	{
+		auto &regs = Build->Registers[type];
+		regs.MostUsed = MIN(regs.MostUsed, used[type]);
+	}
+}
+
+//==========================================================================
+//
+// VMFunctionBuilder :: Optimize
+//
+// Runs the peephole optimizer over the finished code. If original is
+// given, it receives a copy of the code as it was emitted.
+//
+//==========================================================================
+
+void VMFunctionBuilder::Optimize(TArray<VMOP> *original)
+{
+	if (original != nullptr)
+	{
+		*original = Code;
+	}
+	FBytecodeOptimizer optimizer(this);
+	optimizer.Run();
+}
@@ -1278,6 +1278,7 @@ void ParseDecorate (FScanner &sc, PNamespace *ns)
 			}
 			FScanner newscanner;
 			newscanner.Open(sc.String);
+			FunctionBuildList.AddScriptLump(newscanner.LumpNum);
 			ParseDecorate(newscanner, ns);
 			break;
 		}
@@ -1342,6 +1343,7 @@ void ParseAllDecorate()
 	{
 		FScanner sc(lump);
 		auto ns = Namespaces.NewNamespace(sc.LumpNum);
+		FunctionBuildList.AddScriptLump(lump);
 		ParseDecorate(sc, ns);
 	}
 }
\ No newline at end of file
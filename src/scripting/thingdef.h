@@ -192,6 +192,7 @@ inline void ResetBaggage (Baggage *bag, PClassActor *stateclass)
 
 AFuncDesc *FindFunction(PContainerType *cls, const char * string);
 FieldDesc *FindField(PContainerType *cls, const char * string);
+const TArray<FieldDesc> &GetNativeFields();
 
 
 FxExpression *ParseExpression(FScanner &sc, PClassActor *cls, PNamespace *resolvenspc = nullptr);
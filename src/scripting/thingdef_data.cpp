@@ -731,6 +731,18 @@ FieldDesc *FindField(PContainerType *cls, const char * string)
 }
 
 
+//==========================================================================
+//
+// Returns the sorted table of all native fields and globals
+//
+//==========================================================================
+
+const TArray<FieldDesc> &GetNativeFields()
+{
+	return FieldTable;
+}
+
+
 //==========================================================================
 //
 // Find an action function in AActor's table
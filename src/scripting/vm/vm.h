@@ -36,6 +36,7 @@
 #ifndef VM_H
 #define VM_H
 
+#include <utility>
 #include "zstring.h"
 #include "autosegs.h"
 #include "vectors.h"
@@ -352,6 +353,106 @@ public:
 protected:
 };
 
+// Direct entry points for natives whose parameters are all plain values
+// that fit into a single register. Script code calls them with CALL_N,
+// which passes a pointer to each argument's register instead of boxing
+// everything into VMValues. See DEFINE_ACTION_FUNCTION_NATIVE.
+#define VM_MAXDIRECTARGS	16
+
+typedef void (*VMDirectFunc)();
+typedef void (*VMDirectInvoker)(VMDirectFunc func, const void *const *args, VMReturn *ret);
+
+template<class T> struct TDirectArg;
+
+template<> struct TDirectArg<int>
+{
+	enum { RegType = REGT_INT };
+	static int Get(const void *p) { return *(const int *)p; }
+	static void Set(VMReturn *ret, int v) { ret->SetInt(v); }
+};
+
+template<> struct TDirectArg<unsigned>
+{
+	enum { RegType = REGT_INT };
+	static unsigned Get(const void *p) { return *(const unsigned *)p; }
+	static void Set(VMReturn *ret, unsigned v) { ret->SetInt(v); }
+};
+
+template<> struct TDirectArg<bool>
+{
+	enum { RegType = REGT_INT };
+	static bool Get(const void *p) { return *(const int *)p != 0; }
+	static void Set(VMReturn *ret, bool v) { ret->SetInt(v); }
+};
+
+template<> struct TDirectArg<double>
+{
+	enum { RegType = REGT_FLOAT };
+	static double Get(const void *p) { return *(const double *)p; }
+	static void Set(VMReturn *ret, double v) { ret->SetFloat(v); }
+};
+
+template<> struct TDirectArg<FName>
+{
+	enum { RegType = REGT_INT };
+	static FName Get(const void *p) { return ENamedName(*(const int *)p); }
+	static void Set(VMReturn *ret, FName v) { ret->SetInt(v.GetIndex()); }
+};
+
+template<class T> struct TDirectArg<T *>
+{
+	enum { RegType = REGT_POINTER };
+	static T *Get(const void *p) { return (T *)*(void *const *)p; }
+	static void Set(VMReturn *ret, T *v) { ret->SetPointer((void *)v); }
+};
+
+template<class R, class... Args> struct TDirectNative
+{
+	template<size_t... I> static R Call(VMDirectFunc func, const void *const *args, std::index_sequence<I...>)
+	{
+		return reinterpret_cast<R(*)(Args...)>(func)(TDirectArg<Args>::Get(args[I])...);
+	}
+	static void Invoke(VMDirectFunc func, const void *const *args, VMReturn *ret)
+	{
+		R result = Call(func, args, std::index_sequence_for<Args...>());
+		if (ret != nullptr) TDirectArg<R>::Set(ret, result);
+	}
+	// Return type, argument count and the argument types.
+	static const uint8_t *Signature()
+	{
+		static const uint8_t sig[] = { TDirectArg<R>::RegType, sizeof...(Args), TDirectArg<Args>::RegType... };
+		return sig;
+	}
+};
+
+template<class... Args> struct TDirectNative<void, Args...>
+{
+	template<size_t... I> static void Call(VMDirectFunc func, const void *const *args, std::index_sequence<I...>)
+	{
+		reinterpret_cast<void(*)(Args...)>(func)(TDirectArg<Args>::Get(args[I])...);
+	}
+	static void Invoke(VMDirectFunc func, const void *const *args, VMReturn *ret)
+	{
+		Call(func, args, std::index_sequence_for<Args...>());
+	}
+	static const uint8_t *Signature()
+	{
+		static const uint8_t sig[] = { REGT_NIL, sizeof...(Args), TDirectArg<Args>::RegType... };
+		return sig;
+	}
+};
+
+template<class R, class... Args> VMDirectInvoker VMGetDirectInvoker(R (*)(Args...))
+{
+	static_assert(sizeof...(Args) <= VM_MAXDIRECTARGS, "Too many arguments for a direct native call");
+	return &TDirectNative<R, Args...>::Invoke;
+}
+
+template<class R, class... Args> const uint8_t *VMGetDirectSignature(R (*)(Args...))
+{
+	return TDirectNative<R, Args...>::Signature();
+}
+
 class VMNativeFunction : public VMFunction
 {
 public:
@@ -364,9 +465,14 @@ public:
 
 	// Return value is the number of results.
 	NativeCallType NativeCall;
+
+	// Optional direct entry point, only set if its signature matches the script declaration.
+	VMDirectFunc DirectNativeCall = nullptr;
+	VMDirectInvoker DirectInvoker = nullptr;
 };
 
 int VMCall(VMFunction *func, VMValue *params, int numparams, VMReturn *results, int numresults/*, VMException **trap = NULL*/);
+void VMJitRelease();
 
 // Use this in the prototype for a native function.
 #define VM_ARGS			VMValue *param, TArray<VMValue> &defaultparam, int numparam, VMReturn *ret, int numret
@@ -480,6 +586,9 @@ struct AFuncDesc
 	const char *FuncName;
 	actionf_p Function;
 	VMNativeFunction **VMPointer;
+	VMDirectFunc DirectNativeCall;
+	VMDirectInvoker DirectInvoker;
+	const uint8_t *DirectSignature;
 };
 
 #if defined(_MSC_VER)
@@ -508,6 +617,20 @@ struct AFuncDesc
 	MSVC_ASEG AFuncDesc const *const cls##_##name##_HookPtr GCC_ASEG = &cls##_##name##_Hook; \
 	static int AF_##cls##_##name(VM_ARGS)
 
+// Same as above, but also registers native as a direct entry point that script
+// code can call without going through the VMValue based thunk. Its parameters,
+// including the implicit ones, must match the script declaration.
+// Direct calls always pass all arguments, with omitted ones filled in from the
+// defaults, so this must not be used for a thunk that looks at numparam.
+#define DEFINE_ACTION_FUNCTION_NATIVE(cls, name, native) \
+	static int AF_##cls##_##name(VM_ARGS); \
+	VMNativeFunction *cls##_##name##_VMPtr; \
+	static const AFuncDesc cls##_##name##_Hook = { #cls, #name, AF_##cls##_##name, &cls##_##name##_VMPtr, \
+		reinterpret_cast<VMDirectFunc>(native), VMGetDirectInvoker(native), VMGetDirectSignature(native) }; \
+	extern AFuncDesc const *const cls##_##name##_HookPtr; \
+	MSVC_ASEG AFuncDesc const *const cls##_##name##_HookPtr GCC_ASEG = &cls##_##name##_Hook; \
+	static int AF_##cls##_##name(VM_ARGS)
+
 // cls is the scripted class name, icls the internal one (e.g. player_t vs. Player)
 #define DEFINE_FIELD_X(cls, icls, name) \
 	static const FieldDesc VMField_##icls##_##name = { "A" #cls, #name, (unsigned)myoffsetof(icls, name), (unsigned)sizeof(icls::name), 0 }; \
@@ -181,6 +181,65 @@ void VMSelectEngine(EVMEngine engine)
 	}
 }
 
+//===========================================================================
+//
+// Access to the interpreter's helpers for the JIT
+//
+//===========================================================================
+
+void VMFillReturns(VMFrame *frame, VMReturn *returns, const VMOP *retval, int numret)
+{
+	VMExec_Unchecked::FillReturns(VMRegisters(frame), frame, returns, retval, numret);
+}
+
+void VMSetReturn(VMFrame *frame, VMReturn *ret, VM_UBYTE regtype, int regnum)
+{
+	VMExec_Unchecked::SetReturn(VMRegisters(frame), frame, ret, regtype, regnum);
+}
+
+void VMCallDirect(VMFrame *frame, VMNativeFunction *call, const VMOP *pc)
+{
+	VMExec_Unchecked::CallDirect(VMRegisters(frame), frame, call, pc);
+}
+
+//===========================================================================
+//
+// VMLookupVirtual
+//
+// Gets the target of a virtual call from the call site's inline cache and
+// only goes to the class's virtual table if the cache does not know it.
+//
+//===========================================================================
+
+int VMVirtualHits[10], VMVirtualMisses[10];
+
+VMFunction *VMLookupVirtual(DObject *self, VMVirtualCache *cache)
+{
+	PClass *cls = self->GetClass();
+	if (cls == cache->Class[0])
+	{
+		VMVirtualHits[0]++;
+		return cache->Func[0];
+	}
+	if (cls == cache->Class[1])
+	{
+		VMVirtualHits[0]++;
+		return cache->Func[1];
+	}
+	VMVirtualMisses[0]++;
+	assert(cache->Index < cls->Virtuals.Size());
+	cache->Class[1] = cache->Class[0];
+	cache->Func[1] = cache->Func[0];
+	cache->Class[0] = cls;
+	cache->Func[0] = cls->Virtuals[cache->Index];
+	return cache->Func[0];
+}
+
+double VMDoFLOP(int flop, double v)
+{
+	return VMExec_Unchecked::DoFLOP(flop, v);
+}
+
 //===========================================================================
 //
 // VMFillParams
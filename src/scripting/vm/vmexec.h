@@ -670,6 +670,10 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 			reg.a[a] = p->Virtuals[C];
 		}
 		NEXTOP;
+	OP(VTBL_K):
+		ASSERTA(a); ASSERTA(B); ASSERTKA(C);
+		reg.a[a] = VMLookupVirtual((DObject*)reg.a[B], (VMVirtualCache *)konsta[C].v);
+		NEXTOP;
 	OP(SCOPE):
 		{
 			ASSERTA(a); ASSERTKA(C);
@@ -718,7 +722,7 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 				VMFillParams(reg.param + f->NumParam - b, newf, b);
 				try
 				{
-					numret = Exec(stack, script->Code, returns, C);
+					numret = VMJitExec(stack, script, returns, C);
 				}
 				catch(...)
 				{
@@ -732,6 +736,12 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 			pc += C;			// Skip RESULTs
 		}
 		NEXTOP;
+	OP(CALL_N):
+		ASSERTKA(a);
+		assert(C <= 1);
+		CallDirect(reg, f, (VMNativeFunction *)konsta[a].v, pc);
+		pc += B + C;		// Skip argument descriptors and RESULTs
+		NEXTOP;
 	OP(TAIL_K):
 		ASSERTKA(a);
 		ptr = konsta[a].o;
@@ -772,7 +782,7 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 				VMFillParams(reg.param + f->NumParam - B, newf, B);
 				try
 				{
-					numret = Exec(stack, script->Code, ret, numret);
+					numret = VMJitExec(stack, script, ret, numret);
 				}
 				catch(...)
 				{
@@ -1703,6 +1713,32 @@ static int Exec(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret)
 		CMPJMP(reg.a[B] == konsta[C].v);
 		NEXTOP;
 
+	OP(EQ_LB):
+		ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		CMPJMP(*(VM_UBYTE *)ptr == 0);
+		NEXTOP;
+	OP(EQ_LW):
+		ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		CMPJMP(*(VM_SWORD *)ptr == 0);
+		NEXTOP;
+	OP(EQ_LBIT):
+		ASSERTA(B);
+		GETADDR(PB,0,X_READ_NIL);
+		CMPJMP(!(*(VM_UBYTE *)ptr & C));
+		NEXTOP;
+	OP(EQA_LP):
+		ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		CMPJMP(*(void **)ptr == nullptr);
+		NEXTOP;
+	OP(EQA_LO):
+		ASSERTA(B); ASSERTKD(C);
+		GETADDR(PB,KC,X_READ_NIL);
+		CMPJMP(GC::ReadBarrier(*(DObject **)ptr) == nullptr);
+		NEXTOP;
+
 	OP(NOP):
 		NEXTOP;
 	}
@@ -1967,6 +2003,66 @@ static void FillReturns(const VMRegisters &reg, VMFrame *frame, VMReturn *return
 	}
 }
 
+//===========================================================================
+//
+// CallDirect
+//
+// Calls a native's direct entry point for the CALL_N at pc. The PARAMs
+// following it tell where each argument is, and no VMValues get built.
+//
+//===========================================================================
+
+static void CallDirect(const VMRegisters &reg, VMFrame *frame, VMNativeFunction *call, const VMOP *pc)
+{
+	const void *args[VM_MAXDIRECTARGS];
+	int imm[VM_MAXDIRECTARGS];
+	VMReturn returns[1];
+	VMScriptFunction *func = static_cast<VMScriptFunction *>(frame->Func);
+	int numargs = pc->b;
+	int numret = pc->c;
+
+	assert(call->DirectInvoker != nullptr && numargs <= VM_MAXDIRECTARGS);
+	for (int i = 0; i < numargs; i++)
+	{
+		const VMOP &arg = pc[1 + i];
+		int regnum = arg.c;
+
+		if (arg.op == OP_PARAMI)
+		{
+			imm[i] = arg.i24;
+			args[i] = &imm[i];
+			continue;
+		}
+		assert(arg.op == OP_PARAM);
+		switch (arg.b)
+		{
+		case REGT_INT:					assert(regnum < frame->NumRegD);	args[i] = &reg.d[regnum]; break;
+		case REGT_INT | REGT_KONST:		assert(regnum < func->NumKonstD);	args[i] = &func->KonstD[regnum]; break;
+		case REGT_FLOAT:				assert(regnum < frame->NumRegF);	args[i] = &reg.f[regnum]; break;
+		case REGT_FLOAT | REGT_KONST:	assert(regnum < func->NumKonstF);	args[i] = &func->KonstF[regnum]; break;
+		case REGT_POINTER:				assert(regnum < frame->NumRegA);	args[i] = &reg.a[regnum]; break;
+		case REGT_POINTER | REGT_KONST:	assert(regnum < func->NumKonstA);	args[i] = &func->KonstA[regnum].v; break;
+		default:
+			assert(0 && "Unsupported argument for a direct native call");
+			args[i] = nullptr;
+			break;
+		}
+	}
+	FillReturns(reg, frame, returns, pc + 1 + numargs, numret);
+	try
+	{
+		VMCycles[0].Unclock();
+		call->DirectInvoker(call->DirectNativeCall, args, numret > 0 ? returns : nullptr);
+		VMCycles[0].Clock();
+	}
+	catch (CVMAbortException &err)
+	{
+		err.MaybePrintMessage();
+		err.stacktrace.AppendFormat("Called from %s\n", call->PrintableName.GetChars());
+		throw;
+	}
+}
+
 //===========================================================================
 //
 // SetReturn
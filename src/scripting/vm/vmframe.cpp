@@ -74,6 +74,8 @@ VMScriptFunction::VMScriptFunction(FName name)
 	NumKonstA = 0;
 	MaxParam = 0;
 	NumArgs = 0;
+	JitTried = false;
+	JitFunc = nullptr;
 }
 
 VMScriptFunction::~VMScriptFunction()
@@ -286,8 +288,14 @@ VMFrame *VMFrameStack::AllocFrame(VMScriptFunction *func)
 	frame->NumRegS = func->NumRegS;
 	frame->NumRegA = func->NumRegA;
 	frame->MaxParam = func->MaxParam;
-	frame->Func = func;
-	frame->InitRegS();
+	frame->NumParam = 0;
+	// The parameter area is only read after PARAM wrote to it, so only the registers and the extra space need clearing.
+	VM_UBYTE *regs = (VM_UBYTE *)frame->GetRegF();
+	memset(regs, 0, (VM_UBYTE *)frame + func->StackSize - regs);
+	if (func->NumRegS != 0)
+	{
+		frame->InitRegS();
+	}
 	if (func->SpecialInits.Size())
 	{
 		func->InitExtra(frame->GetExtra());
@@ -300,7 +308,8 @@ VMFrame *VMFrameStack::AllocFrame(VMScriptFunction *func)
 // VMFrameStack :: Alloc
 //
 // Allocates space for a frame. Its size will be rounded up to a multiple
-// of 16 bytes.
+// of 16 bytes. Only the link to the parent frame gets set up, the rest is
+// left to AllocFrame.
 //
 //===========================================================================
 
@@ -349,7 +358,6 @@ VMFrame *VMFrameStack::Alloc(int size)
 		Blocks = block;
 	}
 	frame = (VMFrame *)block->FreeSpace;
-	memset(frame, 0, size);
 	frame->ParentFrame = parent;
 	block->FreeSpace += size;
 	block->LastFrame = frame;
@@ -383,10 +391,13 @@ VMFrame *VMFrameStack::PopFrame()
 		Func->DestroyExtra(frame->GetExtra());
 	}
 	// Free any string registers this frame had.
-	FString *regs = frame->GetRegS();
-	for (int i = frame->NumRegS; i != 0; --i)
+	if (frame->NumRegS != 0)
 	{
-		(regs++)->~FString();
+		FString *regs = frame->GetRegS();
+		for (int i = frame->NumRegS; i != 0; --i)
+		{
+			(regs++)->~FString();
+		}
 	}
 	VMFrame *parent = frame->ParentFrame;
 	if (parent == NULL)
@@ -461,7 +472,7 @@ int VMCall(VMFunction *func, VMValue *params, int numparams, VMReturn *results,
 				stack.AllocFrame(static_cast<VMScriptFunction *>(func));
 				allocated = true;
 				VMFillParams(params, stack.TopFrame(), numparams);
-				int numret = VMExec(&stack, code, results, numresults);
+				int numret = VMJitExec(&stack, static_cast<VMScriptFunction *>(func), results, numresults);
 				stack.PopFrame();
 				VMCycles[0].Unclock();
 				return numret;
@@ -610,6 +621,20 @@ ADD_STAT(VM)
 	return FStringf("VM time in last 10 tics: %f ms, %d calls, peak = %f ms", added, addedc, peak);
 }
 
+extern int VMVirtualHits[10], VMVirtualMisses[10];
+
+ADD_STAT(vcache)
+{
+	int hits = 0, misses = 0;
+	for (auto d : VMVirtualHits) hits += d;
+	for (auto d : VMVirtualMisses) misses += d;
+	memmove(&VMVirtualHits[1], &VMVirtualHits[0], 9 * sizeof(int));
+	memmove(&VMVirtualMisses[1], &VMVirtualMisses[0], 9 * sizeof(int));
+	VMVirtualHits[0] = VMVirtualMisses[0] = 0;
+	return FStringf("Virtual calls in last 10 tics: %d, %d cache hits (%.1f%%), %d misses",
+		hits + misses, hits, hits + misses > 0 ? hits * 100. / (hits + misses) : 0., misses);
+}
+
 //-----------------------------------------------------------------------------
 //
 //
@@ -429,6 +429,26 @@ enum EVMEngine
 void VMSelectEngine(EVMEngine engine);
 extern int (*VMExec)(VMFrameStack *stack, const VMOP *pc, VMReturn *ret, int numret);
 void VMFillParams(VMValue *params, VMFrame *callee, int numparam);
+void VMFillReturns(VMFrame *frame, VMReturn *returns, const VMOP *retval, int numret);
+void VMSetReturn(VMFrame *frame, VMReturn *ret, VM_UBYTE regtype, int regnum);
+void VMCallDirect(VMFrame *frame, VMNativeFunction *call, const VMOP *pc);
+double VMDoFLOP(int flop, double v);
+
+// Inline cache of a virtual call site for VTBL_K. It remembers the targets
+// for the last two classes that were seen there.
+struct VMVirtualCache
+{
+	PClass *Class[2];
+	VMFunction *Func[2];
+	unsigned Index;
+};
+
+VMFunction *VMLookupVirtual(DObject *self, VMVirtualCache *cache);
+
+// vmjit.cpp
+struct FJitContext;
+typedef int (*VMJitFunc)(VMFrame *frame, FJitContext *ctx);
+int VMJitExec(VMFrameStack *stack, VMScriptFunction *func, VMReturn *ret, int numret);
 
 void VMDumpConstants(FILE *out, const VMScriptFunction *func);
 void VMDisasm(FILE *out, const VMOP *code, int codesize, const VMScriptFunction *func);
@@ -465,6 +485,8 @@ public:
 	VM_UHALF NumKonstA;
 	VM_UHALF MaxParam;		// Maximum number of parameters this function has on the stack at once
 	VM_UBYTE NumArgs;		// Number of arguments this function takes
+	bool JitTried;			// JitFunc is only valid if this is set
+	VMJitFunc JitFunc;		// native code for this function, if the JIT could compile it
 	TArray<FTypeAndOffset> SpecialInits;	// list of all contents on the extra stack which require construction and destruction
 
 	void InitExtra(void *addr);
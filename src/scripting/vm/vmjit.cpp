@@ -0,0 +1,1482 @@
+//-----------------------------------------------------------------------------
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see http://www.gnu.org/licenses/
+//
+//-----------------------------------------------------------------------------
+//
+// DESCRIPTION:
+//		x86-64 code generator for script functions.
+//
+//		A function gets compiled the first time it is called. The generated
+//		code keeps all VM registers in the frame, exactly where the
+//		interpreter has them, so whenever it gets to an instruction it can't
+//		handle (or one that would throw) it just returns and the interpreter
+//		continues the same frame from there. Calls and returns go through
+//		small helpers that catch everything, so no exception ever has to
+//		unwind through generated code.
+//
+//-----------------------------------------------------------------------------
+
+#include <exception>
+#include <stddef.h>
+#include "dobject.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "stats.h"
+#include "v_text.h"
+#include "vmintern.h"
+#include "types.h"
+
+#if (defined(_M_X64) || defined(__x86_64__)) && !defined(NO_VM_JIT)
+#define VM_JIT 1
+#endif
+
+#ifdef VM_JIT
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+CVAR(Bool, vm_jit, false, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+
+extern cycle_t VMCycles[10];
+extern int VMCalls[10];
+
+struct FJitContext
+{
+	VMFrameStack *Stack;
+	VMReturn *Ret;
+	int NumRet;
+	int ResumePC;					// where the interpreter has to take over
+	std::exception_ptr Exception;	// caught by one of the helpers
+};
+
+enum
+{
+	JIT_RESUME = -1,
+	JIT_EXCEPTION = -2,
+};
+
+#ifdef VM_JIT
+
+//==========================================================================
+//
+// Executable memory
+//
+//==========================================================================
+
+static const size_t JIT_BLOCK_SIZE = 1 << 20;
+static TArray<uint8_t *> JitBlocks;
+static size_t JitBlockUsed;
+
+static uint8_t *JitAllocBlock()
+{
+#ifdef _WIN32
+	return (uint8_t *)VirtualAlloc(nullptr, JIT_BLOCK_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READ);
+#else
+	void *mem = mmap(nullptr, JIT_BLOCK_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	return mem == MAP_FAILED ? nullptr : (uint8_t *)mem;
+#endif
+}
+
+static void JitProtectBlock(uint8_t *block, bool writable)
+{
+#ifdef _WIN32
+	DWORD oldprotect;
+	VirtualProtect(block, JIT_BLOCK_SIZE, writable ? PAGE_READWRITE : PAGE_EXECUTE_READ, &oldprotect);
+#else
+	mprotect(block, JIT_BLOCK_SIZE, writable ? PROT_READ | PROT_WRITE : PROT_READ | PROT_EXEC);
+#endif
+}
+
+static void *JitStoreCode(const uint8_t *code, size_t size)
+{
+	size_t padded = (size + 15) & ~15;
+	if (padded > JIT_BLOCK_SIZE)
+	{
+		return nullptr;
+	}
+	if (JitBlocks.Size() == 0 || JitBlockUsed + padded > JIT_BLOCK_SIZE)
+	{
+		uint8_t *block = JitAllocBlock();
+		if (block == nullptr)
+		{
+			return nullptr;
+		}
+		JitBlocks.Push(block);
+		JitBlockUsed = 0;
+	}
+	// Nothing in the block can be running while it is writable: compiling happens
+	// before the new function is called and the block is executable again by then.
+	uint8_t *block = JitBlocks.Last();
+	uint8_t *dest = block + JitBlockUsed;
+	JitProtectBlock(block, true);
+	memcpy(dest, code, size);
+	memset(dest + size, 0xcc, padded - size);	// int3
+	JitProtectBlock(block, false);
+	JitBlockUsed += padded;
+	return dest;
+}
+
+//==========================================================================
+//
+// Helpers called from generated code
+//
+//==========================================================================
+
+static int JitReturn(FJitContext *ctx, VMFrame *f, const VMOP *pc)
+{
+	if (pc->op == OP_RET && pc->b == REGT_NIL)
+	{
+		return 0;
+	}
+	int retnum = pc->a & ~RET_FINAL;
+	if (retnum < ctx->NumRet)
+	{
+		if (pc->op == OP_RETI)
+		{
+			ctx->Ret[retnum].SetInt(pc->i16);
+		}
+		else
+		{
+			VMSetReturn(f, &ctx->Ret[retnum], pc->b, pc->c);
+		}
+	}
+	if (pc->a & RET_FINAL)
+	{
+		return retnum < ctx->NumRet ? retnum + 1 : ctx->NumRet;
+	}
+	return JIT_RESUME;	// not final, keep going
+}
+
+static int JitCall(FJitContext *ctx, VMFrame *f, const VMOP *pc, VMFunction *call)
+{
+	// CALL_N does its own argument and result handling and does not use the parameter stack.
+	int b = pc->op == OP_CALL_N ? 0 : pc->b;
+	int c = pc->c;
+	VMValue *params = f->GetParam() + f->NumParam - b;
+	VMReturn returns[MAX_RETURNS];
+
+	if (pc->op != OP_CALL_N)
+	{
+		VMFillReturns(f, returns, pc + 1, c);
+	}
+	try
+	{
+		if (pc->op == OP_CALL_N)
+		{
+			VMCallDirect(f, static_cast<VMNativeFunction *>(call), pc);
+		}
+		else if (call->VarFlags & VARF_Native)
+		{
+			try
+			{
+				VMCycles[0].Unclock();
+				static_cast<VMNativeFunction *>(call)->NativeCall(params, call->DefaultArgs, b, returns, c);
+				VMCycles[0].Clock();
+			}
+			catch (CVMAbortException &err)
+			{
+				err.MaybePrintMessage();
+				err.stacktrace.AppendFormat("Called from %s\n", call->PrintableName.GetChars());
+				throw;
+			}
+		}
+		else
+		{
+			VMCalls[0]++;
+			VMScriptFunction *script = static_cast<VMScriptFunction *>(call);
+			VMFrame *newf = ctx->Stack->AllocFrame(script);
+			VMFillParams(params, newf, b);
+			try
+			{
+				VMJitExec(ctx->Stack, script, returns, c);
+			}
+			catch (...)
+			{
+				ctx->Stack->PopFrame();
+				throw;
+			}
+			ctx->Stack->PopFrame();
+		}
+	}
+	catch (CVMAbortException &err)
+	{
+		auto sfunc = static_cast<VMScriptFunction *>(f->Func);
+		err.MaybePrintMessage();
+		err.stacktrace.AppendFormat("Called from %s at %s, line %d\n", sfunc->PrintableName.GetChars(), sfunc->SourceFileName.GetChars(), sfunc->PCToLine(pc));
+		ctx->Exception = std::current_exception();
+		return 1;
+	}
+	catch (...)
+	{
+		ctx->Exception = std::current_exception();
+		return 1;
+	}
+	f->NumParam -= b;
+	return 0;
+}
+
+static void *JitVirtual(DObject *o, int index)
+{
+	return o->GetClass()->Virtuals[index];
+}
+
+static void JitFlop(double *dest, const double *src, int flop)
+{
+	*dest = VMDoFLOP(flop, *src);
+}
+
+//==========================================================================
+//
+// FJitCompiler
+//
+// Register use in generated code:
+//	r14 = the VMFrame, r15 = the FJitContext
+//	rax, rcx, rdx, xmm0-xmm2 are scratch
+//
+//==========================================================================
+
+enum
+{
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15,
+
+	FRAME = R14,
+	CTX = R15,
+
+#ifdef _WIN32
+	ARG1 = RCX, ARG2 = RDX, ARG3 = R8, ARG4 = R9,
+#else
+	ARG1 = RDI, ARG2 = RSI, ARG3 = RDX, ARG4 = RCX,
+#endif
+};
+
+enum
+{
+	CC_B = 2, CC_AE = 3, CC_E = 4, CC_NE = 5, CC_BE = 6, CC_A = 7,
+	CC_P = 10, CC_NP = 11, CC_L = 12, CC_GE = 13, CC_LE = 14, CC_G = 15,
+};
+
+class FJitCompiler
+{
+public:
+	FJitCompiler(VMScriptFunction *func);
+	bool Generate();
+	VMJitFunc Compile();
+
+	int NumNative = 0;
+
+private:
+	enum EFixup { FIX_LABEL, FIX_BAIL, FIX_EPILOGUE, FIX_EXCEPTION };
+	struct FFixup
+	{
+		int Pos;
+		EFixup Kind;
+		int Index;
+	};
+
+	bool EmitOp(int i);
+	bool EmitLoad(int i, const VMOP *pc);
+	bool EmitStore(int i, const VMOP *pc);
+	bool EmitParam(const VMOP *pc);
+	void EmitCompareJump(int i, int cc);
+	void EmitIntOperand(int reg, bool konst, int index);
+	void EmitFloatOperand(int xmm, bool konst, int index);
+	void EmitAddress(int i, int ptrreg, bool konst, int index);
+	void EmitCall(void *func);
+
+	int RegD(int i) const { return OffD + i * (int)sizeof(int); }
+	int RegF(int i) const { return OffF + i * (int)sizeof(double); }
+	int RegS(int i) const { return OffS + i * (int)sizeof(FString); }
+	int RegA(int i) const { return OffA + i * (int)sizeof(void *); }
+
+	void Byte(int b) { Code.Push((uint8_t)b); }
+	void Dword(uint32_t d) { for (int i = 0; i < 4; i++) Byte(d >> (i * 8)); }
+	void Qword(uint64_t q) { for (int i = 0; i < 8; i++) Byte(int(q >> (i * 8))); }
+	void Opcode(int prefix, int rex, int opcode);
+	void Mem(int prefix, bool w, int opcode, int reg, int base, int disp);
+	void RR(int prefix, bool w, int opcode, int reg, int rm);
+	void MovImm(int reg, uint64_t imm);
+	void Jump(int cc, EFixup kind, int index);
+
+	void Load32(int reg, int base, int disp) { Mem(0, false, 0x8B, reg, base, disp); }
+	void Store32(int base, int disp, int reg) { Mem(0, false, 0x89, reg, base, disp); }
+	void Load64(int reg, int base, int disp) { Mem(0, true, 0x8B, reg, base, disp); }
+	void Store64(int base, int disp, int reg) { Mem(0, true, 0x89, reg, base, disp); }
+	void LoadSD(int xmm, int base, int disp) { Mem(0xF2, false, 0x0F10, xmm, base, disp); }
+	void StoreSD(int base, int disp, int xmm) { Mem(0xF2, false, 0x0F11, xmm, base, disp); }
+
+	VMScriptFunction *Func;
+	const VMOP *Ops;
+	TArray<uint8_t> Code;
+	TArray<int> Labels;
+	TArray<FFixup> Fixups;
+	bool Invalid = false;
+
+	int OffParam, OffF, OffS, OffA, OffD, OffExtra;
+};
+
+FJitCompiler::FJitCompiler(VMScriptFunction *func)
+{
+	Func = func;
+	Ops = func->Code;
+
+	// Same layout as VMFrame::GetAllRegs, which is fixed for a given function.
+	OffParam = (sizeof(VMFrame) + 15) & ~15;
+	OffF = OffParam + func->MaxParam * sizeof(VMValue);
+	OffS = OffF + func->NumRegF * sizeof(double);
+	OffA = OffS + func->NumRegS * sizeof(FString);
+	OffD = OffA + func->NumRegA * sizeof(void *);
+	OffExtra = (OffD + func->NumRegD * sizeof(int) + 15) & ~15;
+}
+
+//==========================================================================
+//
+// Instruction encoding
+//
+//==========================================================================
+
+void FJitCompiler::Opcode(int prefix, int rex, int opcode)
+{
+	if (prefix != 0) Byte(prefix);
+	if (rex != 0x40) Byte(rex);
+	if (opcode > 0xff) Byte(opcode >> 8);
+	Byte(opcode & 0xff);
+}
+
+// opcode reg, [base + disp]
+void FJitCompiler::Mem(int prefix, bool w, int opcode, int reg, int base, int disp)
+{
+	Opcode(prefix, 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((base & 8) ? 1 : 0), opcode);
+	int mod = (disp == 0 && (base & 7) != RBP) ? 0 : (disp >= -128 && disp <= 127) ? 1 : 2;
+	Byte((mod << 6) | ((reg & 7) << 3) | (base & 7));
+	if ((base & 7) == RSP) Byte(0x24);
+	if (mod == 1) Byte(disp);
+	else if (mod == 2) Dword(disp);
+}
+
+// opcode reg, rm
+void FJitCompiler::RR(int prefix, bool w, int opcode, int reg, int rm)
+{
+	Opcode(prefix, 0x40 | (w ? 8 : 0) | ((reg & 8) ? 4 : 0) | ((rm & 8) ? 1 : 0), opcode);
+	Byte(0xC0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+void FJitCompiler::MovImm(int reg, uint64_t imm)
+{
+	if (imm <= 0xffffffffu)
+	{
+		if (reg & 8) Byte(0x41);
+		Byte(0xB8 + (reg & 7));
+		Dword((uint32_t)imm);
+	}
+	else
+	{
+		Byte(0x48 | ((reg & 8) ? 1 : 0));
+		Byte(0xB8 + (reg & 7));
+		Qword(imm);
+	}
+}
+
+// cc < 0 is an unconditional jump
+void FJitCompiler::Jump(int cc, EFixup kind, int index)
+{
+	if (kind == FIX_LABEL && (index < 0 || index > Func->CodeSize))
+	{
+		Invalid = true;
+		return;
+	}
+	if (cc < 0)
+	{
+		Byte(0xE9);
+	}
+	else
+	{
+		Byte(0x0F);
+		Byte(0x80 | cc);
+	}
+	Fixups.Push({ (int)Code.Size(), kind, index });
+	Dword(0);
+}
+
+void FJitCompiler::EmitCall(void *func)
+{
+	MovImm(RAX, (uint64_t)(uintptr_t)func);
+	Byte(0xFF);		// call rax
+	Byte(0xD0);
+}
+
+//==========================================================================
+//
+// Operand helpers
+//
+//==========================================================================
+
+void FJitCompiler::EmitIntOperand(int reg, bool konst, int index)
+{
+	if (konst) MovImm(reg, (uint32_t)Func->KonstD[index]);
+	else Load32(reg, FRAME, RegD(index));
+}
+
+void FJitCompiler::EmitFloatOperand(int xmm, bool konst, int index)
+{
+	if (konst)
+	{
+		MovImm(RDX, (uint64_t)(uintptr_t)&Func->KonstF[index]);
+		LoadSD(xmm, RDX, 0);
+	}
+	else
+	{
+		LoadSD(xmm, FRAME, RegF(index));
+	}
+}
+
+// Loads the pointer register into rax and adds the offset. A null pointer leaves
+// the instruction to the interpreter, which throws the appropriate exception.
+void FJitCompiler::EmitAddress(int i, int ptrreg, bool konst, int index)
+{
+	Load64(RAX, FRAME, RegA(ptrreg));
+	RR(0, true, 0x85, RAX, RAX);		// test rax, rax
+	Jump(CC_E, FIX_BAIL, i);
+	if (konst)
+	{
+		int ofs = Func->KonstD[index];
+		if (ofs != 0)
+		{
+			MovImm(RDX, (uint32_t)ofs);
+			RR(0, true, 0x63, RDX, RDX);	// movsxd rdx, edx
+			RR(0, true, 0x01, RDX, RAX);	// add rax, rdx
+		}
+	}
+	else
+	{
+		Mem(0, true, 0x63, RDX, FRAME, RegD(index));	// movsxd rdx, [d]
+		RR(0, true, 0x01, RDX, RAX);
+	}
+}
+
+// For a compare followed by a JMP: jumps to the JMP's target if the test result
+// cc matches the check bit, otherwise skips the JMP.
+void FJitCompiler::EmitCompareJump(int i, int cc)
+{
+	int check = Ops[i].a & CMP_CHECK;
+	Jump(check ? cc : cc ^ 1, FIX_LABEL, i + 2 + Ops[i + 1].i24);
+	Jump(-1, FIX_LABEL, i + 2);
+}
+
+//==========================================================================
+//
+// Loads and stores. rA = *(rB + rkC) and *(rA + rkC) = rB
+//
+//==========================================================================
+
+bool FJitCompiler::EmitLoad(int i, const VMOP *pc)
+{
+	int op = pc->op;
+	bool konst = (op == OP_LB || op == OP_LH || op == OP_LW || op == OP_LBU || op == OP_LHU ||
+		op == OP_LSP || op == OP_LDP || op == OP_LP || op == OP_LV2 || op == OP_LV3);
+	EmitAddress(i, pc->b, konst, pc->c);
+
+	switch (op)
+	{
+	case OP_LB: case OP_LB_R:		Mem(0, false, 0x0FBE, RCX, RAX, 0); break;	// movsx ecx, byte
+	case OP_LH: case OP_LH_R:		Mem(0, false, 0x0FBF, RCX, RAX, 0); break;	// movsx ecx, word
+	case OP_LBU: case OP_LBU_R:		Mem(0, false, 0x0FB6, RCX, RAX, 0); break;	// movzx ecx, byte
+	case OP_LHU: case OP_LHU_R:		Mem(0, false, 0x0FB7, RCX, RAX, 0); break;	// movzx ecx, word
+	case OP_LW: case OP_LW_R:		Load32(RCX, RAX, 0); break;
+
+	case OP_LSP: case OP_LSP_R:
+		Mem(0xF3, false, 0x0F5A, 0, RAX, 0);	// cvtss2sd xmm0, dword
+		StoreSD(FRAME, RegF(pc->a), 0);
+		return true;
+
+	case OP_LDP: case OP_LDP_R:
+	case OP_LV2: case OP_LV2_R:
+	case OP_LV3: case OP_LV3_R:
+	{
+		int count = (op == OP_LV3 || op == OP_LV3_R) ? 3 : (op == OP_LV2 || op == OP_LV2_R) ? 2 : 1;
+		for (int j = 0; j < count; j++)
+		{
+			LoadSD(0, RAX, j * sizeof(double));
+			StoreSD(FRAME, RegF(pc->a + j), 0);
+		}
+		return true;
+	}
+
+	case OP_LP: case OP_LP_R:
+		Load64(RCX, RAX, 0);
+		Store64(FRAME, RegA(pc->a), RCX);
+		return true;
+
+	default:
+		assert(0);
+		return false;
+	}
+	Store32(FRAME, RegD(pc->a), RCX);
+	return true;
+}
+
+bool FJitCompiler::EmitStore(int i, const VMOP *pc)
+{
+	int op = pc->op;
+	bool konst = (op == OP_SB || op == OP_SH || op == OP_SW || op == OP_SSP || op == OP_SDP ||
+		op == OP_SP || op == OP_SV2 || op == OP_SV3);
+	EmitAddress(i, pc->a, konst, pc->c);
+
+	switch (op)
+	{
+	case OP_SB: case OP_SB_R:
+		Load32(RCX, FRAME, RegD(pc->b));
+		Mem(0, false, 0x88, RCX, RAX, 0);		// mov byte [rax], cl
+		break;
+
+	case OP_SH: case OP_SH_R:
+		Load32(RCX, FRAME, RegD(pc->b));
+		Mem(0x66, false, 0x89, RCX, RAX, 0);	// mov word [rax], cx
+		break;
+
+	case OP_SW: case OP_SW_R:
+		Load32(RCX, FRAME, RegD(pc->b));
+		Store32(RAX, 0, RCX);
+		break;
+
+	case OP_SSP: case OP_SSP_R:
+		Mem(0xF2, false, 0x0F5A, 0, FRAME, RegF(pc->b));	// cvtsd2ss xmm0, qword
+		Mem(0xF3, false, 0x0F11, 0, RAX, 0);				// movss [rax], xmm0
+		break;
+
+	case OP_SDP: case OP_SDP_R:
+	case OP_SV2: case OP_SV2_R:
+	case OP_SV3: case OP_SV3_R:
+	{
+		int count = (op == OP_SV3 || op == OP_SV3_R) ? 3 : (op == OP_SV2 || op == OP_SV2_R) ? 2 : 1;
+		for (int j = 0; j < count; j++)
+		{
+			LoadSD(0, FRAME, RegF(pc->b + j));
+			StoreSD(RAX, j * sizeof(double), 0);
+		}
+		break;
+	}
+
+	case OP_SP: case OP_SP_R:
+		Load64(RCX, FRAME, RegA(pc->b));
+		Store64(RAX, 0, RCX);
+		break;
+
+	default:
+		assert(0);
+		return false;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// PARAM: fills in the next VMValue the same way the interpreter's
+// constructors do.
+//
+//==========================================================================
+
+bool FJitCompiler::EmitParam(const VMOP *pc)
+{
+	int b = pc->b, c = pc->c;
+	int type;
+	bool isfloat = false;
+
+	if (pc->op == OP_PARAMI)
+	{
+		MovImm(RCX, (uint32_t)pc->i24);
+		type = REGT_INT;
+	}
+	else switch (b)
+	{
+	case REGT_NIL:
+		RR(0, false, 0x33, RCX, RCX);			// xor ecx, ecx
+		type = REGT_NIL;
+		break;
+	case REGT_INT:
+		Load32(RCX, FRAME, RegD(c));
+		type = REGT_INT;
+		break;
+	case REGT_INT | REGT_KONST:
+		MovImm(RCX, (uint32_t)Func->KonstD[c]);
+		type = REGT_INT;
+		break;
+	case REGT_FLOAT:
+		LoadSD(0, FRAME, RegF(c));
+		isfloat = true;
+		type = REGT_FLOAT;
+		break;
+	case REGT_FLOAT | REGT_KONST:
+		EmitFloatOperand(0, true, c);
+		isfloat = true;
+		type = REGT_FLOAT;
+		break;
+	case REGT_POINTER:
+		Load64(RCX, FRAME, RegA(c));
+		type = REGT_POINTER;
+		break;
+	case REGT_POINTER | REGT_KONST:
+		MovImm(RCX, (uint64_t)(uintptr_t)Func->KonstA[c].v);
+		type = REGT_POINTER;
+		break;
+	case REGT_STRING:
+		Mem(0, true, 0x8D, RCX, FRAME, RegS(c));	// lea
+		type = REGT_STRING;
+		break;
+	case REGT_STRING | REGT_KONST:
+		MovImm(RCX, (uint64_t)(uintptr_t)&Func->KonstS[c]);
+		type = REGT_STRING;
+		break;
+	case REGT_STRING | REGT_ADDROF:
+		Mem(0, true, 0x8D, RCX, FRAME, RegS(c));
+		type = REGT_POINTER;
+		break;
+	case REGT_INT | REGT_ADDROF:
+		Mem(0, true, 0x8D, RCX, FRAME, RegD(c));
+		type = REGT_POINTER;
+		break;
+	case REGT_FLOAT | REGT_ADDROF:
+		Mem(0, true, 0x8D, RCX, FRAME, RegF(c));
+		type = REGT_POINTER;
+		break;
+	case REGT_POINTER | REGT_ADDROF:
+		Mem(0, true, 0x8D, RCX, FRAME, RegA(c));
+		type = REGT_POINTER;
+		break;
+	default:
+		return false;		// vectors
+	}
+
+	// rax = frame + NumParam++ * sizeof(VMValue)
+	Mem(0, false, 0x0FB7, RAX, FRAME, offsetof(VMFrame, NumParam));	// movzx eax, word
+	Mem(0, false, 0x8D, RDX, RAX, 1);									// lea edx, [rax+1]
+	Mem(0x66, false, 0x89, RDX, FRAME, offsetof(VMFrame, NumParam));	// mov word, dx
+	RR(0, false, 0xC1, 4, RAX);											// shl eax, 4
+	Byte(4);
+	static_assert(sizeof(VMValue) == 16, "VMValue size changed");
+	RR(0, true, 0x01, FRAME, RAX);										// add rax, r14
+
+	if (isfloat) StoreSD(RAX, OffParam, 0);
+	else Store64(RAX, OffParam, RCX);
+	Mem(0, false, 0xC6, 0, RAX, OffParam + offsetof(VMValue, Type));		// mov byte, imm8
+	Byte(type);
+	return true;
+}
+
+//==========================================================================
+//
+// Emits one instruction. Returns false if it has to be left to the
+// interpreter.
+//
+//==========================================================================
+
+bool FJitCompiler::EmitOp(int i)
+{
+	const VMOP *pc = &Ops[i];
+	int a = pc->a, b = pc->b, c = pc->c;
+	int op = pc->op;
+
+	switch (op)
+	{
+	case OP_NOP:
+		return true;
+
+	// Constants and moves
+	case OP_LI:
+		Mem(0, false, 0xC7, 0, FRAME, RegD(a));
+		Dword(pc->i16);
+		return true;
+	case OP_LK:
+		Mem(0, false, 0xC7, 0, FRAME, RegD(a));
+		Dword(Func->KonstD[pc->i16u]);
+		return true;
+	case OP_LKF:
+		EmitFloatOperand(0, true, pc->i16u);
+		StoreSD(FRAME, RegF(a), 0);
+		return true;
+	case OP_LKP:
+		MovImm(RCX, (uint64_t)(uintptr_t)Func->KonstA[pc->i16u].v);
+		Store64(FRAME, RegA(a), RCX);
+		return true;
+	case OP_LFP:
+		Mem(0, true, 0x8D, RCX, FRAME, OffExtra);
+		Store64(FRAME, RegA(a), RCX);
+		return true;
+	case OP_MOVE:
+		Load32(RCX, FRAME, RegD(b));
+		Store32(FRAME, RegD(a), RCX);
+		return true;
+	case OP_MOVEA:
+		Load64(RCX, FRAME, RegA(b));
+		Store64(FRAME, RegA(a), RCX);
+		return true;
+	case OP_MOVEF:
+	case OP_MOVEV2:
+	case OP_MOVEV3:
+		for (int j = 0; j < (op == OP_MOVEV3 ? 3 : op == OP_MOVEV2 ? 2 : 1); j++)
+		{
+			LoadSD(0, FRAME, RegF(b + j));
+			StoreSD(FRAME, RegF(a + j), 0);
+		}
+		return true;
+
+	case OP_CAST:
+		if (c == CAST_I2F)
+		{
+			Mem(0xF2, false, 0x0F2A, 0, FRAME, RegD(b));	// cvtsi2sd xmm0, dword
+			StoreSD(FRAME, RegF(a), 0);
+			return true;
+		}
+		else if (c == CAST_F2I)
+		{
+			Mem(0xF2, false, 0x0F2C, RCX, FRAME, RegF(b));	// cvttsd2si ecx, qword
+			Store32(FRAME, RegD(a), RCX);
+			return true;
+		}
+		return false;
+
+	case OP_CASTB:
+		if (c == CASTB_I || c == CASTB_A)
+		{
+			Mem(0, c == CASTB_A, 0x83, 7, FRAME, c == CASTB_A ? RegA(b) : RegD(b));	// cmp, 0
+			Byte(0);
+			RR(0, false, 0x0F90 | CC_NE, 0, RCX);		// setne cl
+		}
+		else if (c == CASTB_F)
+		{
+			LoadSD(0, FRAME, RegF(b));
+			RR(0, false, 0x0F57, 1, 1);					// xorps xmm1, xmm1
+			RR(0x66, false, 0x0F2E, 0, 1);				// ucomisd xmm0, xmm1
+			RR(0, false, 0x0F90 | CC_NE, 0, RCX);		// setne cl
+			RR(0, false, 0x0F90 | CC_P, 0, RDX);		// setp dl
+			RR(0, false, 0x0B, RCX, RDX);				// or ecx, edx
+		}
+		else
+		{
+			return false;
+		}
+		RR(0, false, 0x0FB6, RCX, RCX);					// movzx ecx, cl
+		Store32(FRAME, RegD(a), RCX);
+		return true;
+
+	// Memory
+	case OP_LB: case OP_LB_R: case OP_LH: case OP_LH_R: case OP_LW: case OP_LW_R:
+	case OP_LBU: case OP_LBU_R: case OP_LHU: case OP_LHU_R:
+	case OP_LSP: case OP_LSP_R: case OP_LDP: case OP_LDP_R:
+	case OP_LP: case OP_LP_R: case OP_LV2: case OP_LV2_R: case OP_LV3: case OP_LV3_R:
+		return EmitLoad(i, pc);
+
+	case OP_SB: case OP_SB_R: case OP_SH: case OP_SH_R: case OP_SW: case OP_SW_R:
+	case OP_SSP: case OP_SSP_R: case OP_SDP: case OP_SDP_R:
+	case OP_SP: case OP_SP_R: case OP_SV2: case OP_SV2_R: case OP_SV3: case OP_SV3_R:
+		return EmitStore(i, pc);
+
+	case OP_LBIT:
+		Load64(RAX, FRAME, RegA(b));
+		RR(0, true, 0x85, RAX, RAX);
+		Jump(CC_E, FIX_BAIL, i);
+		Mem(0, false, 0x0FB6, RCX, RAX, 0);				// movzx ecx, byte
+		RR(0, false, 0xF7, 0, RCX);						// test ecx, imm32
+		Dword(c);
+		RR(0, false, 0x0F90 | CC_NE, 0, RCX);			// setne cl
+		RR(0, false, 0x0FB6, RCX, RCX);
+		Store32(FRAME, RegD(a), RCX);
+		return true;
+
+	// Integer math
+	case OP_ADD_RR: case OP_ADD_RK: case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:
+	case OP_MUL_RR: case OP_MUL_RK: case OP_AND_RR: case OP_AND_RK:
+	case OP_OR_RR: case OP_OR_RK: case OP_XOR_RR: case OP_XOR_RK:
+	case OP_MIN_RR: case OP_MIN_RK: case OP_MAX_RR: case OP_MAX_RK:
+	case OP_SLL_RR: case OP_SLL_KR: case OP_SRL_RR: case OP_SRA_RR: case OP_SRA_KR:
+	{
+		EmitIntOperand(RAX, op == OP_SUB_KR || op == OP_SLL_KR || op == OP_SRA_KR, b);
+		EmitIntOperand(RCX, op == OP_ADD_RK || op == OP_SUB_RK || op == OP_MUL_RK || op == OP_AND_RK ||
+			op == OP_OR_RK || op == OP_XOR_RK || op == OP_MIN_RK || op == OP_MAX_RK, c);
+		switch (op)
+		{
+		case OP_ADD_RR: case OP_ADD_RK:					RR(0, false, 0x03, RAX, RCX); break;
+		case OP_SUB_RR: case OP_SUB_RK: case OP_SUB_KR:	RR(0, false, 0x2B, RAX, RCX); break;
+		case OP_MUL_RR: case OP_MUL_RK:					RR(0, false, 0x0FAF, RAX, RCX); break;
+		case OP_AND_RR: case OP_AND_RK:					RR(0, false, 0x23, RAX, RCX); break;
+		case OP_OR_RR: case OP_OR_RK:					RR(0, false, 0x0B, RAX, RCX); break;
+		case OP_XOR_RR: case OP_XOR_RK:					RR(0, false, 0x33, RAX, RCX); break;
+		case OP_SLL_RR: case OP_SLL_KR:					RR(0, false, 0xD3, 4, RAX); break;
+		case OP_SRL_RR:									RR(0, false, 0xD3, 5, RAX); break;
+		case OP_SRA_RR: case OP_SRA_KR:					RR(0, false, 0xD3, 7, RAX); break;
+		case OP_MIN_RR: case OP_MIN_RK:
+			RR(0, false, 0x3B, RAX, RCX);
+			RR(0, false, 0x0F40 | CC_GE, RAX, RCX);		// cmovge
+			break;
+		case OP_MAX_RR: case OP_MAX_RK:
+			RR(0, false, 0x3B, RAX, RCX);
+			RR(0, false, 0x0F40 | CC_LE, RAX, RCX);		// cmovle
+			break;
+		}
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+	}
+
+	case OP_SLL_RI: case OP_SRL_RI: case OP_SRA_RI:
+		Load32(RAX, FRAME, RegD(b));
+		RR(0, false, 0xC1, op == OP_SLL_RI ? 4 : op == OP_SRL_RI ? 5 : 7, RAX);
+		Byte(c);
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+
+	case OP_ADDI:
+		Load32(RAX, FRAME, RegD(b));
+		MovImm(RCX, (uint32_t)pc->cs);
+		RR(0, false, 0x03, RAX, RCX);
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+
+	case OP_DIV_RR: case OP_DIV_RK: case OP_DIV_KR:
+	case OP_DIVU_RR: case OP_DIVU_RK: case OP_DIVU_KR:
+	case OP_MOD_RR: case OP_MOD_RK: case OP_MOD_KR:
+	case OP_MODU_RR: case OP_MODU_RK: case OP_MODU_KR:
+	{
+		bool kb = (op == OP_DIV_KR || op == OP_DIVU_KR || op == OP_MOD_KR || op == OP_MODU_KR);
+		bool kc = (op == OP_DIV_RK || op == OP_DIVU_RK || op == OP_MOD_RK || op == OP_MODU_RK);
+		bool isunsigned = (op >= OP_DIVU_RR && op <= OP_DIVU_KR) || (op >= OP_MODU_RR && op <= OP_MODU_KR);
+		bool ismod = (op >= OP_MOD_RR && op <= OP_MODU_KR);
+
+		if (kc && Func->KonstD[c] == 0)
+		{
+			return false;
+		}
+		EmitIntOperand(RAX, kb, b);
+		EmitIntOperand(RCX, kc, c);
+		if (!kc)
+		{
+			RR(0, false, 0x85, RCX, RCX);				// test ecx, ecx
+			Jump(CC_E, FIX_BAIL, i);
+		}
+		if (isunsigned)
+		{
+			RR(0, false, 0x33, RDX, RDX);				// xor edx, edx
+			RR(0, false, 0xF7, 6, RCX);					// div ecx
+		}
+		else
+		{
+			Byte(0x99);									// cdq
+			RR(0, false, 0xF7, 7, RCX);					// idiv ecx
+		}
+		Store32(FRAME, RegD(a), ismod ? RDX : RAX);
+		return true;
+	}
+
+	case OP_ABS:
+		Load32(RAX, FRAME, RegD(b));
+		RR(0, false, 0x8B, RCX, RAX);					// mov ecx, eax
+		RR(0, false, 0xF7, 3, RAX);						// neg eax
+		RR(0, false, 0x0F40 | CC_L, RAX, RCX);			// cmovl eax, ecx
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+	case OP_NEG:
+	case OP_NOT:
+		Load32(RAX, FRAME, RegD(b));
+		RR(0, false, 0xF7, op == OP_NEG ? 3 : 2, RAX);
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+
+	// Floating point math
+	case OP_ADDF_RR: case OP_ADDF_RK: case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:
+	case OP_MULF_RR: case OP_MULF_RK: case OP_DIVF_RR: case OP_DIVF_RK: case OP_DIVF_KR:
+	case OP_MINF_RR: case OP_MINF_RK: case OP_MAXF_RR: case OP_MAXF_RK:
+	{
+		bool kb = (op == OP_SUBF_KR || op == OP_DIVF_KR);
+		bool kc = (op == OP_ADDF_RK || op == OP_SUBF_RK || op == OP_MULF_RK || op == OP_DIVF_RK || op == OP_MINF_RK || op == OP_MAXF_RK);
+		int sseop;
+		switch (op)
+		{
+		case OP_ADDF_RR: case OP_ADDF_RK:					sseop = 0x0F58; break;
+		case OP_MULF_RR: case OP_MULF_RK:					sseop = 0x0F59; break;
+		case OP_SUBF_RR: case OP_SUBF_RK: case OP_SUBF_KR:	sseop = 0x0F5C; break;
+		case OP_MINF_RR: case OP_MINF_RK:					sseop = 0x0F5D; break;	// minsd is b < c ? b : c
+		case OP_MAXF_RR: case OP_MAXF_RK:					sseop = 0x0F5F; break;	// maxsd is b > c ? b : c
+		default:											sseop = 0x0F5E; break;
+		}
+		if (sseop == 0x0F5E && kc && Func->KonstF[c] == 0.)
+		{
+			return false;
+		}
+		EmitFloatOperand(0, kb, b);
+		EmitFloatOperand(1, kc, c);
+		if (sseop == 0x0F5E && !kc)
+		{
+			// bail if the divisor == 0, which is false for NaN
+			RR(0, false, 0x0F57, 2, 2);					// xorps xmm2, xmm2
+			RR(0x66, false, 0x0F2E, 1, 2);				// ucomisd xmm1, xmm2
+			Byte(0x7A);									// jp over the next jump
+			Byte(6);
+			Jump(CC_E, FIX_BAIL, i);
+		}
+		RR(0xF2, false, sseop, 0, 1);
+		StoreSD(FRAME, RegF(a), 0);
+		return true;
+	}
+
+	case OP_FLOP:
+		Mem(0, true, 0x8D, ARG1, FRAME, RegF(a));
+		Mem(0, true, 0x8D, ARG2, FRAME, RegF(b));
+		MovImm(ARG3, c);
+		EmitCall((void *)JitFlop);
+		return true;
+
+	// Comparisons. These are always followed by a JMP.
+	case OP_EQ_R: case OP_EQ_K: case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:
+	case OP_LE_RR: case OP_LE_RK: case OP_LE_KR: case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:
+	case OP_LEU_RR: case OP_LEU_RK: case OP_LEU_KR:
+	{
+		if (i + 1 >= Func->CodeSize || Ops[i + 1].op != OP_JMP) return false;
+		bool kb = (op == OP_LT_KR || op == OP_LE_KR || op == OP_LTU_KR || op == OP_LEU_KR);
+		bool kc = (op == OP_EQ_K || op == OP_LT_RK || op == OP_LE_RK || op == OP_LTU_RK || op == OP_LEU_RK);
+		int cc;
+		switch (op)
+		{
+		case OP_EQ_R: case OP_EQ_K:							cc = CC_E; break;
+		case OP_LT_RR: case OP_LT_RK: case OP_LT_KR:		cc = CC_L; break;
+		case OP_LE_RR: case OP_LE_RK: case OP_LE_KR:		cc = CC_LE; break;
+		case OP_LTU_RR: case OP_LTU_RK: case OP_LTU_KR:		cc = CC_B; break;
+		default:											cc = CC_BE; break;
+		}
+		EmitIntOperand(RAX, kb, b);
+		EmitIntOperand(RCX, kc, c);
+		RR(0, false, 0x3B, RAX, RCX);					// cmp eax, ecx
+		EmitCompareJump(i, cc);
+		return true;
+	}
+
+	case OP_EQF_R: case OP_EQF_K: case OP_LTF_RR: case OP_LTF_RK: case OP_LTF_KR:
+	case OP_LEF_RR: case OP_LEF_RK: case OP_LEF_KR:
+	{
+		if (i + 1 >= Func->CodeSize || Ops[i + 1].op != OP_JMP) return false;
+		if (a & CMP_APPROX) return false;
+		bool kb = (op == OP_LTF_KR || op == OP_LEF_KR);
+		bool kc = (op == OP_EQF_K || op == OP_LTF_RK || op == OP_LEF_RK);
+		EmitFloatOperand(0, kb, b);
+		EmitFloatOperand(1, kc, c);
+		if (op == OP_EQF_R || op == OP_EQF_K)
+		{
+			// equal means ZF set and PF clear
+			RR(0x66, false, 0x0F2E, 0, 1);				// ucomisd xmm0, xmm1
+			RR(0, false, 0x0F90 | CC_E, 0, RAX);		// sete al
+			RR(0, false, 0x0F90 | CC_NP, 0, RCX);		// setnp cl
+			RR(0, false, 0x84, RCX, RAX);				// test al, cl
+			EmitCompareJump(i, CC_NE);
+		}
+		else
+		{
+			// b < c as c > b, so that unordered comes out false
+			RR(0x66, false, 0x0F2E, 1, 0);				// ucomisd xmm1, xmm0
+			EmitCompareJump(i, (op == OP_LEF_RR || op == OP_LEF_RK || op == OP_LEF_KR) ? CC_AE : CC_A);
+		}
+		return true;
+	}
+
+	case OP_EQA_R: case OP_EQA_K:
+		if (i + 1 >= Func->CodeSize || Ops[i + 1].op != OP_JMP) return false;
+		Load64(RAX, FRAME, RegA(b));
+		if (op == OP_EQA_K) MovImm(RCX, (uint64_t)(uintptr_t)Func->KonstA[c].v);
+		else Load64(RCX, FRAME, RegA(c));
+		RR(0, true, 0x3B, RAX, RCX);
+		EmitCompareJump(i, CC_E);
+		return true;
+
+	case OP_EQ_LB: case OP_EQ_LW: case OP_EQ_LBIT: case OP_EQA_LP:
+		if (i + 1 >= Func->CodeSize || Ops[i + 1].op != OP_JMP) return false;
+		if (op == OP_EQ_LBIT)
+		{
+			Load64(RAX, FRAME, RegA(b));
+			RR(0, true, 0x85, RAX, RAX);
+			Jump(CC_E, FIX_BAIL, i);
+		}
+		else
+		{
+			EmitAddress(i, b, true, c);
+		}
+		switch (op)
+		{
+		case OP_EQ_LB:
+			Mem(0, false, 0x0FB6, RCX, RAX, 0);			// movzx ecx, byte
+			RR(0, false, 0x85, RCX, RCX);				// test ecx, ecx
+			break;
+
+		case OP_EQ_LW:
+			Load32(RCX, RAX, 0);
+			RR(0, false, 0x85, RCX, RCX);
+			break;
+
+		case OP_EQ_LBIT:
+			Mem(0, false, 0x0FB6, RCX, RAX, 0);
+			RR(0, false, 0xF7, 0, RCX);					// test ecx, imm32
+			Dword(c);
+			break;
+
+		default:
+			Load64(RCX, RAX, 0);
+			RR(0, true, 0x85, RCX, RCX);				// test rcx, rcx
+			break;
+		}
+		EmitCompareJump(i, CC_E);
+		return true;
+
+	// Pointer math
+	case OP_ADDA_RR: case OP_ADDA_RK:
+		Load64(RAX, FRAME, RegA(b));
+		if (op == OP_ADDA_RK) MovImm(RCX, (uint32_t)Func->KonstD[c]);
+		else Load32(RCX, FRAME, RegD(c));
+		RR(0, true, 0x63, RCX, RCX);					// movsxd rcx, ecx
+		RR(0, true, 0x85, RAX, RAX);
+		RR(0, true, 0x0F40 | CC_E, RCX, RAX);			// null pointers stay null
+		RR(0, true, 0x01, RCX, RAX);					// add rax, rcx
+		Store64(FRAME, RegA(a), RAX);
+		return true;
+	case OP_SUBA:
+		Load64(RAX, FRAME, RegA(b));
+		Mem(0, true, 0x2B, RAX, FRAME, RegA(c));
+		Store32(FRAME, RegD(a), RAX);
+		return true;
+
+	// Control flow
+	case OP_JMP:
+		Jump(-1, FIX_LABEL, i + 1 + pc->i24);
+		return true;
+	case OP_TEST:
+	case OP_TESTN:
+		Mem(0, false, 0x81, 7, FRAME, RegD(a));			// cmp dword, imm32
+		Dword(op == OP_TEST ? pc->i16u : -(int)pc->i16u);
+		Jump(CC_NE, FIX_LABEL, i + 2);
+		return true;
+
+	case OP_BOUND:
+	case OP_BOUND_K:
+		Mem(0, false, 0x81, 7, FRAME, RegD(a));
+		Dword(op == OP_BOUND ? pc->i16u : Func->KonstD[pc->i16u]);
+		Jump(CC_GE, FIX_BAIL, i);
+		return true;
+	case OP_BOUND_R:
+		Load32(RAX, FRAME, RegD(a));
+		Mem(0, false, 0x3B, RAX, FRAME, RegD(b));
+		Jump(CC_GE, FIX_BAIL, i);
+		return true;
+
+	case OP_PARAM:
+	case OP_PARAMI:
+		return EmitParam(pc);
+
+	case OP_VTBL:
+		Load64(ARG1, FRAME, RegA(b));
+		MovImm(ARG2, c);
+		EmitCall((void *)JitVirtual);
+		Store64(FRAME, RegA(a), RAX);
+		return true;
+	case OP_VTBL_K:
+		Load64(ARG1, FRAME, RegA(b));
+		MovImm(ARG2, (uint64_t)(uintptr_t)Func->KonstA[c].v);
+		EmitCall((void *)VMLookupVirtual);
+		Store64(FRAME, RegA(a), RAX);
+		return true;
+
+	case OP_CALL:
+	case OP_CALL_K:
+	case OP_CALL_N:
+		RR(0, true, 0x8B, ARG1, CTX);
+		RR(0, true, 0x8B, ARG2, FRAME);
+		MovImm(ARG3, (uint64_t)(uintptr_t)pc);
+		if (op != OP_CALL) MovImm(ARG4, (uint64_t)(uintptr_t)Func->KonstA[a].v);
+		else Load64(ARG4, FRAME, RegA(a));
+		EmitCall((void *)JitCall);
+		RR(0, false, 0x85, RAX, RAX);
+		Jump(CC_NE, FIX_EXCEPTION, 0);
+		Jump(-1, FIX_LABEL, i + 1 + c + (op == OP_CALL_N ? b : 0));	// skip the RESULTs and CALL_N's arguments
+		return true;
+
+	case OP_RET:
+	case OP_RETI:
+		RR(0, true, 0x8B, ARG1, CTX);
+		RR(0, true, 0x8B, ARG2, FRAME);
+		MovImm(ARG3, (uint64_t)(uintptr_t)pc);
+		EmitCall((void *)JitReturn);
+		RR(0, false, 0x85, RAX, RAX);
+		Jump(CC_GE, FIX_EPILOGUE, 0);
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+//==========================================================================
+//
+// FJitCompiler :: Generate
+//
+// Generated functions are int f(VMFrame *frame, FJitContext *ctx) and
+// return the number of results, JIT_RESUME or JIT_EXCEPTION.
+//
+//==========================================================================
+
+bool FJitCompiler::Generate()
+{
+	int codesize = Func->CodeSize;
+
+	// prologue
+	Byte(0x41); Byte(0x56);							// push r14
+	Byte(0x41); Byte(0x57);							// push r15
+	Byte(0x48); Byte(0x83); Byte(0xEC); Byte(40);	// sub rsp, 40 (shadow space and alignment)
+	RR(0, true, 0x8B, FRAME, ARG1);
+	RR(0, true, 0x8B, CTX, ARG2);
+
+	bool entrynative = false;
+	Labels.Resize(codesize + 1);
+	for (int i = 0; i < codesize; i++)
+	{
+		Labels[i] = Code.Size();
+		unsigned start = Code.Size();
+		unsigned numfixups = Fixups.Size();
+		if (EmitOp(i))
+		{
+			NumNative++;
+			if (i == 0) entrynative = true;
+		}
+		else
+		{
+			// Throw away whatever got emitted and let the interpreter do it.
+			Code.Resize(start);
+			Fixups.Resize(numfixups);
+			Jump(-1, FIX_BAIL, i);
+		}
+	}
+	// Running off the end behaves like an empty return.
+	Labels[codesize] = Code.Size();
+	RR(0, false, 0x33, RAX, RAX);
+	Jump(-1, FIX_EPILOGUE, 0);
+
+	// Not worth it if the interpreter would have to take over right away.
+	if (Invalid || !entrynative)
+	{
+		return false;
+	}
+
+	int epilogue = Code.Size();
+	Byte(0x48); Byte(0x83); Byte(0xC4); Byte(40);	// add rsp, 40
+	Byte(0x41); Byte(0x5F);							// pop r15
+	Byte(0x41); Byte(0x5E);							// pop r14
+	Byte(0xC3);
+
+	int exception = Code.Size();
+	MovImm(RAX, (uint32_t)JIT_EXCEPTION);
+	Jump(-1, FIX_EPILOGUE, 0);
+
+	// One stub per instruction that may go back to the interpreter.
+	TArray<int> bails;
+	bails.Resize(codesize);
+	for (auto &bail : bails) bail = -1;
+	for (unsigned i = 0; i < Fixups.Size(); i++)
+	{
+		int index = Fixups[i].Index;
+		if (Fixups[i].Kind == FIX_BAIL && bails[index] < 0)
+		{
+			bails[index] = Code.Size();
+			Mem(0, false, 0xC7, 0, CTX, offsetof(FJitContext, ResumePC));
+			Dword(index);
+			MovImm(RAX, (uint32_t)JIT_RESUME);
+			Jump(-1, FIX_EPILOGUE, 0);
+		}
+	}
+
+	for (auto &fix : Fixups)
+	{
+		int target;
+		switch (fix.Kind)
+		{
+		case FIX_LABEL:		target = Labels[fix.Index]; break;
+		case FIX_BAIL:		target = bails[fix.Index]; break;
+		case FIX_EPILOGUE:	target = epilogue; break;
+		default:			target = exception; break;
+		}
+		int32_t rel = target - (fix.Pos + 4);
+		memcpy(&Code[fix.Pos], &rel, 4);
+	}
+	return true;
+}
+
+//==========================================================================
+//
+// FJitCompiler :: Compile
+//
+//==========================================================================
+
+VMJitFunc FJitCompiler::Compile()
+{
+	if (!Generate())
+	{
+		return nullptr;
+	}
+	return (VMJitFunc)JitStoreCode(&Code[0], Code.Size());
+}
+
+//==========================================================================
+//
+// Runs compiled code with the callee's frame already set up
+//
+//==========================================================================
+
+static int JitRun(VMFrameStack *stack, VMScriptFunction *func, VMReturn *ret, int numret)
+{
+	FJitContext ctx;
+	ctx.Stack = stack;
+	ctx.Ret = ret;
+	ctx.NumRet = numret;
+	ctx.ResumePC = 0;
+
+	int result = func->JitFunc(stack->TopFrame(), &ctx);
+	if (result == JIT_RESUME)
+	{
+		return VMExec(stack, func->Code + ctx.ResumePC, ret, numret);
+	}
+	else if (result == JIT_EXCEPTION)
+	{
+		std::rethrow_exception(ctx.Exception);
+	}
+	return result;
+}
+
+static bool JitCompile(VMScriptFunction *func, int *numnative = nullptr)
+{
+	if (!func->JitTried)
+	{
+		func->JitTried = true;
+		if (func->Code != nullptr && func->CodeSize > 0)
+		{
+			FJitCompiler compiler(func);
+			func->JitFunc = compiler.Compile();
+			if (numnative != nullptr) *numnative = compiler.NumNative;
+		}
+	}
+	return func->JitFunc != nullptr;
+}
+
+#endif
+
+//==========================================================================
+//
+// VMJitExec
+//
+// Entry point for all calls of script functions. Runs the compiled code
+// if there is any, the interpreter otherwise.
+//
+//==========================================================================
+
+int VMJitExec(VMFrameStack *stack, VMScriptFunction *func, VMReturn *ret, int numret)
+{
+#ifdef VM_JIT
+	if (vm_jit && JitCompile(func))
+	{
+		return JitRun(stack, func, ret, numret);
+	}
+#endif
+	return VMExec(stack, func->Code, ret, numret);
+}
+
+void VMJitRelease()
+{
+#ifdef VM_JIT
+	for (auto block : JitBlocks)
+	{
+#ifdef _WIN32
+		VirtualFree(block, 0, MEM_RELEASE);
+#else
+		munmap(block, JIT_BLOCK_SIZE);
+#endif
+	}
+	JitBlocks.Reset();
+	JitBlockUsed = 0;
+#endif
+}
+
+#ifdef VM_JIT
+
+//==========================================================================
+//
+// CCMD vmjittest
+//
+// Compiles every script function and reports how much of it ended up as
+// native code. Functions that only do math on numeric arguments get run
+// through both the JIT and the interpreter with a set of arguments and
+// must produce identical results.
+//
+//==========================================================================
+
+static bool JitIsPure(VMScriptFunction *func)
+{
+	for (int i = 0; i < func->CodeSize; i++)
+	{
+		const VMOP *pc = &func->Code[i];
+		switch (pc->op)
+		{
+		case OP_JMP:
+			if (pc->i24 < 0) return false;	// loops may not end with made up arguments
+			break;
+
+		case OP_NOP: case OP_LI: case OP_LK: case OP_LKF: case OP_MOVE: case OP_MOVEF:
+		case OP_MOVEV2: case OP_MOVEV3: case OP_CAST: case OP_CASTB: case OP_FLOP:
+		case OP_TEST: case OP_TESTN: case OP_RET: case OP_RETI: case OP_ABS: case OP_NEG: case OP_NOT:
+		case OP_ADDI: case OP_BOUND: case OP_BOUND_K: case OP_BOUND_R:
+			break;
+
+		default:
+			if ((pc->op >= OP_SLL_RR && pc->op <= OP_LEU_KR) || (pc->op >= OP_ADDF_RR && pc->op <= OP_LEF_KR))
+			{
+				break;
+			}
+			return false;
+		}
+	}
+	return true;
+}
+
+static bool JitIsNumeric(const TArray<PType *> &types)
+{
+	for (auto type : types)
+	{
+		int regtype = type->GetRegType();
+		if ((regtype != REGT_INT && regtype != REGT_FLOAT) || type->GetRegCount() != 1)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Runs the function once. Returns -2 if it threw.
+static int JitTestRun(VMScriptFunction *func, VMValue *params, VMReturn *ret, int numret, bool jit)
+{
+	auto &stack = GlobalVMStack;
+	stack.AllocFrame(func);
+	VMFillParams(params, stack.TopFrame(), func->NumArgs);
+	int result;
+	try
+	{
+		result = jit ? JitRun(&stack, func, ret, numret) : VMExec(&stack, func->Code, ret, numret);
+	}
+	catch (CVMAbortException &)
+	{
+		CVMAbortException::stacktrace = "";
+		result = -2;
+	}
+	stack.PopFrame();
+	return result;
+}
+
+// Compiles every script function for the statistics, but only compares
+// the ones JitIsPure accepts against the interpreter: Anything that loads,
+// stores or calls needs real objects to work on, which can't be made up here.
+CCMD(vmjittest)
+{
+	static const int testints[] = { 0, 1, -1, 2, 7, -100, 65536, 0x7fffffff };
+	static const double testfloats[] = { 0., 1., -1., 0.5, 3.75, -1000.25, 1e10, 1 / 65536. };
+	const int numtests = countof(testints);
+
+	int numfuncs = 0, numcompiled = 0, numops = 0, numnative = 0, numtested = 0, numfailed = 0;
+
+	for (auto vmfunc : VMFunction::AllFunctions)
+	{
+		if (vmfunc->VarFlags & VARF_Native)
+		{
+			continue;
+		}
+		auto func = static_cast<VMScriptFunction *>(vmfunc);
+		if (func->Code == nullptr)
+		{
+			continue;
+		}
+		numfuncs++;
+		numops += func->CodeSize;
+
+		// Functions that already ran keep their code, which can't be freed
+		// because the blocks are shared. Only generate it again for the statistics.
+		int native = 0;
+		if (func->JitTried)
+		{
+			if (func->JitFunc == nullptr)
+			{
+				continue;
+			}
+			FJitCompiler compiler(func);
+			compiler.Generate();
+			native = compiler.NumNative;
+		}
+		else if (!JitCompile(func, &native))
+		{
+			continue;
+		}
+		numcompiled++;
+		numnative += native;
+
+		auto proto = func->Proto;
+		if (proto == nullptr || !JitIsPure(func) || !JitIsNumeric(proto->ArgumentTypes) || !JitIsNumeric(proto->ReturnTypes) ||
+			proto->ReturnTypes.Size() > MAX_RETURNS || (int)proto->ArgumentTypes.Size() != func->NumArgs)
+		{
+			continue;
+		}
+		numtested++;
+
+		for (int test = 0; test < numtests; test++)
+		{
+			VMValue params[256];
+			for (int i = 0; i < func->NumArgs; i++)
+			{
+				int n = (test + i) % numtests;
+				if (proto->ArgumentTypes[i]->GetRegType() == REGT_INT) params[i] = testints[n];
+				else params[i] = testfloats[n];
+			}
+
+			int numret = proto->ReturnTypes.Size();
+			int iresults[2][MAX_RETURNS] = {};
+			double fresults[2][MAX_RETURNS] = {};
+			VMReturn rets[2][MAX_RETURNS];
+			int counts[2];
+			for (int path = 0; path < 2; path++)
+			{
+				for (int i = 0; i < numret; i++)
+				{
+					if (proto->ReturnTypes[i]->GetRegType() == REGT_INT) rets[path][i].IntAt(&iresults[path][i]);
+					else rets[path][i].FloatAt(&fresults[path][i]);
+				}
+				counts[path] = JitTestRun(func, params, rets[path], numret, path == 1);
+			}
+
+			if (counts[0] != counts[1] || memcmp(iresults[0], iresults[1], sizeof(iresults[0])) != 0 ||
+				memcmp(fresults[0], fresults[1], sizeof(fresults[0])) != 0)
+			{
+				Printf(TEXTCOLOR_RED "%s: JIT and interpreter differ for argument set %d\n", func->PrintableName.GetChars(), test);
+				numfailed++;
+				break;
+			}
+		}
+	}
+
+	Printf("%d of %d script functions compiled, %d of %d instructions native (%.1f%%)\n",
+		numcompiled, numfuncs, numnative, numops, numops > 0 ? numnative * 100. / numops : 0.);
+	Printf("%d pure numeric functions compared against the interpreter, %d mismatches\n", numtested, numfailed);
+}
+
+#endif
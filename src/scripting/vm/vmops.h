@@ -103,7 +103,9 @@ xx(PARAM,	param,	__BCP,		NOP,	0, 0),		// push parameter encoded in BC for functi
 xx(PARAMI,	parami,	I24,		NOP,	0, 0),		// push immediate, signed integer for function call
 xx(CALL,	call,	RPI8I8,		NOP,	0, 0),	// Call function pkA with parameter count B and expected result count C
 xx(CALL_K,	call,	KPI8I8,		CALL,	1, REGT_POINTER),
+xx(CALL_N,	calln,	KPI8I8,		NOP,	0, 0),		// Call native kA directly with B arguments and C results; the B following PARAMs only say where the arguments are
 xx(VTBL,	vtbl,	RPRPI8,		NOP,	0, 0),	// dereferences a virtual method table.
+xx(VTBL_K,	vtbl,	RPRPKP,		NOP,	0, 0),		// same as VTBL, but looks up the function through the inline cache kC
 xx(SCOPE,	scope,	RPI8,		NOP,	0, 0),		// Scope check at runtime.
 xx(TAIL,	tail,	RPI8,		NOP,	0, 0),		// Call+Ret in a single instruction
 xx(TAIL_K,	tail,	KPI8,		TAIL,	1, REGT_POINTER),
@@ -202,7 +204,7 @@ xx(DIVF_RK,		div,	RFRFKF,		DIVF_RR,4, REGT_FLOAT),
 xx(DIVF_KR,		div,	RFKFRF,		DIVF_RR,2, REGT_FLOAT),
 xx(MODF_RR,		mod,	RFRFRF,		NOP,	0, 0),		// fA = fkB % fkC
 xx(MODF_RK,		mod,	RFRFKF,		MODF_RR,4, REGT_FLOAT),
-xx(MODF_KR,		mod,	RFKFRF,		MODF_RR,4, REGT_FLOAT),
+xx(MODF_KR,		mod,	RFKFRF,		MODF_RR,2, REGT_FLOAT),
 xx(POWF_RR,		pow,	RFRFRF,		NOP,	0, 0),		// fA = fkB ** fkC
 xx(POWF_RK,		pow,	RFRFKF,		POWF_RR,4, REGT_FLOAT),
 xx(POWF_KR,		pow,	RFKFRF,		POWF_RR,2, REGT_FLOAT),
@@ -255,4 +257,11 @@ xx(SUBA,		sub,	RIRPRP,		NOP,	0, 0),		// dA = pB - pC
 xx(EQA_R,		beq,	CPRR,		NOP,	0, 0),			// if ((pB == pkC) != A) then pc++
 xx(EQA_K,		beq,	CPRK,		EQA_R,	4, REGT_POINTER),
 
+// Fused loads and tests against zero. These are only created by the optimizer, from a load into a register that dies at the following compare.
+xx(EQ_LB,		beqlb,	CPKI,		NOP,	0, 0),			// if ((*(pB + kC) == 0) != A) then pc++	-- byte
+xx(EQ_LW,		beqlw,	CPKI,		NOP,	0, 0),			// if ((*(pB + kC) == 0) != A) then pc++	-- word
+xx(EQ_LBIT,		beqbit,	CPI8,		NOP,	0, 0),			// if (((*pB & C) == 0) != A) then pc++
+xx(EQA_LP,		beqlp,	CPKI,		NOP,	0, 0),			// if ((*(pB + kC) == NULL) != A) then pc++	-- pointer
+xx(EQA_LO,		beqlo,	CPKI,		NOP,	0, 0),			// if ((*(pB + kC) == NULL) != A) then pc++	-- object pointer with read barrier
+
 #undef xx
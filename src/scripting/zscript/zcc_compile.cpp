@@ -2617,6 +2617,34 @@ void ZCCCompiler::CompileFunction(ZCC_StructWork *c, ZCC_FuncDeclarator *f, bool
 		sym->AddVariant(NewPrototype(rets, args), argflags, argnames, afd == nullptr ? nullptr : *(afd->VMPointer), varflags, useflags);
 		c->Type()->Symbols.ReplaceSymbol(sym);
 
+		if (afd != nullptr && afd->DirectSignature != nullptr)
+		{
+			// The direct entry point receives each argument's register as is, so every parameter must fit into one
+			// of the registers the native expects.
+			auto sig = afd->DirectSignature;
+			bool match = !(varflags & VARF_VarArg) && rets.Size() == (sig[0] == REGT_NIL ? 0u : 1u) && args.Size() == sig[1];
+			if (match && rets.Size() == 1)
+			{
+				match = rets[0]->GetRegType() == sig[0] && rets[0]->GetRegCount() == 1;
+			}
+			for (unsigned i = 0; match && i < args.Size(); i++)
+			{
+				match = args[i] != nullptr && args[i]->GetRegType() == sig[2 + i] && args[i]->GetRegCount() == 1 && !(argflags[i] & (VARF_Out | VARF_Ref));
+			}
+			auto func = *afd->VMPointer;
+			if (match)
+			{
+				func->DirectNativeCall = afd->DirectNativeCall;
+				func->DirectInvoker = afd->DirectInvoker;
+			}
+			else
+			{
+				func->DirectNativeCall = nullptr;
+				func->DirectInvoker = nullptr;
+				Error(f, "The direct entry point of '%s.%s' does not match its declaration", c->Type()->TypeName.GetChars(), FName(f->Name).GetChars());
+			}
+		}
+
 		auto vcls = PType::toClass(c->Type());
 		auto cls = vcls ? vcls->Descriptor : nullptr;
 		PFunction *virtsym = nullptr;
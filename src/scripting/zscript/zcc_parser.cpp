@@ -261,6 +261,7 @@ static void ParseSingleFile(FScanner *pSC, const char *filename, int lump, void
 		pSC = &lsc;
 	}
 	FScanner &sc = *pSC;
+	FunctionBuildList.AddScriptLump(lump);
 	sc.SetParseVersion(state.ParseVersion);
 	state.sc = &sc;
 